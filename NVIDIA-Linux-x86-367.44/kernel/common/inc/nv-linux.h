@@ -1364,6 +1364,7 @@ typedef struct nvidia_pte_s {
     unsigned int    guest_pfn;
 #endif
     unsigned int    page_count;
+    unsigned int    order;      /* order of the system memory chunk starting at this page */
 } nvidia_pte_t;
 
 typedef struct nv_alloc_s {
@@ -1378,6 +1379,7 @@ typedef struct nv_alloc_s {
     unsigned int   pid;
     struct page  **user_pages;
     NvU64         guest_id;             /* id of guest VM */
+    unsigned int  num_chunks;           /* physically contiguous chunks backing system allocations */
 } nv_alloc_t;
 
 #define NV_ALLOC_TYPE_PCI      (1<<0)
@@ -68,6 +68,11 @@ void        nv_mem_pool_destroy         (void);
 void *      nv_mem_pool_alloc_pages     (NvU32);
 void        nv_mem_pool_free_pages      (void *, NvU32);
 
+#if defined(DEBUG)
+int         nv_lock_user_pages_self_test(void);
+int         nv_alloc_system_pages_self_test(struct pci_dev *);
+#endif
+
 NvUPtr      nv_vm_map_pages             (struct page **, NvU32, NvBool);
 void        nv_vm_unmap_pages           (NvUPtr, NvU32);
 
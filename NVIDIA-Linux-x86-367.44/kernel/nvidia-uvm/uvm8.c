@@ -629,6 +629,8 @@ static long uvm_unlocked_ioctl(struct file *filp, unsigned int cmd, unsigned lon
         UVM_ROUTE_CMD_STACK(UVM_ENABLE_READ_DUPLICATION,        uvm_api_enable_read_duplication);
         UVM_ROUTE_CMD_STACK(UVM_DISABLE_READ_DUPLICATION,       uvm_api_disable_read_duplication);
         UVM_ROUTE_CMD_STACK(UVM_MIGRATE,                        uvm_api_migrate);
+        UVM_ROUTE_CMD_STACK(UVM_MIGRATE_BATCH,                  uvm_api_migrate_batch);
+        UVM_ROUTE_CMD_STACK(UVM_GET_VA_BLOCK_HEATMAP,           uvm_api_get_va_block_heatmap);
         UVM_ROUTE_CMD_STACK(UVM_ENABLE_SYSTEM_WIDE_ATOMICS,     uvm_api_enable_system_wide_atomics);
         UVM_ROUTE_CMD_STACK(UVM_DISABLE_SYSTEM_WIDE_ATOMICS,    uvm_api_disable_system_wide_atomics);
         UVM_ROUTE_CMD_STACK(UVM_TOOLS_READ_PROCESS_MEMORY,      uvm_api_tools_read_process_memory);
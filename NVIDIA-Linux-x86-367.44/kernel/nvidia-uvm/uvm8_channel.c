@@ -38,6 +38,24 @@
 // Likely also using different number of channels for different pools.
 #define UVM_CHANNELS_PER_POOL 2
 
+// Maximum number of CEs the channels of each copy pool (CPU to GPU, GPU to CPU,
+// GPU internal and GPU to GPU) are spread across. Each CE gets
+// UVM_CHANNELS_PER_POOL channels of the pool and pushes are reserved on the
+// least loaded channel, so the copies of independent VA blocks are striped
+// across the CEs. 1 disables striping.
+#define UVM_CHANNEL_COPY_CE_STRIPE_WIDTH_DEFAULT 2
+
+static unsigned uvm_channel_copy_ce_stripe_width = UVM_CHANNEL_COPY_CE_STRIPE_WIDTH_DEFAULT;
+module_param(uvm_channel_copy_ce_stripe_width, uint, S_IRUGO);
+
+// When set, pushes ended concurrently on the same channel are submitted with a
+// single GPPut write by the last thread to end its push, instead of one write
+// per push. A push can then wait for the submission of the pushes ended right
+// after it, but only for as long as those threads spin on the channel lock
+// with preemption disabled.
+static unsigned uvm_channel_coalesce_doorbells = 0;
+module_param(uvm_channel_coalesce_doorbells, uint, S_IRUGO);
+
 static NV_STATUS manager_create_procfs_dirs(uvm_channel_manager_t *manager);
 static NV_STATUS manager_create_procfs(uvm_channel_manager_t *manager);
 static NV_STATUS channel_create_procfs(uvm_channel_t *channel);
@@ -52,6 +70,20 @@ typedef enum
     UVM_CHANNEL_UPDATE_MODE_FORCE_ALL
 } uvm_channel_update_mode_t;
 
+// A channel preferred by the caller of uvm_channel_reserve_type_preferred() is
+// used as long as it doesn't have more than this many pending pushes over the
+// least loaded channel of the type.
+#define UVM_CHANNEL_PREFERRED_MAX_EXTRA_PUSHES 4
+
+// Time spent spinning for a channel to become available before napping
+// between the checks.
+#define UVM_CHANNEL_RESERVE_SPIN_NS (50 * 1000ULL)
+
+// Length of each nap between the checks once done spinning. Completions don't
+// raise an interrupt, so the channels have to be polled and the naps are kept
+// short.
+#define UVM_CHANNEL_RESERVE_NAP_US 10
+
 // Update channel progress, completing up to max_to_complete entries
 static NvU32 uvm_channel_update_progress_with_max(uvm_channel_t *channel,
                                                   NvU32 max_to_complete,
@@ -64,7 +96,7 @@ static NvU32 uvm_channel_update_progress_with_max(uvm_channel_t *channel,
 
     NvU64 completed_value = uvm_channel_update_completed_value(channel);
 
-    uvm_spin_lock(&channel->pool->lock);
+    uvm_spin_lock(&channel->lock);
 
     cpu_put = channel->cpu_put;
     gpu_get = channel->gpu_get;
@@ -82,7 +114,7 @@ static NvU32 uvm_channel_update_progress_with_max(uvm_channel_t *channel,
 
     channel->gpu_get = gpu_get;
 
-    uvm_spin_unlock(&channel->pool->lock);
+    uvm_spin_unlock(&channel->lock);
 
     if (cpu_put >= gpu_get)
         pending_gpfifos = cpu_put - gpu_get;
@@ -126,7 +158,7 @@ static bool is_channel_available(uvm_channel_t *channel)
 {
     NvU32 next_put;
 
-    uvm_assert_spinlock_locked(&channel->pool->lock);
+    uvm_assert_spinlock_locked(&channel->lock);
 
     next_put = (channel->cpu_put + channel->current_pushes_count + 1) % channel->channel_info.numGpFifoEntries;
 
@@ -137,52 +169,157 @@ static bool try_claim_channel(uvm_channel_t *channel)
 {
     bool claimed = false;
 
-    uvm_spin_lock(&channel->pool->lock);
+    uvm_spin_lock(&channel->lock);
 
     if (is_channel_available(channel)) {
         ++channel->current_pushes_count;
         claimed = true;
     }
 
-    uvm_spin_unlock(&channel->pool->lock);
+    uvm_spin_unlock(&channel->lock);
 
     return claimed;
 }
 
-NV_STATUS uvm_channel_reserve_type(uvm_channel_manager_t *channel_manager, uvm_channel_type_t type, uvm_channel_t **channel_out)
+// Get the number of pushes on the channel that are either on-going or
+// submitted but not completed yet. Returns false if the channel doesn't have a
+// GPFIFO entry available for a new push.
+static bool channel_get_load(uvm_channel_t *channel, NvU64 *load)
+{
+    bool available;
+    NvU64 completed_value = uvm_channel_update_completed_value(channel);
+
+    uvm_spin_lock(&channel->lock);
+
+    available = is_channel_available(channel);
+    *load = channel->tracking_sem.queued_value - completed_value + channel->current_pushes_count;
+
+    uvm_spin_unlock(&channel->lock);
+
+    return available;
+}
+
+// Pick the available channel of the given type with the fewest pending
+// pushes, or the preferred channel if it is available and not much busier.
+// Returns NULL if no channel of the type is available.
+static uvm_channel_t *channel_pick_least_loaded(uvm_channel_manager_t *channel_manager,
+                                                uvm_channel_type_t type,
+                                                uvm_channel_t *preferred_channel,
+                                                bool *picked_preferred)
 {
-    NV_STATUS status;
     uvm_channel_t *channel;
-    uvm_spin_loop_t spin;
+    uvm_channel_t *best_channel = NULL;
+    NvU64 best_load = ~0ULL;
+    NvU64 preferred_load = 0;
+    bool preferred_available = false;
 
     uvm_for_each_channel_of_type(channel, channel_manager, type) {
-        // TODO: Bug 1764953: Prefer idle/less busy channels
-        if (try_claim_channel(channel)) {
-            *channel_out = channel;
-            return NV_OK;
+        NvU64 load;
+
+        if (!channel_get_load(channel, &load))
+            continue;
+
+        if (channel == preferred_channel) {
+            preferred_available = true;
+            preferred_load = load;
+        }
+
+        if (load < best_load) {
+            best_channel = channel;
+            best_load = load;
         }
     }
 
+    *picked_preferred = preferred_available &&
+                        preferred_load <= best_load + UVM_CHANNEL_PREFERRED_MAX_EXTRA_PUSHES;
+    if (*picked_preferred)
+        return preferred_channel;
+
+    return best_channel;
+}
+
+static bool channel_try_claim_least_loaded(uvm_channel_manager_t *channel_manager,
+                                           uvm_channel_type_t type,
+                                           uvm_channel_t *preferred_channel,
+                                           uvm_channel_t **channel_out)
+{
+    bool picked_preferred;
+    uvm_channel_t *channel = channel_pick_least_loaded(channel_manager, type, preferred_channel, &picked_preferred);
+
+    // The channel can be claimed by another thread after being picked. The
+    // caller retries in that case.
+    if (!channel || !try_claim_channel(channel))
+        return false;
+
+    uvm_spin_lock(&channel->lock);
+
+    if (picked_preferred)
+        ++channel->stats.preferred_reservations;
+    else
+        ++channel->stats.least_loaded_reservations;
+
+    uvm_spin_unlock(&channel->lock);
+
+    *channel_out = channel;
+
+    return true;
+}
+
+NV_STATUS uvm_channel_reserve_type_preferred(uvm_channel_manager_t *channel_manager,
+                                             uvm_channel_type_t type,
+                                             uvm_channel_t *preferred_channel,
+                                             uvm_channel_t **channel_out)
+{
+    NV_STATUS status;
+    uvm_channel_t *channel;
+    uvm_spin_loop_t spin;
+    NvU64 wait_ns;
+
+    UVM_ASSERT(!preferred_channel || preferred_channel->pool->manager == channel_manager);
+    UVM_ASSERT(!preferred_channel ||
+               type == UVM_CHANNEL_TYPE_ANY ||
+               preferred_channel->pool->channel_type == type);
+
+    if (channel_try_claim_least_loaded(channel_manager, type, preferred_channel, channel_out))
+        return NV_OK;
+
+    // All the channels are busy. Spin for a short while as GPFIFO entries are
+    // likely to free up soon, and then nap between the checks.
     uvm_spin_loop_init(&spin);
     while (1) {
-        uvm_for_each_channel_of_type(channel, channel_manager, type) {
-            uvm_channel_update_progress(channel);
-
-            if (try_claim_channel(channel)) {
-                *channel_out = channel;
-                return NV_OK;
-            }
+        uvm_channel_manager_update_progress(channel_manager);
 
+        uvm_for_each_channel_of_type(channel, channel_manager, type) {
             status = uvm_channel_check_errors(channel);
             if (status != NV_OK)
                 return status;
-
-            UVM_SPIN_LOOP(&spin);
         }
+
+        if (channel_try_claim_least_loaded(channel_manager, type, preferred_channel, channel_out))
+            break;
+
+        if (NV_MAY_SLEEP() && NV_GETTIME() - spin.start_time_ns >= UVM_CHANNEL_RESERVE_SPIN_NS)
+            usleep_range(UVM_CHANNEL_RESERVE_NAP_US, 2 * UVM_CHANNEL_RESERVE_NAP_US);
+
+        UVM_SPIN_LOOP(&spin);
     }
 
-    UVM_ASSERT_MSG(0, "Cannot get here?!\n");
-    return NV_ERR_GENERIC;
+    wait_ns = NV_GETTIME() - spin.start_time_ns;
+    channel = *channel_out;
+
+    uvm_spin_lock(&channel->lock);
+
+    ++channel->stats.reservation_waits;
+    channel->stats.reservation_wait_ns += wait_ns;
+
+    uvm_spin_unlock(&channel->lock);
+
+    return NV_OK;
+}
+
+NV_STATUS uvm_channel_reserve_type(uvm_channel_manager_t *channel_manager, uvm_channel_type_t type, uvm_channel_t **channel_out)
+{
+    return uvm_channel_reserve_type_preferred(channel_manager, type, NULL, channel_out);
 }
 
 NV_STATUS uvm_channel_manager_wait(uvm_channel_manager_t *manager)
@@ -206,12 +343,12 @@ static NvU32 channel_get_next_push_info_index(uvm_channel_t *channel)
 {
     NvU32 push_info_index;
 
-    uvm_spin_lock(&channel->pool->lock);
+    uvm_spin_lock(&channel->lock);
 
     push_info_index = channel->next_push_info_index;
     channel->next_push_info_index = (channel->next_push_info_index + 1) % channel->channel_info.numGpFifoEntries;
 
-    uvm_spin_unlock(&channel->pool->lock);
+    uvm_spin_unlock(&channel->lock);
 
     return push_info_index;
 }
@@ -252,10 +389,21 @@ void uvm_channel_end_push(uvm_push_t *push)
     NvU32 cpu_put;
     NvU32 new_cpu_put;
     NvU64 *gpfifo_entry;
+    bool write_gpu_put;
 
     BUILD_BUG_ON(sizeof(*gpfifo_entry) != NVA06F_GP_ENTRY__SIZE);
 
-    uvm_spin_lock(&channel->pool->lock);
+    // Announce the push before waiting for the lock so that the thread holding
+    // it knows that a GPPut write will follow its own. Preemption stays
+    // disabled until the lock is dropped, otherwise a thread preempted between
+    // the announcement and taking the lock would delay the submission of the
+    // pushes whose GPPut write it was counted on to do.
+    if (uvm_channel_coalesce_doorbells) {
+        preempt_disable();
+        atomic_inc(&channel->ending_pushes_count);
+    }
+
+    uvm_spin_lock(&channel->lock);
 
     new_tracking_value = ++channel->tracking_sem.queued_value;
     new_payload = (NvU32)new_tracking_value;
@@ -280,6 +428,12 @@ void uvm_channel_end_push(uvm_push_t *push)
     UVM_ASSERT(channel->current_pushes_count > 0);
     --channel->current_pushes_count;
 
+    ++channel->stats.pushes;
+    channel->stats.pushbuffer_bytes += push_size;
+    channel->stats.max_pending_gpfifos = max(channel->stats.max_pending_gpfifos,
+                                             (new_cpu_put + channel->channel_info.numGpFifoEntries - channel->gpu_get) %
+                                             channel->channel_info.numGpFifoEntries);
+
     gpu->host_hal->set_gpfifo_entry(gpfifo_entry, pushbuffer_va, push_size);
 
     // Need to make sure all the pushbuffer and the GPFIFO entries writes
@@ -289,9 +443,20 @@ void uvm_channel_end_push(uvm_push_t *push)
     mb();
 
     channel->cpu_put = new_cpu_put;
-    gpu->host_hal->write_gpu_put(channel, new_cpu_put);
 
-    uvm_spin_unlock(&channel->pool->lock);
+    // With doorbell coalescing, only the last of the threads ending pushes
+    // concurrently writes GPPut. The GPFIFO entries of the others are already
+    // visible (see the mb() above) and are submitted by that write.
+    write_gpu_put = !uvm_channel_coalesce_doorbells || atomic_dec_and_test(&channel->ending_pushes_count);
+    if (write_gpu_put) {
+        gpu->host_hal->write_gpu_put(channel, new_cpu_put);
+        ++channel->stats.doorbells;
+    }
+
+    uvm_spin_unlock(&channel->lock);
+
+    if (uvm_channel_coalesce_doorbells)
+        preempt_enable();
 
     uvm_pushbuffer_end_push(pushbuffer, push, entry);
 
@@ -334,12 +499,12 @@ static uvm_gpfifo_entry_t *uvm_channel_get_first_pending_entry(uvm_channel_t *ch
     if (pending_count == 0)
         return NULL;
 
-    uvm_spin_lock(&channel->pool->lock);
+    uvm_spin_lock(&channel->lock);
 
     if (channel->gpu_get != channel->cpu_put)
         entry = &channel->gpfifo_entries[channel->gpu_get];
 
-    uvm_spin_unlock(&channel->pool->lock);
+    uvm_spin_unlock(&channel->lock);
 
     return entry;
 }
@@ -426,13 +591,12 @@ NvU64 uvm_channel_update_completed_value(uvm_channel_t *channel)
 
 static void destroy_channel(uvm_channel_t *channel);
 
-static NV_STATUS create_channel(uvm_channel_pool_t *pool, bool with_procfs, uvm_channel_t **channel_out)
+static NV_STATUS create_channel(uvm_channel_pool_t *pool, NvU32 ce_index, bool with_procfs, uvm_channel_t **channel_out)
 {
     NV_STATUS status;
     uvm_channel_t *channel = NULL;
     uvmGpuCopyEngineHandle ce_handle;
     uvm_gpu_t *gpu = pool->manager->gpu;
-    NvU32 ce_index = pool->manager->ce_to_use_by_type[pool->channel_type];
 
     UVM_ASSERT(ce_index < UVM_COPY_ENGINE_COUNT_MAX);
 
@@ -443,6 +607,9 @@ static NV_STATUS create_channel(uvm_channel_pool_t *pool, bool with_procfs, uvm_
     }
 
     channel->pool = pool;
+    channel->ce_index = ce_index;
+    uvm_spin_lock_init(&channel->lock, UVM_LOCK_ORDER_CHANNEL);
+    atomic_set(&channel->ending_pushes_count, 0);
 
     status = uvm_gpu_tracking_semaphore_alloc(gpu->semaphore_pool, &channel->tracking_sem);
     if (status != NV_OK) {
@@ -532,12 +699,17 @@ static void destroy_channel(uvm_channel_t *channel)
     uvm_kvfree(channel);
 }
 
-static NV_STATUS create_channel_pool(uvm_channel_manager_t *channel_manager, uvm_channel_type_t channel_type, NvU32 count, bool with_procfs)
+static NV_STATUS create_channel_pool(uvm_channel_manager_t *channel_manager,
+                                     uvm_channel_type_t channel_type,
+                                     NvU32 channels_per_ce,
+                                     bool with_procfs)
 {
     NV_STATUS status = NV_OK;
     NvU32 i;
     uvm_channel_t *channel;
     uvm_channel_pool_t *pool = &channel_manager->channel_pools[channel_type];
+    NvU32 stripe_width = channel_manager->ce_stripe_width_by_type[channel_type];
+    NvU32 count = channels_per_ce * stripe_width;
 
     UVM_ASSERT_MSG(channel_type < UVM_CHANNEL_TYPE_COUNT, "type %u\n", channel_type);
     UVM_ASSERT(channel_type != UVM_CHANNEL_TYPE_ANY);
@@ -545,11 +717,14 @@ static NV_STATUS create_channel_pool(uvm_channel_manager_t *channel_manager, uvm
     pool->manager = channel_manager;
     pool->channel_type = channel_type;
 
-    uvm_spin_lock_init(&pool->lock, UVM_LOCK_ORDER_CHANNEL);
     INIT_LIST_HEAD(&pool->channels_list);
 
+    // Interleave the CEs in the pool so that the least loaded channel picks
+    // rotate across them when all the channels are idle.
     for (i = 0; i < count; ++i) {
-        status = create_channel(pool, with_procfs, &channel);
+        NvU32 ce_index = channel_manager->ce_stripe_by_type[channel_type][i % stripe_width];
+
+        status = create_channel(pool, ce_index, with_procfs, &channel);
         if (status != NV_OK)
             goto error;
 
@@ -568,9 +743,9 @@ uvm_channel_t *uvm_channel_manager_find_available_channel(uvm_channel_manager_t
     uvm_for_each_channel(channel, channel_manager) {
         bool available;
 
-        uvm_spin_lock(&channel->pool->lock);
+        uvm_spin_lock(&channel->lock);
         available = is_channel_available(channel);
-        uvm_spin_unlock(&channel->pool->lock);
+        uvm_spin_unlock(&channel->lock);
 
         if (available)
             return channel;
@@ -725,6 +900,68 @@ static void pick_ce_for_channel_type(uvm_channel_manager_t *manager, uvm_channel
     manager->ce_to_use_by_type[type] = best_ce;
 }
 
+static bool channel_type_can_stripe(uvm_channel_type_t type)
+{
+    // MEMOPS pushes are small and latency sensitive, so they stay on a single
+    // CE.
+    return type == UVM_CHANNEL_TYPE_CPU_TO_GPU ||
+           type == UVM_CHANNEL_TYPE_GPU_TO_CPU ||
+           type == UVM_CHANNEL_TYPE_GPU_INTERNAL ||
+           type == UVM_CHANNEL_TYPE_GPU_TO_GPU;
+}
+
+// Pick the CEs the channels of the given type are spread across. The first one
+// is the CE picked by pick_ce_for_channel_type() and the rest are the next best
+// usable CEs in the order of compare_ce_for_channel_type(). The extra CEs don't
+// count towards the usage count, so they don't affect the CEs picked for the
+// other channel types.
+static void pick_ce_stripe_for_channel_type(uvm_channel_manager_t *manager,
+                                            uvm_channel_type_t type,
+                                            NvU32 stripe_width,
+                                            NvU32 *usage_count)
+{
+    uvm_gpu_t *gpu = manager->gpu;
+    NvU32 *stripe = manager->ce_stripe_by_type[type];
+    NvU32 width = 1;
+
+    UVM_ASSERT(manager->ce_to_use_by_type[type] < UVM_COPY_ENGINE_COUNT_MAX);
+
+    stripe[0] = manager->ce_to_use_by_type[type];
+
+    if (!channel_type_can_stripe(type))
+        stripe_width = 1;
+
+    while (width < stripe_width) {
+        NvU32 i;
+        NvU32 best_ce = UVM_COPY_ENGINE_COUNT_MAX;
+
+        for (i = 0; i < UVM_COPY_ENGINE_COUNT_MAX; ++i) {
+            NvU32 j;
+            bool in_stripe = false;
+
+            if (!ce_usable_for_channel_type(type, &gpu->ce_caps[i]))
+                continue;
+
+            for (j = 0; j < width; ++j)
+                in_stripe = in_stripe || stripe[j] == i;
+
+            if (in_stripe)
+                continue;
+
+            if (best_ce == UVM_COPY_ENGINE_COUNT_MAX ||
+                compare_ce_for_channel_type(gpu, type, i, best_ce, usage_count) < 0)
+                best_ce = i;
+        }
+
+        if (best_ce == UVM_COPY_ENGINE_COUNT_MAX)
+            break;
+
+        stripe[width++] = best_ce;
+    }
+
+    manager->ce_stripe_width_by_type[type] = width;
+}
+
 static NV_STATUS channel_manager_pick_copy_engines(uvm_channel_manager_t *manager)
 {
     uvm_gpu_t *gpu = manager->gpu;
@@ -732,6 +969,13 @@ static NV_STATUS channel_manager_pick_copy_engines(uvm_channel_manager_t *manage
 
     // Per CE usage count so far
     NvU32 usage_count[UVM_COPY_ENGINE_COUNT_MAX] = {0};
+    NvU32 stripe_width = uvm_channel_copy_ce_stripe_width;
+
+    if (stripe_width == 0 || stripe_width > UVM_COPY_ENGINE_COUNT_MAX) {
+        pr_info("Invalid value %u for uvm_channel_copy_ce_stripe_width. Using %u instead\n",
+                uvm_channel_copy_ce_stripe_width, UVM_CHANNEL_COPY_CE_STRIPE_WIDTH_DEFAULT);
+        stripe_width = UVM_CHANNEL_COPY_CE_STRIPE_WIDTH_DEFAULT;
+    }
 
     for (i = 0; i < UVM_CHANNEL_TYPE_COUNT; ++i)
         manager->ce_to_use_by_type[i] = UVM_COPY_ENGINE_COUNT_MAX;
@@ -755,6 +999,8 @@ static NV_STATUS channel_manager_pick_copy_engines(uvm_channel_manager_t *manage
                     uvm_channel_type_to_string(i), gpu->name);
             return NV_ERR_NOT_SUPPORTED;
         }
+
+        pick_ce_stripe_for_channel_type(manager, (uvm_channel_type_t)i, stripe_width, usage_count);
     }
 
     return NV_OK;
@@ -774,10 +1020,6 @@ NV_STATUS uvm_channel_manager_create_common(uvm_gpu_t *gpu, bool with_procfs, uv
     channel_manager->gpu = gpu;
     INIT_LIST_HEAD(&channel_manager->all_channels_list);
 
-    status = uvm_pushbuffer_create_common(channel_manager, with_procfs, &channel_manager->pushbuffer);
-    if (status != NV_OK)
-        goto error;
-
     if (with_procfs) {
         status = manager_create_procfs_dirs(channel_manager);
         if (status != NV_OK)
@@ -798,6 +1040,12 @@ NV_STATUS uvm_channel_manager_create_common(uvm_gpu_t *gpu, bool with_procfs, uv
             goto error;
     }
 
+    // The pushbuffer is sized based on the number of channels so it's created
+    // after the channels, but before any pushes are done in init_channels().
+    status = uvm_pushbuffer_create_common(channel_manager, with_procfs, &channel_manager->pushbuffer);
+    if (status != NV_OK)
+        goto error;
+
     status = init_channels(channel_manager);
     if (status != NV_OK)
         goto error;
@@ -857,9 +1105,14 @@ const char *uvm_channel_type_to_string(uvm_channel_type_t channel_type)
 
 static void uvm_channel_print_info(uvm_channel_t *channel, struct seq_file *s)
 {
+    NvU32 pending_gpfifos;
+
     UVM_SEQ_OR_DBG_PRINT(s, "Channel %s\n", channel->name);
 
-    uvm_spin_lock(&channel->pool->lock);
+    uvm_spin_lock(&channel->lock);
+
+    pending_gpfifos = (channel->cpu_put + channel->channel_info.numGpFifoEntries - channel->gpu_get) %
+                      channel->channel_info.numGpFifoEntries;
 
     UVM_SEQ_OR_DBG_PRINT(s, "completed          %llu\n", uvm_channel_update_completed_value(channel));
     UVM_SEQ_OR_DBG_PRINT(s, "queued             %llu\n", channel->tracking_sem.queued_value);
@@ -868,8 +1121,18 @@ static void uvm_channel_print_info(uvm_channel_t *channel, struct seq_file *s)
     UVM_SEQ_OR_DBG_PRINT(s, "put                %u\n", channel->cpu_put);
     UVM_SEQ_OR_DBG_PRINT(s, "Semaphore GPU VA   0x%llx\n", uvm_gpu_semaphore_get_gpu_va(&channel->tracking_sem.semaphore,
                                                                                         uvm_channel_get_gpu(channel)));
-
-    uvm_spin_unlock(&channel->pool->lock);
+    UVM_SEQ_OR_DBG_PRINT(s, "pending GPFIFOs    %u\n", pending_gpfifos);
+    UVM_SEQ_OR_DBG_PRINT(s, "max pending        %u\n", channel->stats.max_pending_gpfifos);
+    UVM_SEQ_OR_DBG_PRINT(s, "on-going pushes    %u\n", channel->current_pushes_count);
+    UVM_SEQ_OR_DBG_PRINT(s, "pushes             %llu\n", channel->stats.pushes);
+    UVM_SEQ_OR_DBG_PRINT(s, "pushbuffer bytes   %llu\n", channel->stats.pushbuffer_bytes);
+    UVM_SEQ_OR_DBG_PRINT(s, "doorbells          %llu\n", channel->stats.doorbells);
+    UVM_SEQ_OR_DBG_PRINT(s, "least loaded picks %llu\n", channel->stats.least_loaded_reservations);
+    UVM_SEQ_OR_DBG_PRINT(s, "preferred picks    %llu\n", channel->stats.preferred_reservations);
+    UVM_SEQ_OR_DBG_PRINT(s, "reserve waits      %llu\n", channel->stats.reservation_waits);
+    UVM_SEQ_OR_DBG_PRINT(s, "reserve wait ns    %llu\n", channel->stats.reservation_wait_ns);
+
+    uvm_spin_unlock(&channel->lock);
 }
 
 // Print all pending pushes and up to finished_pushes_count completed if their
@@ -881,7 +1144,7 @@ static void channel_print_pushes(uvm_channel_t *channel, NvU32 finished_pushes_c
 
     NvU64 completed_value = uvm_channel_update_completed_value(channel);
 
-    uvm_spin_lock(&channel->pool->lock);
+    uvm_spin_lock(&channel->lock);
 
     cpu_put = channel->cpu_put;
 
@@ -897,7 +1160,7 @@ static void channel_print_pushes(uvm_channel_t *channel, NvU32 finished_pushes_c
                 push_info->description, push_info->filename, push_info->line, push_info->function,
                 entry->tracking_semaphore_value);
     }
-    uvm_spin_unlock(&channel->pool->lock);
+    uvm_spin_unlock(&channel->lock);
 }
 
 void uvm_channel_print_pending_pushes(uvm_channel_t *channel)
@@ -103,9 +103,6 @@ typedef struct
 
     // List of the channels in the pool
     struct list_head channels_list;
-
-    // Lock protecting the state of channels in the pool
-    uvm_spinlock_t lock;
 } uvm_channel_pool_t;
 
 struct uvm_channel_struct
@@ -116,6 +113,17 @@ struct uvm_channel_struct
     // The channel type and HW channel ID as string for easy debugging and logs
     char name[64];
 
+    // Index of the CE the channel pushes its work to
+    NvU32 ce_index;
+
+    // Lock protecting the state of the channel. Each channel has its own lock
+    // so that pushes to different channels of the same pool don't serialize.
+    uvm_spinlock_t lock;
+
+    // Number of threads in uvm_channel_end_push() for this channel, used to
+    // coalesce their GPPut writes when uvm_channel_coalesce_doorbells is set.
+    atomic_t ending_pushes_count;
+
     // Array of gpfifo entries, one per each HW GPFIFO
     uvm_gpfifo_entry_t *gpfifo_entries;
 
@@ -161,6 +169,37 @@ struct uvm_channel_struct
     // notifier etc.
     UvmGpuChannelPointers channel_info;
 
+    // Utilization statistics reported in the channel procfs info file.
+    // Protected by the channel lock.
+    struct
+    {
+        // Number of pushes submitted to the channel
+        NvU64 pushes;
+
+        // Total size of the pushes submitted to the channel
+        NvU64 pushbuffer_bytes;
+
+        // Number of GPPut writes. Lower than the number of pushes if several
+        // pushes were submitted by a single doorbell.
+        NvU64 doorbells;
+
+        // Largest number of pending GPFIFO entries seen on push submission
+        NvU32 max_pending_gpfifos;
+
+        // Number of reservations by uvm_channel_reserve_type_preferred() that
+        // picked the channel as the least loaded one or as the preferred one
+        NvU64 least_loaded_reservations;
+
+        NvU64 preferred_reservations;
+
+        // Number of reservations that had to wait for all the channels of the
+        // type to become available and ended up claiming this channel, and
+        // the total time they waited
+        NvU64 reservation_waits;
+
+        NvU64 reservation_wait_ns;
+    } stats;
+
     struct
     {
         struct proc_dir_entry *dir;
@@ -184,6 +223,15 @@ struct uvm_channel_manager_struct
     // Initialized in channel_manager_pick_copy_engines()
     NvU32 ce_to_use_by_type[UVM_CHANNEL_TYPE_COUNT];
 
+    // CEs the channels of each pool are spread across, starting with
+    // ce_to_use_by_type. Copy pools can use several CEs so that independent
+    // copies, like the ones of different VA blocks of a large migration, run
+    // in parallel on all of them. See uvm_channel_copy_ce_stripe_width.
+    // Initialized in channel_manager_pick_copy_engines()
+    NvU32 ce_stripe_by_type[UVM_CHANNEL_TYPE_COUNT][UVM_COPY_ENGINE_COUNT_MAX];
+
+    NvU32 ce_stripe_width_by_type[UVM_CHANNEL_TYPE_COUNT];
+
     // List of all channels
     struct list_head all_channels_list;
 
@@ -264,8 +312,22 @@ NvU64 uvm_channel_update_completed_value(uvm_channel_t *channel);
 
 // Reserve a channel with the specified type for a push
 // Channel type can be UVM_CHANNEL_TYPE_ANY to reserve any channel.
+//
+// The available channel with the fewest pending pushes is picked. If all the
+// channels of the type are busy, the calling thread spins for a short while
+// and then polls the channels with short naps in between (if allowed to sleep)
+// until a GPFIFO entry becomes available.
 NV_STATUS uvm_channel_reserve_type(uvm_channel_manager_t *manager, uvm_channel_type_t type, uvm_channel_t **channel_out);
 
+// Same as uvm_channel_reserve_type(), but preferred_channel (if not NULL) is
+// picked over the least loaded channel unless it is unavailable or
+// significantly busier. Keeping dependent work on the same channel makes its
+// ordering free.
+NV_STATUS uvm_channel_reserve_type_preferred(uvm_channel_manager_t *manager,
+                                             uvm_channel_type_t type,
+                                             uvm_channel_t *preferred_channel,
+                                             uvm_channel_t **channel_out);
+
 // Reserve a specific channel for a push
 NV_STATUS uvm_channel_reserve(uvm_channel_t *channel);
 
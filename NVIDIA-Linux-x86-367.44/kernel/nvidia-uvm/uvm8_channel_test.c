@@ -569,3 +569,97 @@ done:
 
     return status;
 }
+
+#define CHANNEL_PUSH_BENCHMARK_MAX_THREADS 64
+
+typedef struct
+{
+    uvm_channel_manager_t *manager;
+    uvm_channel_type_t channel_type;
+    NvU32 num_pushes;
+} channel_push_benchmark_t;
+
+static NV_STATUS channel_push_benchmark_thread(void *arg, NvU32 thread_index)
+{
+    channel_push_benchmark_t *bench = (channel_push_benchmark_t *)arg;
+    uvm_tracker_t tracker = UVM_TRACKER_INIT();
+    NV_STATUS status = NV_OK;
+    NV_STATUS tracker_status;
+    NvU32 i;
+
+    for (i = 0; i < bench->num_pushes; ++i) {
+        uvm_push_t push;
+
+        status = uvm_push_begin(bench->manager, bench->channel_type, &push, "push benchmark %u", i);
+        if (status != NV_OK)
+            break;
+
+        uvm_push_end(&push);
+
+        status = uvm_tracker_add_push_safe(&tracker, &push);
+        if (status != NV_OK)
+            break;
+    }
+
+    tracker_status = uvm_tracker_wait_deinit(&tracker);
+
+    return status == NV_OK ? tracker_status : status;
+}
+
+static NvU64 channel_manager_doorbells(uvm_channel_manager_t *manager)
+{
+    uvm_channel_t *channel;
+    NvU64 doorbells = 0;
+
+    uvm_for_each_channel(channel, manager) {
+        uvm_spin_lock(&channel->lock);
+        doorbells += channel->stats.doorbells;
+        uvm_spin_unlock(&channel->lock);
+    }
+
+    return doorbells;
+}
+
+NV_STATUS uvm8_test_channel_push_benchmark(UVM_TEST_CHANNEL_PUSH_BENCHMARK_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status;
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+    channel_push_benchmark_t bench;
+    uvm_gpu_t *gpu;
+    NvU64 start_doorbells;
+
+    if (params->num_threads == 0 || params->num_threads > CHANNEL_PUSH_BENCHMARK_MAX_THREADS ||
+        params->num_pushes == 0 || params->channel_type >= UVM_CHANNEL_TYPE_COUNT)
+        return NV_ERR_INVALID_PARAMETER;
+
+    // Holding the VA space lock keeps the GPU registered while the threads run
+    uvm_va_space_down_read_rm(va_space);
+
+    gpu = uvm_processor_mask_find_first_gpu(&va_space->registered_gpus);
+    if (!gpu) {
+        status = NV_ERR_INVALID_DEVICE;
+        goto done;
+    }
+
+    bench.manager = gpu->channel_manager;
+    bench.channel_type = params->channel_type;
+    bench.num_pushes = params->num_pushes;
+
+    start_doorbells = channel_manager_doorbells(gpu->channel_manager);
+
+    status = uvm_test_benchmark_run("uvm-push-bench",
+                                    params->num_threads,
+                                    channel_push_benchmark_thread,
+                                    NULL,
+                                    &bench,
+                                    &params->elapsed_ns);
+
+    params->doorbells = channel_manager_doorbells(gpu->channel_manager) - start_doorbells;
+    params->pushes_per_sec = uvm_test_rate_per_sec((NvU64)params->num_threads * params->num_pushes,
+                                                   params->elapsed_ns);
+
+done:
+    uvm_va_space_up_read_rm(va_space);
+
+    return status;
+}
@@ -68,6 +68,7 @@ typedef struct uvm_tlb_batch_struct uvm_tlb_batch_t;
 
 typedef struct uvm_fault_service_batch_context_struct uvm_fault_service_batch_context_t;
 typedef struct uvm_fault_service_block_context_struct uvm_fault_service_block_context_t;
+typedef struct uvm_fault_service_workers_struct uvm_fault_service_workers_t;
 
 typedef struct uvm_replayable_fault_buffer_info_struct uvm_replayable_fault_buffer_info_t;
 
@@ -99,6 +99,12 @@ NV_STATUS uvm_global_init(void)
         goto error;
     }
 
+    status = uvm_kvmalloc_procfs_init();
+    if (status != NV_OK) {
+        UVM_ERR_PRINT("uvm_kvmalloc_procfs_init() failed: %s\n", nvstatusToString(status));
+        goto error;
+    }
+
     status = uvm_rm_locked_call(nvUvmInterfaceSessionCreate(&g_uvm_global.rm_session_handle));
     if (status != NV_OK) {
         UVM_ERR_PRINT("nvUvmInterfaceSessionCreate() failed: %s\n", nvstatusToString(status));
@@ -180,6 +186,7 @@ void uvm_global_exit(void)
     if (g_uvm_global.rm_session_handle != 0)
         uvm_rm_locked_call_void(nvUvmInterfaceSessionDestroy(g_uvm_global.rm_session_handle));
 
+    uvm_kvmalloc_procfs_exit();
     uvm_procfs_exit();
 
     if (&g_uvm_global.q_is_initialized)
@@ -31,6 +31,7 @@
 #include "uvm8_hal.h"
 #include "uvm8_procfs.h"
 #include "uvm8_pmm_gpu.h"
+#include "uvm8_pte_batch.h"
 #include "uvm8_va_space.h"
 #include "uvm8_gpu_page_fault.h"
 #include "uvm8_user_channel.h"
@@ -39,6 +40,14 @@
 #include "ctrl2080mc.h"
 #include "nv-kthread-q.h"
 
+// Number of consecutive PTEs written with memsets before PTE batches switch to
+// inline memcopy (see uvm8_pte_batch.h). The default of -1 measures the cost
+// of both when each GPU is registered and picks the number from that. Other
+// values are used as-is for all GPUs instead, clamped to
+// UVM_PTE_BATCH_MAX_PTES.
+static int uvm_pte_batch_memset_ptes = -1;
+module_param(uvm_pte_batch_memset_ptes, int, S_IRUGO);
+
 static void remove_gpu(uvm_gpu_t *gpu);
 static void disable_peer_access(uvm_gpu_t *gpu_1, uvm_gpu_t *gpu_2);
 
@@ -161,6 +170,11 @@ gpu_info_print_common(uvm_gpu_t *gpu, struct seq_file *s)
     UVM_SEQ_OR_DBG_PRINT(s, "interrupts            %llu\n", gpu->interrupt_count);
     UVM_SEQ_OR_DBG_PRINT(s, "bottom_halves         %llu\n", gpu->interrupt_count_bottom_half);
 
+    if (uvm_gpu_supports_eviction(gpu)) {
+        UVM_SEQ_OR_DBG_PRINT(s, "eviction_policy       %s\n",
+                             uvm_pmm_gpu_eviction_policy_string(gpu->pmm.eviction_policy));
+    }
+
     if (gpu->handling_replayable_faults) {
         UVM_SEQ_OR_DBG_PRINT(s, "fault_buffer_entries  %u\n", gpu->fault_buffer_info.max_faults);
         UVM_SEQ_OR_DBG_PRINT(s, "cached_get            %u\n", gpu->fault_buffer_info.replayable.cached_get);
@@ -168,7 +182,8 @@ gpu_info_print_common(uvm_gpu_t *gpu, struct seq_file *s)
         UVM_SEQ_OR_DBG_PRINT(s, "fault_batch_size      %u\n", gpu->fault_buffer_info.fault_batch_count);
         UVM_SEQ_OR_DBG_PRINT(s, "replay_policy         %s\n",
                              uvm_perf_fault_replay_policy_string(gpu->fault_buffer_info.replayable.replay_policy));
-        UVM_SEQ_OR_DBG_PRINT(s, "faults                %llu\n", gpu->stats.num_faults);
+        UVM_SEQ_OR_DBG_PRINT(s, "faults                %llu\n",
+                             (NvU64)atomic64_read(&gpu->stats.num_faults));
     }
 
     num_pages_out = atomic64_read(&gpu->stats.num_pages_out);
@@ -201,26 +216,65 @@ gpu_fault_stats_print_common(uvm_gpu_t *gpu, struct seq_file *s)
 {
     NvU64 num_pages_in;
     NvU64 num_pages_out;
+    NvU64 num_prefetch_useful;
+    NvU64 num_prefetch_wasted;
+    NvU64 num_prefetch_missed;
+    NvU64 num_batches;
+    NvU64 num_pipelined_batches;
 
     if (!uvm_procfs_is_debug_enabled())
         return;
 
+    num_batches = gpu->fault_buffer_info.replayable.stats.num_batches;
+    num_pipelined_batches = gpu->fault_buffer_info.replayable.stats.num_pipelined_batches;
+
     num_pages_out = atomic64_read(&gpu->fault_buffer_info.replayable.stats.num_pages_out);
     num_pages_in = atomic64_read(&gpu->fault_buffer_info.replayable.stats.num_pages_in);
+    num_prefetch_useful = atomic64_read(&gpu->fault_buffer_info.replayable.stats.num_prefetch_pages_useful);
+    num_prefetch_wasted = atomic64_read(&gpu->fault_buffer_info.replayable.stats.num_prefetch_pages_wasted);
+    num_prefetch_missed = atomic64_read(&gpu->fault_buffer_info.replayable.stats.num_prefetch_pages_missed);
 
     UVM_SEQ_OR_DBG_PRINT(s, "faults_by_access_type:\n");
-    UVM_SEQ_OR_DBG_PRINT(s, "  prefetch             %llu\n", gpu->fault_buffer_info.replayable.stats.num_prefetch_faults);
-    UVM_SEQ_OR_DBG_PRINT(s, "  read                 %llu\n", gpu->fault_buffer_info.replayable.stats.num_read_faults);
-    UVM_SEQ_OR_DBG_PRINT(s, "  write                %llu\n", gpu->fault_buffer_info.replayable.stats.num_write_faults);
-    UVM_SEQ_OR_DBG_PRINT(s, "  atomics              %llu\n", gpu->fault_buffer_info.replayable.stats.num_atomic_faults);
+    UVM_SEQ_OR_DBG_PRINT(s, "  prefetch             %llu\n",
+                         (NvU64)atomic64_read(&gpu->fault_buffer_info.replayable.stats.num_prefetch_faults));
+    UVM_SEQ_OR_DBG_PRINT(s, "  read                 %llu\n",
+                         (NvU64)atomic64_read(&gpu->fault_buffer_info.replayable.stats.num_read_faults));
+    UVM_SEQ_OR_DBG_PRINT(s, "  write                %llu\n",
+                         (NvU64)atomic64_read(&gpu->fault_buffer_info.replayable.stats.num_write_faults));
+    UVM_SEQ_OR_DBG_PRINT(s, "  atomics              %llu\n",
+                         (NvU64)atomic64_read(&gpu->fault_buffer_info.replayable.stats.num_atomic_faults));
+    UVM_SEQ_OR_DBG_PRINT(s, "  duplicates           %llu\n",
+                         (NvU64)atomic64_read(&gpu->fault_buffer_info.replayable.stats.num_duplicate_faults));
     UVM_SEQ_OR_DBG_PRINT(s, "migrations:\n");
     UVM_SEQ_OR_DBG_PRINT(s, "  num_pages_in         %llu (%llu MB)\n", num_pages_in,
                          (num_pages_in * (NvU64)PAGE_SIZE) / (1024u * 1024u));
     UVM_SEQ_OR_DBG_PRINT(s, "  num_pages_out        %llu (%llu MB)\n", num_pages_out,
                          (num_pages_out * (NvU64)PAGE_SIZE) / (1024u * 1024u));
+    // Accuracy: fraction of the resolved prefetched pages that were useful.
+    // Coverage: fraction of the pages that would have faulted without
+    // prefetching that were prefetched instead.
+    UVM_SEQ_OR_DBG_PRINT(s, "prefetch:\n");
+    UVM_SEQ_OR_DBG_PRINT(s, "  pages_useful         %llu\n", num_prefetch_useful);
+    UVM_SEQ_OR_DBG_PRINT(s, "  pages_wasted         %llu\n", num_prefetch_wasted);
+    UVM_SEQ_OR_DBG_PRINT(s, "  pages_missed         %llu\n", num_prefetch_missed);
+    UVM_SEQ_OR_DBG_PRINT(s, "  accuracy             %llu%%\n",
+                         num_prefetch_useful + num_prefetch_wasted == 0 ? 0 :
+                         (num_prefetch_useful * 100) / (num_prefetch_useful + num_prefetch_wasted));
+    UVM_SEQ_OR_DBG_PRINT(s, "  coverage             %llu%%\n",
+                         num_prefetch_useful + num_prefetch_missed == 0 ? 0 :
+                         (num_prefetch_useful * 100) / (num_prefetch_useful + num_prefetch_missed));
     UVM_SEQ_OR_DBG_PRINT(s, "replays:\n");
     UVM_SEQ_OR_DBG_PRINT(s, "  start                %llu\n", gpu->fault_buffer_info.replayable.stats.num_replays);
     UVM_SEQ_OR_DBG_PRINT(s, "  start_ack_all        %llu\n", gpu->fault_buffer_info.replayable.stats.num_replays_ack_all);
+    // Occupancy: fraction of the serviced batches that were fetched and
+    // preprocessed while the previous batch was being serviced.
+    UVM_SEQ_OR_DBG_PRINT(s, "pipeline:\n");
+    UVM_SEQ_OR_DBG_PRINT(s, "  batches              %llu\n", num_batches);
+    UVM_SEQ_OR_DBG_PRINT(s, "  pipelined_batches    %llu\n", num_pipelined_batches);
+    UVM_SEQ_OR_DBG_PRINT(s, "  discarded_batches    %llu\n",
+                         gpu->fault_buffer_info.replayable.stats.num_discarded_prefetched_batches);
+    UVM_SEQ_OR_DBG_PRINT(s, "  occupancy            %llu%%\n",
+                         num_batches == 0 ? 0 : (num_pipelined_batches * 100) / num_batches);
 }
 
 void uvm_gpu_print(uvm_gpu_t *gpu)
@@ -580,6 +634,17 @@ static NV_STATUS add_gpu(NvProcessorUuid *gpu_uuid, uvm_gpu_t **gpu_out)
         goto error;
     }
 
+    if (uvm_pte_batch_memset_ptes >= 0) {
+        gpu->pte_batch.max_memset_ptes = min((NvU32)uvm_pte_batch_memset_ptes, (NvU32)UVM_PTE_BATCH_MAX_PTES);
+    }
+    else {
+        status = uvm_mmu_calibrate_pte_batch(gpu);
+        if (status != NV_OK) {
+            UVM_ERR_PRINT("Failed to calibrate PTE batches: %s, GPU %s\n", nvstatusToString(status), gpu->name);
+            goto error;
+        }
+    }
+
     status = init_procfs_files(gpu);
     if (status != NV_OK) {
         UVM_ERR_PRINT("Failed to init procfs files: %s, GPU %s\n", nvstatusToString(status), gpu->name);
@@ -825,21 +890,23 @@ void update_stats_fault_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *eve
     switch (event_data->fault.gpu.buffer_entry->fault_access_type)
     {
         case UVM_FAULT_ACCESS_TYPE_PREFETCH:
-            ++gpu->fault_buffer_info.replayable.stats.num_prefetch_faults;
+            atomic64_inc(&gpu->fault_buffer_info.replayable.stats.num_prefetch_faults);
             break;
         case UVM_FAULT_ACCESS_TYPE_READ:
-            ++gpu->fault_buffer_info.replayable.stats.num_read_faults;
+            atomic64_inc(&gpu->fault_buffer_info.replayable.stats.num_read_faults);
             break;
         case UVM_FAULT_ACCESS_TYPE_WRITE:
-            ++gpu->fault_buffer_info.replayable.stats.num_write_faults;
+            atomic64_inc(&gpu->fault_buffer_info.replayable.stats.num_write_faults);
             break;
         case UVM_FAULT_ACCESS_TYPE_ATOMIC:
-            ++gpu->fault_buffer_info.replayable.stats.num_atomic_faults;
+            atomic64_inc(&gpu->fault_buffer_info.replayable.stats.num_atomic_faults);
             break;
         default:
             break;
     }
-    ++gpu->stats.num_faults;
+    if (event_data->fault.gpu.buffer_entry->num_instances == 0)
+        atomic64_inc(&gpu->fault_buffer_info.replayable.stats.num_duplicate_faults);
+    atomic64_inc(&gpu->stats.num_faults);
 }
 
 void update_stats_migration_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data)
@@ -185,6 +185,10 @@ struct uvm_fault_service_batch_context_struct
 
     NvU32 replays;
 
+    // Number of uTLBs whose pending faults in the batch have been all serviced since the last replay. Only used by
+    // UVM_PERF_FAULT_REPLAY_POLICY_UTLB
+    NvU32 num_completed_utlbs;
+
     // Unique id (per-GPU) generated for tools events recording
     NvU32 batch_id;
 
@@ -223,6 +227,35 @@ typedef struct
         // fault_batch_count
         uvm_fault_buffer_entry_t **ordered_fault_cache;
 
+        // Scratch storage used to sort ordered_fault_cache
+        uvm_fault_sort_scratch_t sort_scratch;
+
+        // Second pair of fault caches used to fetch and preprocess the next
+        // batch while the fault service workers are servicing the current one.
+        // The pairs are swapped when the prefetched batch becomes the current
+        // batch, so fault_cache and ordered_fault_cache always describe the
+        // batch being serviced.
+        struct
+        {
+            uvm_fault_buffer_entry_t *fault_cache;
+
+            uvm_fault_buffer_entry_t **ordered_fault_cache;
+
+            // Number of faults in the prefetched batch. 0 if there is no
+            // prefetched batch.
+            NvU32 cached_faults;
+
+            // Whether the prefetched batch has already been sorted,
+            // translated and coalesced. A batch with faults whose VA space
+            // could not be found is left for preprocess_fault_batch, which
+            // flushes the buffer.
+            bool preprocessed;
+
+            // Set by the bottom half when the batch being serviced may be
+            // followed by a prefetched batch in the same service invocation
+            bool enabled;
+        } prefetch;
+
         // Policy that determines when GPU replays are issued during normal
         // fault servicing
         uvm_perf_fault_replay_policy_t replay_policy;
@@ -231,18 +264,19 @@ typedef struct
         uvm_tracker_t replay_tracker;
 
         // Fault statistics. These fields are per-GPU and most of them are only
-        // updated during fault servicing, and can be safely incremented.
-        // Migrations may be triggered by different GPUs and need to be
+        // updated by the bottom half, and can be safely incremented.
+        // Migrations may be triggered by different GPUs, and faults may be
+        // notified by the fault service workers, so those need to be
         // incremented using atomics
         struct
         {
-            NvU64 num_prefetch_faults;
+            atomic64_t num_prefetch_faults;
 
-            NvU64 num_read_faults;
+            atomic64_t num_read_faults;
 
-            NvU64 num_write_faults;
+            atomic64_t num_write_faults;
 
-            NvU64 num_atomic_faults;
+            atomic64_t num_atomic_faults;
 
             atomic64_t num_pages_out;
 
@@ -251,6 +285,28 @@ typedef struct
             NvU64 num_replays;
 
             NvU64 num_replays_ack_all;
+
+            // Batches serviced by the bottom half in regular mode, batches
+            // that were fetched while the previous batch was being serviced,
+            // and prefetched batches dropped by a fault buffer flush or
+            // cancel.
+            NvU64 num_batches;
+
+            NvU64 num_pipelined_batches;
+
+            NvU64 num_discarded_prefetched_batches;
+
+            atomic64_t num_duplicate_faults;
+
+            // Pages prefetched to the GPU that the GPU later faulted on,
+            // pages prefetched to the GPU that migrated away before that, and
+            // faulted pages in VA blocks tracked by the prefetcher. Prefetch
+            // resolution may be triggered by different processors.
+            atomic64_t num_prefetch_pages_useful;
+
+            atomic64_t num_prefetch_pages_wasted;
+
+            atomic64_t num_prefetch_pages_missed;
         } stats;
 
         // Per uTLB fault information. Used for replay policies and fault
@@ -268,6 +324,11 @@ typedef struct
 
         // Structure used to coalesce fault servicing in a VA block
         uvm_fault_service_block_context_t block_service_context;
+
+        // Pool of workers that service the VA blocks of a fault batch in
+        // parallel. NULL if the bottom half services them serially, see
+        // uvm_perf_fault_service_workers.
+        uvm_fault_service_workers_t *service_workers;
     } replayable;
 
     // Flag that tells if prefetch faults are enabled in HW
@@ -416,8 +477,21 @@ struct uvm_gpu_struct
         // How many pages does it make sense to invalidate with the targeted VA
         // invalidate before falling back to invalidate all?
         NvU32 max_pages;
+
+        // How many separate ranges does it make sense to invalidate with the
+        // targeted VA invalidate before falling back to invalidate all? At
+        // most UVM_TLB_BATCH_MAX_ENTRIES.
+        NvU32 max_ranges;
     } tlb_batch;
 
+    // Parameters used by the PTE batching API
+    struct
+    {
+        // How many consecutive PTEs to write with memsets before switching to
+        // inline memcopy. At most UVM_PTE_BATCH_MAX_PTES.
+        NvU32 max_memset_ptes;
+    } pte_batch;
+
     // For the next chip and for any other features that are not yet ready to be
     // made public:
     uvm_gpu_next_data_t uvm_next;
@@ -557,11 +631,11 @@ struct uvm_gpu_struct
     // This is set to true if the GPU is a simulated/emulated device. Else, set to false.
     bool is_simulated;
 
-    // Global statistics. These fields are per-GPU and most of them are only
-    // updated during fault servicing, and can be safely incremented.
+    // Global statistics. These fields are per-GPU and are updated using
+    // atomics, since faults may be serviced by multiple threads.
     struct
     {
-        NvU64 num_faults;
+        atomic64_t num_faults;
 
         atomic64_t num_pages_out;
 
@@ -68,9 +68,166 @@ module_param(uvm_perf_fault_max_batches_per_service, uint, S_IRUGO);
 static unsigned uvm_perf_fault_max_throttle_per_service = UVM_PERF_FAULT_MAX_THROTTLE_PER_SERVICE_DEFAULT;
 module_param(uvm_perf_fault_max_throttle_per_service, uint, S_IRUGO);
 
+// Number of kernel threads that service the VA blocks of each fault batch in
+// parallel. With a single worker the bottom half services all the VA blocks
+// itself.
+#define UVM_PERF_FAULT_SERVICE_WORKERS_DEFAULT 1
+#define UVM_PERF_FAULT_SERVICE_WORKERS_MAX     16
+
+static unsigned uvm_perf_fault_service_workers = UVM_PERF_FAULT_SERVICE_WORKERS_DEFAULT;
+module_param(uvm_perf_fault_service_workers, uint, S_IRUGO);
+
+// VA block of a fault batch queued for the fault service workers
+typedef struct
+{
+    uvm_va_block_t *va_block;
+
+    // Faults of the block in the ordered view of the batch
+    NvU32 first_fault_index;
+    NvU32 num_faults;
+} fault_service_work_block_t;
+
+typedef struct
+{
+    nv_kthread_q_t q;
+
+    nv_kthread_q_item_t q_item;
+
+    uvm_fault_service_workers_t *workers;
+
+    // Private copies of the per-GPU fault service contexts. The batch context
+    // accumulates the counters and the tracker of the blocks serviced by the
+    // worker, which are merged into the bottom half's batch context afterwards.
+    uvm_fault_service_block_context_t *block_service_context;
+
+    uvm_fault_service_batch_context_t batch_context;
+
+    NV_STATUS status;
+
+    struct
+    {
+        // Time spent servicing VA blocks
+        atomic64_t service_time_ns;
+
+        atomic64_t num_blocks;
+
+        atomic64_t num_faults;
+    } stats;
+} fault_service_worker_t;
+
+struct uvm_fault_service_workers_struct
+{
+    uvm_gpu_t *gpu;
+
+    NvU32 num_workers;
+
+    fault_service_worker_t *workers;
+
+    // VA blocks queued by the bottom half. They all belong to va_space, whose
+    // lock is held in read mode by the bottom half while the workers run.
+    fault_service_work_block_t *blocks;
+
+    NvU32 num_blocks;
+
+    uvm_va_space_t *va_space;
+
+    // Index of the next block to be picked up by a worker
+    atomic_t next_block;
+
+    // Set by a worker that fails to service a block, so that the rest stop
+    // picking up blocks
+    atomic_t error;
+
+    atomic_t num_active_workers;
+
+    wait_queue_head_t done_wait_queue;
+};
+
+static void fault_service_worker(void *args);
+static void destroy_fault_service_workers(uvm_fault_service_workers_t *workers);
+
+static NV_STATUS create_fault_service_workers(uvm_gpu_t *gpu, NvU32 num_workers,
+                                              uvm_fault_service_workers_t **workers_out)
+{
+    NV_STATUS status = NV_OK;
+    NvU32 i;
+    uvm_fault_service_workers_t *workers;
+
+    workers = uvm_kvmalloc_zero(sizeof(*workers));
+    if (!workers)
+        return NV_ERR_NO_MEMORY;
+
+    workers->gpu = gpu;
+    init_waitqueue_head(&workers->done_wait_queue);
+
+    workers->blocks = uvm_kvmalloc_zero(gpu->fault_buffer_info.max_faults * sizeof(*workers->blocks));
+    workers->workers = uvm_kvmalloc_zero(num_workers * sizeof(*workers->workers));
+    if (!workers->blocks || !workers->workers) {
+        status = NV_ERR_NO_MEMORY;
+        goto fail;
+    }
+
+    for (i = 0; i < num_workers; ++i) {
+        fault_service_worker_t *worker = &workers->workers[i];
+        char name[TASK_COMM_LEN];
+        int ret;
+
+        worker->workers = workers;
+        uvm_tracker_init(&worker->batch_context.tracker);
+        nv_kthread_q_item_init(&worker->q_item, fault_service_worker, worker);
+
+        worker->block_service_context = uvm_kvmalloc_zero(sizeof(*worker->block_service_context));
+        if (!worker->block_service_context) {
+            status = NV_ERR_NO_MEMORY;
+            goto fail;
+        }
+
+        snprintf(name, sizeof(name), "UVM GPU%u fault %u", gpu->id, i);
+        ret = nv_kthread_q_init(&worker->q, name);
+        if (ret != 0) {
+            UVM_ERR_PRINT("nv_kthread_q_init() failed: %d, GPU %s\n", ret, gpu->name);
+            uvm_kvfree(worker->block_service_context);
+            status = errno_to_nv_status(ret);
+            goto fail;
+        }
+
+        ++workers->num_workers;
+    }
+
+    *workers_out = workers;
+
+    return NV_OK;
+
+fail:
+    destroy_fault_service_workers(workers);
+
+    return status;
+}
+
+static void destroy_fault_service_workers(uvm_fault_service_workers_t *workers)
+{
+    NvU32 i;
+
+    if (!workers)
+        return;
+
+    for (i = 0; i < workers->num_workers; ++i) {
+        fault_service_worker_t *worker = &workers->workers[i];
+
+        nv_kthread_q_stop(&worker->q);
+        uvm_tracker_deinit(&worker->batch_context.tracker);
+        uvm_kvfree(worker->block_service_context);
+    }
+
+    uvm_kvfree(workers->workers);
+    uvm_kvfree(workers->blocks);
+    uvm_kvfree(workers);
+}
+
 static NV_STATUS init_replayable_faults(uvm_gpu_t *gpu)
 {
     NV_STATUS status = NV_OK;
+    NvU32 num_service_workers;
     uvm_replayable_fault_buffer_info_t *replayable_faults = &gpu->fault_buffer_info.replayable;
 
     uvm_tracker_init(&replayable_faults->replay_tracker);
@@ -105,6 +262,10 @@ static NV_STATUS init_replayable_faults(uvm_gpu_t *gpu)
         goto fail;
     }
 
+    status = uvm_fault_sort_scratch_init(&replayable_faults->sort_scratch, gpu->fault_buffer_info.max_faults);
+    if (status != NV_OK)
+        goto fail;
+
     // This value must be initialized by HAL
     UVM_ASSERT(replayable_faults->utlb_count > 0);
 
@@ -117,6 +278,33 @@ static NV_STATUS init_replayable_faults(uvm_gpu_t *gpu)
 
     replayable_faults->max_utlb_id = 0;
 
+    // Check provided module parameter value
+    num_service_workers = uvm_perf_fault_service_workers;
+    if (num_service_workers < 1 || num_service_workers > UVM_PERF_FAULT_SERVICE_WORKERS_MAX) {
+        num_service_workers = UVM_PERF_FAULT_SERVICE_WORKERS_DEFAULT;
+        pr_info("Invalid uvm_perf_fault_service_workers value on GPU %s: %u. Valid range [1:%u] Using %u instead\n",
+                gpu->name, uvm_perf_fault_service_workers, UVM_PERF_FAULT_SERVICE_WORKERS_MAX,
+                num_service_workers);
+    }
+
+    if (num_service_workers > 1) {
+        status = create_fault_service_workers(gpu, num_service_workers, &replayable_faults->service_workers);
+        if (status != NV_OK)
+            goto fail;
+
+        // The next batch is only fetched ahead of time while the workers
+        // service the current one
+        replayable_faults->prefetch.fault_cache =
+            uvm_kvmalloc_zero(gpu->fault_buffer_info.max_faults * sizeof(*replayable_faults->prefetch.fault_cache));
+        replayable_faults->prefetch.ordered_fault_cache =
+            uvm_kvmalloc_zero(gpu->fault_buffer_info.max_faults *
+                              sizeof(*replayable_faults->prefetch.ordered_fault_cache));
+        if (!replayable_faults->prefetch.fault_cache || !replayable_faults->prefetch.ordered_fault_cache) {
+            status = NV_ERR_NO_MEMORY;
+            goto fail;
+        }
+    }
+
     status = uvm_rm_locked_call(nvUvmInterfaceOwnPageFaultIntr((NvU8*)&gpu->uuid,
                                                                sizeof(gpu->uuid),
                                                                NV_TRUE));
@@ -176,9 +364,17 @@ static void deinit_replayable_faults(uvm_gpu_t *gpu)
     uvm_kvfree(replayable_faults->fault_cache);
     uvm_kvfree(replayable_faults->ordered_fault_cache);
     uvm_kvfree(replayable_faults->utlbs);
-    replayable_faults->fault_cache         = NULL;
-    replayable_faults->ordered_fault_cache = NULL;
-    replayable_faults->utlbs               = NULL;
+    uvm_fault_sort_scratch_deinit(&replayable_faults->sort_scratch);
+    destroy_fault_service_workers(replayable_faults->service_workers);
+    uvm_kvfree(replayable_faults->prefetch.fault_cache);
+    uvm_kvfree(replayable_faults->prefetch.ordered_fault_cache);
+    replayable_faults->fault_cache                  = NULL;
+    replayable_faults->ordered_fault_cache          = NULL;
+    replayable_faults->utlbs                        = NULL;
+    replayable_faults->service_workers              = NULL;
+    replayable_faults->prefetch.fault_cache         = NULL;
+    replayable_faults->prefetch.ordered_fault_cache = NULL;
+    replayable_faults->prefetch.cached_faults       = 0;
 }
 
 NV_STATUS uvm_gpu_fault_buffer_init(uvm_gpu_t *gpu)
@@ -441,6 +637,20 @@ typedef enum
 } fault_buffer_flush_mode_t;
 
 
+// Drop the batch fetched ahead of time, if any. Its entries have already been
+// consumed from the GPU fault buffer, so a replay needs to be issued afterwards
+// for the faults to show up again.
+static bool discard_prefetched_batch(uvm_replayable_fault_buffer_info_t *replayable_faults)
+{
+    if (replayable_faults->prefetch.cached_faults == 0)
+        return false;
+
+    replayable_faults->prefetch.cached_faults = 0;
+    ++replayable_faults->stats.num_discarded_prefetched_batches;
+
+    return true;
+}
+
 static NV_STATUS fault_buffer_flush_locked(uvm_gpu_t *gpu, fault_buffer_flush_mode_t flush_mode,
                                            uvm_fault_replay_type_t fault_replay,
                                            uvm_fault_service_batch_context_t *batch_context)
@@ -457,6 +667,9 @@ static NV_STATUS fault_buffer_flush_locked(uvm_gpu_t *gpu, fault_buffer_flush_mo
     UVM_ASSERT(uvm_gpu_supports_replayable_faults(gpu));
     UVM_ASSERT(mutex_is_locked(&gpu->isr_lock.m));
 
+    // The replay issued below covers the faults of the prefetched batch, too
+    discard_prefetched_batch(replayable_faults);
+
     // Read PUT pointer from the GPU if requested
     if (flush_mode == FAULT_BUFFER_FLUSH_MODE_UPDATE_PUT)
         replayable_faults->cached_put = UVM_READ_ONCE(*gpu->fault_buffer_info.rm_info.replayable.pFaultBufferPut);
@@ -523,14 +736,16 @@ typedef enum
     FAULT_FETCH_MODE_ALL,
 } fault_fetch_mode_t;
 
-static NvU32 fetch_fault_buffer_entries(uvm_gpu_t *gpu, fault_fetch_mode_t fetch_mode)
+// Parse the ready entries of the GPU fault buffer into the given fault cache.
+// The per-uTLB information is not updated, see account_fault_batch_utlbs.
+static NvU32 fetch_fault_buffer_entries_to_cache(uvm_gpu_t *gpu,
+                                                 uvm_fault_buffer_entry_t *fault_cache,
+                                                 fault_fetch_mode_t fetch_mode)
 {
     NvU32 get;
     NvU32 put;
     NvU32 i;
     NvU32 cached_faults;
-    NvU32 utlb_id;
-    uvm_fault_buffer_entry_t *fault_cache;
     uvm_spin_loop_t spin;
     uvm_replayable_fault_buffer_info_t *replayable_faults = &gpu->fault_buffer_info.replayable;
 
@@ -540,14 +755,6 @@ static NvU32 fetch_fault_buffer_entries(uvm_gpu_t *gpu, fault_fetch_mode_t fetch
     UVM_ASSERT(mutex_is_locked(&gpu->isr_lock.m));
     UVM_ASSERT(uvm_gpu_supports_replayable_faults(gpu));
 
-    // Check that all prior faults have been serviced
-    for (utlb_id = 0; utlb_id <= replayable_faults->max_utlb_id; ++utlb_id)
-        UVM_ASSERT(replayable_faults->utlbs[utlb_id].num_pending_faults == 0);
-
-    replayable_faults->max_utlb_id = 0;
-
-    fault_cache = replayable_faults->fault_cache;
-
     get = replayable_faults->cached_get;
 
     // Read put pointer from GPU and cache it
@@ -599,13 +806,6 @@ static NvU32 fetch_fault_buffer_entries(uvm_gpu_t *gpu, fault_fetch_mode_t fetch
             fault_cache[i].fatal_reason = UvmEventFatalReasonInvalidFaultType;
         }
 
-        if (fault_cache[i].fault_source.utlb_id > replayable_faults->max_utlb_id) {
-            UVM_ASSERT(fault_cache[i].fault_source.utlb_id < replayable_faults->utlb_count);
-            replayable_faults->max_utlb_id = fault_cache[i].fault_source.utlb_id;
-        }
-
-        ++replayable_faults->utlbs[fault_cache[i].fault_source.utlb_id].num_pending_faults;
-
         ++cached_faults;
         ++get;
         if (get == gpu->fault_buffer_info.max_faults)
@@ -621,6 +821,68 @@ done:
     return cached_faults;
 }
 
+// Register the faults of the current batch as pending in their uTLBs
+static void account_fault_batch_utlbs(uvm_replayable_fault_buffer_info_t *replayable_faults, NvU32 cached_faults)
+{
+    NvU32 i;
+    NvU32 utlb_id;
+
+    // Check that all prior faults have been serviced
+    for (utlb_id = 0; utlb_id <= replayable_faults->max_utlb_id; ++utlb_id)
+        UVM_ASSERT(replayable_faults->utlbs[utlb_id].num_pending_faults == 0);
+
+    replayable_faults->max_utlb_id = 0;
+
+    for (i = 0; i < cached_faults; ++i) {
+        uvm_fault_buffer_entry_t *current_entry = &replayable_faults->fault_cache[i];
+
+        if (current_entry->fault_source.utlb_id > replayable_faults->max_utlb_id) {
+            UVM_ASSERT(current_entry->fault_source.utlb_id < replayable_faults->utlb_count);
+            replayable_faults->max_utlb_id = current_entry->fault_source.utlb_id;
+        }
+
+        ++replayable_faults->utlbs[current_entry->fault_source.utlb_id].num_pending_faults;
+    }
+}
+
+static NvU32 fetch_fault_buffer_entries(uvm_gpu_t *gpu, fault_fetch_mode_t fetch_mode)
+{
+    NvU32 cached_faults;
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &gpu->fault_buffer_info.replayable;
+
+    // A prefetched batch must be serviced or discarded before fetching more
+    // faults, or the batches would be serviced out of order
+    UVM_ASSERT(replayable_faults->prefetch.cached_faults == 0);
+
+    cached_faults = fetch_fault_buffer_entries_to_cache(gpu, replayable_faults->fault_cache, fetch_mode);
+    account_fault_batch_utlbs(replayable_faults, cached_faults);
+
+    return cached_faults;
+}
+
+// Make the prefetched batch the current one by swapping the fault caches
+static NvU32 swap_in_prefetched_batch(uvm_gpu_t *gpu)
+{
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &gpu->fault_buffer_info.replayable;
+    uvm_fault_buffer_entry_t *fault_cache = replayable_faults->fault_cache;
+    uvm_fault_buffer_entry_t **ordered_fault_cache = replayable_faults->ordered_fault_cache;
+    NvU32 cached_faults = replayable_faults->prefetch.cached_faults;
+
+    UVM_ASSERT(cached_faults > 0);
+
+    replayable_faults->fault_cache                  = replayable_faults->prefetch.fault_cache;
+    replayable_faults->ordered_fault_cache          = replayable_faults->prefetch.ordered_fault_cache;
+    replayable_faults->prefetch.fault_cache         = fault_cache;
+    replayable_faults->prefetch.ordered_fault_cache = ordered_fault_cache;
+    replayable_faults->prefetch.cached_faults       = 0;
+
+    account_fault_batch_utlbs(replayable_faults, cached_faults);
+
+    ++replayable_faults->stats.num_pipelined_batches;
+
+    return cached_faults;
+}
+
 #define CMP_DEFAULT(a,b)                  \
 ({                                        \
     typeof(a) _a = a;                     \
@@ -703,18 +965,273 @@ static int cmp_sort_fault_entry_by_va_space_address_access_type(const void *_a,
     return cmp_access_type((*a)->fault_access_type, (*b)->fault_access_type);
 }
 
+void uvm_fault_sort_by_instance_ptr_generic(uvm_fault_buffer_entry_t **entries, NvU32 count)
+{
+    sort(entries, count, sizeof(*entries), cmp_sort_fault_entry_by_instance_ptr, NULL);
+}
+
+void uvm_fault_sort_by_va_space_address_access_type_generic(uvm_fault_buffer_entry_t **entries, NvU32 count)
+{
+    sort(entries, count, sizeof(*entries), cmp_sort_fault_entry_by_va_space_address_access_type, NULL);
+}
+
+NV_STATUS uvm_fault_sort_scratch_init(uvm_fault_sort_scratch_t *scratch, NvU32 max_entries)
+{
+    scratch->max_entries = max_entries;
+
+    scratch->keys = uvm_kvmalloc(max_entries * sizeof(*scratch->keys));
+    scratch->tmp_keys = uvm_kvmalloc(max_entries * sizeof(*scratch->tmp_keys));
+    scratch->tmp_entries = uvm_kvmalloc(max_entries * sizeof(*scratch->tmp_entries));
+    if (!scratch->keys || !scratch->tmp_keys || !scratch->tmp_entries) {
+        uvm_fault_sort_scratch_deinit(scratch);
+        return NV_ERR_NO_MEMORY;
+    }
+
+    return NV_OK;
+}
+
+void uvm_fault_sort_scratch_deinit(uvm_fault_sort_scratch_t *scratch)
+{
+    uvm_kvfree(scratch->keys);
+    uvm_kvfree(scratch->tmp_keys);
+    uvm_kvfree(scratch->tmp_entries);
+    scratch->keys = NULL;
+    scratch->tmp_keys = NULL;
+    scratch->tmp_entries = NULL;
+    scratch->max_entries = 0;
+}
+
+// Stable LSD radix sort of entries using scratch->keys[i] as the key of
+// entries[i]. Digits that are equal across all the keys are skipped, which
+// removes most of the passes since keys are made of small ranks and page
+// numbers with a common prefix.
+static void fault_sort_radix(uvm_fault_sort_scratch_t *scratch, uvm_fault_buffer_entry_t **entries, NvU32 count)
+{
+    NvU64 *keys = scratch->keys;
+    NvU64 *tmp_keys = scratch->tmp_keys;
+    uvm_fault_buffer_entry_t **src_entries = entries;
+    uvm_fault_buffer_entry_t **dst_entries = scratch->tmp_entries;
+    NvU32 *counts = scratch->radix_counts;
+    NvU64 diff = 0;
+    NvU32 shift;
+    NvU32 i;
+
+    for (i = 1; i < count; ++i)
+        diff |= keys[i] ^ keys[0];
+
+    for (shift = 0; shift < 64; shift += UVM_FAULT_SORT_RADIX_BITS) {
+        NvU32 offset = 0;
+        NvU32 digit;
+
+        if (((diff >> shift) & (UVM_FAULT_SORT_RADIX_SIZE - 1)) == 0)
+            continue;
+
+        memset(counts, 0, sizeof(scratch->radix_counts));
+
+        for (i = 0; i < count; ++i)
+            ++counts[(keys[i] >> shift) & (UVM_FAULT_SORT_RADIX_SIZE - 1)];
+
+        for (digit = 0; digit < UVM_FAULT_SORT_RADIX_SIZE; ++digit) {
+            NvU32 digit_count = counts[digit];
+            counts[digit] = offset;
+            offset += digit_count;
+        }
+
+        for (i = 0; i < count; ++i) {
+            NvU32 pos = counts[(keys[i] >> shift) & (UVM_FAULT_SORT_RADIX_SIZE - 1)]++;
+
+            tmp_keys[pos] = keys[i];
+            dst_entries[pos] = src_entries[i];
+        }
+
+        swap(keys, tmp_keys);
+        swap(src_entries, dst_entries);
+    }
+
+    if (src_entries != entries)
+        memcpy(entries, src_entries, count * sizeof(*entries));
+}
+
+// Binary search of the given instance pointer in the sorted array of distinct
+// instance pointers. Returns the insertion position if it's not found.
+static NvU32 instance_ptr_rank(uvm_fault_sort_scratch_t *scratch, NvU32 num_instance_ptrs,
+                               uvm_gpu_phys_address_t instance_ptr, bool *found)
+{
+    NvU32 lo = 0;
+    NvU32 hi = num_instance_ptrs;
+
+    while (lo < hi) {
+        NvU32 mid = lo + (hi - lo) / 2;
+        int result = cmp_gpu_phys_addr(scratch->instance_ptrs[mid], instance_ptr);
+
+        if (result == 0) {
+            *found = true;
+            return mid;
+        }
+
+        if (result < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    *found = false;
+    return lo;
+}
+
+// Same as instance_ptr_rank() for the array of distinct VA spaces
+static NvU32 va_space_rank(uvm_fault_sort_scratch_t *scratch, NvU32 num_va_spaces, uvm_va_space_t *va_space,
+                           bool *found)
+{
+    NvU32 lo = 0;
+    NvU32 hi = num_va_spaces;
+
+    while (lo < hi) {
+        NvU32 mid = lo + (hi - lo) / 2;
+        int result = cmp_va_space(scratch->va_spaces[mid], va_space);
+
+        if (result == 0) {
+            *found = true;
+            return mid;
+        }
+
+        if (result < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    *found = false;
+    return lo;
+}
+
+void uvm_fault_sort_by_instance_ptr(uvm_fault_sort_scratch_t *scratch, uvm_fault_buffer_entry_t **entries, NvU32 count)
+{
+    NvU32 num_instance_ptrs = 0;
+    NvU32 rank = 0;
+    NvU32 i;
+
+    UVM_ASSERT(count <= scratch->max_entries);
+
+    if (count < 2)
+        return;
+
+    // Gather the distinct instance pointers in sorted order. Consecutive faults
+    // usually come from the same instance pointer, so check against the
+    // previous one first.
+    for (i = 0; i < count; ++i) {
+        bool found;
+
+        if (i > 0 && cmp_gpu_phys_addr(entries[i]->instance_ptr, entries[i - 1]->instance_ptr) == 0)
+            continue;
+
+        rank = instance_ptr_rank(scratch, num_instance_ptrs, entries[i]->instance_ptr, &found);
+        if (found)
+            continue;
+
+        if (num_instance_ptrs == UVM_FAULT_SORT_MAX_DISTINCT_KEYS) {
+            uvm_fault_sort_by_instance_ptr_generic(entries, count);
+            return;
+        }
+
+        memmove(&scratch->instance_ptrs[rank + 1],
+                &scratch->instance_ptrs[rank],
+                (num_instance_ptrs - rank) * sizeof(scratch->instance_ptrs[0]));
+        scratch->instance_ptrs[rank] = entries[i]->instance_ptr;
+        ++num_instance_ptrs;
+    }
+
+    // All faults come from the same instance pointer, nothing to sort
+    if (num_instance_ptrs == 1)
+        return;
+
+    for (i = 0; i < count; ++i) {
+        bool found;
+
+        if (i == 0 || cmp_gpu_phys_addr(entries[i]->instance_ptr, entries[i - 1]->instance_ptr) != 0) {
+            rank = instance_ptr_rank(scratch, num_instance_ptrs, entries[i]->instance_ptr, &found);
+            UVM_ASSERT(found);
+        }
+
+        scratch->keys[i] = rank;
+    }
+
+    fault_sort_radix(scratch, entries, count);
+}
+
+void uvm_fault_sort_by_va_space_address_access_type(uvm_fault_sort_scratch_t *scratch,
+                                                    uvm_fault_buffer_entry_t **entries,
+                                                    NvU32 count)
+{
+    NvU32 num_va_spaces = 0;
+    NvU32 rank = 0;
+    NvU32 i;
+
+    // Key layout: [63:58] VA space rank, [57:2] 4K page number, [1:0] access
+    // type. Fault addresses are at most 64 bits so their 4K page number always
+    // fits in 52 bits.
+    BUILD_BUG_ON(UVM_FAULT_SORT_MAX_DISTINCT_KEYS > (1 << 6));
+    BUILD_BUG_ON(UVM_FAULT_ACCESS_TYPE_MAX > (1 << 2));
+
+    UVM_ASSERT(count <= scratch->max_entries);
+
+    if (count < 2)
+        return;
+
+    for (i = 0; i < count; ++i) {
+        bool found;
+
+        if (i > 0 && entries[i]->va_space == entries[i - 1]->va_space)
+            continue;
+
+        rank = va_space_rank(scratch, num_va_spaces, entries[i]->va_space, &found);
+        if (found)
+            continue;
+
+        if (num_va_spaces == UVM_FAULT_SORT_MAX_DISTINCT_KEYS) {
+            uvm_fault_sort_by_va_space_address_access_type_generic(entries, count);
+            return;
+        }
+
+        memmove(&scratch->va_spaces[rank + 1],
+                &scratch->va_spaces[rank],
+                (num_va_spaces - rank) * sizeof(scratch->va_spaces[0]));
+        scratch->va_spaces[rank] = entries[i]->va_space;
+        ++num_va_spaces;
+    }
+
+    for (i = 0; i < count; ++i) {
+        uvm_fault_buffer_entry_t *entry = entries[i];
+        bool found;
+
+        if (i == 0 || entry->va_space != entries[i - 1]->va_space) {
+            rank = va_space_rank(scratch, num_va_spaces, entry->va_space, &found);
+            UVM_ASSERT(found);
+        }
+
+        UVM_ASSERT(IS_ALIGNED(entry->fault_address, 1ULL << 12));
+        UVM_ASSERT(entry->fault_access_type >= 0 && entry->fault_access_type < UVM_FAULT_ACCESS_TYPE_MAX);
+
+        scratch->keys[i] = ((NvU64)rank << 58) | ((entry->fault_address >> 12) << 2) | entry->fault_access_type;
+    }
+
+    fault_sort_radix(scratch, entries, count);
+}
+
 // Translate all instance pointers to VA spaces. Since the buffer is ordered by instance_ptr, we minimize the number of
 // translations
 //
 // This function returns NV_WARN_MORE_PROCESSING_REQUIRED if a fault buffer flush occurred and
 // executed successfully, or the error code if it failed. NV_OK otherwise.
+// If batch_context is NULL, the fault buffer is not flushed when a VA space
+// cannot be found and NV_ERR_INVALID_STATE is returned instead.
 static NV_STATUS translate_instance_ptrs(uvm_gpu_t *gpu, uvm_fault_buffer_entry_t **ordered_fault_cache,
-                                         uvm_fault_service_batch_context_t *batch_context)
+                                         NvU32 num_faults, uvm_fault_service_batch_context_t *batch_context)
 {
     uvm_gpu_phys_address_t prev_instance_ptr = { 0, 0 };
     NvU32 i;
 
-    for (i = 0; i < batch_context->cached_faults; ++i) {
+    for (i = 0; i < num_faults; ++i) {
         uvm_fault_buffer_entry_t *current_entry;
 
         current_entry = ordered_fault_cache[i];
@@ -732,6 +1249,9 @@ static NV_STATUS translate_instance_ptrs(uvm_gpu_t *gpu, uvm_fault_buffer_entry_
         if (current_entry->va_space == NULL) {
             NV_STATUS status;
 
+            if (!batch_context)
+                return NV_ERR_INVALID_STATE;
+
             status = fault_buffer_flush_locked(gpu,
                                                FAULT_BUFFER_FLUSH_MODE_UPDATE_PUT,
                                                UVM_FAULT_REPLAY_TYPE_START,
@@ -746,6 +1266,50 @@ static NV_STATUS translate_instance_ptrs(uvm_gpu_t *gpu, uvm_fault_buffer_entry_
     return NV_OK;
 }
 
+// Account for a fault of the given uTLB that does not need further servicing. The uTLB is considered completed
+// when none of its faults in the batch are pending and none of them were fatal, since replaying a uTLB with fatal
+// faults would only make them show up again.
+static void utlb_fault_serviced(uvm_fault_utlb_info_t *utlb, uvm_fault_service_batch_context_t *batch_context)
+{
+    UVM_ASSERT(utlb->num_pending_faults > 0);
+    --utlb->num_pending_faults;
+
+    if (utlb->num_pending_faults == 0 && utlb->num_fatal_faults == 0)
+        ++batch_context->num_completed_utlbs;
+}
+
+// Coalesce runs of faults in the ordered view with the same VA space, fault address and access type. The first
+// fault of each run becomes its representative and gets num_instances set to the length of the run. The rest of the
+// faults in the run get num_instances set to 0. Only representatives are serviced, the rest of the run just inherits
+// the outcome (see service_fault_batch_block_locked).
+//
+// Faults with different access types on the same page are not coalesced, as they can have a different outcome
+// (i.e. a write fault on a read-only page is fatal but a read fault is not). Faults that have been already flagged
+// as fatal are not coalesced either.
+static void coalesce_fault_batch(uvm_fault_buffer_entry_t **ordered_fault_cache, NvU32 num_faults)
+{
+    NvU32 i;
+    uvm_fault_buffer_entry_t *representative = NULL;
+
+    for (i = 0; i < num_faults; ++i) {
+        uvm_fault_buffer_entry_t *current_entry = ordered_fault_cache[i];
+
+        if (representative &&
+            !representative->is_fatal &&
+            !current_entry->is_fatal &&
+            current_entry->va_space == representative->va_space &&
+            current_entry->fault_address == representative->fault_address &&
+            current_entry->fault_access_type == representative->fault_access_type) {
+            ++representative->num_instances;
+            current_entry->num_instances = 0;
+        }
+        else {
+            representative = current_entry;
+            representative->num_instances = 1;
+        }
+    }
+}
+
 // Fault cache preprocessing for fault coalescing
 //
 // This function generates an ordered view of the given fault_cache in which faults are sorted by VA space, fault
@@ -753,48 +1317,96 @@ static NV_STATUS translate_instance_ptrs(uvm_gpu_t *gpu, uvm_fault_buffer_entry_
 // the number of instance_ptr to VA space translations we perform a first sort by instance_ptr.
 //
 // This function returns NV_WARN_MORE_PROCESSING_REQUIRED if a fault buffer flush occurred during instance_ptr
-// translation and executed successfully, or the error code if it failed. NV_OK otherwise.
+// translation and executed successfully, or the error code if it failed. NV_OK otherwise. batch_context is NULL
+// when preprocessing a prefetched batch, in which case the buffer is never flushed (see translate_instance_ptrs).
 //
 // Current scheme:
 // 1) sort by instance_ptr
 // 2) translate all instance_ptrs to VA spaces
 // 3) sort by va_space, fault address (GPU already reports 4K-aligned address) and access type
-static NV_STATUS preprocess_fault_batch(uvm_gpu_t *gpu, uvm_fault_service_batch_context_t *batch_context)
+// 4) coalesce faults with the same va_space, fault address and access type
+//
+// Both sorts are performed by the specialized fault sort (see
+// uvm_fault_sort_scratch_t), which falls back to the generic sort() if the
+// batch contains too many distinct instance pointers or VA spaces.
+static NV_STATUS preprocess_faults(uvm_gpu_t *gpu,
+                                   uvm_fault_buffer_entry_t *fault_cache,
+                                   uvm_fault_buffer_entry_t **ordered_fault_cache,
+                                   NvU32 num_faults,
+                                   uvm_fault_service_batch_context_t *batch_context)
 {
     NV_STATUS status;
     NvU32 i;
-    uvm_fault_buffer_entry_t *fault_cache;
-    uvm_fault_buffer_entry_t **ordered_fault_cache;
     uvm_replayable_fault_buffer_info_t *replayable_faults = &gpu->fault_buffer_info.replayable;
 
-    UVM_ASSERT(batch_context->cached_faults > 0);
-
-    fault_cache = replayable_faults->fault_cache;
-    ordered_fault_cache = replayable_faults->ordered_fault_cache;
+    UVM_ASSERT(num_faults > 0);
 
     // Generate an ordered view of the fault cache in ordered_fault_cache. We sort the pointers, not the entries
     // in fault_cache
 
     // Initialize pointers before they are sorted
-    for (i = 0; i < batch_context->cached_faults; ++i)
+    for (i = 0; i < num_faults; ++i)
         ordered_fault_cache[i] = &fault_cache[i];
 
     // 1) sort by instance_ptr
-    sort(ordered_fault_cache, batch_context->cached_faults, sizeof(*ordered_fault_cache),
-         cmp_sort_fault_entry_by_instance_ptr, NULL);
+    uvm_fault_sort_by_instance_ptr(&replayable_faults->sort_scratch, ordered_fault_cache, num_faults);
 
     // 2) translate all instance_ptrs to VA spaces
-    status = translate_instance_ptrs(gpu, ordered_fault_cache, batch_context);
+    status = translate_instance_ptrs(gpu, ordered_fault_cache, num_faults, batch_context);
     if (status != NV_OK)
         return status;
 
     // 3) sort by va_space, fault address (GPU already reports 4K-aligned address) and access type
-    sort(ordered_fault_cache, batch_context->cached_faults, sizeof(*ordered_fault_cache),
-         cmp_sort_fault_entry_by_va_space_address_access_type, NULL);
+    uvm_fault_sort_by_va_space_address_access_type(&replayable_faults->sort_scratch, ordered_fault_cache, num_faults);
+
+    // 4) coalesce faults with the same va_space, fault address and access type
+    coalesce_fault_batch(ordered_fault_cache, num_faults);
 
     return NV_OK;
 }
 
+static NV_STATUS preprocess_fault_batch(uvm_gpu_t *gpu, uvm_fault_service_batch_context_t *batch_context)
+{
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &gpu->fault_buffer_info.replayable;
+
+    return preprocess_faults(gpu,
+                             replayable_faults->fault_cache,
+                             replayable_faults->ordered_fault_cache,
+                             batch_context->cached_faults,
+                             batch_context);
+}
+
+// Fetch and preprocess the next fault batch into the prefetch fault caches.
+// This is called by the bottom half while the fault service workers service
+// the current batch, so it must not touch any state used by them or by the
+// replay policies: the uTLB information is only updated when the batch
+// becomes the current one (see swap_in_prefetched_batch), and the fault buffer
+// is never flushed from here.
+static void prefetch_fault_batch(uvm_gpu_t *gpu)
+{
+    NV_STATUS status;
+    NvU32 cached_faults;
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &gpu->fault_buffer_info.replayable;
+
+    if (!replayable_faults->prefetch.enabled || replayable_faults->prefetch.cached_faults > 0)
+        return;
+
+    cached_faults = fetch_fault_buffer_entries_to_cache(gpu,
+                                                        replayable_faults->prefetch.fault_cache,
+                                                        FAULT_FETCH_MODE_BATCH_READY);
+    if (cached_faults == 0)
+        return;
+
+    status = preprocess_faults(gpu,
+                               replayable_faults->prefetch.fault_cache,
+                               replayable_faults->prefetch.ordered_fault_cache,
+                               cached_faults,
+                               NULL);
+
+    replayable_faults->prefetch.cached_faults = cached_faults;
+    replayable_faults->prefetch.preprocessed = (status == NV_OK);
+}
+
 // We notify the fault event for all faults within the block so that the
 // performance heuristics are updated. Then, all required actions for the block
 // data are performed by the performance heuristics code.
@@ -811,11 +1423,13 @@ static NV_STATUS preprocess_fault_batch(uvm_gpu_t *gpu, uvm_fault_service_batch_
 static NV_STATUS service_fault_batch_block_locked(uvm_gpu_t *gpu,
                                                   uvm_va_block_t *va_block, uvm_va_block_retry_t *va_block_retry,
                                                   NvU32 first_fault_index,
+                                                  uvm_fault_service_block_context_t *service_context,
                                                   uvm_fault_service_batch_context_t *batch_context,
                                                   NvU32 *block_faults)
 {
     NV_STATUS status = NV_OK;
     NvU32 i;
+    NvU32 j;
     NvU32 block_fatal_faults = 0;
     NvU32 block_throttled_faults = 0;
     NvU32 block_invalid_prefetch_faults = 0;
@@ -825,7 +1439,6 @@ static NV_STATUS service_fault_batch_block_locked(uvm_gpu_t *gpu,
     uvm_range_group_range_iter_t iter;
     uvm_replayable_fault_buffer_info_t *replayable_faults = &gpu->fault_buffer_info.replayable;
     uvm_fault_buffer_entry_t **ordered_fault_cache = replayable_faults->ordered_fault_cache;
-    uvm_fault_service_block_context_t *service_context = &replayable_faults->block_service_context;
 
     // Check that all uvm_fault_access_type_t values can fit into an NvU8
     BUILD_BUG_ON(UVM_FAULT_ACCESS_TYPE_MAX > (int)(NvU8)-1);
@@ -851,7 +1464,7 @@ static NV_STATUS service_fault_batch_block_locked(uvm_gpu_t *gpu,
     // Scan the sorted array and notify the fault event for all fault entries in the block
     for (i = first_fault_index;
         (i < batch_context->cached_faults) && (ordered_fault_cache[i]->fault_address <= va_block->end);
-        ++i) {
+        i += ordered_fault_cache[i]->num_instances) {
         uvm_perf_event_data_t event_data;
         uvm_fault_buffer_entry_t *current_entry = ordered_fault_cache[i];
         uvm_fault_buffer_entry_t *previous_entry = NULL;
@@ -863,6 +1476,8 @@ static NV_STATUS service_fault_batch_block_locked(uvm_gpu_t *gpu,
                                                                            current_entry->fault_address,
                                                                            PAGE_SIZE);
 
+        UVM_ASSERT(current_entry->num_instances > 0);
+
         current_entry->is_fatal            = false;
         current_entry->is_throttled        = false;
         current_entry->is_invalid_prefetch = false;
@@ -887,7 +1502,8 @@ static NV_STATUS service_fault_batch_block_locked(uvm_gpu_t *gpu,
             uvm_perf_event_notify(&current_entry->va_space->perf_events, UVM_PERF_EVENT_FAULT, &event_data);
         }
 
-        // Service the most intrusive fault per page, only. Waive the rest
+        // Service the most intrusive fault per page, only. Waive the rest. Faults with the same access type have
+        // been already coalesced, so here the previous fault has a more intrusive access type
         if (i > first_fault_index && current_entry->fault_address == previous_entry->fault_address) {
             // Propagate the is_invalid_prefetch flag across all prefetch faults on the page
             if (previous_entry->is_invalid_prefetch)
@@ -977,25 +1593,38 @@ static NV_STATUS service_fault_batch_block_locked(uvm_gpu_t *gpu,
             last_page_index = region.first;
 
     next:
-        // Only update counters the first time since logical permissions cannot change while we hold the
-        // VA space lock
-        // TODO: Bug 1750144: That might not be true with HMM.
-        if (service_context->num_retries == 0) {
-            uvm_fault_utlb_info_t *utlb = &replayable_faults->utlbs[current_entry->fault_source.utlb_id];
+        // Faults coalesced into the current one share its outcome
+        for (j = i; j < i + current_entry->num_instances; ++j) {
+            uvm_fault_buffer_entry_t *entry = ordered_fault_cache[j];
+
+            if (j > i) {
+                UVM_ASSERT(entry->num_instances == 0);
 
-            if (current_entry->is_fatal) {
-                ++block_fatal_faults;
-                ++utlb->num_fatal_faults;
+                entry->is_fatal            = current_entry->is_fatal;
+                entry->fatal_reason        = current_entry->fatal_reason;
+                entry->is_throttled        = current_entry->is_throttled;
+                entry->is_invalid_prefetch = current_entry->is_invalid_prefetch;
             }
 
-            if (current_entry->is_invalid_prefetch)
-                ++block_invalid_prefetch_faults;
+            // Only update counters the first time since logical permissions cannot change while we hold the
+            // VA space lock. The uTLBs are updated by the caller, see utlb_block_faults_serviced.
+            // TODO: Bug 1750144: That might not be true with HMM.
+            if (service_context->num_retries == 0) {
+                // The representative fault has been already notified
+                if (j > i) {
+                    event_data.fault.gpu.buffer_entry = entry;
+                    uvm_perf_event_notify(&entry->va_space->perf_events, UVM_PERF_EVENT_FAULT, &event_data);
+                }
 
-            if (current_entry->is_throttled)
-                ++block_throttled_faults;
+                if (entry->is_fatal)
+                    ++block_fatal_faults;
 
-            UVM_ASSERT(utlb->num_pending_faults > 0);
-            --utlb->num_pending_faults;
+                if (entry->is_invalid_prefetch)
+                    ++block_invalid_prefetch_faults;
+
+                if (entry->is_throttled)
+                    ++block_throttled_faults;
+            }
         }
     }
 
@@ -1032,13 +1661,13 @@ static NV_STATUS service_fault_batch_block_locked(uvm_gpu_t *gpu,
 // See the comments for function service_fault_batch_block_locked for implementation details and error codes.
 static NV_STATUS service_fault_batch_block(uvm_gpu_t *gpu, uvm_va_block_t *va_block,
                                            NvU32 first_fault_index,
+                                           uvm_fault_service_block_context_t *service_context,
                                            uvm_fault_service_batch_context_t *batch_context,
                                            NvU32 *block_faults)
 {
     NV_STATUS status;
     uvm_va_block_retry_t va_block_retry;
     NV_STATUS tracker_status;
-    uvm_fault_service_block_context_t *service_context = &gpu->fault_buffer_info.replayable.block_service_context;
 
     service_context->num_retries = 0;
 
@@ -1049,6 +1678,7 @@ static NV_STATUS service_fault_batch_block(uvm_gpu_t *gpu, uvm_va_block_t *va_bl
                                                                         va_block,
                                                                         &va_block_retry,
                                                                         first_fault_index,
+                                                                        service_context,
                                                                         batch_context,
                                                                         block_faults));
 
@@ -1068,6 +1698,190 @@ typedef enum
     FAULT_SERVICE_MODE_CANCEL,
 } fault_service_mode_t;
 
+// Account the faults of a serviced VA block in their uTLBs. This is done once the block has been serviced, rather
+// than while servicing it, so that the fault service workers never update the per-uTLB state concurrently.
+static void utlb_block_faults_serviced(uvm_replayable_fault_buffer_info_t *replayable_faults,
+                                       NvU32 first_fault_index,
+                                       NvU32 block_faults,
+                                       uvm_fault_service_batch_context_t *batch_context)
+{
+    NvU32 i;
+
+    for (i = first_fault_index; i < first_fault_index + block_faults; ++i) {
+        uvm_fault_buffer_entry_t *entry = replayable_faults->ordered_fault_cache[i];
+        uvm_fault_utlb_info_t *utlb = &replayable_faults->utlbs[entry->fault_source.utlb_id];
+
+        if (entry->is_fatal)
+            ++utlb->num_fatal_faults;
+
+        utlb_fault_serviced(utlb, batch_context);
+    }
+}
+
+// Number of faults in the ordered view, starting at first_fault_index, that service_fault_batch_block_locked
+// services for the given VA block
+static NvU32 count_block_faults(uvm_fault_buffer_entry_t **ordered_fault_cache,
+                                NvU32 first_fault_index,
+                                NvU32 cached_faults,
+                                uvm_va_block_t *va_block)
+{
+    NvU32 i = first_fault_index;
+
+    while (i < cached_faults &&
+           ordered_fault_cache[i]->fault_address <= va_block->end &&
+           ordered_fault_cache[i]->va_space == ordered_fault_cache[first_fault_index]->va_space) {
+        UVM_ASSERT(ordered_fault_cache[i]->num_instances > 0);
+        i += ordered_fault_cache[i]->num_instances;
+    }
+
+    return i - first_fault_index;
+}
+
+static void fault_service_worker(void *args)
+{
+    fault_service_worker_t *worker = (fault_service_worker_t *)args;
+    uvm_fault_service_workers_t *workers = worker->workers;
+    NvU64 start_time = NV_GETTIME();
+    NvU32 num_blocks = 0;
+    NvU32 num_faults = 0;
+    NvU32 block_index;
+
+    // The VA space lock is held in read mode by the bottom half on behalf of the workers
+    uvm_record_lock(&workers->va_space->lock, UVM_LOCK_MODE_SHARED);
+
+    while (atomic_read(&workers->error) == 0) {
+        fault_service_work_block_t *block;
+        NvU32 block_faults;
+        NV_STATUS status;
+
+        block_index = atomic_inc_return(&workers->next_block) - 1;
+        if (block_index >= workers->num_blocks)
+            break;
+
+        block = &workers->blocks[block_index];
+
+        status = service_fault_batch_block(workers->gpu,
+                                           block->va_block,
+                                           block->first_fault_index,
+                                           worker->block_service_context,
+                                           &worker->batch_context,
+                                           &block_faults);
+        if (status != NV_OK) {
+            worker->status = status;
+            atomic_set(&workers->error, 1);
+            break;
+        }
+
+        UVM_ASSERT(block_faults == block->num_faults);
+
+        ++num_blocks;
+        num_faults += block_faults;
+    }
+
+    uvm_record_unlock(&workers->va_space->lock, UVM_LOCK_MODE_SHARED);
+
+    atomic64_add(NV_GETTIME() - start_time, &worker->stats.service_time_ns);
+    atomic64_add(num_blocks, &worker->stats.num_blocks);
+    atomic64_add(num_faults, &worker->stats.num_faults);
+
+    if (atomic_dec_and_test(&workers->num_active_workers))
+        wake_up(&workers->done_wait_queue);
+}
+
+// Service the VA blocks queued for the fault service workers and wait for them. Then account their faults in the
+// uTLBs and the batch context, and issue a replay if required by the replay policy. Since the blocks are serviced
+// in parallel, UVM_PERF_FAULT_REPLAY_POLICY_BLOCK and UVM_PERF_FAULT_REPLAY_POLICY_UTLB issue a single replay after
+// all of them have been serviced.
+//
+// The lock of the VA space the blocks belong to must be held in read mode.
+static NV_STATUS service_fault_batch_blocks_parallel(uvm_gpu_t *gpu,
+                                                     uvm_va_space_t *va_space,
+                                                     fault_service_mode_t service_mode,
+                                                     uvm_fault_service_batch_context_t *batch_context)
+{
+    NV_STATUS status = NV_OK;
+    NvU32 i;
+    NvU32 num_workers;
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &gpu->fault_buffer_info.replayable;
+    uvm_fault_service_workers_t *workers = replayable_faults->service_workers;
+
+    if (workers->num_blocks == 0)
+        return NV_OK;
+
+    uvm_assert_rwsem_locked_read(&va_space->lock);
+
+    workers->va_space = va_space;
+    atomic_set(&workers->next_block, 0);
+    atomic_set(&workers->error, 0);
+
+    num_workers = min(workers->num_workers, workers->num_blocks);
+    atomic_set(&workers->num_active_workers, num_workers);
+
+    for (i = 0; i < num_workers; ++i) {
+        fault_service_worker_t *worker = &workers->workers[i];
+
+        worker->status = NV_OK;
+        worker->batch_context.cached_faults           = batch_context->cached_faults;
+        worker->batch_context.batch_id                = batch_context->batch_id;
+        worker->batch_context.fatal_faults            = 0;
+        worker->batch_context.serviced_faults         = 0;
+        worker->batch_context.throttled_faults        = 0;
+        worker->batch_context.invalid_prefetch_faults = 0;
+
+        nv_kthread_q_schedule_q_item(&worker->q, &worker->q_item);
+    }
+
+    // Get the next batch ready while the workers are busy
+    if (service_mode == FAULT_SERVICE_MODE_REGULAR)
+        prefetch_fault_batch(gpu);
+
+    wait_event(workers->done_wait_queue, atomic_read(&workers->num_active_workers) == 0);
+
+    for (i = 0; i < num_workers; ++i) {
+        fault_service_worker_t *worker = &workers->workers[i];
+        NV_STATUS tracker_status;
+
+        if (status == NV_OK)
+            status = worker->status;
+
+        batch_context->fatal_faults            += worker->batch_context.fatal_faults;
+        batch_context->serviced_faults         += worker->batch_context.serviced_faults;
+        batch_context->throttled_faults        += worker->batch_context.throttled_faults;
+        batch_context->invalid_prefetch_faults += worker->batch_context.invalid_prefetch_faults;
+
+        tracker_status = uvm_tracker_add_tracker_safe(&batch_context->tracker, &worker->batch_context.tracker);
+        uvm_tracker_clear(&worker->batch_context.tracker);
+        if (status == NV_OK)
+            status = tracker_status;
+    }
+
+    if (status == NV_OK) {
+        for (i = 0; i < workers->num_blocks; ++i) {
+            utlb_block_faults_serviced(replayable_faults,
+                                       workers->blocks[i].first_fault_index,
+                                       workers->blocks[i].num_faults,
+                                       batch_context);
+        }
+    }
+
+    workers->num_blocks = 0;
+
+    if (status != NV_OK)
+        return status;
+
+    // Don't issue replays in cancel mode
+    if (service_mode != FAULT_SERVICE_MODE_CANCEL &&
+        uvm_perf_fault_replay_policy_should_replay(replayable_faults->replay_policy,
+                                                   UVM_PERF_FAULT_REPLAY_POINT_BLOCK,
+                                                   batch_context->num_completed_utlbs)) {
+        status = push_replay_on_gpu(gpu, UVM_FAULT_REPLAY_TYPE_START, batch_context);
+        batch_context->num_completed_utlbs = 0;
+        ++batch_context->batch_id;
+    }
+
+    return status;
+}
+
 // Scan the ordered view of faults and group them by different va_blocks. Service faults for each va_block, in batch.
 //
 // This function returns NV_WARN_MORE_PROCESSING_REQUIRED if the fault buffer was flushed because the
@@ -1080,9 +1894,12 @@ static NV_STATUS service_fault_batch(uvm_gpu_t *gpu, fault_service_mode_t servic
     uvm_va_space_t *va_space = NULL;
     uvm_replayable_fault_buffer_info_t *replayable_faults = &gpu->fault_buffer_info.replayable;
     uvm_fault_buffer_entry_t **ordered_fault_cache = replayable_faults->ordered_fault_cache;
+    uvm_fault_service_workers_t *workers = replayable_faults->service_workers;
 
     UVM_ASSERT(uvm_gpu_supports_replayable_faults(gpu));
 
+    batch_context->num_completed_utlbs = 0;
+
     for (i = 0; i < batch_context->cached_faults;) {
         uvm_va_block_t *va_block;
         uvm_fault_buffer_entry_t *current_entry = ordered_fault_cache[i];
@@ -1092,6 +1909,14 @@ static NV_STATUS service_fault_batch(uvm_gpu_t *gpu, fault_service_mode_t servic
 
         if (current_entry->va_space != va_space) {
             uvm_gpu_va_space_t *gpu_va_space;
+
+            // Service the blocks queued for the workers before dropping the VA space lock
+            if (workers && va_space != NULL) {
+                status = service_fault_batch_blocks_parallel(gpu, va_space, service_mode, batch_context);
+                if (status != NV_OK)
+                    goto fail;
+            }
+
             // Fault on a different va_space, drop the lock of the old one...
             if (va_space != NULL)
                 uvm_va_space_up_read(va_space);
@@ -1118,13 +1943,13 @@ static NV_STATUS service_fault_batch(uvm_gpu_t *gpu, fault_service_mode_t servic
             // The case where there is no valid GPU VA space for the GPU in this VA space is handled next
         }
 
-        // Some faults could be already fatal if they cannot be handled by the UVM driver
+        // Some faults could be already fatal if they cannot be handled by the UVM driver. These are never coalesced
         if (current_entry->is_fatal) {
+            UVM_ASSERT(current_entry->num_instances == 1);
             ++i;
             ++batch_context->fatal_faults;
             ++utlb->num_fatal_faults;
-            UVM_ASSERT(utlb->num_pending_faults > 0);
-            --utlb->num_pending_faults;
+            utlb_fault_serviced(utlb, batch_context);
             continue;
         }
 
@@ -1133,30 +1958,52 @@ static NV_STATUS service_fault_batch(uvm_gpu_t *gpu, fault_service_mode_t servic
             // space is destroyed without explicitly freeing all memory ranges (destroying the VA range triggers a
             // flush of the fault buffer) and there are stale entries in the buffer that got fixed by the servicing
             // in a previous batch
-            ++i;
+            i += current_entry->num_instances;
             continue;
         }
 
         status = uvm_va_block_find_create(current_entry->va_space, current_entry->fault_address, &va_block);
-        if (status == NV_OK) {
+        if (status == NV_OK && workers) {
+            // Queue the block for the workers, they are serviced when the VA space changes or the batch ends
+            fault_service_work_block_t *block = &workers->blocks[workers->num_blocks++];
+
+            block->va_block = va_block;
+            block->first_fault_index = i;
+            block->num_faults = count_block_faults(ordered_fault_cache, i, batch_context->cached_faults, va_block);
+
+            i += block->num_faults;
+        }
+        else if (status == NV_OK) {
             NvU32 block_faults;
 
-            status = service_fault_batch_block(gpu, va_block, i, batch_context, &block_faults);
+            status = service_fault_batch_block(gpu,
+                                               va_block,
+                                               i,
+                                               &replayable_faults->block_service_context,
+                                               batch_context,
+                                               &block_faults);
 
             // When service_fault_batch_block returns != NV_OK something really bad happened
             if (status != NV_OK)
                 goto fail;
 
+            utlb_block_faults_serviced(replayable_faults, i, block_faults, batch_context);
+
             // Don't issue replays in cancel mode
             if (service_mode != FAULT_SERVICE_MODE_CANCEL &&
-                replayable_faults->replay_policy == UVM_PERF_FAULT_REPLAY_POLICY_BLOCK) {
+                uvm_perf_fault_replay_policy_should_replay(replayable_faults->replay_policy,
+                                                           UVM_PERF_FAULT_REPLAY_POINT_BLOCK,
+                                                           batch_context->num_completed_utlbs)) {
                 status = push_replay_on_gpu(gpu, UVM_FAULT_REPLAY_TYPE_START, batch_context);
                 if (status != NV_OK)
                     goto fail;
 
+                batch_context->num_completed_utlbs = 0;
+
                 // Increment the batch id if UVM_PERF_FAULT_REPLAY_POLICY_BLOCK
-                // is used, as we issue a replay after servicing each VA block
-                // and we can service a number of VA blocks before returning.
+                // or UVM_PERF_FAULT_REPLAY_POLICY_UTLB are used, as we can
+                // issue a replay after servicing each VA block and we can
+                // service a number of VA blocks before returning.
                 ++batch_context->batch_id;
             }
 
@@ -1165,46 +2012,74 @@ static NV_STATUS service_fault_batch(uvm_gpu_t *gpu, fault_service_mode_t servic
         else {
             // Avoid dropping fault events when the VA block is not found or cannot be created
             uvm_perf_event_data_t event_data;
+            NV_STATUS find_status = status;
+            NvU32 j;
 
             event_data.fault.block = NULL;
             event_data.fault.space = va_space;
             event_data.fault.proc_id = gpu->id;
-            event_data.fault.gpu.buffer_entry = current_entry;
 
-            uvm_perf_event_notify(&va_space->perf_events, UVM_PERF_EVENT_FAULT, &event_data);
+            // All the faults coalesced into the current one get the same outcome
+            for (j = i; j < i + current_entry->num_instances; ++j) {
+                uvm_fault_buffer_entry_t *entry = ordered_fault_cache[j];
 
-            UVM_ASSERT(utlb->num_pending_faults > 0);
-            --utlb->num_pending_faults;
+                utlb = &replayable_faults->utlbs[entry->fault_source.utlb_id];
+                status = find_status;
 
-            if (status != NV_OK && current_entry->fault_access_type == UVM_FAULT_ACCESS_TYPE_PREFETCH) {
-                if (status == NV_ERR_INVALID_ADDRESS)
-                    ++batch_context->invalid_prefetch_faults;
+                event_data.fault.gpu.buffer_entry = entry;
 
-                // Do not flag prefetch faults as fatal unless something fatal happened
-                if (status != uvm_global_get_status())
-                    status = NV_OK;
-            }
+                uvm_perf_event_notify(&va_space->perf_events, UVM_PERF_EVENT_FAULT, &event_data);
 
-            if (status != NV_OK) {
-                // If the VA block cannot be found, set the fatal fault flag
-                current_entry->is_fatal = true;
-                current_entry->fatal_reason = uvm_tools_status_to_fatal_fault_reason(status);
+                if (status != NV_OK && entry->fault_access_type == UVM_FAULT_ACCESS_TYPE_PREFETCH) {
+                    if (status == NV_ERR_INVALID_ADDRESS)
+                        ++batch_context->invalid_prefetch_faults;
+
+                    // Do not flag prefetch faults as fatal unless something fatal happened
+                    if (status != uvm_global_get_status())
+                        status = NV_OK;
+                }
 
-                ++batch_context->fatal_faults;
-                ++utlb->num_fatal_faults;
+                if (status != NV_OK) {
+                    // If the VA block cannot be found, set the fatal fault flag
+                    entry->is_fatal = true;
+                    entry->fatal_reason = uvm_tools_status_to_fatal_fault_reason(status);
+
+                    ++batch_context->fatal_faults;
+                    ++utlb->num_fatal_faults;
+                }
+
+                utlb_fault_serviced(utlb, batch_context);
 
                 // Do not exit early due to logical errors
-                if (status != NV_ERR_INVALID_ADDRESS)
+                if (status != NV_OK && status != NV_ERR_INVALID_ADDRESS)
                     goto fail;
 
                 status = NV_OK;
             }
 
-            ++i;
+            i += current_entry->num_instances;
         }
     }
 
+    if (workers && va_space != NULL && status == NV_OK)
+        status = service_fault_batch_blocks_parallel(gpu, va_space, service_mode, batch_context);
+
+    // Don't issue replays in cancel mode
+    if (status == NV_OK &&
+        service_mode != FAULT_SERVICE_MODE_CANCEL &&
+        uvm_perf_fault_replay_policy_should_replay(replayable_faults->replay_policy,
+                                                   UVM_PERF_FAULT_REPLAY_POINT_BATCH_SERVICED,
+                                                   batch_context->num_completed_utlbs)) {
+        status = push_replay_on_gpu(gpu, UVM_FAULT_REPLAY_TYPE_START, batch_context);
+        batch_context->num_completed_utlbs = 0;
+        ++batch_context->batch_id;
+    }
+
 fail:
+    // Drop the blocks that could not be serviced
+    if (workers)
+        workers->num_blocks = 0;
+
     if (va_space != NULL)
         uvm_va_space_up_read(va_space);
 
@@ -1582,7 +2457,8 @@ static NV_STATUS service_fault_buffer(uvm_gpu_t *gpu)
     NvU32 num_batches = 0;
     NvU32 num_throttled = 0;
     NV_STATUS status = NV_OK;
-    uvm_fault_service_batch_context_t *batch_context = &gpu->fault_buffer_info.replayable.batch_service_context;
+    uvm_replayable_fault_buffer_info_t *replayable_faults = &gpu->fault_buffer_info.replayable;
+    uvm_fault_service_batch_context_t *batch_context = &replayable_faults->batch_service_context;
 
     uvm_tracker_init(&batch_context->tracker);
 
@@ -1601,13 +2477,34 @@ static NV_STATUS service_fault_buffer(uvm_gpu_t *gpu)
         batch_context->invalid_prefetch_faults = 0;
         batch_context->replays                 = 0;
 
-        batch_context->cached_faults = fetch_fault_buffer_entries(gpu, FAULT_FETCH_MODE_BATCH_READY);
-        ++batch_context->batch_id;
+        if (replayable_faults->prefetch.cached_faults > 0) {
+            bool preprocessed = replayable_faults->prefetch.preprocessed;
 
-        if (batch_context->cached_faults == 0)
-            break;
+            batch_context->cached_faults = swap_in_prefetched_batch(gpu);
+            ++batch_context->batch_id;
 
-        status = preprocess_fault_batch(gpu, batch_context);
+            status = preprocessed? NV_OK: preprocess_fault_batch(gpu, batch_context);
+        }
+        else {
+            batch_context->cached_faults = fetch_fault_buffer_entries(gpu, FAULT_FETCH_MODE_BATCH_READY);
+            ++batch_context->batch_id;
+
+            if (batch_context->cached_faults == 0)
+                break;
+
+            status = preprocess_fault_batch(gpu, batch_context);
+        }
+
+        ++replayable_faults->stats.num_batches;
+
+        // The next batch can be fetched while this one is serviced as long as
+        // it is going to be serviced in this invocation, too. With the
+        // BATCH_FLUSH policy the next batch would be dropped by the flush that
+        // follows the current one, so it is not fetched ahead of time.
+        replayable_faults->prefetch.enabled = replayable_faults->service_workers &&
+                                              replayable_faults->replay_policy !=
+                                                  UVM_PERF_FAULT_REPLAY_POLICY_BATCH_FLUSH &&
+                                              num_batches + 1 < uvm_perf_fault_max_batches_per_service;
 
         replays += batch_context->replays;
 
@@ -1655,23 +2552,27 @@ static NV_STATUS service_fault_buffer(uvm_gpu_t *gpu)
             break;
         }
 
-        if (gpu->fault_buffer_info.replayable.replay_policy == UVM_PERF_FAULT_REPLAY_POLICY_BATCH) {
-            status = push_replay_on_gpu(gpu, UVM_FAULT_REPLAY_TYPE_START, batch_context);
-            if (status != NV_OK)
-                break;
-            ++replays;
-        }
-        else if (gpu->fault_buffer_info.replayable.replay_policy == UVM_PERF_FAULT_REPLAY_POLICY_BATCH_FLUSH) {
-            status = fault_buffer_flush_locked(gpu,
-                                               FAULT_BUFFER_FLUSH_MODE_CACHED_PUT,
-                                               UVM_FAULT_REPLAY_TYPE_START,
-                                               batch_context);
-            if (status != NV_OK)
-                break;
-            ++replays;
-            status = uvm_tracker_wait(&gpu->fault_buffer_info.replayable.replay_tracker);
-            if (status != NV_OK)
-                break;
+        if (uvm_perf_fault_replay_policy_should_replay(replayable_faults->replay_policy,
+                                                       UVM_PERF_FAULT_REPLAY_POINT_BATCH_END,
+                                                       batch_context->num_completed_utlbs)) {
+            if (replayable_faults->replay_policy == UVM_PERF_FAULT_REPLAY_POLICY_BATCH_FLUSH) {
+                status = fault_buffer_flush_locked(gpu,
+                                                   FAULT_BUFFER_FLUSH_MODE_CACHED_PUT,
+                                                   UVM_FAULT_REPLAY_TYPE_START,
+                                                   batch_context);
+                if (status != NV_OK)
+                    break;
+                ++replays;
+                status = uvm_tracker_wait(&replayable_faults->replay_tracker);
+                if (status != NV_OK)
+                    break;
+            }
+            else {
+                status = push_replay_on_gpu(gpu, UVM_FAULT_REPLAY_TYPE_START, batch_context);
+                if (status != NV_OK)
+                    break;
+                ++replays;
+            }
         }
 
         if (batch_context->throttled_faults > 0)
@@ -1680,11 +2581,22 @@ static NV_STATUS service_fault_buffer(uvm_gpu_t *gpu)
         ++num_batches;
     }
 
+    replayable_faults->prefetch.enabled = false;
+
     // Make sure that we issue at least one replay if no replay has been issued yet to avoid dropping faults that do
-    // not show up in the buffer
-    if ((status == NV_OK && gpu->fault_buffer_info.replayable.replay_policy == UVM_PERF_FAULT_REPLAY_POLICY_ONCE) ||
-        replays == 0)
-        status = push_replay_on_gpu(gpu, UVM_FAULT_REPLAY_TYPE_START, batch_context);
+    // not show up in the buffer. The same applies to the faults in a batch prefetched while servicing the last one,
+    // which is not going to be serviced.
+    if (discard_prefetched_batch(replayable_faults) ||
+        (status == NV_OK &&
+         uvm_perf_fault_replay_policy_should_replay(replayable_faults->replay_policy,
+                                                    UVM_PERF_FAULT_REPLAY_POINT_BUFFER_END,
+                                                    batch_context->num_completed_utlbs)) ||
+        replays == 0) {
+        NV_STATUS replay_status = push_replay_on_gpu(gpu, UVM_FAULT_REPLAY_TYPE_START, batch_context);
+
+        if (status == NV_OK || replays == 0)
+            status = replay_status;
+    }
 
     uvm_tracker_deinit(&batch_context->tracker);
 
@@ -1827,17 +2739,49 @@ void uvm_gpu_disable_prefetch_faults(uvm_gpu_t *gpu)
 
 const char *uvm_perf_fault_replay_policy_string(uvm_perf_fault_replay_policy_t replay_policy)
 {
-    BUILD_BUG_ON(UVM_PERF_FAULT_REPLAY_POLICY_MAX != 4);
+    BUILD_BUG_ON(UVM_PERF_FAULT_REPLAY_POLICY_MAX != 5);
 
     switch (replay_policy) {
         UVM_ENUM_STRING_CASE(UVM_PERF_FAULT_REPLAY_POLICY_BLOCK);
         UVM_ENUM_STRING_CASE(UVM_PERF_FAULT_REPLAY_POLICY_BATCH);
         UVM_ENUM_STRING_CASE(UVM_PERF_FAULT_REPLAY_POLICY_BATCH_FLUSH);
         UVM_ENUM_STRING_CASE(UVM_PERF_FAULT_REPLAY_POLICY_ONCE);
+        UVM_ENUM_STRING_CASE(UVM_PERF_FAULT_REPLAY_POLICY_UTLB);
         UVM_ENUM_STRING_DEFAULT();
     }
 }
 
+bool uvm_perf_fault_replay_policy_should_replay(uvm_perf_fault_replay_policy_t replay_policy,
+                                                uvm_perf_fault_replay_point_t point,
+                                                NvU32 num_completed_utlbs)
+{
+    BUILD_BUG_ON(UVM_PERF_FAULT_REPLAY_POLICY_MAX != 5);
+
+    UVM_ASSERT(replay_policy < UVM_PERF_FAULT_REPLAY_POLICY_MAX);
+    UVM_ASSERT(point < UVM_PERF_FAULT_REPLAY_POINT_MAX);
+
+    switch (point) {
+        case UVM_PERF_FAULT_REPLAY_POINT_BLOCK:
+            return replay_policy == UVM_PERF_FAULT_REPLAY_POLICY_BLOCK ||
+                   (replay_policy == UVM_PERF_FAULT_REPLAY_POLICY_UTLB && num_completed_utlbs > 0);
+
+        // uTLBs can also be completed by faults that don't belong to any VA block
+        case UVM_PERF_FAULT_REPLAY_POINT_BATCH_SERVICED:
+            return replay_policy == UVM_PERF_FAULT_REPLAY_POLICY_UTLB && num_completed_utlbs > 0;
+
+        // UVM_PERF_FAULT_REPLAY_POLICY_BATCH_FLUSH flushes the fault buffer before replaying
+        case UVM_PERF_FAULT_REPLAY_POINT_BATCH_END:
+            return replay_policy == UVM_PERF_FAULT_REPLAY_POLICY_BATCH ||
+                   replay_policy == UVM_PERF_FAULT_REPLAY_POLICY_BATCH_FLUSH;
+
+        case UVM_PERF_FAULT_REPLAY_POINT_BUFFER_END:
+            return replay_policy == UVM_PERF_FAULT_REPLAY_POLICY_ONCE;
+
+        default:
+            return false;
+    }
+}
+
 NV_STATUS uvm8_test_get_prefetch_faults_reenable_lapse(UVM_TEST_GET_PREFETCH_FAULTS_REENABLE_LAPSE_PARAMS *params,
                                                        struct file *filp)
 {
@@ -1853,3 +2797,44 @@ NV_STATUS uvm8_test_set_prefetch_faults_reenable_lapse(UVM_TEST_SET_PREFETCH_FAU
 
     return NV_OK;
 }
+
+NV_STATUS uvm8_test_fault_service_worker_stats(UVM_TEST_FAULT_SERVICE_WORKER_STATS_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status = NV_OK;
+    NvU32 i;
+    uvm_gpu_t *gpu;
+    uvm_fault_service_workers_t *workers;
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+
+    BUILD_BUG_ON(UVM_PERF_FAULT_SERVICE_WORKERS_MAX > UVM_TEST_FAULT_SERVICE_WORKERS_MAX);
+
+    uvm_va_space_down_read(va_space);
+
+    gpu = uvm_va_space_get_gpu_by_uuid(va_space, &params->gpu_uuid);
+    if (!gpu || !uvm_gpu_supports_replayable_faults(gpu)) {
+        status = NV_ERR_INVALID_DEVICE;
+        goto done;
+    }
+
+    workers = gpu->fault_buffer_info.replayable.service_workers;
+    params->num_workers = workers? workers->num_workers: 0;
+
+    for (i = 0; i < params->num_workers; ++i) {
+        fault_service_worker_t *worker = &workers->workers[i];
+
+        params->service_time_ns[i] = atomic64_read(&worker->stats.service_time_ns);
+        params->num_blocks[i] = atomic64_read(&worker->stats.num_blocks);
+        params->num_faults[i] = atomic64_read(&worker->stats.num_faults);
+
+        if (params->reset) {
+            atomic64_set(&worker->stats.service_time_ns, 0);
+            atomic64_set(&worker->stats.num_blocks, 0);
+            atomic64_set(&worker->stats.num_faults, 0);
+        }
+    }
+
+done:
+    uvm_va_space_up_read(va_space);
+
+    return status;
+}
@@ -45,13 +45,97 @@ typedef enum
     // Issue a fault replay after all faults in the buffer have been serviced
     UVM_PERF_FAULT_REPLAY_POLICY_ONCE,
 
-    // TODO: Bug 1768226: Implement uTLB-aware fault replay policy
+    // Issue a fault replay as soon as all the pending faults of a uTLB within a batch have been serviced, so that
+    // the SMs behind it can resume execution without waiting for the rest of the batch. Replays cannot target a
+    // single uTLB, so the replay is issued after servicing the VA block that completed the uTLB. Replays are not
+    // issued for blocks that don't complete any uTLB, like UVM_PERF_FAULT_REPLAY_POLICY_BLOCK would do.
+    UVM_PERF_FAULT_REPLAY_POLICY_UTLB,
 
     UVM_PERF_FAULT_REPLAY_POLICY_MAX,
 } uvm_perf_fault_replay_policy_t;
 
 const char *uvm_perf_fault_replay_policy_string(uvm_perf_fault_replay_policy_t fault_replay);
 
+// Points of the fault servicing at which the replay policy is consulted
+typedef enum
+{
+    // The faults of a VA block, or of a set of VA blocks serviced in parallel, have been serviced
+    UVM_PERF_FAULT_REPLAY_POINT_BLOCK = 0,
+
+    // All the faults of a batch have been serviced, including the ones that don't belong to any VA block
+    UVM_PERF_FAULT_REPLAY_POINT_BATCH_SERVICED,
+
+    // A batch has been serviced without fatal faults and the next one is about to be fetched
+    UVM_PERF_FAULT_REPLAY_POINT_BATCH_END,
+
+    // No more batches are going to be serviced
+    UVM_PERF_FAULT_REPLAY_POINT_BUFFER_END,
+
+    UVM_PERF_FAULT_REPLAY_POINT_MAX,
+} uvm_perf_fault_replay_point_t;
+
+// Whether the given replay policy issues a replay at the given point of the fault servicing. num_completed_utlbs
+// is the number of uTLBs whose faults in the current batch have been all serviced, without fatal faults, since the
+// last replay.
+//
+// This only covers the decisions driven by the policy. The servicing code also issues a replay at the end if none
+// has been issued yet, and never replays when servicing faults to cancel them.
+bool uvm_perf_fault_replay_policy_should_replay(uvm_perf_fault_replay_policy_t replay_policy,
+                                                uvm_perf_fault_replay_point_t point,
+                                                NvU32 num_completed_utlbs);
+
+// Maximum number of distinct instance pointers (and, hence, VA spaces) in a
+// batch for which the specialized fault sort is used. Batches with more
+// distinct values fall back to the generic kernel sort().
+#define UVM_FAULT_SORT_MAX_DISTINCT_KEYS 64
+
+#define UVM_FAULT_SORT_RADIX_BITS 8
+#define UVM_FAULT_SORT_RADIX_SIZE (1 << UVM_FAULT_SORT_RADIX_BITS)
+
+// Scratch storage used to sort the ordered view of a fault batch. The sort
+// works on 64-bit keys packed from the fault entry fields it orders by:
+// instance pointers and VA spaces are replaced by their rank among the distinct
+// values in the batch, which are very few in practice, and fault addresses are
+// 4K-aligned. An LSD radix sort is then performed on the keys, skipping the
+// digits that are the same for all the entries.
+typedef struct
+{
+    // Maximum number of entries that can be sorted
+    NvU32 max_entries;
+
+    // Packed sort keys, and ping-pong buffers for the radix sort passes
+    NvU64 *keys;
+    NvU64 *tmp_keys;
+    uvm_fault_buffer_entry_t **tmp_entries;
+
+    // Sorted arrays of the distinct instance pointers/VA spaces in the batch
+    uvm_gpu_phys_address_t instance_ptrs[UVM_FAULT_SORT_MAX_DISTINCT_KEYS];
+    uvm_va_space_t *va_spaces[UVM_FAULT_SORT_MAX_DISTINCT_KEYS];
+
+    NvU32 radix_counts[UVM_FAULT_SORT_RADIX_SIZE];
+} uvm_fault_sort_scratch_t;
+
+NV_STATUS uvm_fault_sort_scratch_init(uvm_fault_sort_scratch_t *scratch, NvU32 max_entries);
+void uvm_fault_sort_scratch_deinit(uvm_fault_sort_scratch_t *scratch);
+
+// Sort the given array of pointers to fault entries by instance_ptr. The sort
+// is stable.
+void uvm_fault_sort_by_instance_ptr(uvm_fault_sort_scratch_t *scratch,
+                                    uvm_fault_buffer_entry_t **entries,
+                                    NvU32 count);
+
+// Sort the given array of pointers to fault entries by va_space, fault address
+// and access type "intrusiveness" (atomic - write - read - prefetch). The sort
+// is stable.
+void uvm_fault_sort_by_va_space_address_access_type(uvm_fault_sort_scratch_t *scratch,
+                                                    uvm_fault_buffer_entry_t **entries,
+                                                    NvU32 count);
+
+// Same as above, using the generic kernel sort(). Used as the fallback path and
+// as the reference in tests.
+void uvm_fault_sort_by_instance_ptr_generic(uvm_fault_buffer_entry_t **entries, NvU32 count);
+void uvm_fault_sort_by_va_space_address_access_type_generic(uvm_fault_buffer_entry_t **entries, NvU32 count);
+
 NV_STATUS uvm_gpu_fault_buffer_init(uvm_gpu_t *gpu);
 void uvm_gpu_fault_buffer_deinit(uvm_gpu_t *gpu);
 
@@ -0,0 +1,569 @@
+/*******************************************************************************
+    Copyright (c) 2016 NVIDIA Corporation
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to
+    deal in the Software without restriction, including without limitation the
+    rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+        The above copyright notice and this permission notice shall be
+        included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+#include "uvm_common.h"
+#include "uvm_linux.h"
+#include "uvm8_gpu_page_fault.h"
+#include "uvm8_kvmalloc.h"
+#include "uvm8_test.h"
+#include "uvm8_test_rng.h"
+#include "uvm8_va_block_types.h"
+
+#define FAULT_SORT_MAX_BATCH_SIZE (64 * 1024)
+
+// Number of fake VA spaces the instance pointers are mapped to. Several
+// instance pointers can map to the same VA space, like channels of the same
+// process do.
+#define FAULT_SORT_FAKE_VA_SPACES 16
+
+// Only the addresses of the fake VA spaces are used, they are never
+// dereferenced.
+static char g_fake_va_spaces[FAULT_SORT_FAKE_VA_SPACES];
+
+static uvm_va_space_t *fake_va_space(uvm_gpu_phys_address_t instance_ptr)
+{
+    NvU64 hash = (instance_ptr.address >> 12) * 2654435761ULL + instance_ptr.aperture;
+
+    return (uvm_va_space_t *)&g_fake_va_spaces[hash % FAULT_SORT_FAKE_VA_SPACES];
+}
+
+static void fault_from_record(uvm_fault_buffer_entry_t *entry, const UvmTestFaultRecord *record)
+{
+    memset(entry, 0, sizeof(*entry));
+
+    entry->instance_ptr = uvm_gpu_phys_address((uvm_aperture_t)record->instance_ptr_aperture, record->instance_ptr);
+    entry->fault_address = UVM_PAGE_ALIGN_DOWN(record->fault_address);
+    entry->fault_access_type = (uvm_fault_access_type_t)record->access_type;
+    entry->va_space = fake_va_space(entry->instance_ptr);
+}
+
+// Generate a batch of faults similar to what warps of a few different contexts
+// touching a handful of VA blocks would generate. Many faults hit the same
+// pages.
+static void generate_records(uvm_test_rng_t *rng, UvmTestFaultRecord *records, NvU32 num_records,
+                             NvU32 num_instance_ptrs)
+{
+    NvU32 i;
+
+    for (i = 0; i < num_records; ++i) {
+        NvU32 instance = uvm_test_rng_range_32(rng, 0, num_instance_ptrs - 1);
+        NvU64 block = uvm_test_rng_range_64(rng, 0, 15);
+
+        records[i].instance_ptr = (NvU64)(instance + 1) << 12;
+        records[i].instance_ptr_aperture = (instance % 2) ? UVM_APERTURE_SYS : UVM_APERTURE_VID;
+        records[i].fault_address = (1ULL << 40) + block * UVM_VA_BLOCK_SIZE +
+                                   uvm_test_rng_range_64(rng, 0, 31) * PAGE_SIZE;
+        records[i].access_type = uvm_test_rng_range_32(rng, 0, UVM_FAULT_ACCESS_TYPE_MAX - 1);
+    }
+}
+
+static bool same_instance_ptr(uvm_fault_buffer_entry_t *a, uvm_fault_buffer_entry_t *b)
+{
+    return a->instance_ptr.aperture == b->instance_ptr.aperture && a->instance_ptr.address == b->instance_ptr.address;
+}
+
+static bool same_va_space_address_access_type(uvm_fault_buffer_entry_t *a, uvm_fault_buffer_entry_t *b)
+{
+    return a->va_space == b->va_space &&
+           a->fault_address == b->fault_address &&
+           a->fault_access_type == b->fault_access_type;
+}
+
+// Sort the given faults with both implementations and check that the resulting
+// orderings are equivalent. The generic sort() is not stable so only the keys
+// are compared.
+static NV_STATUS sort_batch(uvm_fault_sort_scratch_t *scratch,
+                            uvm_fault_buffer_entry_t *faults,
+                            uvm_fault_buffer_entry_t **generic_order,
+                            uvm_fault_buffer_entry_t **fault_sort_order,
+                            NvU32 count,
+                            NvU64 *generic_sort_ns,
+                            NvU64 *fault_sort_ns)
+{
+    NvU64 start;
+    NvU32 i;
+
+    for (i = 0; i < count; ++i) {
+        generic_order[i] = &faults[i];
+        fault_sort_order[i] = &faults[i];
+    }
+
+    start = NV_GETTIME();
+    uvm_fault_sort_by_instance_ptr_generic(generic_order, count);
+    *generic_sort_ns += NV_GETTIME() - start;
+
+    start = NV_GETTIME();
+    uvm_fault_sort_by_instance_ptr(scratch, fault_sort_order, count);
+    *fault_sort_ns += NV_GETTIME() - start;
+
+    for (i = 0; i < count; ++i)
+        TEST_CHECK_RET(same_instance_ptr(generic_order[i], fault_sort_order[i]));
+
+    // Stability of the specialized sort
+    for (i = 1; i < count; ++i) {
+        if (same_instance_ptr(fault_sort_order[i - 1], fault_sort_order[i]))
+            TEST_CHECK_RET(fault_sort_order[i - 1] < fault_sort_order[i]);
+    }
+
+    start = NV_GETTIME();
+    uvm_fault_sort_by_va_space_address_access_type_generic(generic_order, count);
+    *generic_sort_ns += NV_GETTIME() - start;
+
+    start = NV_GETTIME();
+    uvm_fault_sort_by_va_space_address_access_type(scratch, fault_sort_order, count);
+    *fault_sort_ns += NV_GETTIME() - start;
+
+    for (i = 0; i < count; ++i)
+        TEST_CHECK_RET(same_va_space_address_access_type(generic_order[i], fault_sort_order[i]));
+
+    return NV_OK;
+}
+
+NV_STATUS uvm8_test_fault_sort_benchmark(UVM_TEST_FAULT_SORT_BENCHMARK_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status = NV_OK;
+    uvm_test_rng_t rng;
+    uvm_fault_sort_scratch_t *scratch = NULL;
+    UvmTestFaultRecord *records = NULL;
+    uvm_fault_buffer_entry_t *faults = NULL;
+    uvm_fault_buffer_entry_t **generic_order = NULL;
+    uvm_fault_buffer_entry_t **fault_sort_order = NULL;
+    NvU32 iter;
+
+    if (params->num_records == 0 ||
+        params->batch_size == 0 ||
+        params->batch_size > FAULT_SORT_MAX_BATCH_SIZE)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    if (params->records == 0 && params->num_instance_ptrs == 0)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    params->generic_sort_ns = 0;
+    params->fault_sort_ns = 0;
+
+    scratch = uvm_kvmalloc_zero(sizeof(*scratch));
+    records = uvm_kvmalloc(params->num_records * sizeof(*records));
+    faults = uvm_kvmalloc(params->batch_size * sizeof(*faults));
+    generic_order = uvm_kvmalloc(params->batch_size * sizeof(*generic_order));
+    fault_sort_order = uvm_kvmalloc(params->batch_size * sizeof(*fault_sort_order));
+    if (!scratch || !records || !faults || !generic_order || !fault_sort_order) {
+        status = NV_ERR_NO_MEMORY;
+        goto done;
+    }
+
+    status = uvm_fault_sort_scratch_init(scratch, params->batch_size);
+    if (status != NV_OK)
+        goto done;
+
+    if (params->records) {
+        if (copy_from_user(records, (void __user *)params->records, params->num_records * sizeof(*records))) {
+            status = NV_ERR_INVALID_ADDRESS;
+            goto done;
+        }
+    }
+    else {
+        uvm_test_rng_init(&rng, params->seed);
+        generate_records(&rng, records, params->num_records, params->num_instance_ptrs);
+    }
+
+    for (iter = 0; iter < params->iterations; ++iter) {
+        NvU32 first;
+
+        for (first = 0; first < params->num_records; first += params->batch_size) {
+            NvU32 count = min(params->batch_size, params->num_records - first);
+            NvU32 i;
+
+            for (i = 0; i < count; ++i) {
+                TEST_CHECK_GOTO(records[first + i].access_type < UVM_FAULT_ACCESS_TYPE_MAX, done);
+                TEST_CHECK_GOTO(records[first + i].instance_ptr_aperture < UVM_APERTURE_MAX, done);
+                fault_from_record(&faults[i], &records[first + i]);
+            }
+
+            TEST_NV_CHECK_GOTO(sort_batch(scratch,
+                                          faults,
+                                          generic_order,
+                                          fault_sort_order,
+                                          count,
+                                          &params->generic_sort_ns,
+                                          &params->fault_sort_ns), done);
+        }
+
+        if (fatal_signal_pending(current)) {
+            status = NV_ERR_SIGNAL_PENDING;
+            goto done;
+        }
+
+        schedule();
+    }
+
+done:
+    if (scratch)
+        uvm_fault_sort_scratch_deinit(scratch);
+    uvm_kvfree(scratch);
+    uvm_kvfree(records);
+    uvm_kvfree(faults);
+    uvm_kvfree(generic_order);
+    uvm_kvfree(fault_sort_order);
+
+    return status;
+}
+
+// Number of VA blocks touched by the synthetic faults of the replay policy
+// simulation
+#define FAULT_REPLAY_SIM_BLOCKS 64
+
+typedef struct
+{
+    uvm_perf_fault_replay_policy_t policy;
+
+    NvU32 batch_size;
+    NvU32 block_service_ns;
+    NvU32 page_service_ns;
+    NvU32 replay_ns;
+
+    uvm_fault_buffer_entry_t *faults;
+    uvm_fault_buffer_entry_t **ordered_faults;
+
+    // Simulated time
+    NvU64 now;
+
+    // Number of uTLBs whose faults in the current batch have been all serviced
+    // since the last replay
+    NvU32 num_completed_utlbs;
+
+    struct
+    {
+        // Faults of the uTLB in the current batch that have not been serviced
+        NvU32 batch_pending;
+
+        // Faults of the uTLB in the trace that have not been serviced
+        NvU32 trace_pending;
+
+        // Whether the uTLB has faults in the trace
+        bool faulted;
+
+        // Time of the first replay issued after all the faults of the uTLB
+        // in the trace were serviced. (NvU64)-1 until then.
+        NvU64 resume_ns;
+    } utlbs[UVM_TEST_FAULT_REPLAY_MAX_UTLBS];
+
+    NvU64 first_replay_ns;
+    NvU32 replays;
+    NvU32 premature_replays;
+} fault_replay_sim_t;
+
+// Generate faults from uTLBs that mostly touch their own VA block, with some
+// faults on random blocks, so that uTLBs complete at different points of the
+// batch.
+static void generate_replay_records(uvm_test_rng_t *rng, UvmTestFaultReplayRecord *records, NvU32 num_records,
+                                    NvU32 num_utlbs)
+{
+    NvU32 i;
+
+    for (i = 0; i < num_records; ++i) {
+        NvU32 utlb_id = uvm_test_rng_range_32(rng, 0, num_utlbs - 1);
+        NvU64 block = (utlb_id * 7) % FAULT_REPLAY_SIM_BLOCKS;
+
+        if (uvm_test_rng_range_32(rng, 0, 3) == 0)
+            block = uvm_test_rng_range_64(rng, 0, FAULT_REPLAY_SIM_BLOCKS - 1);
+
+        records[i].utlb_id = utlb_id;
+        records[i].fault_address = (1ULL << 40) + block * UVM_VA_BLOCK_SIZE +
+                                   uvm_test_rng_range_64(rng, 0, PAGES_PER_UVM_VA_BLOCK - 1) * PAGE_SIZE;
+        records[i].access_type = uvm_test_rng_range_32(rng, 0, UVM_FAULT_ACCESS_TYPE_MAX - 1);
+    }
+}
+
+static void fault_replay_sim_replay(fault_replay_sim_t *sim)
+{
+    NvU32 utlb_id;
+
+    sim->now += sim->replay_ns;
+
+    if (sim->replays++ == 0)
+        sim->first_replay_ns = sim->now;
+
+    for (utlb_id = 0; utlb_id < UVM_TEST_FAULT_REPLAY_MAX_UTLBS; ++utlb_id) {
+        if (!sim->utlbs[utlb_id].faulted)
+            continue;
+
+        if (sim->utlbs[utlb_id].trace_pending > 0)
+            ++sim->premature_replays;
+        else if (sim->utlbs[utlb_id].resume_ns == (NvU64)-1)
+            sim->utlbs[utlb_id].resume_ns = sim->now;
+    }
+
+    sim->num_completed_utlbs = 0;
+}
+
+// Service a batch the way service_fault_batch does: faults are sorted and
+// serviced one VA block at a time, and replays are issued wherever
+// uvm_perf_fault_replay_policy_should_replay tells the servicing code to.
+static void fault_replay_sim_batch(fault_replay_sim_t *sim, const UvmTestFaultReplayRecord *records, NvU32 count)
+{
+    NvU32 i;
+
+    for (i = 0; i < count; ++i) {
+        uvm_fault_buffer_entry_t *entry = &sim->faults[i];
+
+        memset(entry, 0, sizeof(*entry));
+        entry->fault_address = UVM_PAGE_ALIGN_DOWN(records[i].fault_address);
+        entry->fault_access_type = (uvm_fault_access_type_t)records[i].access_type;
+        entry->fault_source.utlb_id = records[i].utlb_id;
+        entry->va_space = (uvm_va_space_t *)&g_fake_va_spaces[0];
+
+        sim->ordered_faults[i] = entry;
+        ++sim->utlbs[entry->fault_source.utlb_id].batch_pending;
+    }
+
+    uvm_fault_sort_by_va_space_address_access_type_generic(sim->ordered_faults, count);
+
+    i = 0;
+    while (i < count) {
+        NvU64 block_start = UVM_VA_BLOCK_ALIGN_DOWN(sim->ordered_faults[i]->fault_address);
+        NvU64 last_address = (NvU64)-1;
+
+        sim->now += sim->block_service_ns;
+
+        for (; i < count && sim->ordered_faults[i]->fault_address < block_start + UVM_VA_BLOCK_SIZE; ++i) {
+            uvm_fault_buffer_entry_t *entry = sim->ordered_faults[i];
+            NvU32 utlb_id = entry->fault_source.utlb_id;
+
+            // Only the most intrusive fault per page is serviced
+            if (entry->fault_address != last_address) {
+                sim->now += sim->page_service_ns;
+                last_address = entry->fault_address;
+            }
+
+            --sim->utlbs[utlb_id].trace_pending;
+            if (--sim->utlbs[utlb_id].batch_pending == 0)
+                ++sim->num_completed_utlbs;
+        }
+
+        if (uvm_perf_fault_replay_policy_should_replay(sim->policy,
+                                                       UVM_PERF_FAULT_REPLAY_POINT_BLOCK,
+                                                       sim->num_completed_utlbs))
+            fault_replay_sim_replay(sim);
+    }
+
+    if (uvm_perf_fault_replay_policy_should_replay(sim->policy,
+                                                   UVM_PERF_FAULT_REPLAY_POINT_BATCH_SERVICED,
+                                                   sim->num_completed_utlbs))
+        fault_replay_sim_replay(sim);
+
+    // The cost of flushing the fault buffer in UVM_PERF_FAULT_REPLAY_POLICY_BATCH_FLUSH, and of the faults that
+    // show up again after it, is not modeled
+    if (uvm_perf_fault_replay_policy_should_replay(sim->policy,
+                                                   UVM_PERF_FAULT_REPLAY_POINT_BATCH_END,
+                                                   sim->num_completed_utlbs))
+        fault_replay_sim_replay(sim);
+}
+
+static NV_STATUS fault_replay_sim_run(fault_replay_sim_t *sim,
+                                      const UvmTestFaultReplayRecord *records,
+                                      NvU32 num_records,
+                                      UVM_TEST_FAULT_REPLAY_POLICY_SIMULATE_PARAMS *params)
+{
+    NvU32 first;
+    NvU32 utlb_id;
+    NvU32 num_faulted_utlbs = 0;
+    NvU64 total_resume_ns = 0;
+    NvU64 max_resume_ns = 0;
+
+    sim->now = 0;
+    sim->num_completed_utlbs = 0;
+    sim->first_replay_ns = 0;
+    sim->replays = 0;
+    sim->premature_replays = 0;
+
+    for (utlb_id = 0; utlb_id < UVM_TEST_FAULT_REPLAY_MAX_UTLBS; ++utlb_id) {
+        sim->utlbs[utlb_id].batch_pending = 0;
+        sim->utlbs[utlb_id].trace_pending = 0;
+        sim->utlbs[utlb_id].faulted = false;
+        sim->utlbs[utlb_id].resume_ns = (NvU64)-1;
+    }
+
+    for (first = 0; first < num_records; ++first) {
+        ++sim->utlbs[records[first].utlb_id].trace_pending;
+        sim->utlbs[records[first].utlb_id].faulted = true;
+    }
+
+    for (first = 0; first < num_records; first += sim->batch_size)
+        fault_replay_sim_batch(sim, records + first, min(sim->batch_size, num_records - first));
+
+    // Like service_fault_buffer, issue at least one replay
+    if (uvm_perf_fault_replay_policy_should_replay(sim->policy,
+                                                   UVM_PERF_FAULT_REPLAY_POINT_BUFFER_END,
+                                                   sim->num_completed_utlbs) ||
+        sim->replays == 0)
+        fault_replay_sim_replay(sim);
+
+    for (utlb_id = 0; utlb_id < UVM_TEST_FAULT_REPLAY_MAX_UTLBS; ++utlb_id) {
+        if (!sim->utlbs[utlb_id].faulted)
+            continue;
+
+        // Every policy must eventually resume all uTLBs
+        TEST_CHECK_RET(sim->utlbs[utlb_id].trace_pending == 0);
+        TEST_CHECK_RET(sim->utlbs[utlb_id].batch_pending == 0);
+        TEST_CHECK_RET(sim->utlbs[utlb_id].resume_ns != (NvU64)-1);
+
+        ++num_faulted_utlbs;
+        total_resume_ns += sim->utlbs[utlb_id].resume_ns;
+        max_resume_ns = max(max_resume_ns, sim->utlbs[utlb_id].resume_ns);
+    }
+
+    params->first_replay_ns[sim->policy] = sim->first_replay_ns;
+    params->avg_resume_ns[sim->policy] = total_resume_ns / num_faulted_utlbs;
+    params->max_resume_ns[sim->policy] = max_resume_ns;
+    params->replays[sim->policy] = sim->replays;
+    params->premature_replays[sim->policy] = sim->premature_replays;
+
+    return NV_OK;
+}
+
+// Check the replay decisions that don't depend on the trace
+static NV_STATUS test_replay_policy_decisions(void)
+{
+    uvm_perf_fault_replay_policy_t policy;
+
+    for (policy = 0; policy < UVM_PERF_FAULT_REPLAY_POLICY_MAX; ++policy) {
+        bool replays_per_block = policy == UVM_PERF_FAULT_REPLAY_POLICY_BLOCK;
+        bool replays_per_utlb = policy == UVM_PERF_FAULT_REPLAY_POLICY_UTLB;
+        bool replays_per_batch = policy == UVM_PERF_FAULT_REPLAY_POLICY_BATCH ||
+                                 policy == UVM_PERF_FAULT_REPLAY_POLICY_BATCH_FLUSH;
+        bool replays_once = policy == UVM_PERF_FAULT_REPLAY_POLICY_ONCE;
+
+        // The uTLB-aware policy only replays when some uTLB has been completed
+        TEST_CHECK_RET(uvm_perf_fault_replay_policy_should_replay(policy, UVM_PERF_FAULT_REPLAY_POINT_BLOCK, 0) ==
+                       replays_per_block);
+        TEST_CHECK_RET(uvm_perf_fault_replay_policy_should_replay(policy, UVM_PERF_FAULT_REPLAY_POINT_BLOCK, 1) ==
+                       (replays_per_block || replays_per_utlb));
+        TEST_CHECK_RET(!uvm_perf_fault_replay_policy_should_replay(policy,
+                                                                   UVM_PERF_FAULT_REPLAY_POINT_BATCH_SERVICED,
+                                                                   0));
+        TEST_CHECK_RET(uvm_perf_fault_replay_policy_should_replay(policy,
+                                                                  UVM_PERF_FAULT_REPLAY_POINT_BATCH_SERVICED,
+                                                                  1) == replays_per_utlb);
+        TEST_CHECK_RET(uvm_perf_fault_replay_policy_should_replay(policy, UVM_PERF_FAULT_REPLAY_POINT_BATCH_END, 0) ==
+                       replays_per_batch);
+        TEST_CHECK_RET(uvm_perf_fault_replay_policy_should_replay(policy, UVM_PERF_FAULT_REPLAY_POINT_BUFFER_END, 0) ==
+                       replays_once);
+    }
+
+    return NV_OK;
+}
+
+NV_STATUS uvm8_test_fault_replay_policy_simulate(UVM_TEST_FAULT_REPLAY_POLICY_SIMULATE_PARAMS *params,
+                                                 struct file *filp)
+{
+    NV_STATUS status = NV_OK;
+    fault_replay_sim_t *sim = NULL;
+    UvmTestFaultReplayRecord *records = NULL;
+    NvU32 policy;
+    NvU32 i;
+
+    BUILD_BUG_ON(UVM_PERF_FAULT_REPLAY_POLICY_MAX > UVM_TEST_FAULT_REPLAY_MAX_POLICIES);
+
+    if (params->num_records == 0 ||
+        params->batch_size == 0 ||
+        params->batch_size > FAULT_SORT_MAX_BATCH_SIZE)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    if (params->records == 0 && (params->num_utlbs == 0 || params->num_utlbs > UVM_TEST_FAULT_REPLAY_MAX_UTLBS))
+        return NV_ERR_INVALID_ARGUMENT;
+
+    status = test_replay_policy_decisions();
+    if (status != NV_OK)
+        return status;
+
+    sim = uvm_kvmalloc_zero(sizeof(*sim));
+    records = uvm_kvmalloc(params->num_records * sizeof(*records));
+    if (!sim || !records) {
+        status = NV_ERR_NO_MEMORY;
+        goto done;
+    }
+
+    sim->faults = uvm_kvmalloc(params->batch_size * sizeof(*sim->faults));
+    sim->ordered_faults = uvm_kvmalloc(params->batch_size * sizeof(*sim->ordered_faults));
+    if (!sim->faults || !sim->ordered_faults) {
+        status = NV_ERR_NO_MEMORY;
+        goto done;
+    }
+
+    if (params->records) {
+        if (copy_from_user(records, (void __user *)params->records, params->num_records * sizeof(*records))) {
+            status = NV_ERR_INVALID_ADDRESS;
+            goto done;
+        }
+
+        for (i = 0; i < params->num_records; ++i) {
+            if (records[i].utlb_id >= UVM_TEST_FAULT_REPLAY_MAX_UTLBS ||
+                records[i].access_type >= UVM_FAULT_ACCESS_TYPE_MAX) {
+                status = NV_ERR_INVALID_ARGUMENT;
+                goto done;
+            }
+        }
+    }
+    else {
+        uvm_test_rng_t rng;
+
+        uvm_test_rng_init(&rng, params->seed);
+        generate_replay_records(&rng, records, params->num_records, params->num_utlbs);
+    }
+
+    sim->batch_size = params->batch_size;
+    sim->block_service_ns = params->block_service_ns;
+    sim->page_service_ns = params->page_service_ns;
+    sim->replay_ns = params->replay_ns;
+
+    for (policy = 0; policy < UVM_PERF_FAULT_REPLAY_POLICY_MAX; ++policy) {
+        sim->policy = policy;
+
+        TEST_NV_CHECK_GOTO(fault_replay_sim_run(sim, records, params->num_records, params), done);
+
+        // If replays are free, replaying after every VA block resumes each uTLB
+        // as early as possible. The uTLB-aware policy must match it, since it
+        // replays after every VA block that completes a uTLB.
+        if (params->replay_ns == 0) {
+            TEST_CHECK_GOTO(params->avg_resume_ns[policy] >=
+                            params->avg_resume_ns[UVM_PERF_FAULT_REPLAY_POLICY_BLOCK], done);
+
+            if (policy == UVM_PERF_FAULT_REPLAY_POLICY_UTLB) {
+                TEST_CHECK_GOTO(params->avg_resume_ns[policy] ==
+                                params->avg_resume_ns[UVM_PERF_FAULT_REPLAY_POLICY_BLOCK], done);
+            }
+        }
+    }
+
+    params->num_policies = UVM_PERF_FAULT_REPLAY_POLICY_MAX;
+
+done:
+    if (sim) {
+        uvm_kvfree(sim->faults);
+        uvm_kvfree(sim->ordered_faults);
+    }
+    uvm_kvfree(sim);
+    uvm_kvfree(records);
+
+    return status;
+}
@@ -273,6 +273,12 @@ struct uvm_fault_buffer_entry_struct
 
     uvm_va_space_t *va_space;
 
+    // Number of faults in the batch with the same va_space, fault address and
+    // access type that have been coalesced into this one, including itself.
+    // 0 if this fault has been coalesced into the previous one in the ordered
+    // view of the batch.
+    NvU32 num_instances;
+
     // For the next chip and for any other features that are not yet ready to be
     // made public:
     uvm_fault_buffer_entry_next_data_t uvm_next;
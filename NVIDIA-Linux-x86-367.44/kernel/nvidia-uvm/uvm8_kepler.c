@@ -24,6 +24,7 @@
 #include "uvm8_hal.h"
 #include "uvm8_gpu.h"
 #include "uvm8_mem.h"
+#include "uvm8_pte_batch.h"
 
 void uvm_hal_kepler_arch_init_properties(uvm_gpu_t *gpu)
 {
@@ -39,6 +40,8 @@ void uvm_hal_kepler_arch_init_properties(uvm_gpu_t *gpu)
 
     gpu->tlb_batch.va_invalidate_supported = false;
 
+    gpu->pte_batch.max_memset_ptes = UVM_PTE_BATCH_MEMSET_PTES_DEFAULT;
+
     gpu->uvm_mem_va_base = 768ull * 1024 * 1024 * 1024;
     gpu->uvm_mem_va_size = UVM_MEM_VA_SIZE;
 
@@ -24,6 +24,7 @@
 #include "uvm_common.h"
 #include "uvm_linux.h"
 #include "uvm8_kvmalloc.h"
+#include "uvm8_procfs.h"
 
 // To implement realloc for vmalloc-based allocations we need to track the size
 // of the original allocation. We can do that by allocating a header along with
@@ -88,8 +89,352 @@ MODULE_PARM_DESC(uvm_leak_checker,
                  "Enable uvm memory leak checking. "
                  "0 = disabled, 1 = count total bytes allocated and freed, 2 = per-allocation origin tracking.");
 
+// The sampling profiler records one in uvm_kvmalloc_sample_rate allocations
+// along with their origin, and keeps per call site counts of the sampled
+// allocations and of the sampled bytes that are still live. Unlike the origin
+// tracking leak checker, the allocations that are not sampled only pay for a
+// per-CPU countdown and for a lockless check of a hash bucket when freed, so it
+// can be left enabled to find the code paths that drive memory churn. The
+// statistics are reported in /proc/driver/nvidia-uvm/kvmalloc_sites.
+static unsigned uvm_kvmalloc_sample_rate = 0;
+module_param(uvm_kvmalloc_sample_rate, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_kvmalloc_sample_rate,
+                 "Sample one in every N uvm allocations and report per call site statistics. 0 = disabled.");
+
+// Number of buckets of the table of live sampled allocations. Must be a power
+// of 2.
+#define UVM_KVMALLOC_SAMPLE_BUCKET_COUNT 1024
+
+// Maximum number of call sites the sampling profiler can track. Samples from
+// other call sites are dropped. Must be a power of 2.
+#define UVM_KVMALLOC_SAMPLE_MAX_SITES 1024
+
+typedef struct
+{
+    // Origin of the allocations. file is NULL for unused entries.
+    const char *file;
+    const char *function;
+    int line;
+
+    // Total number of sampled allocations and their size
+    atomic_long_t samples;
+    atomic_long_t sampled_bytes;
+
+    // Sampled allocations that have not been freed yet and their size
+    atomic_long_t live_samples;
+    atomic_long_t live_bytes;
+} uvm_kvmalloc_site_t;
+
+typedef struct
+{
+    struct list_head bucket_node;
+    void *ptr;
+    size_t size;
+    uvm_kvmalloc_site_t *site;
+} uvm_kvmalloc_sample_t;
+
+typedef struct
+{
+    spinlock_t lock;
+
+    // Number of samples in the bucket. Read without the lock by the free path
+    // to skip the lookup of allocations that can't have been sampled.
+    atomic_t count;
+
+    struct list_head samples;
+} uvm_kvmalloc_sample_bucket_t;
+
+static struct
+{
+    bool enabled;
+
+    NvU64 start_time_ns;
+
+    // Samples dropped because their call site couldn't be tracked or because
+    // their tracking structure couldn't be allocated
+    atomic_long_t dropped_samples;
+
+    // Protects the insertion of new call sites. The statistics of the sites
+    // are updated atomically without it.
+    spinlock_t sites_lock;
+
+    uvm_kvmalloc_site_t sites[UVM_KVMALLOC_SAMPLE_MAX_SITES];
+
+    // Table of the live sampled allocations, hashed by pointer
+    uvm_kvmalloc_sample_bucket_t buckets[UVM_KVMALLOC_SAMPLE_BUCKET_COUNT];
+
+    struct kmem_cache *sample_cache;
+
+    struct proc_dir_entry *procfs_file;
+} g_uvm_kvmalloc_profiler;
+
+// Number of allocations left until the next sample on each CPU
+static DEFINE_PER_CPU(unsigned, g_uvm_kvmalloc_sample_countdown);
+
+static NV_STATUS profiler_init(void)
+{
+    size_t i;
+
+    BUILD_BUG_ON(!is_power_of_2(UVM_KVMALLOC_SAMPLE_BUCKET_COUNT));
+    BUILD_BUG_ON(!is_power_of_2(UVM_KVMALLOC_SAMPLE_MAX_SITES));
+
+    if (uvm_kvmalloc_sample_rate == 0)
+        return NV_OK;
+
+    spin_lock_init(&g_uvm_kvmalloc_profiler.sites_lock);
+
+    for (i = 0; i < UVM_KVMALLOC_SAMPLE_BUCKET_COUNT; ++i) {
+        spin_lock_init(&g_uvm_kvmalloc_profiler.buckets[i].lock);
+        atomic_set(&g_uvm_kvmalloc_profiler.buckets[i].count, 0);
+        INIT_LIST_HEAD(&g_uvm_kvmalloc_profiler.buckets[i].samples);
+    }
+
+    g_uvm_kvmalloc_profiler.sample_cache = NV_KMEM_CACHE_CREATE("uvm_kvmalloc_sample_t", uvm_kvmalloc_sample_t);
+    if (!g_uvm_kvmalloc_profiler.sample_cache)
+        return NV_ERR_NO_MEMORY;
+
+    g_uvm_kvmalloc_profiler.start_time_ns = NV_GETTIME();
+    g_uvm_kvmalloc_profiler.enabled = true;
+
+    return NV_OK;
+}
+
+static void profiler_exit(void)
+{
+    size_t i;
+
+    if (!g_uvm_kvmalloc_profiler.enabled)
+        return;
+
+    // Allocations still live at this point are reported by the leak checker
+    for (i = 0; i < UVM_KVMALLOC_SAMPLE_BUCKET_COUNT; ++i) {
+        uvm_kvmalloc_sample_bucket_t *bucket = &g_uvm_kvmalloc_profiler.buckets[i];
+        uvm_kvmalloc_sample_t *sample, *sample_next;
+
+        list_for_each_entry_safe(sample, sample_next, &bucket->samples, bucket_node) {
+            list_del(&sample->bucket_node);
+            kmem_cache_free(g_uvm_kvmalloc_profiler.sample_cache, sample);
+        }
+
+        atomic_set(&bucket->count, 0);
+    }
+
+    kmem_cache_destroy_safe(&g_uvm_kvmalloc_profiler.sample_cache);
+
+    g_uvm_kvmalloc_profiler.enabled = false;
+}
+
+static bool profiler_should_sample(void)
+{
+    bool sample = false;
+    unsigned *countdown = &get_cpu_var(g_uvm_kvmalloc_sample_countdown);
+
+    if (*countdown <= 1) {
+        *countdown = uvm_kvmalloc_sample_rate;
+        sample = true;
+    }
+    else {
+        --*countdown;
+    }
+
+    put_cpu_var(g_uvm_kvmalloc_sample_countdown);
+
+    return sample;
+}
+
+static uvm_kvmalloc_sample_bucket_t *profiler_bucket(void *p)
+{
+    // Allocations are at least 8-byte aligned, so the low bits carry no
+    // information
+    unsigned long key = (unsigned long)p >> 3;
+
+    return &g_uvm_kvmalloc_profiler.buckets[(key ^ (key >> 10)) & (UVM_KVMALLOC_SAMPLE_BUCKET_COUNT - 1)];
+}
+
+// Find or insert the site for the given origin. Returns NULL if the site table
+// is full.
+static uvm_kvmalloc_site_t *profiler_get_site(const char *file, int line, const char *function)
+{
+    unsigned long hash = ((unsigned long)file >> 3) ^ ((unsigned long)line * 2654435761UL);
+    uvm_kvmalloc_site_t *site = NULL;
+    size_t i;
+
+    spin_lock(&g_uvm_kvmalloc_profiler.sites_lock);
+
+    for (i = 0; i < UVM_KVMALLOC_SAMPLE_MAX_SITES; ++i) {
+        uvm_kvmalloc_site_t *entry;
+
+        entry = &g_uvm_kvmalloc_profiler.sites[(hash + i) & (UVM_KVMALLOC_SAMPLE_MAX_SITES - 1)];
+        if (!entry->file) {
+            entry->file = file;
+            entry->line = line;
+            entry->function = function;
+            site = entry;
+            break;
+        }
+
+        if (entry->file == file && entry->line == line) {
+            site = entry;
+            break;
+        }
+    }
+
+    spin_unlock(&g_uvm_kvmalloc_profiler.sites_lock);
+
+    return site;
+}
+
+static void profiler_insert_sample(uvm_kvmalloc_sample_t *sample)
+{
+    uvm_kvmalloc_sample_bucket_t *bucket = profiler_bucket(sample->ptr);
+
+    spin_lock(&bucket->lock);
+    list_add(&sample->bucket_node, &bucket->samples);
+    atomic_inc(&bucket->count);
+    spin_unlock(&bucket->lock);
+}
+
+// Remove the sample of the given allocation from the table. Returns NULL if the
+// allocation was not sampled.
+static uvm_kvmalloc_sample_t *profiler_remove_sample(void *p)
+{
+    uvm_kvmalloc_sample_bucket_t *bucket = profiler_bucket(p);
+    uvm_kvmalloc_sample_t *sample;
+
+    // The sample of an allocation is inserted before the allocation is
+    // returned, so it is visible to whoever frees it.
+    if (atomic_read(&bucket->count) == 0)
+        return NULL;
+
+    spin_lock(&bucket->lock);
+
+    list_for_each_entry(sample, &bucket->samples, bucket_node) {
+        if (sample->ptr == p) {
+            list_del(&sample->bucket_node);
+            atomic_dec(&bucket->count);
+            spin_unlock(&bucket->lock);
+            return sample;
+        }
+    }
+
+    spin_unlock(&bucket->lock);
+
+    return NULL;
+}
+
+static void profiler_free_sample(uvm_kvmalloc_sample_t *sample)
+{
+    atomic_long_dec(&sample->site->live_samples);
+    atomic_long_sub(sample->size, &sample->site->live_bytes);
+
+    kmem_cache_free(g_uvm_kvmalloc_profiler.sample_cache, sample);
+}
+
+static void profiler_alloc(void *p, const char *file, int line, const char *function)
+{
+    uvm_kvmalloc_site_t *site;
+    uvm_kvmalloc_sample_t *sample;
+
+    if (ZERO_OR_NULL_PTR(p) || !profiler_should_sample())
+        return;
+
+    site = profiler_get_site(file, line, function);
+    sample = kmem_cache_alloc(g_uvm_kvmalloc_profiler.sample_cache, NV_UVM_GFP_FLAGS);
+    if (!site || !sample) {
+        if (sample)
+            kmem_cache_free(g_uvm_kvmalloc_profiler.sample_cache, sample);
+        atomic_long_inc(&g_uvm_kvmalloc_profiler.dropped_samples);
+        return;
+    }
+
+    sample->ptr = p;
+    sample->size = uvm_kvsize(p);
+    sample->site = site;
+
+    atomic_long_inc(&site->samples);
+    atomic_long_add(sample->size, &site->sampled_bytes);
+    atomic_long_inc(&site->live_samples);
+    atomic_long_add(sample->size, &site->live_bytes);
+
+    profiler_insert_sample(sample);
+}
+
+static void profiler_free(void *p)
+{
+    uvm_kvmalloc_sample_t *sample;
+
+    if (ZERO_OR_NULL_PTR(p))
+        return;
+
+    sample = profiler_remove_sample(p);
+    if (sample)
+        profiler_free_sample(sample);
+}
+
+static int nv_procfs_read_kvmalloc_sites(struct seq_file *s, void *v)
+{
+    NvU64 rate = uvm_kvmalloc_sample_rate;
+    NvU64 elapsed_ms = (NV_GETTIME() - g_uvm_kvmalloc_profiler.start_time_ns) / (1000 * 1000);
+    size_t i;
+
+    // The counts are scaled by the sample rate to estimate the totals
+    seq_printf(s, "sample_rate %u elapsed_ms %llu dropped_samples %lu\n",
+               uvm_kvmalloc_sample_rate,
+               elapsed_ms,
+               atomic_long_read(&g_uvm_kvmalloc_profiler.dropped_samples));
+    seq_printf(s, "%-48s %12s %16s %16s %16s\n", "site", "samples", "est_allocs/s", "est_live_allocs", "est_live_bytes");
+
+    for (i = 0; i < UVM_KVMALLOC_SAMPLE_MAX_SITES; ++i) {
+        uvm_kvmalloc_site_t *site = &g_uvm_kvmalloc_profiler.sites[i];
+        NvU64 samples;
+        char name[64];
+
+        // Sites are never removed, and their origin is written once under the
+        // lock before any sample is accounted to them.
+        if (!UVM_READ_ONCE(site->file))
+            continue;
+
+        samples = atomic_long_read(&site->samples);
+        snprintf(name, sizeof(name), "%s:%d:%s", kbasename(site->file), site->line, site->function);
+
+        seq_printf(s, "%-48s %12llu %16llu %16llu %16llu\n",
+                   name,
+                   samples,
+                   samples * rate * 1000 / max(elapsed_ms, 1ULL),
+                   (NvU64)atomic_long_read(&site->live_samples) * rate,
+                   (NvU64)atomic_long_read(&site->live_bytes) * rate);
+    }
+
+    return 0;
+}
+
+NV_DEFINE_PROCFS_SINGLE_FILE(kvmalloc_sites);
+
+NV_STATUS uvm_kvmalloc_procfs_init(void)
+{
+    if (!g_uvm_kvmalloc_profiler.enabled || !uvm_procfs_is_enabled())
+        return NV_OK;
+
+    g_uvm_kvmalloc_profiler.procfs_file = NV_CREATE_PROC_FILE("kvmalloc_sites",
+                                                              uvm_procfs_get_driver_dir(),
+                                                              kvmalloc_sites,
+                                                              NULL);
+    if (!g_uvm_kvmalloc_profiler.procfs_file)
+        return NV_ERR_OPERATING_SYSTEM;
+
+    return NV_OK;
+}
+
+void uvm_kvmalloc_procfs_exit(void)
+{
+    uvm_procfs_destroy_entry(g_uvm_kvmalloc_profiler.procfs_file);
+    g_uvm_kvmalloc_profiler.procfs_file = NULL;
+}
+
 NV_STATUS uvm_kvmalloc_init(void)
 {
+    NV_STATUS status;
+
     if (uvm_leak_checker >= UVM_KVMALLOC_LEAK_CHECK_ORIGIN) {
         spin_lock_init(&g_uvm_leak_checker.lock);
         uvm_init_radix_tree_preloadable(&g_uvm_leak_checker.allocation_info);
@@ -99,6 +444,10 @@ NV_STATUS uvm_kvmalloc_init(void)
             return NV_ERR_NO_MEMORY;
     }
 
+    status = profiler_init();
+    if (status != NV_OK)
+        return status;
+
     g_malloc_initialized = true;
     return NV_OK;
 }
@@ -142,6 +491,8 @@ void uvm_kvmalloc_exit(void)
         kmem_cache_destroy_safe(&g_uvm_leak_checker.info_cache);
     }
 
+    profiler_exit();
+
     g_malloc_initialized = false;
 }
 
@@ -277,6 +628,9 @@ void *__uvm_kvmalloc(size_t size, const char *file, int line, const char *functi
     if (uvm_leak_checker && p)
         alloc_tracking_add(p, file, line, function);
 
+    if (g_uvm_kvmalloc_profiler.enabled)
+        profiler_alloc(p, file, line, function);
+
     return p;
 }
 
@@ -287,6 +641,9 @@ void *__uvm_kvmalloc_zero(size_t size, const char *file, int line, const char *f
     if (uvm_leak_checker && p)
         alloc_tracking_add(p, file, line, function);
 
+    if (g_uvm_kvmalloc_profiler.enabled)
+        profiler_alloc(p, file, line, function);
+
     return p;
 }
 
@@ -298,6 +655,9 @@ void uvm_kvfree(void *p)
     if (uvm_leak_checker)
         alloc_tracking_remove(p);
 
+    if (g_uvm_kvmalloc_profiler.enabled)
+        profiler_free(p);
+
     if (is_vmalloc_addr(p))
         vfree(get_hdr(p));
     else
@@ -351,6 +711,7 @@ void *__uvm_kvrealloc(void *p, size_t new_size, const char *file, int line, cons
 {
     void *new_p;
     uvm_kvmalloc_info_t *info = NULL;
+    uvm_kvmalloc_sample_t *sample = NULL;
     size_t old_size;
 
     if (ZERO_OR_NULL_PTR(p))
@@ -374,6 +735,11 @@ void *__uvm_kvrealloc(void *p, size_t new_size, const char *file, int line, cons
         }
     }
 
+    // Like for the leak checker, remove the sample of the old pointer before it
+    // can be reused by another allocation
+    if (g_uvm_kvmalloc_profiler.enabled)
+        sample = profiler_remove_sample(p);
+
     if (is_vmalloc_addr(p))
         new_p = realloc_from_vmalloc(p, new_size);
     else
@@ -394,6 +760,16 @@ void *__uvm_kvrealloc(void *p, size_t new_size, const char *file, int line, cons
         }
     }
 
+    if (sample) {
+        if (!new_p)
+            profiler_insert_sample(sample);
+        else
+            profiler_free_sample(sample);
+    }
+
+    if (g_uvm_kvmalloc_profiler.enabled && new_p && new_size != 0)
+        profiler_alloc(new_p, file, line, function);
+
     return new_p;
 }
 
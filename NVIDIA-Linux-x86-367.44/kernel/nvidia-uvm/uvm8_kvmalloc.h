@@ -46,6 +46,12 @@
 NV_STATUS uvm_kvmalloc_init(void);
 void uvm_kvmalloc_exit(void);
 
+// Create and destroy the procfs file of the sampling allocation profiler (see
+// uvm_kvmalloc_sample_rate). These are separate from uvm_kvmalloc_init/exit as
+// the kvmalloc layer is initialized before procfs.
+NV_STATUS uvm_kvmalloc_procfs_init(void);
+void uvm_kvmalloc_procfs_exit(void);
+
 // Allocating a size of 0 with any of these APIs returns ZERO_SIZE_PTR
 void *__uvm_kvmalloc(size_t size, const char *file, int line, const char *function);
 void *__uvm_kvmalloc_zero(size_t size, const char *file, int line, const char *function);
@@ -24,6 +24,7 @@
 #include "uvm8_hal.h"
 #include "uvm8_gpu.h"
 #include "uvm8_mem.h"
+#include "uvm8_pte_batch.h"
 
 void uvm_hal_maxwell_arch_init_properties(uvm_gpu_t *gpu)
 {
@@ -31,6 +32,8 @@ void uvm_hal_maxwell_arch_init_properties(uvm_gpu_t *gpu)
 
     gpu->tlb_batch.va_invalidate_supported = false;
 
+    gpu->pte_batch.max_memset_ptes = UVM_PTE_BATCH_MEMSET_PTES_DEFAULT;
+
     // 128 GB should be enough for all current RM allocations and leaves enough
     // space for UVM internal mappings.
     // A single top level PDE covers 64 or 128 MB on Maxwell so 128 GB is fine to use.
@@ -36,6 +36,8 @@
 #include "uvm8_push.h"
 #include "uvm8_hal.h"
 #include "uvm8_tools.h"
+#include "uvm8_kvmalloc.h"
+#include "uvm8_test.h"
 
 NV_STATUS uvm_va_block_migrate_locked(uvm_va_block_t *va_block,
                                       uvm_va_block_retry_t *va_block_retry,
@@ -169,6 +171,7 @@ static NV_STATUS uvm_va_range_migrate(uvm_va_range_t *va_range,
 }
 
 static NV_STATUS uvm_migrate(uvm_va_space_t *va_space,
+                             uvm_va_block_context_t *va_block_context,
                              NvU64 base,
                              NvU64 length,
                              uvm_processor_id_t dest_id,
@@ -179,15 +182,10 @@ static NV_STATUS uvm_migrate(uvm_va_space_t *va_space,
     NvU64 end = base + length - 1;
     NV_STATUS status = NV_OK;
     bool skipped_migrate = false;
-    uvm_va_block_context_t *va_block_context;
 
     uvm_assert_mmap_sem_locked(&current->mm->mmap_sem);
     uvm_assert_rwsem_locked(&va_space->lock);
 
-    va_block_context = uvm_va_block_context_alloc();
-    if (!va_block_context)
-        return NV_ERR_NO_MEMORY;
-
     va_range_last = NULL;
     uvm_for_each_va_range_in_contig(va_range, va_space, base, end) {
         uvm_range_group_range_iter_t iter;
@@ -234,8 +232,6 @@ static NV_STATUS uvm_migrate(uvm_va_space_t *va_space,
         }
     }
 
-    uvm_va_block_context_free(va_block_context);
-
     if (status != NV_OK)
         return status;
 
@@ -302,7 +298,7 @@ static void uvm_release_user_sem_from_cpu(uvm_mem_t *sema_mem, NvU64 user_addr,
     kunmap(sema_mem->sysmem.pages[sema_page]);
 }
 
-static NV_STATUS uvm_migrate_release_user_sem(UVM_MIGRATE_PARAMS *params, uvm_va_space_t *va_space,
+static NV_STATUS uvm_migrate_release_user_sem(NvU64 sema_user_addr, NvU32 payload, uvm_va_space_t *va_space,
                                               uvm_va_range_t *sema_va_range, uvm_gpu_t *dest_gpu,
                                               uvm_tracker_t *tracker_ptr, bool *wait_for_tracker_out)
 {
@@ -320,7 +316,7 @@ static NV_STATUS uvm_migrate_release_user_sem(UVM_MIGRATE_PARAMS *params, uvm_va
         // No GPU has the semaphore pool cached. Attempt eager release from CPU
         // if the tracker is already completed.
         *wait_for_tracker_out = false;
-        uvm_release_user_sem_from_cpu(sema_mem, params->semaphoreAddress, params->semaphorePayload);
+        uvm_release_user_sem_from_cpu(sema_mem, sema_user_addr, payload);
     }
     else {
         // Semaphore has to be released from a GPU because it is cached or we were unable
@@ -335,8 +331,7 @@ static NV_STATUS uvm_migrate_release_user_sem(UVM_MIGRATE_PARAMS *params, uvm_va
             UVM_ASSERT(release_from);
         }
         status = uvm_push_async_user_sem_release(release_from, &sema_va_range->semaphore_pool,
-                                                 params->semaphoreAddress, params->semaphorePayload,
-                                                 tracker_ptr);
+                                                 sema_user_addr, payload, tracker_ptr);
         if (status != NV_OK) {
             UVM_ERR_PRINT("uvm_push_async_user_sem_release() returned %d (%s)\n",
                     status, nvstatusToString(status));
@@ -350,6 +345,75 @@ static NV_STATUS uvm_migrate_release_user_sem(UVM_MIGRATE_PARAMS *params, uvm_va
     return NV_OK;
 }
 
+// Validates the semaphore arguments of a migration and looks up the semaphore
+// pool VA range, if any. Returns NV_OK with *sema_va_range_out set to NULL if
+// no semaphore release was requested.
+static NV_STATUS uvm_migrate_get_user_sem(uvm_va_space_t *va_space,
+                                          NvU32 flags,
+                                          NvU64 sema_user_addr,
+                                          NvU32 payload,
+                                          uvm_va_range_t **sema_va_range_out)
+{
+    uvm_va_range_t *sema_va_range;
+
+    uvm_assert_rwsem_locked(&va_space->lock);
+
+    *sema_va_range_out = NULL;
+
+    if (!(flags & UVM_MIGRATE_FLAG_ASYNC)) {
+        if (sema_user_addr != 0)
+            return NV_ERR_INVALID_ARGUMENT;
+    }
+    else {
+        if (sema_user_addr == 0) {
+            if (payload != 0)
+                return NV_ERR_INVALID_ARGUMENT;
+        }
+        else {
+            sema_va_range = uvm_va_range_find(va_space, sema_user_addr);
+            if (!IS_ALIGNED(sema_user_addr, sizeof(payload)) ||
+                    !sema_va_range || sema_va_range->type != UVM_VA_RANGE_TYPE_SEMAPHORE_POOL)
+                return NV_ERR_INVALID_ADDRESS;
+
+            *sema_va_range_out = sema_va_range;
+        }
+    }
+
+    return NV_OK;
+}
+
+// Looks up the destination processor of a migration. *dest_gpu_out is set to
+// NULL if the destination is the CPU.
+static NV_STATUS uvm_migrate_get_dest_gpu(uvm_va_space_t *va_space,
+                                          const NvProcessorUuid *destination_uuid,
+                                          NvU32 flags,
+                                          NvU64 end,
+                                          uvm_gpu_t **dest_gpu_out)
+{
+    uvm_gpu_t *dest_gpu;
+
+    uvm_assert_rwsem_locked(&va_space->lock);
+
+    *dest_gpu_out = NULL;
+
+    if (uvm_uuid_is_cpu(destination_uuid))
+        return NV_OK;
+
+    if (flags & UVM_MIGRATE_FLAG_NO_GPU_VA_SPACE)
+        dest_gpu = uvm_va_space_get_gpu_by_uuid(va_space, destination_uuid);
+    else
+        dest_gpu = uvm_va_space_get_gpu_by_uuid_with_gpu_va_space(va_space, destination_uuid);
+
+    if (!dest_gpu)
+        return NV_ERR_INVALID_DEVICE;
+
+    if (!uvm_gpu_can_address(dest_gpu, end))
+        return NV_ERR_OUT_OF_RANGE;
+
+    *dest_gpu_out = dest_gpu;
+    return NV_OK;
+}
+
 NV_STATUS uvm_api_migrate(UVM_MIGRATE_PARAMS *params, struct file *filp)
 {
     uvm_va_space_t *va_space = uvm_va_space_get(filp);
@@ -358,6 +422,7 @@ NV_STATUS uvm_api_migrate(UVM_MIGRATE_PARAMS *params, struct file *filp)
     // NULL = CPU
     uvm_gpu_t *dest_gpu = NULL;
     uvm_va_range_t *sema_va_range = NULL;
+    uvm_va_block_context_t *va_block_context = NULL;
     NV_STATUS status;
     NV_STATUS tracker_status = NV_OK;
     bool wait_for_tracker = true;
@@ -377,57 +442,38 @@ NV_STATUS uvm_api_migrate(UVM_MIGRATE_PARAMS *params, struct file *filp)
     uvm_down_read_mmap_sem(&current->mm->mmap_sem);
     uvm_va_space_down_read(va_space);
 
-    if (!(params->flags & UVM_MIGRATE_FLAG_ASYNC)) {
-        if (params->semaphoreAddress != 0) {
-            status = NV_ERR_INVALID_ARGUMENT;
-            goto done;
-        }
-    }
-    else {
-        if (params->semaphoreAddress == 0) {
-            if (params->semaphorePayload != 0) {
-                status = NV_ERR_INVALID_ARGUMENT;
-                goto done;
-            }
-        }
-        else {
-            sema_va_range = uvm_va_range_find(va_space, params->semaphoreAddress);
-            if (!IS_ALIGNED(params->semaphoreAddress, sizeof(params->semaphorePayload)) ||
-                    !sema_va_range || sema_va_range->type != UVM_VA_RANGE_TYPE_SEMAPHORE_POOL) {
-                status = NV_ERR_INVALID_ADDRESS;
-                goto done;
-            }
-        }
-    }
-
-    if (uvm_uuid_is_cpu(&params->destinationUuid)) {
-        dest_gpu = NULL;
-    }
-    else {
-        if (params->flags & UVM_MIGRATE_FLAG_NO_GPU_VA_SPACE)
-            dest_gpu = uvm_va_space_get_gpu_by_uuid(va_space, &params->destinationUuid);
-        else
-            dest_gpu = uvm_va_space_get_gpu_by_uuid_with_gpu_va_space(va_space, &params->destinationUuid);
+    status = uvm_migrate_get_user_sem(va_space,
+                                      params->flags,
+                                      params->semaphoreAddress,
+                                      params->semaphorePayload,
+                                      &sema_va_range);
+    if (status != NV_OK)
+        goto done;
 
-        if (!dest_gpu) {
-            status = NV_ERR_INVALID_DEVICE;
-            goto done;
-        }
+    status = uvm_migrate_get_dest_gpu(va_space,
+                                      &params->destinationUuid,
+                                      params->flags,
+                                      params->base + params->length - 1,
+                                      &dest_gpu);
+    if (status != NV_OK)
+        goto done;
 
-        if (!uvm_gpu_can_address(dest_gpu, params->base + params->length - 1)) {
-            status = NV_ERR_OUT_OF_RANGE;
-            goto done;
-        }
+    va_block_context = uvm_va_block_context_alloc();
+    if (!va_block_context) {
+        status = NV_ERR_NO_MEMORY;
+        goto done;
     }
 
     // If we're synchronous or if we need to release a semaphore, use a tracker.
     if (!(params->flags & UVM_MIGRATE_FLAG_ASYNC) || params->semaphoreAddress)
         tracker_ptr = &tracker;
 
-    status = uvm_migrate(va_space, params->base, params->length, (dest_gpu ? dest_gpu->id : UVM_CPU_ID),
-                         params->flags, tracker_ptr);
+    status = uvm_migrate(va_space, va_block_context, params->base, params->length,
+                         (dest_gpu ? dest_gpu->id : UVM_CPU_ID), params->flags, tracker_ptr);
 
 done:
+    uvm_va_block_context_free(va_block_context);
+
     // We only need to hold mmap_sem to create new CPU mappings, so drop it if
     // we need to wait for the tracker to finish.
     //
@@ -440,8 +486,8 @@ done:
     if (tracker_ptr) {
         if (params->semaphoreAddress && status == NV_OK) {
             // Need to do a semaphore release.
-            status = uvm_migrate_release_user_sem(params, va_space, sema_va_range,
-                                                  dest_gpu, tracker_ptr, &wait_for_tracker);
+            status = uvm_migrate_release_user_sem(params->semaphoreAddress, params->semaphorePayload, va_space,
+                                                  sema_va_range, dest_gpu, tracker_ptr, &wait_for_tracker);
         }
 
         if (wait_for_tracker) {
@@ -468,6 +514,137 @@ done:
     return status == NV_OK ? tracker_status : status;
 }
 
+NV_STATUS uvm_api_migrate_batch(UVM_MIGRATE_BATCH_PARAMS *params, struct file *filp)
+{
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+    uvm_tracker_t tracker = UVM_TRACKER_INIT();
+    uvm_tracker_t *tracker_ptr = NULL;
+    UVM_MIGRATE_BATCH_ENTRY *entries;
+    // GPU used to release the semaphore if no GPU has the pool cached. NULL if
+    // all the destinations are the CPU.
+    uvm_gpu_t *release_gpu = NULL;
+    uvm_va_range_t *sema_va_range = NULL;
+    uvm_va_block_context_t *va_block_context = NULL;
+    NV_STATUS status;
+    NV_STATUS tracker_status = NV_OK;
+    bool wait_for_tracker = true;
+    NvU32 i;
+
+    if (params->numEntries == 0 || params->numEntries > UVM_MIGRATE_BATCH_MAX_ENTRIES)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    if (params->flags & ~UVM_MIGRATE_FLAGS_ALL)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    if ((params->flags & UVM_MIGRATE_FLAGS_TEST_ALL) && !uvm_enable_builtin_tests) {
+        UVM_INFO_PRINT("Test flag set for UVM_MIGRATE_BATCH. Did you mean to insmod with uvm_enable_builtin_tests=1?\n");
+        return NV_ERR_INVALID_ARGUMENT;
+    }
+
+    entries = uvm_kvmalloc(params->numEntries * sizeof(*entries));
+    if (!entries)
+        return NV_ERR_NO_MEMORY;
+
+    if (copy_from_user(entries, (void __user *)params->entries, params->numEntries * sizeof(*entries))) {
+        uvm_kvfree(entries);
+        return NV_ERR_INVALID_ADDRESS;
+    }
+
+    for (i = 0; i < params->numEntries; i++)
+        entries[i].rmStatus = NV_ERR_BUSY_RETRY;
+
+    // mmap_sem will be needed if we have to create CPU mappings
+    uvm_down_read_mmap_sem(&current->mm->mmap_sem);
+    uvm_va_space_down_read(va_space);
+
+    status = uvm_migrate_get_user_sem(va_space,
+                                      params->flags,
+                                      params->semaphoreAddress,
+                                      params->semaphorePayload,
+                                      &sema_va_range);
+    if (status != NV_OK)
+        goto done;
+
+    va_block_context = uvm_va_block_context_alloc();
+    if (!va_block_context) {
+        status = NV_ERR_NO_MEMORY;
+        goto done;
+    }
+
+    // If we're synchronous or if we need to release a semaphore, use a tracker.
+    // It is shared by all the entries so the batch completes with a single wait
+    // or semaphore release.
+    if (!(params->flags & UVM_MIGRATE_FLAG_ASYNC) || params->semaphoreAddress)
+        tracker_ptr = &tracker;
+
+    for (i = 0; i < params->numEntries; i++) {
+        UVM_MIGRATE_BATCH_ENTRY *entry = &entries[i];
+        uvm_gpu_t *dest_gpu = NULL;
+        NV_STATUS entry_status;
+
+        if (uvm_api_range_invalid(entry->base, entry->length)) {
+            entry_status = NV_ERR_INVALID_ADDRESS;
+        }
+        else {
+            entry_status = uvm_migrate_get_dest_gpu(va_space,
+                                                    &entry->destinationUuid,
+                                                    params->flags,
+                                                    entry->base + entry->length - 1,
+                                                    &dest_gpu);
+        }
+
+        if (entry_status == NV_OK) {
+            if (dest_gpu && !release_gpu)
+                release_gpu = dest_gpu;
+
+            entry_status = uvm_migrate(va_space, va_block_context, entry->base, entry->length,
+                                       (dest_gpu ? dest_gpu->id : UVM_CPU_ID), params->flags, tracker_ptr);
+        }
+
+        entry->rmStatus = entry_status;
+        if (status == NV_OK)
+            status = entry_status;
+    }
+
+done:
+    uvm_va_block_context_free(va_block_context);
+
+    // We only need to hold mmap_sem to create new CPU mappings, so drop it if
+    // we need to wait for the tracker to finish.
+    uvm_up_read_mmap_sem_out_of_order(&current->mm->mmap_sem);
+
+    if (tracker_ptr) {
+        if (params->semaphoreAddress && status == NV_OK) {
+            status = uvm_migrate_release_user_sem(params->semaphoreAddress, params->semaphorePayload, va_space,
+                                                  sema_va_range, release_gpu, tracker_ptr, &wait_for_tracker);
+        }
+
+        if (wait_for_tracker) {
+            // Waiting on a tracker requires the VA space lock to prevent GPUs
+            // being unregistered during the wait.
+            tracker_status = uvm_tracker_wait_deinit(tracker_ptr);
+        }
+        else {
+            uvm_tracker_deinit(tracker_ptr);
+        }
+    }
+
+    uvm_va_space_up_read(va_space);
+
+    if (wait_for_tracker)
+        uvm_tools_flush_events(va_space);
+
+    if (copy_to_user((void __user *)params->entries, entries, params->numEntries * sizeof(*entries))) {
+        if (status == NV_OK)
+            status = NV_ERR_INVALID_ADDRESS;
+    }
+
+    uvm_kvfree(entries);
+
+    // Only clobber status if we didn't hit an earlier error
+    return status == NV_OK ? tracker_status : status;
+}
+
 NV_STATUS uvm_api_migrate_range_group(UVM_MIGRATE_RANGE_GROUP_PARAMS *params, struct file *filp)
 {
     NV_STATUS status = NV_OK;
@@ -477,6 +654,7 @@ NV_STATUS uvm_api_migrate_range_group(UVM_MIGRATE_RANGE_GROUP_PARAMS *params, st
     uvm_range_group_range_t *rgr;
     uvm_processor_id_t dest_id;
     uvm_tracker_t local_tracker = UVM_TRACKER_INIT();
+    uvm_va_block_context_t *va_block_context = NULL;
     NvU32 migrate_flags = 0;
 
     // mmap_sem will be needed if we have to create CPU mappings
@@ -502,10 +680,17 @@ NV_STATUS uvm_api_migrate_range_group(UVM_MIGRATE_RANGE_GROUP_PARAMS *params, st
         goto done;
     }
 
+    va_block_context = uvm_va_block_context_alloc();
+    if (!va_block_context) {
+        status = NV_ERR_NO_MEMORY;
+        goto done;
+    }
+
     // Migrate all VA ranges in the range group. uvm_migrate is used because it performs all
     // VA range validity checks.
     list_for_each_entry(rgr, &range_group->ranges, range_group_list_node) {
         status = uvm_migrate(va_space,
+                             va_block_context,
                              rgr->node.start,
                              rgr->node.end - rgr->node.start + 1,
                              dest_id,
@@ -516,6 +701,8 @@ NV_STATUS uvm_api_migrate_range_group(UVM_MIGRATE_RANGE_GROUP_PARAMS *params, st
     }
 
 done:
+    uvm_va_block_context_free(va_block_context);
+
     // We only need to hold mmap_sem to create new CPU mappings, so drop it if
     // we need to wait for the tracker to finish.
     //
@@ -533,3 +720,78 @@ done:
 
     return status == NV_OK? tracker_status : status;
 }
+
+NV_STATUS uvm8_test_migrate_bandwidth(UVM_TEST_MIGRATE_BANDWIDTH_PARAMS *params, struct file *filp)
+{
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+    uvm_tracker_t tracker = UVM_TRACKER_INIT();
+    uvm_tracker_entry_t *entry;
+    uvm_gpu_t *dest_gpu;
+    uvm_va_block_context_t *va_block_context = NULL;
+    NvU32 ce_masks[UVM8_MAX_PROCESSORS] = {0};
+    NvU64 start_time = 0;
+    NV_STATUS status;
+    NV_STATUS tracker_status;
+
+    if (uvm_api_range_invalid(params->base, params->length))
+        return NV_ERR_INVALID_ADDRESS;
+
+    params->num_channels = 0;
+    params->num_copy_engines = 0;
+
+    uvm_down_read_mmap_sem(&current->mm->mmap_sem);
+    uvm_va_space_down_read(va_space);
+
+    status = uvm_migrate_get_dest_gpu(va_space,
+                                      &params->destination_uuid,
+                                      0,
+                                      params->base + params->length - 1,
+                                      &dest_gpu);
+    if (status != NV_OK)
+        goto done;
+
+    va_block_context = uvm_va_block_context_alloc();
+    if (!va_block_context) {
+        status = NV_ERR_NO_MEMORY;
+        goto done;
+    }
+
+    start_time = NV_GETTIME();
+
+    status = uvm_migrate(va_space, va_block_context, params->base, params->length,
+                         (dest_gpu ? dest_gpu->id : UVM_CPU_ID), 0, &tracker);
+
+    // The tracker holds the latest push of every channel the migration used.
+    // Only the copy channels are accounted, not the MEMOPS ones used to update
+    // the mappings.
+    for_each_tracker_entry(entry, &tracker) {
+        uvm_channel_t *channel = entry->channel;
+        uvm_gpu_t *gpu;
+
+        if (!channel || channel->pool->channel_type == UVM_CHANNEL_TYPE_MEMOPS)
+            continue;
+
+        gpu = uvm_channel_get_gpu(channel);
+
+        ++params->num_channels;
+        if (!(ce_masks[gpu->id] & (1 << channel->ce_index))) {
+            ce_masks[gpu->id] |= 1 << channel->ce_index;
+            ++params->num_copy_engines;
+        }
+    }
+
+done:
+    uvm_va_block_context_free(va_block_context);
+
+    uvm_up_read_mmap_sem_out_of_order(&current->mm->mmap_sem);
+
+    tracker_status = uvm_tracker_wait_deinit(&tracker);
+    if (status == NV_OK && tracker_status == NV_OK) {
+        params->migrate_ns = NV_GETTIME() - start_time;
+        params->bandwidth_mbps = params->migrate_ns ? (params->length * 1000) / params->migrate_ns : 0;
+    }
+
+    uvm_va_space_up_read(va_space);
+
+    return status == NV_OK ? tracker_status : status;
+}
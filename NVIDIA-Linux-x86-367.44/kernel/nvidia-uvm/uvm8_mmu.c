@@ -1452,3 +1452,347 @@ unlock_exit:
 
     return status;
 }
+
+// Max pages mapped by each iteration of the PTE and TLB batch benchmark
+#define PTE_TLB_BATCH_BENCHMARK_MAX_PAGES (64 * 1024)
+
+// Max VA span (num_pages * stride * page_size) covered by the range vector of
+// the PTE and TLB batch benchmark. This bounds the page table memory allocated
+// for the private page tree to a few hundred KB.
+#define PTE_TLB_BATCH_BENCHMARK_MAX_SIZE (64 * UVM_PAGE_SIZE_2M)
+
+// Write pte_bits to every stride-th PTE covered by the range vector with at
+// most max_memset_ptes consecutive PTEs written with memsets. Returns the time
+// it took for the GPU to complete all the writes.
+static NV_STATUS pte_batch_benchmark_write(uvm_page_table_range_vec_t *range_vec,
+                                           NvU32 stride,
+                                           NvU32 max_memset_ptes,
+                                           NvU64 pte_bits,
+                                           NvU64 *elapsed_ns)
+{
+    NV_STATUS status = NV_OK;
+    NV_STATUS tracker_status;
+    uvm_page_tree_t *tree = range_vec->tree;
+    uvm_gpu_t *gpu = tree->gpu;
+    NvU32 entry_size = uvm_mmu_pte_size(tree, range_vec->page_size);
+    uvm_tracker_t tracker = UVM_TRACKER_INIT();
+    uvm_pte_batch_t pte_batch;
+    uvm_push_t push;
+    bool in_push = false;
+    NvU64 page_index = 0;
+    NvU64 start_ns = NV_GETTIME();
+    size_t i;
+    NvU32 entry;
+
+    for (i = 0; i < range_vec->range_count; ++i) {
+        uvm_page_table_range_t *range = &range_vec->ranges[i];
+
+        for (entry = 0; entry < range->entry_count; ++entry, ++page_index) {
+            if (page_index % stride != 0)
+                continue;
+
+            if (!in_push) {
+                status = uvm_push_begin(gpu->channel_manager, UVM_CHANNEL_TYPE_MEMOPS, &push, "PTE batch benchmark");
+                if (status != NV_OK)
+                    goto done;
+
+                uvm_pte_batch_begin(&push, &pte_batch);
+                pte_batch.max_memset_ptes = max_memset_ptes;
+                in_push = true;
+            }
+
+            uvm_pte_batch_write_pte(&pte_batch, uvm_page_table_range_entry_address(tree, range, entry), pte_bits, entry_size);
+
+            // Start a new push once close to a full push, like
+            // uvm_page_table_range_vec_clear_ptes() does.
+            if (!uvm_push_has_space(&push, 1024)) {
+                uvm_pte_batch_end(&pte_batch);
+                uvm_push_end(&push);
+                in_push = false;
+
+                status = uvm_tracker_add_push(&tracker, &push);
+                if (status != NV_OK)
+                    goto done;
+            }
+        }
+    }
+
+    if (in_push) {
+        uvm_pte_batch_end(&pte_batch);
+        uvm_push_end(&push);
+        status = uvm_tracker_add_push(&tracker, &push);
+    }
+
+done:
+    tracker_status = uvm_tracker_wait_deinit(&tracker);
+    if (status == NV_OK)
+        status = tracker_status;
+
+    *elapsed_ns = NV_GETTIME() - start_ns;
+
+    return status;
+}
+
+// Measure the average cost per PTE of writing every stride-th PTE covered by
+// the range vector with memsets and with inline memcopies. Each iteration maps
+// and unmaps the num_pages PTEs once with each method.
+static NV_STATUS pte_batch_benchmark_costs(uvm_page_table_range_vec_t *range_vec,
+                                           NvU32 stride,
+                                           NvU32 num_pages,
+                                           NvU32 iterations,
+                                           NvU64 *memset_ns_per_page,
+                                           NvU64 *inline_ns_per_page)
+{
+    NV_STATUS status;
+    uvm_page_tree_t *tree = range_vec->tree;
+    NvU64 memset_ns = 0;
+    NvU64 inline_ns = 0;
+    NvU64 mapped_pte_bits;
+    NvU32 i;
+
+    // The PTEs are never accessed, so any valid physical address works
+    mapped_pte_bits = tree->hal->make_pte(UVM_APERTURE_VID, 0, UVM_PROT_READ_ONLY, NV_FALSE, range_vec->page_size);
+
+    for (i = 0; i < iterations; ++i) {
+        NvU64 map_ns;
+        NvU64 unmap_ns;
+
+        // UVM_PTE_BATCH_MAX_PTES makes each scattered PTE use a memset
+        status = pte_batch_benchmark_write(range_vec, stride, UVM_PTE_BATCH_MAX_PTES, mapped_pte_bits, &map_ns);
+        if (status != NV_OK)
+            return status;
+
+        status = pte_batch_benchmark_write(range_vec, stride, UVM_PTE_BATCH_MAX_PTES, 0, &unmap_ns);
+        if (status != NV_OK)
+            return status;
+
+        memset_ns += map_ns + unmap_ns;
+
+        // 0 makes all PTEs use inline memcopy
+        status = pte_batch_benchmark_write(range_vec, stride, 0, mapped_pte_bits, &map_ns);
+        if (status != NV_OK)
+            return status;
+
+        status = pte_batch_benchmark_write(range_vec, stride, 0, 0, &unmap_ns);
+        if (status != NV_OK)
+            return status;
+
+        inline_ns += map_ns + unmap_ns;
+    }
+
+    *memset_ns_per_page = memset_ns / (2ull * iterations * num_pages);
+    *inline_ns_per_page = inline_ns / (2ull * iterations * num_pages);
+
+    return NV_OK;
+}
+
+// Inline memcopy cost is dominated by the fixed cost of each memcopy while
+// memsets cost the same for each PTE. Use memsets for as many consecutive PTEs
+// as they stay cheaper than a single memcopy.
+static NvU32 pte_batch_max_memset_ptes_from_costs(NvU64 memset_ns_per_page, NvU64 inline_ns_per_page)
+{
+    NvU64 max_memset_ptes = inline_ns_per_page / max(memset_ns_per_page, 1ull);
+
+    return (NvU32)min(max_memset_ptes, (NvU64)UVM_PTE_BATCH_MAX_PTES);
+}
+
+// Scattered PTEs written by each iteration of the PTE batch calibration. Every
+// other 4K PTE is written, so that each PTE is written separately.
+#define PTE_BATCH_CALIBRATION_PAGES      256
+#define PTE_BATCH_CALIBRATION_STRIDE     2
+#define PTE_BATCH_CALIBRATION_ITERATIONS 4
+
+NV_STATUS uvm_mmu_calibrate_pte_batch(uvm_gpu_t *gpu)
+{
+    NV_STATUS status;
+    uvm_page_tree_t *tree;
+    uvm_page_table_range_vec_t range_vec;
+    NvU64 memset_ns;
+    NvU64 inline_ns;
+
+    memset(&range_vec, 0, sizeof(range_vec));
+
+    // Use a private page tree that's not used for any accesses
+    tree = uvm_kvmalloc_zero(sizeof(*tree));
+    if (!tree)
+        return NV_ERR_NO_MEMORY;
+
+    status = uvm_page_tree_init(gpu, gpu->big_page.internal_size, UVM_APERTURE_DEFAULT, tree);
+    if (status != NV_OK) {
+        uvm_kvfree(tree);
+        return status;
+    }
+
+    status = uvm_page_table_range_vec_init(tree,
+                                           0,
+                                           (NvU64)PTE_BATCH_CALIBRATION_PAGES *
+                                               PTE_BATCH_CALIBRATION_STRIDE *
+                                               UVM_PAGE_SIZE_4K,
+                                           UVM_PAGE_SIZE_4K,
+                                           &range_vec);
+    if (status != NV_OK)
+        goto done;
+
+    status = pte_batch_benchmark_costs(&range_vec,
+                                       PTE_BATCH_CALIBRATION_STRIDE,
+                                       PTE_BATCH_CALIBRATION_PAGES,
+                                       PTE_BATCH_CALIBRATION_ITERATIONS,
+                                       &memset_ns,
+                                       &inline_ns);
+    if (status != NV_OK)
+        goto done;
+
+    gpu->pte_batch.max_memset_ptes = pte_batch_max_memset_ptes_from_costs(memset_ns, inline_ns);
+
+done:
+    uvm_page_table_range_vec_deinit(&range_vec);
+    uvm_page_tree_deinit(tree);
+    uvm_kvfree(tree);
+
+    return status;
+}
+
+// Invalidate every stride-th page covered by the range vector in a single TLB
+// batch. Returns the time it took for the GPU to complete the invalidates.
+static NV_STATUS tlb_batch_benchmark_invalidate(uvm_page_table_range_vec_t *range_vec,
+                                                NvU32 stride,
+                                                UVM_TEST_PTE_TLB_BATCH_BENCHMARK_PARAMS *params,
+                                                NvU64 *elapsed_ns)
+{
+    NV_STATUS status;
+    uvm_page_tree_t *tree = range_vec->tree;
+    uvm_tlb_batch_t tlb_batch;
+    uvm_push_t push;
+    NvU64 start_ns = NV_GETTIME();
+    NvU64 va;
+
+    status = uvm_push_begin(tree->gpu->channel_manager, UVM_CHANNEL_TYPE_MEMOPS, &push, "TLB batch benchmark");
+    if (status != NV_OK)
+        return status;
+
+    uvm_tlb_batch_begin(tree, &tlb_batch);
+
+    for (va = range_vec->start; va < range_vec->start + range_vec->size; va += (NvU64)stride * range_vec->page_size)
+        uvm_tlb_batch_invalidate(&tlb_batch, va, range_vec->page_size, range_vec->page_size, UVM_MEMBAR_NONE);
+
+    params->tlb_ranges = tlb_batch.count;
+    params->tlb_invalidate_all = uvm_tlb_batch_should_invalidate_all(&tlb_batch);
+
+    uvm_tlb_batch_end(&tlb_batch, &push, UVM_MEMBAR_NONE);
+
+    status = uvm_push_end_and_wait(&push);
+
+    *elapsed_ns = NV_GETTIME() - start_ns;
+
+    return status;
+}
+
+NV_STATUS uvm8_test_pte_tlb_batch_benchmark(UVM_TEST_PTE_TLB_BATCH_BENCHMARK_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status;
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+    uvm_gpu_va_space_t *gpu_va_space;
+    uvm_page_tree_t *tree = NULL;
+    uvm_page_table_range_vec_t range_vec;
+    uvm_gpu_t *gpu;
+    NvU64 tlb_ns = 0;
+    NvU32 i;
+
+    if (params->num_pages == 0 || params->num_pages > PTE_TLB_BATCH_BENCHMARK_MAX_PAGES ||
+        params->stride == 0 || params->stride > PTE_TLB_BATCH_BENCHMARK_MAX_PAGES ||
+        params->iterations == 0)
+        return NV_ERR_INVALID_PARAMETER;
+
+    if (params->apply && params->stride == 1)
+        return NV_ERR_INVALID_PARAMETER;
+
+    memset(&range_vec, 0, sizeof(range_vec));
+
+    uvm_va_space_down_read(va_space);
+
+    gpu = uvm_va_space_get_gpu_by_uuid_with_gpu_va_space(va_space, &params->gpu_uuid);
+    if (!gpu) {
+        status = NV_ERR_INVALID_DEVICE;
+        goto done;
+    }
+
+    gpu_va_space = uvm_gpu_va_space_get(va_space, gpu);
+    UVM_ASSERT(gpu_va_space);
+
+    if (params->page_size != UVM_PAGE_SIZE_4K && params->page_size != gpu_va_space->page_tables.big_page_size) {
+        status = NV_ERR_INVALID_PARAMETER;
+        goto done;
+    }
+
+    // Both num_pages and stride are bounded above, so the product can't
+    // overflow.
+    if ((NvU64)params->num_pages * params->stride * params->page_size > PTE_TLB_BATCH_BENCHMARK_MAX_SIZE) {
+        status = NV_ERR_INVALID_PARAMETER;
+        goto done;
+    }
+
+    // Use a private page tree so that the benchmark doesn't affect any of the
+    // VA space mappings. The tree is not used for any accesses, so the TLB
+    // invalidates targeting it only measure the invalidate cost.
+    tree = uvm_kvmalloc_zero(sizeof(*tree));
+    if (!tree) {
+        status = NV_ERR_NO_MEMORY;
+        goto done;
+    }
+
+    status = uvm_page_tree_init(gpu, gpu_va_space->page_tables.big_page_size, UVM_APERTURE_DEFAULT, tree);
+    if (status != NV_OK) {
+        uvm_kvfree(tree);
+        tree = NULL;
+        goto done;
+    }
+
+    status = uvm_page_table_range_vec_init(tree,
+                                           0,
+                                           (NvU64)params->num_pages * params->stride * params->page_size,
+                                           params->page_size,
+                                           &range_vec);
+    if (status != NV_OK)
+        goto done;
+
+    status = pte_batch_benchmark_costs(&range_vec,
+                                       params->stride,
+                                       params->num_pages,
+                                       params->iterations,
+                                       &params->pte_memset_ns_per_page,
+                                       &params->pte_inline_ns_per_page);
+    if (status != NV_OK)
+        goto done;
+
+    for (i = 0; i < params->iterations; ++i) {
+        NvU64 invalidate_ns;
+
+        status = tlb_batch_benchmark_invalidate(&range_vec, params->stride, params, &invalidate_ns);
+        if (status != NV_OK)
+            goto done;
+
+        tlb_ns += invalidate_ns;
+    }
+
+    params->tlb_invalidate_ns_per_page = tlb_ns / ((NvU64)params->iterations * params->num_pages);
+
+    if (params->apply) {
+        UVM_WRITE_ONCE(gpu->pte_batch.max_memset_ptes,
+                       pte_batch_max_memset_ptes_from_costs(params->pte_memset_ns_per_page,
+                                                            params->pte_inline_ns_per_page));
+    }
+
+done:
+    params->max_memset_ptes = gpu ? gpu->pte_batch.max_memset_ptes : 0;
+
+    uvm_page_table_range_vec_deinit(&range_vec);
+
+    if (tree) {
+        uvm_page_tree_deinit(tree);
+        uvm_kvfree(tree);
+    }
+
+    uvm_va_space_up_read(va_space);
+
+    return status;
+}
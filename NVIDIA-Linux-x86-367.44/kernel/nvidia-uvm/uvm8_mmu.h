@@ -348,6 +348,12 @@ uvm_gpu_address_t uvm_mmu_gpu_address_for_big_page_physical(uvm_gpu_address_t ph
 // Helper for initializing a GPU's peer VA space
 void uvm_mmu_init_gpu_peer_addresses(uvm_gpu_t *gpu);
 
+// Measure the cost of writing scattered PTEs with memsets and with inline
+// memcopies on the GPU, and set the number of consecutive PTEs PTE batches
+// write with memsets (gpu->pte_batch.max_memset_ptes) accordingly. Requires the
+// channel manager of the GPU.
+NV_STATUS uvm_mmu_calibrate_pte_batch(uvm_gpu_t *gpu);
+
 static NvU64 uvm_mmu_page_tree_entries(uvm_page_tree_t *tree, NvU32 depth, NvU32 page_size)
 {
     return 1ull << tree->hal->index_bits(depth, page_size);
@@ -418,5 +424,6 @@ static uvm_aperture_t uvm_page_table_range_aperture(uvm_page_table_range_t *rang
 }
 
 NV_STATUS uvm8_test_invalidate_tlb(UVM_TEST_INVALIDATE_TLB_PARAMS *params, struct file *filp);
+NV_STATUS uvm8_test_pte_tlb_batch_benchmark(UVM_TEST_PTE_TLB_BATCH_BENCHMARK_PARAMS *params, struct file *filp);
 
 #endif
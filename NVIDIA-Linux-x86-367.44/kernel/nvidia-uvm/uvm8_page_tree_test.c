@@ -876,7 +876,7 @@ static NV_STATUS test_tlb_batch_invalidates_case(uvm_page_tree_t *tree, NvU64 ba
             NvU32 expected_range_depth = tree->hal->page_table_depth(used_max_page_size);
             bool allow_inval_all = (total_pages > gpu->tlb_batch.max_pages) ||
                                    !gpu->tlb_batch.va_invalidate_supported ||
-                                   (i > UVM_TLB_BATCH_MAX_ENTRIES);
+                                   (i > gpu->tlb_batch.max_ranges);
             TEST_CHECK_RET(assert_invalidate_range(base + j * 2 * size, size, min_page_size,
                     allow_inval_all, expected_range_depth, expected_inval_all_depth, false));
         }
@@ -889,6 +889,46 @@ static NV_STATUS test_tlb_batch_invalidates_case(uvm_page_tree_t *tree, NvU64 ba
     return status;
 }
 
+// Queue up consecutive ranges one at a time and check that they are merged into
+// a single targeted invalidate.
+static NV_STATUS test_tlb_batch_merges_case(uvm_page_tree_t *tree, NvU64 base, NvU64 size, NvU32 page_sizes)
+{
+    NV_STATUS status = NV_OK;
+    uvm_push_t push;
+    uvm_tlb_batch_t batch;
+    uvm_gpu_t *gpu = tree->gpu;
+    NvU32 min_page_size = 1u << __ffs(page_sizes);
+    NvU32 depth = tree->hal->page_table_depth(1u << __fls(page_sizes));
+    NvU32 count = gpu->tlb_batch.max_ranges + 1;
+    NvU32 i;
+
+    MEM_NV_CHECK_RET(uvm_push_begin_fake(gpu, &push), NV_OK);
+
+    fake_tlb_invals_enable();
+
+    uvm_tlb_batch_begin(tree, &batch);
+
+    // Queue up more ranges than the batch tracks separately
+    for (i = 0; i < count; ++i)
+        uvm_tlb_batch_invalidate(&batch, base + i * size, size, page_sizes, UVM_MEMBAR_NONE);
+
+    uvm_tlb_batch_end(&batch, &push, UVM_MEMBAR_NONE);
+
+    if (count * (size / min_page_size) > gpu->tlb_batch.max_pages || !gpu->tlb_batch.va_invalidate_supported) {
+        TEST_CHECK_RET(assert_last_invalidate_all(depth, false));
+    }
+    else {
+        TEST_CHECK_RET(g_fake_invals_count == 1);
+        TEST_CHECK_RET(assert_invalidate_range_specific(g_last_fake_inval, base, count * size, min_page_size, depth, false));
+    }
+
+    fake_tlb_invals_disable();
+
+    uvm_push_end_fake(&push);
+
+    return status;
+}
+
 static NV_STATUS test_pascal_tlb_batch_invalidates(uvm_gpu_t *gpu)
 {
     NV_STATUS status = NV_OK;
@@ -912,6 +952,11 @@ static NV_STATUS test_pascal_tlb_batch_invalidates(uvm_gpu_t *gpu)
 
                 TEST_CHECK_GOTO(test_tlb_batch_invalidates_case(&tree, min_index * max_page_size, size, min_page_size, max_page_size) == NV_OK, done);
             }
+
+            TEST_CHECK_GOTO(test_tlb_batch_merges_case(&tree,
+                                                       min_index * page_sizes[max_index],
+                                                       page_sizes[max_index],
+                                                       page_sizes[min_index] | page_sizes[max_index]) == NV_OK, done);
         }
     }
 
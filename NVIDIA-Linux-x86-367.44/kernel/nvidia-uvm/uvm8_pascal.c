@@ -24,6 +24,8 @@
 #include "uvm8_hal.h"
 #include "uvm8_gpu.h"
 #include "uvm8_mem.h"
+#include "uvm8_pte_batch.h"
+#include "uvm8_tlb_batch.h"
 #include "uvm8_pascal_fault_buffer.h"
 
 static unsigned uvm_force_prefetch_fault_support = 0;
@@ -41,6 +43,10 @@ void uvm_hal_pascal_arch_init_properties(uvm_gpu_t *gpu)
     // TODO: Bug 1767241: Run benchmarks to figure out a good number
     gpu->tlb_batch.max_pages = 32;
 
+    gpu->tlb_batch.max_ranges = UVM_TLB_BATCH_MAX_ENTRIES;
+
+    gpu->pte_batch.max_memset_ptes = UVM_PTE_BATCH_MEMSET_PTES_DEFAULT;
+
     gpu->fault_buffer_info.replayable.utlb_count = g_uvm_hal_pascal_max_gpcs * UVM_PASCAL_GPC_UTLB_COUNT;
 
     // A single top level PDE on Pascal covers 128 TB and that's the minimum
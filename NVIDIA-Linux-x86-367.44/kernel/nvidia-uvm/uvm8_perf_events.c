@@ -25,56 +25,45 @@
 #include "uvm8_perf_events.h"
 #include "uvm8_va_space.h"
 
-// Entry of the event callback list
-typedef struct
+// Return the index of the given callback in the callbacks of the event, or UVM_PERF_EVENT_MAX_CALLBACKS if it's not
+// registered. Caller needs to hold (at least) read va_space_events lock
+static NvU32 event_find_callback(uvm_perf_va_space_events_t *va_space_events, uvm_perf_event_t event_id,
+                                 uvm_perf_event_callback_t callback)
 {
-    uvm_perf_event_callback_t callback;
-
-    struct list_head callback_list_node;
-} callback_desc_t;
-
-// Cache for callback descriptor list entries
-struct kmem_cache *g_callback_desc_cache;
-
-// Check if the callback list already contains an entry for the given callback. Caller needs to hold (at least) read
-// va_space_events lock
-static callback_desc_t *event_list_find_callback(uvm_perf_va_space_events_t *va_space_events,
-                                                 struct list_head *callback_list, uvm_perf_event_callback_t callback)
-{
-    callback_desc_t *callback_desc;
+    NvU32 i;
 
     uvm_assert_rwsem_locked(&va_space_events->lock);
 
-    list_for_each_entry(callback_desc, callback_list, callback_list_node) {
-        if (callback_desc->callback == callback)
-            return callback_desc;
+    for (i = 0; i < va_space_events->num_event_callbacks[event_id]; ++i) {
+        if (va_space_events->event_callbacks[event_id][i] == callback)
+            return i;
     }
 
-    return NULL;
+    return UVM_PERF_EVENT_MAX_CALLBACKS;
 }
 
 NV_STATUS uvm_perf_register_event_callback_locked(uvm_perf_va_space_events_t *va_space_events,
                                                   uvm_perf_event_t event_id,
                                                   uvm_perf_event_callback_t callback)
 {
-    callback_desc_t *callback_desc;
-    struct list_head *callback_list;
+    NvU32 num_callbacks;
 
     UVM_ASSERT(event_id >= 0 && event_id < UVM_PERF_EVENT_COUNT);
     UVM_ASSERT(callback);
 
     uvm_assert_rwsem_locked_write(&va_space_events->lock);
 
-    callback_list = &va_space_events->event_callbacks[event_id];
+    UVM_ASSERT(event_find_callback(va_space_events, event_id, callback) == UVM_PERF_EVENT_MAX_CALLBACKS);
 
-    UVM_ASSERT(!event_list_find_callback(va_space_events, callback_list, callback));
+    num_callbacks = va_space_events->num_event_callbacks[event_id];
+    if (num_callbacks == UVM_PERF_EVENT_MAX_CALLBACKS)
+        return NV_ERR_INSUFFICIENT_RESOURCES;
 
-    callback_desc = kmem_cache_alloc(g_callback_desc_cache, NV_UVM_GFP_FLAGS);
-    if (!callback_desc)
-        return NV_ERR_NO_MEMORY;
+    va_space_events->event_callbacks[event_id][num_callbacks] = callback;
 
-    callback_desc->callback = callback;
-    list_add_tail(&callback_desc->callback_list_node, callback_list);
+    // Notifiers only read the callbacks with the lock held, so the count can
+    // be published with a plain store.
+    UVM_WRITE_ONCE(va_space_events->num_event_callbacks[event_id], num_callbacks + 1);
 
     return NV_OK;
 }
@@ -94,23 +83,26 @@ NV_STATUS uvm_perf_register_event_callback(uvm_perf_va_space_events_t *va_space_
 void uvm_perf_unregister_event_callback_locked(uvm_perf_va_space_events_t *va_space_events, uvm_perf_event_t event_id,
                                                uvm_perf_event_callback_t callback)
 {
-    callback_desc_t *callback_desc;
-    struct list_head *callback_list;
+    uvm_perf_event_callback_t *callbacks;
+    NvU32 num_callbacks;
+    NvU32 index;
 
     UVM_ASSERT(event_id >= 0 && event_id < UVM_PERF_EVENT_COUNT);
     UVM_ASSERT(callback);
 
     uvm_assert_rwsem_locked_write(&va_space_events->lock);
 
-    callback_list = &va_space_events->event_callbacks[event_id];
-    callback_desc = event_list_find_callback(va_space_events, callback_list, callback);
-
-    if (!callback_desc)
+    index = event_find_callback(va_space_events, event_id, callback);
+    if (index == UVM_PERF_EVENT_MAX_CALLBACKS)
         return;
 
-    list_del(&callback_desc->callback_list_node);
+    // Keep the registration order of the remaining callbacks
+    callbacks = va_space_events->event_callbacks[event_id];
+    num_callbacks = va_space_events->num_event_callbacks[event_id];
+    memmove(&callbacks[index], &callbacks[index + 1], (num_callbacks - index - 1) * sizeof(*callbacks));
+    callbacks[num_callbacks - 1] = NULL;
 
-    kmem_cache_free(g_callback_desc_cache, callback_desc);
+    UVM_WRITE_ONCE(va_space_events->num_event_callbacks[event_id], num_callbacks - 1);
 }
 
 void uvm_perf_unregister_event_callback(uvm_perf_va_space_events_t *va_space_events, uvm_perf_event_t event_id,
@@ -124,33 +116,34 @@ void uvm_perf_unregister_event_callback(uvm_perf_va_space_events_t *va_space_eve
 void uvm_perf_event_notify(uvm_perf_va_space_events_t *va_space_events, uvm_perf_event_t event_id,
                            uvm_perf_event_data_t *event_data)
 {
-    callback_desc_t *callback_desc;
-    struct list_head *callback_list;
+    NvU32 i;
 
     UVM_ASSERT(event_id >= 0 && event_id < UVM_PERF_EVENT_COUNT);
     UVM_ASSERT(event_data);
 
-    callback_list = &va_space_events->event_callbacks[event_id];
+    // Most events have no callbacks registered most of the time (for example,
+    // the tools ones when no tracer is attached). Skip taking the lock for
+    // them, as it is shared by all the threads notifying events in the VA
+    // space. A notification that races with the registration of the first
+    // callback can be missed, like if it had been notified right before.
+    if (UVM_READ_ONCE(va_space_events->num_event_callbacks[event_id]) == 0)
+        return;
 
     uvm_down_read(&va_space_events->lock);
 
     // Invoke all registered callbacks for the events
-    list_for_each_entry(callback_desc, callback_list, callback_list_node) {
-        callback_desc->callback(event_id, event_data);
-    }
+    for (i = 0; i < va_space_events->num_event_callbacks[event_id]; ++i)
+        va_space_events->event_callbacks[event_id][i](event_id, event_data);
 
     uvm_up_read(&va_space_events->lock);
 }
 
 NV_STATUS uvm_perf_init_va_space_events(uvm_va_space_t *va_space, uvm_perf_va_space_events_t *va_space_events)
 {
-    unsigned event_id;
-
     uvm_init_rwsem(&va_space_events->lock, UVM_LOCK_ORDER_VA_SPACE_EVENTS);
 
-    // Initialize event callback lists
-    for (event_id = 0; event_id < UVM_PERF_EVENT_COUNT; ++event_id)
-        INIT_LIST_HEAD(&va_space_events->event_callbacks[event_id]);
+    memset(va_space_events->event_callbacks, 0, sizeof(va_space_events->event_callbacks));
+    memset(va_space_events->num_event_callbacks, 0, sizeof(va_space_events->num_event_callbacks));
 
     va_space_events->va_space = va_space;
 
@@ -159,39 +152,22 @@ NV_STATUS uvm_perf_init_va_space_events(uvm_va_space_t *va_space, uvm_perf_va_sp
 
 void uvm_perf_destroy_va_space_events(uvm_perf_va_space_events_t *va_space_events)
 {
-    unsigned event_id;
-
     // If the va_space member was not set, va_space creation failed before initializing its va_space_events member. We
     // are done.
     if (!va_space_events->va_space)
         return;
 
-    // Destroy all event callback lists' entries
-    for (event_id = 0; event_id < UVM_PERF_EVENT_COUNT; ++event_id) {
-        callback_desc_t *callback_desc, *callback_desc_tmp;
-        struct list_head *callback_list;
-
-        callback_list = &va_space_events->event_callbacks[event_id];
-
-        list_for_each_entry_safe(callback_desc, callback_desc_tmp, callback_list, callback_list_node) {
-            list_del(&callback_desc->callback_list_node);
-            kmem_cache_free(g_callback_desc_cache, callback_desc);
-        }
-    }
+    // Drop all the registered callbacks
+    memset(va_space_events->num_event_callbacks, 0, sizeof(va_space_events->num_event_callbacks));
 
     va_space_events->va_space = NULL;
 }
 
 NV_STATUS uvm_perf_events_init(void)
 {
-    g_callback_desc_cache = NV_KMEM_CACHE_CREATE("uvm_perf_callback_list", callback_desc_t);
-    if (!g_callback_desc_cache)
-        return NV_ERR_NO_MEMORY;
-
     return NV_OK;
 }
 
 void uvm_perf_events_exit(void)
 {
-    kmem_cache_destroy_safe(&g_callback_desc_cache);
 }
@@ -39,7 +39,7 @@
 // GPU will not be downgraded. Registering/unregistering callbacks requires holding the VA space events lock in write
 // mode. The exact locking guarantees under which callbacks are executed depend on the specific event, but the VA space
 // events lock is held in read mode for all of them. The additional locking guarantees are defined in each event
-// definition.
+// definition. Notifying an event without registered callbacks doesn't take the lock.
 
 // Performance-related events that can be notified
 typedef enum
@@ -217,18 +217,26 @@ typedef union
 //             is declared in the uvm_perf_event_data_t union
 typedef void (*uvm_perf_event_callback_t)(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data);
 
+// Maximum number of callbacks that can be registered for a single event
+#define UVM_PERF_EVENT_MAX_CALLBACKS 8
+
 typedef struct
 {
     // Lock protecting the events
     //
     // Held for write during registration/unregistration of callbacks and for
-    // read during notification of events.
+    // read during notification of events that have callbacks registered.
     //
     // Also used by tools to protect their state and registration of perf event callbacks.
     uvm_rw_semaphore_t lock;
 
-    // Array of callbacks for event notification
-    struct list_head event_callbacks[UVM_PERF_EVENT_COUNT];
+    // Callbacks for event notification, in registration order
+    uvm_perf_event_callback_t event_callbacks[UVM_PERF_EVENT_COUNT][UVM_PERF_EVENT_MAX_CALLBACKS];
+
+    // Number of callbacks registered for each event. Updated with the lock held
+    // in write mode, but read without the lock by uvm_perf_event_notify() so
+    // that events without callbacks don't touch the lock cache line.
+    NvU32 num_event_callbacks[UVM_PERF_EVENT_COUNT];
 
     uvm_va_space_t *va_space;
 } uvm_perf_va_space_events_t;
@@ -74,6 +74,15 @@ static NV_STATUS test_events(uvm_va_space_t *va_space)
     // test_data was initialized to zero. It should have been incremented by 1 and 2, respectively in the callbacks
     TEST_CHECK_GOTO(test_data == 3, done);
 
+    // Unregister the first callback. The second one must still be invoked
+    uvm_perf_unregister_event_callback(&va_space->perf_events, UVM_PERF_EVENT_FAULT, callback_inc_1);
+
+    uvm_va_space_down_read(va_space);
+    uvm_perf_event_notify(&va_space->perf_events, UVM_PERF_EVENT_FAULT, &event_data);
+    uvm_va_space_up_read(va_space);
+
+    TEST_CHECK_GOTO(test_data == 5, done);
+
 done:
     // Unregister all callbacks
     uvm_perf_unregister_event_callback(&va_space->perf_events, UVM_PERF_EVENT_FAULT, callback_inc_1);
@@ -97,3 +106,80 @@ done:
     return status;
 }
 
+#define PERF_EVENTS_BENCHMARK_MAX_THREADS 16
+
+typedef struct
+{
+    uvm_perf_va_space_events_t *va_space_events;
+    NvU32 num_events;
+} perf_events_benchmark_t;
+
+static void callback_nop(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data)
+{
+}
+
+static NV_STATUS perf_events_benchmark_thread(void *arg, NvU32 thread_index)
+{
+    perf_events_benchmark_t *bench = (perf_events_benchmark_t *)arg;
+    uvm_perf_event_data_t event_data;
+    NvU32 i;
+
+    memset(&event_data, 0, sizeof(event_data));
+    event_data.fault.proc_id = UVM_CPU_ID;
+
+    for (i = 0; i < bench->num_events; ++i)
+        uvm_perf_event_notify(bench->va_space_events, UVM_PERF_EVENT_FAULT, &event_data);
+
+    return NV_OK;
+}
+
+NV_STATUS uvm8_test_perf_events_benchmark(UVM_TEST_PERF_EVENTS_BENCHMARK_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status;
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+    perf_events_benchmark_t bench;
+
+    if (params->num_threads == 0 || params->num_threads > PERF_EVENTS_BENCHMARK_MAX_THREADS || params->num_events == 0)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    // Use a private set of events so that the callbacks registered in the VA
+    // space are not invoked
+    bench.va_space_events = uvm_kvmalloc_zero(sizeof(*bench.va_space_events));
+    bench.num_events = params->num_events;
+    if (!bench.va_space_events)
+        return NV_ERR_NO_MEMORY;
+
+    status = uvm_perf_init_va_space_events(va_space, bench.va_space_events);
+    if (status != NV_OK)
+        goto done;
+
+    status = uvm_test_benchmark_run("uvm-events-bench",
+                                    params->num_threads,
+                                    perf_events_benchmark_thread,
+                                    NULL,
+                                    &bench,
+                                    &params->no_callbacks_ns);
+    if (status != NV_OK)
+        goto destroy;
+
+    status = uvm_perf_register_event_callback(bench.va_space_events, UVM_PERF_EVENT_FAULT, callback_nop);
+    if (status != NV_OK)
+        goto destroy;
+
+    status = uvm_test_benchmark_run("uvm-events-bench",
+                                    params->num_threads,
+                                    perf_events_benchmark_thread,
+                                    NULL,
+                                    &bench,
+                                    &params->callback_ns);
+
+    uvm_perf_unregister_event_callback(bench.va_space_events, UVM_PERF_EVENT_FAULT, callback_nop);
+
+destroy:
+    uvm_perf_destroy_va_space_events(bench.va_space_events);
+
+done:
+    uvm_kvfree(bench.va_space_events);
+
+    return status;
+}
@@ -0,0 +1,414 @@
+/*******************************************************************************
+    Copyright (c) 2016 NVIDIA Corporation
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to
+    deal in the Software without restriction, including without limitation the
+    rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+        The above copyright notice and this permission notice shall be
+        included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+#include "uvm_linux.h"
+#include "uvm_ioctl.h"
+#include "uvm8_api.h"
+#include "uvm8_perf_events.h"
+#include "uvm8_perf_module.h"
+#include "uvm8_perf_heatmap.h"
+#include "uvm8_perf_utils.h"
+#include "uvm8_kvmalloc.h"
+#include "uvm8_va_block.h"
+#include "uvm8_va_range.h"
+#include "uvm8_va_space.h"
+
+// Global cache to allocate the per-VA block heatmap structures
+static struct kmem_cache *g_heatmap_info_cache __read_mostly;
+
+// Per-VA block heatmap counters. All the counters saturate.
+typedef struct
+{
+    // Number of faults reported by each processor on the block
+    NvU32 faults[UVM8_MAX_PROCESSORS];
+
+    // Number of pages migrated to/from each processor
+    NvU32 pages_migrated_in[UVM8_MAX_PROCESSORS];
+    NvU32 pages_migrated_out[UVM8_MAX_PROCESSORS];
+
+    // Number of pages detected as thrashing
+    NvU32 thrashing_pages;
+
+    // Number of pages pinned by thrashing prevention
+    NvU32 pinned_pages;
+
+    // Number of prefetched pages that the processor they were prefetched to
+    // later faulted on
+    NvU32 prefetch_hit_pages;
+} block_heatmap_info_t;
+
+// Enable/disable the per-VA block heatmap
+static unsigned uvm_perf_heatmap_enable = 1;
+
+module_param(uvm_perf_heatmap_enable, uint, S_IRUGO);
+
+static bool g_uvm_perf_heatmap_enable __read_mostly;
+
+// Performance heuristics module for the heatmap
+static uvm_perf_module_t g_module_heatmap;
+
+// Callback declaration for the performance heuristics events
+static void heatmap_block_destroy_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data);
+static void heatmap_fault_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data);
+static void heatmap_migration_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data);
+
+static uvm_perf_module_event_callback_desc_t g_callbacks_heatmap[] = {
+    { UVM_PERF_EVENT_BLOCK_DESTROY, heatmap_block_destroy_cb },
+    { UVM_PERF_EVENT_MODULE_UNLOAD, heatmap_block_destroy_cb },
+    { UVM_PERF_EVENT_BLOCK_SHRINK,  heatmap_block_destroy_cb },
+    { UVM_PERF_EVENT_FAULT,         heatmap_fault_cb         },
+    { UVM_PERF_EVENT_MIGRATION,     heatmap_migration_cb     }
+};
+
+// Get the heatmap struct for the given block
+static block_heatmap_info_t *heatmap_info_get(uvm_va_block_t *va_block)
+{
+    return uvm_perf_module_type_data(va_block->perf_modules_data, UVM_PERF_MODULE_TYPE_HEATMAP);
+}
+
+// Get the heatmap struct for the given block or create it if it does not exist
+static block_heatmap_info_t *heatmap_info_get_create(uvm_va_block_t *va_block)
+{
+    block_heatmap_info_t *heatmap_info = heatmap_info_get(va_block);
+
+    if (!heatmap_info) {
+        heatmap_info = kmem_cache_zalloc(g_heatmap_info_cache, NV_UVM_GFP_FLAGS);
+        if (!heatmap_info)
+            return NULL;
+
+        uvm_perf_module_type_set_data(va_block->perf_modules_data, heatmap_info, UVM_PERF_MODULE_TYPE_HEATMAP);
+    }
+
+    return heatmap_info;
+}
+
+// Destroy the heatmap struct for the given block
+static void heatmap_info_destroy(uvm_va_block_t *va_block)
+{
+    block_heatmap_info_t *heatmap_info = heatmap_info_get(va_block);
+
+    if (heatmap_info) {
+        kmem_cache_free(g_heatmap_info_cache, heatmap_info);
+        uvm_perf_module_type_unset_data(va_block->perf_modules_data, UVM_PERF_MODULE_TYPE_HEATMAP);
+    }
+}
+
+// Splitting a block discards its counters, as they cannot be attributed to
+// either half
+void heatmap_block_destroy_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data)
+{
+    uvm_va_block_t *va_block;
+
+    UVM_ASSERT(g_uvm_perf_heatmap_enable);
+
+    UVM_ASSERT(event_id == UVM_PERF_EVENT_BLOCK_DESTROY ||
+               event_id == UVM_PERF_EVENT_BLOCK_SHRINK ||
+               event_id == UVM_PERF_EVENT_MODULE_UNLOAD);
+
+    if (event_id == UVM_PERF_EVENT_BLOCK_DESTROY)
+        va_block = event_data->block_destroy.block;
+    else if (event_id == UVM_PERF_EVENT_BLOCK_SHRINK)
+        va_block = event_data->block_shrink.block;
+    else
+        va_block = event_data->module_unload.block;
+
+    if (!va_block)
+        return;
+
+    heatmap_info_destroy(va_block);
+}
+
+void heatmap_fault_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data)
+{
+    UVM_ASSERT(g_uvm_perf_heatmap_enable);
+    UVM_ASSERT(event_id == UVM_PERF_EVENT_FAULT);
+
+    // Fatal faults may not have a block
+    if (!event_data->fault.block)
+        return;
+
+    uvm_perf_heatmap_record_fault(event_data->fault.block, event_data->fault.proc_id);
+}
+
+void heatmap_migration_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data)
+{
+    UVM_ASSERT(g_uvm_perf_heatmap_enable);
+    UVM_ASSERT(event_id == UVM_PERF_EVENT_MIGRATION);
+
+    uvm_perf_heatmap_record_migration(event_data->migration.block,
+                                      event_data->migration.src,
+                                      event_data->migration.dst,
+                                      event_data->migration.bytes / PAGE_SIZE);
+}
+
+void uvm_perf_heatmap_record_fault(uvm_va_block_t *va_block, uvm_processor_id_t proc_id)
+{
+    block_heatmap_info_t *heatmap_info;
+
+    if (!g_uvm_perf_heatmap_enable)
+        return;
+
+    uvm_assert_mutex_locked(&va_block->lock);
+
+    heatmap_info = heatmap_info_get_create(va_block);
+    if (heatmap_info)
+        UVM_PERF_SATURATING_INC(heatmap_info->faults[proc_id]);
+}
+
+void uvm_perf_heatmap_record_migration(uvm_va_block_t *va_block,
+                                       uvm_processor_id_t src,
+                                       uvm_processor_id_t dst,
+                                       NvU64 num_pages)
+{
+    block_heatmap_info_t *heatmap_info;
+
+    if (!g_uvm_perf_heatmap_enable)
+        return;
+
+    uvm_assert_mutex_locked(&va_block->lock);
+
+    heatmap_info = heatmap_info_get_create(va_block);
+    if (!heatmap_info)
+        return;
+
+    UVM_PERF_SATURATING_ADD(heatmap_info->pages_migrated_in[dst], num_pages);
+    UVM_PERF_SATURATING_ADD(heatmap_info->pages_migrated_out[src], num_pages);
+}
+
+void uvm_perf_heatmap_record_thrashing(uvm_va_block_t *va_block, NvU32 num_pages)
+{
+    block_heatmap_info_t *heatmap_info;
+
+    if (!g_uvm_perf_heatmap_enable)
+        return;
+
+    uvm_assert_mutex_locked(&va_block->lock);
+
+    heatmap_info = heatmap_info_get_create(va_block);
+    if (heatmap_info)
+        UVM_PERF_SATURATING_ADD(heatmap_info->thrashing_pages, num_pages);
+}
+
+void uvm_perf_heatmap_record_pinning(uvm_va_block_t *va_block, NvU32 num_pages)
+{
+    block_heatmap_info_t *heatmap_info;
+
+    if (!g_uvm_perf_heatmap_enable)
+        return;
+
+    uvm_assert_mutex_locked(&va_block->lock);
+
+    heatmap_info = heatmap_info_get_create(va_block);
+    if (heatmap_info)
+        UVM_PERF_SATURATING_ADD(heatmap_info->pinned_pages, num_pages);
+}
+
+void uvm_perf_heatmap_record_prefetch_hits(uvm_va_block_t *va_block, NvU32 num_pages)
+{
+    block_heatmap_info_t *heatmap_info;
+
+    if (!g_uvm_perf_heatmap_enable || num_pages == 0)
+        return;
+
+    uvm_assert_mutex_locked(&va_block->lock);
+
+    heatmap_info = heatmap_info_get_create(va_block);
+    if (heatmap_info)
+        UVM_PERF_SATURATING_ADD(heatmap_info->prefetch_hit_pages, num_pages);
+}
+
+static void heatmap_info_fill_entry(uvm_va_block_t *va_block,
+                                    block_heatmap_info_t *heatmap_info,
+                                    UVM_VA_BLOCK_HEATMAP_ENTRY *entry)
+{
+    BUILD_BUG_ON(UVM8_MAX_PROCESSORS != UVM_MAX_PROCESSORS);
+    BUILD_BUG_ON(sizeof(entry->faults) != sizeof(heatmap_info->faults));
+    BUILD_BUG_ON(sizeof(entry->pagesMigratedIn) != sizeof(heatmap_info->pages_migrated_in));
+    BUILD_BUG_ON(sizeof(entry->pagesMigratedOut) != sizeof(heatmap_info->pages_migrated_out));
+
+    entry->start = va_block->start;
+    entry->end   = va_block->end;
+
+    memcpy(entry->faults, heatmap_info->faults, sizeof(entry->faults));
+    memcpy(entry->pagesMigratedIn, heatmap_info->pages_migrated_in, sizeof(entry->pagesMigratedIn));
+    memcpy(entry->pagesMigratedOut, heatmap_info->pages_migrated_out, sizeof(entry->pagesMigratedOut));
+
+    entry->thrashingPages   = heatmap_info->thrashing_pages;
+    entry->pinnedPages      = heatmap_info->pinned_pages;
+    entry->prefetchHitPages = heatmap_info->prefetch_hit_pages;
+}
+
+NV_STATUS uvm_perf_heatmap_snapshot(uvm_va_space_t *va_space,
+                                    NvU64 base,
+                                    NvU64 length,
+                                    NvU32 flags,
+                                    UVM_VA_BLOCK_HEATMAP_ENTRY *entries,
+                                    NvU32 *num_entries,
+                                    NvU64 *next_address)
+{
+    uvm_va_range_t *va_range;
+    uvm_va_block_t *va_block;
+    NvU64 end = base + length - 1;
+    NvU32 count = 0;
+
+    uvm_assert_rwsem_locked(&va_space->lock);
+
+    if (!g_uvm_perf_heatmap_enable)
+        return NV_ERR_NOT_SUPPORTED;
+
+    *next_address = end + 1;
+
+    // Blocks are sampled one at a time under their own lock, so servicing of
+    // faults on the rest of the VA space is not stalled by the walk
+    uvm_for_each_va_range_in(va_range, va_space, base, end) {
+        if (va_range->type != UVM_VA_RANGE_TYPE_MANAGED)
+            continue;
+
+        for_each_va_block_in_va_range(va_range, va_block) {
+            block_heatmap_info_t *heatmap_info;
+
+            if (va_block->end < base)
+                continue;
+
+            if (va_block->start > end)
+                break;
+
+            uvm_mutex_lock(&va_block->lock);
+
+            heatmap_info = heatmap_info_get(va_block);
+            if (heatmap_info && count == *num_entries) {
+                uvm_mutex_unlock(&va_block->lock);
+                *next_address = va_block->start;
+                goto done;
+            }
+
+            if (heatmap_info) {
+                heatmap_info_fill_entry(va_block, heatmap_info, &entries[count++]);
+
+                // Drop the counters rather than zeroing them, so that the
+                // block is only reported again once new activity is recorded
+                if (flags & UVM_VA_BLOCK_HEATMAP_FLAG_RESET)
+                    heatmap_info_destroy(va_block);
+            }
+
+            uvm_mutex_unlock(&va_block->lock);
+        }
+    }
+
+done:
+    *num_entries = count;
+
+    return NV_OK;
+}
+
+NV_STATUS uvm_api_get_va_block_heatmap(UVM_GET_VA_BLOCK_HEATMAP_PARAMS *params, struct file *filp)
+{
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+    UVM_VA_BLOCK_HEATMAP_ENTRY *entries;
+    NvU32 count = params->numEntries;
+    NvU64 next_address;
+    NV_STATUS status;
+
+    if (uvm_api_range_invalid(params->base, params->length))
+        return NV_ERR_INVALID_ADDRESS;
+
+    if (params->numEntries == 0 || params->numEntries > UVM_VA_BLOCK_HEATMAP_MAX_ENTRIES)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    if (params->flags & ~UVM_VA_BLOCK_HEATMAP_FLAGS_ALL)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    if (!g_uvm_perf_heatmap_enable)
+        return NV_ERR_NOT_SUPPORTED;
+
+    // Entries are staged in kernel memory so that the copy to user space,
+    // which may fault, is done with no locks held
+    entries = uvm_kvmalloc(params->numEntries * sizeof(*entries));
+    if (!entries)
+        return NV_ERR_NO_MEMORY;
+
+    uvm_va_space_down_read(va_space);
+
+    status = uvm_perf_heatmap_snapshot(va_space,
+                                       params->base,
+                                       params->length,
+                                       params->flags,
+                                       entries,
+                                       &count,
+                                       &next_address);
+
+    uvm_va_space_up_read(va_space);
+
+    if (status == NV_OK) {
+        if (count > 0 && copy_to_user((void __user *)params->entries, entries, count * sizeof(*entries)))
+            status = NV_ERR_INVALID_ADDRESS;
+
+        params->numEntries  = count;
+        params->nextAddress = next_address;
+    }
+
+    uvm_kvfree(entries);
+
+    return status;
+}
+
+NV_STATUS uvm_perf_heatmap_load(uvm_va_space_t *va_space)
+{
+    if (!g_uvm_perf_heatmap_enable)
+        return NV_OK;
+
+    return uvm_perf_module_load(&g_module_heatmap, va_space);
+}
+
+void uvm_perf_heatmap_unload(uvm_va_space_t *va_space)
+{
+    if (!g_uvm_perf_heatmap_enable)
+        return;
+
+    uvm_perf_module_unload(&g_module_heatmap, va_space);
+}
+
+NV_STATUS uvm_perf_heatmap_init()
+{
+    g_uvm_perf_heatmap_enable = uvm_perf_heatmap_enable != 0;
+
+    if (!g_uvm_perf_heatmap_enable)
+        return NV_OK;
+
+    uvm_perf_module_init("perf_heatmap", UVM_PERF_MODULE_TYPE_HEATMAP, g_callbacks_heatmap,
+                         ARRAY_SIZE(g_callbacks_heatmap), &g_module_heatmap);
+
+    g_heatmap_info_cache = NV_KMEM_CACHE_CREATE("block_heatmap_info_t", block_heatmap_info_t);
+    if (!g_heatmap_info_cache)
+        return NV_ERR_NO_MEMORY;
+
+    return NV_OK;
+}
+
+void uvm_perf_heatmap_exit()
+{
+    if (!g_uvm_perf_heatmap_enable)
+        return;
+
+    kmem_cache_destroy_safe(&g_heatmap_info_cache);
+}
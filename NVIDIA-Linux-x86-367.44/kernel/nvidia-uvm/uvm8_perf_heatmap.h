@@ -0,0 +1,80 @@
+/*******************************************************************************
+    Copyright (c) 2016 NVIDIA Corporation
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to
+    deal in the Software without restriction, including without limitation the
+    rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+        The above copyright notice and this permission notice shall be
+        included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+#ifndef __UVM8_PERF_HEATMAP_H__
+#define __UVM8_PERF_HEATMAP_H__
+
+#include "uvm_linux.h"
+#include "uvm_ioctl.h"
+#include "uvm8_forward_decl.h"
+#include "uvm8_processors.h"
+
+// The heatmap module keeps per-VA block access and migration counters that
+// are exported to user space by UVM_GET_VA_BLOCK_HEATMAP. Counters are updated
+// from the perf events and from the thrashing and prefetch modules, always
+// with the block lock held.
+
+// Global initialization/cleanup functions
+NV_STATUS uvm_perf_heatmap_init(void);
+void uvm_perf_heatmap_exit(void);
+
+// VA space Initialization/cleanup functions
+NV_STATUS uvm_perf_heatmap_load(uvm_va_space_t *va_space);
+void uvm_perf_heatmap_unload(uvm_va_space_t *va_space);
+
+// Record a fault reported by the given processor on the block
+void uvm_perf_heatmap_record_fault(uvm_va_block_t *va_block, uvm_processor_id_t proc_id);
+
+// Record that num_pages pages of the block were migrated from src to dst
+void uvm_perf_heatmap_record_migration(uvm_va_block_t *va_block,
+                                       uvm_processor_id_t src,
+                                       uvm_processor_id_t dst,
+                                       NvU64 num_pages);
+
+// Record that num_pages pages of the block started thrashing
+void uvm_perf_heatmap_record_thrashing(uvm_va_block_t *va_block, NvU32 num_pages);
+
+// Record that num_pages pages of the block were pinned to prevent thrashing
+void uvm_perf_heatmap_record_pinning(uvm_va_block_t *va_block, NvU32 num_pages);
+
+// Record that num_pages prefetched pages of the block were accessed by the
+// processor they were prefetched to
+void uvm_perf_heatmap_record_prefetch_hits(uvm_va_block_t *va_block, NvU32 num_pages);
+
+// Fill entries with the counters of at most *num_entries blocks with recorded
+// activity in [base, base + length), in address order. On return *num_entries
+// is the number of entries filled and *next_address the address at which to
+// continue the walk, or base + length if all blocks have been reported. See
+// UVM_GET_VA_BLOCK_HEATMAP for the flags.
+//
+// LOCKING: the caller must hold the va_space lock in at least read mode. The
+//          block locks are taken internally.
+NV_STATUS uvm_perf_heatmap_snapshot(uvm_va_space_t *va_space,
+                                    NvU64 base,
+                                    NvU64 length,
+                                    NvU32 flags,
+                                    UVM_VA_BLOCK_HEATMAP_ENTRY *entries,
+                                    NvU32 *num_entries,
+                                    NvU64 *next_address);
+
+#endif
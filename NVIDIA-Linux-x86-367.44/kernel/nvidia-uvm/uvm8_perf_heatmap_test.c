@@ -0,0 +1,157 @@
+/*******************************************************************************
+    Copyright (c) 2016 NVIDIA Corporation
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to
+    deal in the Software without restriction, including without limitation the
+    rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+        The above copyright notice and this permission notice shall be
+        included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+#include "uvm8_perf_heatmap.h"
+#include "uvm8_va_block.h"
+#include "uvm8_va_space.h"
+#include "uvm8_kvmalloc.h"
+#include "uvm8_test.h"
+
+#define HEATMAP_TEST_MAX_BLOCKS 8
+
+// Discard the counters of all the blocks in [base, base + length), one block
+// per walk so that the pagination of resetting walks is exercised as well
+static NV_STATUS heatmap_test_reset(uvm_va_space_t *va_space,
+                                    NvU64 base,
+                                    NvU64 length,
+                                    UVM_VA_BLOCK_HEATMAP_ENTRY *entries)
+{
+    NvU64 end = base + length;
+    NvU64 address = base;
+
+    while (address < end) {
+        NvU64 next_address;
+        NvU32 count = 1;
+
+        MEM_NV_CHECK_RET(uvm_perf_heatmap_snapshot(va_space,
+                                                   address,
+                                                   end - address,
+                                                   UVM_VA_BLOCK_HEATMAP_FLAG_RESET,
+                                                   entries,
+                                                   &count,
+                                                   &next_address), NV_OK);
+        TEST_CHECK_RET(next_address > address);
+
+        address = next_address;
+    }
+
+    return NV_OK;
+}
+
+NV_STATUS uvm8_test_va_block_heatmap(UVM_TEST_VA_BLOCK_HEATMAP_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status;
+    uvm_va_space_t *va_space = uvm_va_space_get(filp);
+    UVM_VA_BLOCK_HEATMAP_ENTRY *entries;
+    NvU64 end = params->base + params->length - 1;
+    NvU64 num_blocks = params->length / UVM_VA_BLOCK_SIZE;
+    NvU64 next_address;
+    NvU64 address;
+    NvU32 count;
+    NvU32 i;
+
+    if (!IS_ALIGNED(params->base, UVM_VA_BLOCK_SIZE) || !IS_ALIGNED(params->length, UVM_VA_BLOCK_SIZE))
+        return NV_ERR_INVALID_ADDRESS;
+
+    if (num_blocks < 2 || num_blocks > HEATMAP_TEST_MAX_BLOCKS)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    entries = uvm_kvmalloc_zero(HEATMAP_TEST_MAX_BLOCKS * sizeof(*entries));
+    if (!entries)
+        return NV_ERR_NO_MEMORY;
+
+    uvm_va_space_down_read(va_space);
+
+    status = heatmap_test_reset(va_space, params->base, params->length, entries);
+    if (status != NV_OK)
+        goto done;
+
+    // Reset blocks are not reported until new activity is recorded
+    count = num_blocks;
+    TEST_NV_CHECK_GOTO(uvm_perf_heatmap_snapshot(va_space, params->base, params->length, 0, entries, &count,
+                                                 &next_address), done);
+    TEST_CHECK_GOTO(count == 0, done);
+    TEST_CHECK_GOTO(next_address == end + 1, done);
+
+    // Record i + 1 faults and a migration of 2 * (i + 1) pages on block i
+    for (i = 0; i < num_blocks; ++i) {
+        uvm_va_block_t *va_block;
+        NvU32 j;
+
+        status = uvm_va_block_find_create(va_space, params->base + i * UVM_VA_BLOCK_SIZE, &va_block);
+        if (status != NV_OK)
+            goto done;
+
+        uvm_mutex_lock(&va_block->lock);
+
+        for (j = 0; j <= i; ++j)
+            uvm_perf_heatmap_record_fault(va_block, UVM_CPU_ID);
+
+        uvm_perf_heatmap_record_migration(va_block, UVM_CPU_ID, UVM_CPU_ID, 2 * (i + 1));
+
+        uvm_mutex_unlock(&va_block->lock);
+    }
+
+    // Walk the blocks one entry at a time, following nextAddress
+    address = params->base;
+    for (i = 0; i < num_blocks; ++i) {
+        UVM_VA_BLOCK_HEATMAP_ENTRY *entry = &entries[0];
+
+        count = 1;
+        TEST_NV_CHECK_GOTO(uvm_perf_heatmap_snapshot(va_space, address, end - address + 1, 0, entries, &count,
+                                                     &next_address), done);
+        TEST_CHECK_GOTO(count == 1, done);
+        TEST_CHECK_GOTO(entry->start == params->base + i * UVM_VA_BLOCK_SIZE, done);
+        TEST_CHECK_GOTO(entry->end == entry->start + UVM_VA_BLOCK_SIZE - 1, done);
+        TEST_CHECK_GOTO(entry->faults[UVM_CPU_ID] == i + 1, done);
+        TEST_CHECK_GOTO(entry->pagesMigratedIn[UVM_CPU_ID] == 2 * (i + 1), done);
+        TEST_CHECK_GOTO(entry->pagesMigratedOut[UVM_CPU_ID] == 2 * (i + 1), done);
+
+        if (i + 1 < num_blocks)
+            TEST_CHECK_GOTO(next_address == entry->end + 1, done);
+        else
+            TEST_CHECK_GOTO(next_address == end + 1, done);
+
+        address = next_address;
+    }
+
+    // A resetting walk reports every block once, and none of them afterwards
+    count = num_blocks;
+    TEST_NV_CHECK_GOTO(uvm_perf_heatmap_snapshot(va_space, params->base, params->length,
+                                                 UVM_VA_BLOCK_HEATMAP_FLAG_RESET, entries, &count,
+                                                 &next_address), done);
+    TEST_CHECK_GOTO(count == num_blocks, done);
+    TEST_CHECK_GOTO(next_address == end + 1, done);
+
+    count = num_blocks;
+    TEST_NV_CHECK_GOTO(uvm_perf_heatmap_snapshot(va_space, params->base, params->length, 0, entries, &count,
+                                                 &next_address), done);
+    TEST_CHECK_GOTO(count == 0, done);
+
+done:
+    uvm_va_space_up_read(va_space);
+
+    uvm_kvfree(entries);
+
+    return status;
+}
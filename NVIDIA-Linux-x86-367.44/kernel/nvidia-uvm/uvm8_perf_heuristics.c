@@ -25,6 +25,7 @@
 #include "uvm8_perf_heuristics.h"
 #include "uvm8_perf_thrashing.h"
 #include "uvm8_perf_prefetch.h"
+#include "uvm8_perf_heatmap.h"
 
 NV_STATUS uvm_perf_heuristics_init()
 {
@@ -38,11 +39,16 @@ NV_STATUS uvm_perf_heuristics_init()
     if (status != NV_OK)
         return status;
 
+    status = uvm_perf_heatmap_init();
+    if (status != NV_OK)
+        return status;
+
     return NV_OK;
 }
 
 void uvm_perf_heuristics_exit()
 {
+    uvm_perf_heatmap_exit();
     uvm_perf_prefetch_exit();
     uvm_perf_thrashing_exit();
 }
@@ -55,6 +61,9 @@ NV_STATUS uvm_perf_heuristics_load(uvm_va_space_t *va_space)
     if (status != NV_OK)
         return status;
     status = uvm_perf_prefetch_load(va_space);
+    if (status != NV_OK)
+        return status;
+    status = uvm_perf_heatmap_load(va_space);
     if (status != NV_OK)
         return status;
 
@@ -63,6 +72,7 @@ NV_STATUS uvm_perf_heuristics_load(uvm_va_space_t *va_space)
 
 void uvm_perf_heuristics_unload(uvm_va_space_t *va_space)
 {
+    uvm_perf_heatmap_unload(va_space);
     uvm_perf_prefetch_unload(va_space);
     uvm_perf_thrashing_unload(va_space);
 }
@@ -40,6 +40,7 @@
 //
 // UVM_PERF_MODULE_TYPE_THRASHING: detects memory thrashing scenarios and provides thrashing prevention mechanisms
 // UVM_PERF_MODULE_TYPE_PREFETCH: detects memory prefetching opportunities
+// UVM_PERF_MODULE_TYPE_HEATMAP: keeps per-VA block access and migration counters
 typedef enum
 {
     UVM_PERF_MODULE_FIRST_TYPE     = 0,
@@ -47,6 +48,7 @@ typedef enum
     UVM_PERF_MODULE_TYPE_TEST      = UVM_PERF_MODULE_FIRST_TYPE,
     UVM_PERF_MODULE_TYPE_THRASHING,
     UVM_PERF_MODULE_TYPE_PREFETCH,
+    UVM_PERF_MODULE_TYPE_HEATMAP,
 
     UVM_PERF_MODULE_TYPE_COUNT,
 } uvm_perf_module_type_t;
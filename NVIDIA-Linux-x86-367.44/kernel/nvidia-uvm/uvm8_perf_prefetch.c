@@ -25,7 +25,12 @@
 #include "uvm8_perf_events.h"
 #include "uvm8_perf_module.h"
 #include "uvm8_perf_prefetch.h"
+#include "uvm8_perf_heatmap.h"
 #include "uvm8_kvmalloc.h"
+#include "uvm8_gpu.h"
+#include "uvm8_procfs.h"
+#include "uvm8_test.h"
+#include "uvm8_test_rng.h"
 #include "uvm8_va_block.h"
 #include "uvm8_va_range.h"
 
@@ -54,6 +59,23 @@ typedef struct
     NvU16 pending_prefetch_pages;
 
     NvU16 fault_migrations_to_last_proc;
+
+    // Pages prefetched to prefetched_proc_id whose usefulness has not been
+    // resolved yet. A page is considered useful once the processor is seen
+    // accessing it, that is, when the processor faults on the page, and
+    // wasted if it migrates away before that. Accesses that don't fault are
+    // not observed, so pages may stay unresolved until they migrate away.
+    DECLARE_BITMAP(prefetched_pages, PAGES_PER_UVM_VA_BLOCK);
+
+    uvm_processor_id_t prefetched_proc_id;
+
+    // Resolved prefetched pages since the last threshold update
+    NvU16 window_useful_pages;
+
+    NvU16 window_wasted_pages;
+
+    // Prefetch threshold of the block. See uvm_perf_prefetch_threshold
+    NvU8 threshold;
 } block_prefetch_info_t;
 
 //
@@ -63,7 +85,6 @@ typedef struct
 // Enable/disable prefetch performance heuristics
 static unsigned uvm_perf_prefetch_enable = 1;
 
-// TODO: Bug 1778037: [uvm8] Use adaptive threshold for page prefetching
 #define UVM_PREFETCH_THRESHOLD_DEFAULT 51
 
 // Percentage of children subregions that need to be resident in order to
@@ -80,17 +101,54 @@ static unsigned uvm_perf_prefetch_threshold  = UVM_PREFETCH_THRESHOLD_DEFAULT;
 // logic
 static unsigned uvm_perf_prefetch_min_faults = UVM_PREFETCH_MIN_FAULTS_DEFAULT;
 
+// Adapt the threshold of each VA block, starting from
+// uvm_perf_prefetch_threshold, depending on the fraction of the pages
+// prefetched to the block that end up being useful. Prefetched pages are
+// mapped on the processor, so most accesses to them don't fault and are not
+// observed. Disabled by default until a better access signal is available.
+static unsigned uvm_perf_prefetch_adaptive = 0;
+
+// Bounds and step of the adaptive threshold
+#define UVM_PREFETCH_ADAPTIVE_THRESHOLD_MIN  10
+#define UVM_PREFETCH_ADAPTIVE_THRESHOLD_MAX  90
+#define UVM_PREFETCH_ADAPTIVE_THRESHOLD_STEP 10
+
+// Number of resolved prefetched pages needed to update the threshold
+#define UVM_PREFETCH_ADAPTIVE_WINDOW 32
+
+// The threshold is raised (less prefetching) if less than ACCURACY_LOW% of
+// the resolved prefetched pages were useful, and lowered (more prefetching) if
+// at least ACCURACY_HIGH% were useful
+#define UVM_PREFETCH_ADAPTIVE_ACCURACY_LOW  50
+#define UVM_PREFETCH_ADAPTIVE_ACCURACY_HIGH 90
+
+#define UVM_PREFETCH_CPU_FAULT_AROUND_BYTES_DEFAULT (64 * 1024)
+
+// Size of the naturally-aligned window around a faulting CPU address that is
+// migrated to and mapped on the CPU with the faulting page. Only pages already
+// resident on other processors are brought in. Values up to PAGE_SIZE disable
+// fault-around.
+//
+// Valid values: powers of two up to UVM_VA_BLOCK_SIZE
+static unsigned uvm_perf_prefetch_cpu_fault_around_bytes = UVM_PREFETCH_CPU_FAULT_AROUND_BYTES_DEFAULT;
+
 // Module parameters for the tunables
 module_param(uvm_perf_prefetch_enable, uint, S_IRUGO);
 module_param(uvm_perf_prefetch_threshold, uint, S_IRUGO);
 module_param(uvm_perf_prefetch_min_faults, uint, S_IRUGO);
+module_param(uvm_perf_prefetch_adaptive, uint, S_IRUGO);
+module_param(uvm_perf_prefetch_cpu_fault_around_bytes, uint, S_IRUGO);
 
 unsigned g_uvm_perf_prefetch_enable;
 unsigned g_uvm_perf_prefetch_threshold;
 unsigned g_uvm_perf_prefetch_min_faults;
+unsigned g_uvm_perf_prefetch_adaptive;
+unsigned g_uvm_perf_prefetch_cpu_fault_around_bytes;
 
 // Callback declaration for the performance heuristics events
 static void prefetch_block_destroy_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data);
+static void prefetch_migration_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data);
+static void prefetch_fault_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data);
 
 static uvm_va_block_region_t compute_prefetch_region(size_t page_index, block_prefetch_info_t *prefetch_info)
 {
@@ -104,7 +162,7 @@ static uvm_va_block_region_t compute_prefetch_region(size_t page_index, block_pr
         uvm_va_block_region_t subregion = uvm_va_block_bitmap_tree_iter_get_range(bitmap_tree, &iter);
         NvU16 subregion_pages = uvm_va_block_region_num_pages(subregion);
 
-        if (counter < subregion_pages && counter * 100 > subregion_pages * g_uvm_perf_prefetch_threshold)
+        if (counter < subregion_pages && counter * 100 > subregion_pages * prefetch_info->threshold)
             prefetch_region = subregion;
     }
 
@@ -120,13 +178,105 @@ static uvm_va_block_region_t compute_prefetch_region(size_t page_index, block_pr
     return prefetch_region;
 }
 
+// Compute the pages to prefetch for the pages in migrate_pages within region,
+// using the state of the bitmap tree. The resulting mask is in tree page
+// index space, that is, shifted by first_page.
+static void compute_prefetch_mask(block_prefetch_info_t *prefetch_info, uvm_va_block_region_t region)
+{
+    size_t page_index;
+
+    uvm_page_mask_zero(prefetch_info->prefetch_pages);
+    for_each_va_block_page_in_mask(page_index, prefetch_info->migrate_pages, region) {
+        uvm_va_block_region_t prefetch_region = compute_prefetch_region(page_index + prefetch_info->first_page,
+                                                                        prefetch_info);
+        uvm_page_mask_region_fill(prefetch_info->prefetch_pages, prefetch_region);
+
+        // Early out if we have already prefetched until the end of the VA block
+        if (prefetch_region.outer == prefetch_info->outer_page)
+            break;
+    }
+
+    // Do not prefetch pages that are going to be migrated due to a fault or are already resident in
+    // the destination processor
+    uvm_page_mask_andnot(prefetch_info->prefetch_pages,
+                         prefetch_info->prefetch_pages,
+                         prefetch_info->bitmap_tree.pages);
+}
+
+// Update the threshold of the block once enough prefetched pages have been
+// resolved as useful or wasted
+static void prefetch_threshold_update(block_prefetch_info_t *prefetch_info)
+{
+    NvU32 resolved = prefetch_info->window_useful_pages + prefetch_info->window_wasted_pages;
+    NvU32 accuracy;
+
+    if (resolved < UVM_PREFETCH_ADAPTIVE_WINDOW)
+        return;
+
+    accuracy = prefetch_info->window_useful_pages * 100 / resolved;
+
+    if (accuracy < UVM_PREFETCH_ADAPTIVE_ACCURACY_LOW) {
+        prefetch_info->threshold = min(prefetch_info->threshold + UVM_PREFETCH_ADAPTIVE_THRESHOLD_STEP,
+                                       UVM_PREFETCH_ADAPTIVE_THRESHOLD_MAX);
+    }
+    else if (accuracy >= UVM_PREFETCH_ADAPTIVE_ACCURACY_HIGH) {
+        prefetch_info->threshold = max(prefetch_info->threshold - UVM_PREFETCH_ADAPTIVE_THRESHOLD_STEP,
+                                       UVM_PREFETCH_ADAPTIVE_THRESHOLD_MIN);
+    }
+
+    prefetch_info->window_useful_pages = 0;
+    prefetch_info->window_wasted_pages = 0;
+}
+
+// Record that the pages in region have been prefetched to the given processor.
+// Unresolved prefetched pages to a different processor are dropped.
+static void prefetch_record_prefetched_pages(block_prefetch_info_t *prefetch_info,
+                                             uvm_processor_id_t proc_id,
+                                             uvm_va_block_region_t region)
+{
+    if (prefetch_info->prefetched_proc_id != proc_id) {
+        uvm_page_mask_zero(prefetch_info->prefetched_pages);
+        prefetch_info->prefetched_proc_id = proc_id;
+    }
+
+    uvm_page_mask_region_fill(prefetch_info->prefetched_pages, region);
+}
+
+// The processor the pages were prefetched to accessed the given page. If the
+// page is an unresolved prefetched page, it is considered useful. Returns
+// whether the page was useful.
+static bool prefetch_resolve_accessed_page(block_prefetch_info_t *prefetch_info, size_t page_index)
+{
+    if (!__test_and_clear_bit(page_index, prefetch_info->prefetched_pages))
+        return false;
+
+    ++prefetch_info->window_useful_pages;
+
+    return true;
+}
+
+// The pages in region left the processor they were prefetched to. Unresolved
+// prefetched pages in the region are considered wasted. Returns the number of
+// wasted pages.
+static NvU32 prefetch_resolve_wasted_pages(block_prefetch_info_t *prefetch_info, uvm_va_block_region_t region)
+{
+    NvU32 wasted = uvm_page_mask_region_weight(prefetch_info->prefetched_pages, region);
+
+    uvm_page_mask_region_clear(prefetch_info->prefetched_pages, region);
+    prefetch_info->window_wasted_pages += wasted;
+
+    return wasted;
+}
+
 // Performance heuristics module for prefetch
 static uvm_perf_module_t g_module_prefetch;
 
 static uvm_perf_module_event_callback_desc_t g_callbacks_prefetch[] = {
     { UVM_PERF_EVENT_BLOCK_DESTROY, prefetch_block_destroy_cb },
     { UVM_PERF_EVENT_MODULE_UNLOAD, prefetch_block_destroy_cb },
-    { UVM_PERF_EVENT_BLOCK_SHRINK,  prefetch_block_destroy_cb }
+    { UVM_PERF_EVENT_BLOCK_SHRINK,  prefetch_block_destroy_cb },
+    { UVM_PERF_EVENT_MIGRATION,     prefetch_migration_cb     },
+    { UVM_PERF_EVENT_FAULT,         prefetch_fault_cb         }
 };
 
 // Get the prefetch detection struct for the given block
@@ -173,6 +323,9 @@ static block_prefetch_info_t *prefetch_info_get_create(uvm_va_block_t *va_block)
 
         uvm_va_block_bitmap_tree_init_from_page_count(&prefetch_info->bitmap_tree, num_leaves);
 
+        prefetch_info->prefetched_proc_id = UVM8_MAX_PROCESSORS;
+        prefetch_info->threshold = g_uvm_perf_prefetch_threshold;
+
         uvm_perf_module_type_set_data(va_block->perf_modules_data, prefetch_info, UVM_PERF_MODULE_TYPE_PREFETCH);
     }
 
@@ -246,10 +399,11 @@ void uvm_perf_prefetch_prenotify_fault_migrations(uvm_va_block_t *va_block,
                                                   const long unsigned *faulted_pages,
                                                   uvm_va_block_region_t region)
 {
-    size_t page_index;
     block_prefetch_info_t *prefetch_info;
     const long unsigned *resident_mask = NULL;
     const long unsigned *thrashing_pages;
+    uvm_gpu_t *gpu = NULL;
+    NvU32 faulted_pages_count;
 
     if (!g_uvm_perf_prefetch_enable)
         return;
@@ -273,9 +427,16 @@ void uvm_perf_prefetch_prenotify_fault_migrations(uvm_va_block_t *va_block,
 
     prefetch_info->pending_prefetch_pages = 0;
 
+    faulted_pages_count = uvm_page_mask_region_weight(faulted_pages, region);
+
+    if (new_residency != UVM_CPU_ID)
+        gpu = uvm_gpu_get(new_residency);
+
+    if (gpu && uvm_procfs_is_debug_enabled())
+        atomic64_add(faulted_pages_count, &gpu->fault_buffer_info.replayable.stats.num_prefetch_pages_missed);
+
     // Get the big page size for the new residency
-    if (new_residency != UVM_CPU_ID) {
-        uvm_gpu_t *gpu = uvm_gpu_get(new_residency);
+    if (gpu) {
         prefetch_info->big_page_size = uvm_va_block_gpu_big_page_size(va_block, gpu);
     }
     else {
@@ -304,22 +465,7 @@ void uvm_perf_prefetch_prenotify_fault_migrations(uvm_va_block_t *va_block,
     initialize_migration_mask(va_block, prefetch_info, faulted_pages, thrashing_pages);
 
     // Update the tree using the migration mask to compute the pages to prefetch
-    uvm_page_mask_zero(prefetch_info->prefetch_pages);
-    for_each_va_block_page_in_mask(page_index, prefetch_info->migrate_pages, region) {
-        uvm_va_block_region_t prefetch_region = compute_prefetch_region(page_index + prefetch_info->first_page,
-                                                                        prefetch_info);
-        uvm_page_mask_region_fill(prefetch_info->prefetch_pages, prefetch_region);
-
-        // Early out if we have already prefetched until the end of the VA block
-        if (prefetch_region.outer == prefetch_info->outer_page)
-            break;
-    }
-
-    // Do not prefetch pages that are going to be migrated due to a fault or are already resident in
-    // the destination processor
-    uvm_page_mask_andnot(prefetch_info->prefetch_pages,
-                         prefetch_info->prefetch_pages,
-                         prefetch_info->bitmap_tree.pages);
+    compute_prefetch_mask(prefetch_info, region);
 
     // Adjust prefetching page mask
     if (prefetch_info->first_page > 0) {
@@ -336,7 +482,7 @@ void uvm_perf_prefetch_prenotify_fault_migrations(uvm_va_block_t *va_block,
                              thrashing_pages);
     }
 
-    prefetch_info->fault_migrations_to_last_proc += uvm_page_mask_region_weight(faulted_pages, region);
+    prefetch_info->fault_migrations_to_last_proc += faulted_pages_count;
     prefetch_info->pending_prefetch_pages = uvm_page_mask_weight(prefetch_info->prefetch_pages);
 }
 
@@ -384,6 +530,30 @@ uvm_perf_prefetch_hint_t uvm_perf_prefetch_get_hint(uvm_va_block_t *va_block)
     return ret;
 }
 
+uvm_va_block_region_t uvm_perf_prefetch_cpu_fault_around_region(uvm_va_block_t *va_block, NvU64 fault_addr)
+{
+    uvm_va_space_t *va_space = va_block->va_range->va_space;
+    uvm_va_block_region_t fault_region = uvm_va_block_region_from_start_size(va_block, fault_addr, PAGE_SIZE);
+    NvU64 start;
+    NvU64 end;
+
+    if (!g_uvm_perf_prefetch_enable || g_uvm_perf_prefetch_cpu_fault_around_bytes <= PAGE_SIZE)
+        return fault_region;
+
+    if (!va_space->test_page_prefetch_enabled)
+        return fault_region;
+
+    start = max(UVM_ALIGN_DOWN(fault_addr, g_uvm_perf_prefetch_cpu_fault_around_bytes), va_block->start);
+    end = min(start + g_uvm_perf_prefetch_cpu_fault_around_bytes - 1, va_block->end);
+
+    // Pages in non-migratable range groups cannot be prefetched. Do not bother
+    // carving them out of the window, just fall back to the faulting page.
+    if (!uvm_range_group_all_migratable(va_space, start, end))
+        return fault_region;
+
+    return uvm_va_block_region_from_start_end(va_block, start, end);
+}
+
 void prefetch_block_destroy_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data)
 {
     uvm_va_block_t *va_block;
@@ -407,6 +577,94 @@ void prefetch_block_destroy_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t
     prefetch_info_destroy(va_block);
 }
 
+void prefetch_migration_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data)
+{
+    uvm_va_block_t *va_block = event_data->migration.block;
+    block_prefetch_info_t *prefetch_info;
+    uvm_va_block_region_t region;
+    NvU32 wasted_pages;
+
+    UVM_ASSERT(g_uvm_perf_prefetch_enable);
+    UVM_ASSERT(event_id == UVM_PERF_EVENT_MIGRATION);
+
+    prefetch_info = prefetch_info_get(va_block);
+    if (!prefetch_info)
+        return;
+
+    region = uvm_va_block_region_from_start_end(va_block,
+                                                event_data->migration.address,
+                                                event_data->migration.address + event_data->migration.bytes - 1);
+
+    if (event_data->migration.cause == UvmEventMigrationCausePrefetch) {
+        prefetch_record_prefetched_pages(prefetch_info, event_data->migration.dst, region);
+        return;
+    }
+
+    // Copies leave the pages resident on the source processor
+    if (event_data->migration.src != prefetch_info->prefetched_proc_id ||
+        event_data->migration.transfer_mode != UVM_VA_BLOCK_TRANSFER_MODE_MOVE)
+        return;
+
+    wasted_pages = prefetch_resolve_wasted_pages(prefetch_info, region);
+    if (wasted_pages == 0)
+        return;
+
+    if (g_uvm_perf_prefetch_adaptive)
+        prefetch_threshold_update(prefetch_info);
+
+    if (event_data->migration.src != UVM_CPU_ID && uvm_procfs_is_debug_enabled()) {
+        uvm_gpu_t *gpu = uvm_gpu_get(event_data->migration.src);
+
+        atomic64_add(wasted_pages, &gpu->fault_buffer_info.replayable.stats.num_prefetch_pages_wasted);
+    }
+}
+
+void prefetch_fault_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_data)
+{
+    uvm_va_block_t *va_block = event_data->fault.block;
+    uvm_processor_id_t proc_id = event_data->fault.proc_id;
+    block_prefetch_info_t *prefetch_info;
+    NvU64 address;
+
+    UVM_ASSERT(g_uvm_perf_prefetch_enable);
+    UVM_ASSERT(event_id == UVM_PERF_EVENT_FAULT);
+
+    // Fatal faults may not have a block
+    if (!va_block)
+        return;
+
+    prefetch_info = prefetch_info_get(va_block);
+    if (!prefetch_info || prefetch_info->prefetched_proc_id != proc_id)
+        return;
+
+    if (proc_id == UVM_CPU_ID) {
+        address = event_data->fault.cpu.fault_va;
+    }
+    else {
+        uvm_fault_buffer_entry_t *buffer_entry = event_data->fault.gpu.buffer_entry;
+
+        // Faults from the GPU prefetcher are not accesses
+        if (buffer_entry->fault_access_type == UVM_FAULT_ACCESS_TYPE_PREFETCH)
+            return;
+
+        address = buffer_entry->fault_address;
+    }
+
+    if (!prefetch_resolve_accessed_page(prefetch_info, uvm_va_block_cpu_page_index(va_block, address)))
+        return;
+
+    uvm_perf_heatmap_record_prefetch_hits(va_block, 1);
+
+    if (g_uvm_perf_prefetch_adaptive)
+        prefetch_threshold_update(prefetch_info);
+
+    if (proc_id != UVM_CPU_ID && uvm_procfs_is_debug_enabled()) {
+        uvm_gpu_t *gpu = uvm_gpu_get(proc_id);
+
+        atomic64_inc(&gpu->fault_buffer_info.replayable.stats.num_prefetch_pages_useful);
+    }
+}
+
 NV_STATUS uvm_perf_prefetch_load(uvm_va_space_t *va_space)
 {
     if (!g_uvm_perf_prefetch_enable)
@@ -458,6 +716,19 @@ NV_STATUS uvm_perf_prefetch_init()
         g_uvm_perf_prefetch_min_faults = UVM_PREFETCH_MIN_FAULTS_DEFAULT;
     }
 
+    g_uvm_perf_prefetch_adaptive = uvm_perf_prefetch_adaptive != 0;
+
+    if (uvm_perf_prefetch_cpu_fault_around_bytes <= UVM_VA_BLOCK_SIZE &&
+        (uvm_perf_prefetch_cpu_fault_around_bytes & (uvm_perf_prefetch_cpu_fault_around_bytes - 1)) == 0) {
+        g_uvm_perf_prefetch_cpu_fault_around_bytes = uvm_perf_prefetch_cpu_fault_around_bytes;
+    }
+    else {
+        pr_info("Invalid value %u for uvm_perf_prefetch_cpu_fault_around_bytes. Using %u instead\n",
+                uvm_perf_prefetch_cpu_fault_around_bytes, UVM_PREFETCH_CPU_FAULT_AROUND_BYTES_DEFAULT);
+
+        g_uvm_perf_prefetch_cpu_fault_around_bytes = UVM_PREFETCH_CPU_FAULT_AROUND_BYTES_DEFAULT;
+    }
+
     return NV_OK;
 }
 
@@ -487,3 +758,194 @@ NV_STATUS uvm8_test_set_page_prefetch_policy(UVM_TEST_SET_PAGE_PREFETCH_POLICY_P
 
     return NV_OK;
 }
+
+#define PREFETCH_REPLAY_MAX_RECORDS (1024 * 1024)
+
+// State of a single VA block replayed by uvm8_test_prefetch_replay. Pages are
+// resident on a single simulated processor, represented by UVM_CPU_ID.
+typedef struct
+{
+    block_prefetch_info_t prefetch_info;
+
+    DECLARE_BITMAP(resident_pages, PAGES_PER_UVM_VA_BLOCK);
+
+    // Prefetched pages that have not been accessed or evicted yet
+    DECLARE_BITMAP(untouched_pages, PAGES_PER_UVM_VA_BLOCK);
+} prefetch_replay_t;
+
+static void prefetch_replay_generate_trace(uvm_test_rng_t *rng,
+                                           UVM_TEST_PREFETCH_REPLAY_PARAMS *params,
+                                           UvmTestPrefetchReplayRecord *records)
+{
+    NvU32 i;
+    NvU16 stream_page = 0;
+
+    for (i = 0; i < params->num_records; ++i) {
+        NvU32 r = uvm_test_rng_range_32(rng, 0, 99);
+
+        records[i].padding = 0;
+
+        if (r < params->evict_percent) {
+            records[i].type = UVM_TEST_PREFETCH_REPLAY_EVICT;
+            records[i].page_index = uvm_test_rng_range_32(rng, 0, PAGES_PER_UVM_VA_BLOCK - 1);
+        }
+        else if (r < params->evict_percent + params->sparse_percent) {
+            records[i].type = UVM_TEST_PREFETCH_REPLAY_ACCESS;
+            records[i].page_index = uvm_test_rng_range_32(rng, 0, PAGES_PER_UVM_VA_BLOCK - 1);
+        }
+        else {
+            records[i].type = UVM_TEST_PREFETCH_REPLAY_ACCESS;
+            records[i].page_index = stream_page;
+            stream_page = (stream_page + 1) % PAGES_PER_UVM_VA_BLOCK;
+        }
+    }
+}
+
+static NV_STATUS prefetch_replay_run(prefetch_replay_t *replay,
+                                     NvU32 policy,
+                                     const UvmTestPrefetchReplayRecord *records,
+                                     UVM_TEST_PREFETCH_REPLAY_PARAMS *params)
+{
+    block_prefetch_info_t *prefetch_info = &replay->prefetch_info;
+    uvm_va_block_region_t block_region = uvm_va_block_region(0, PAGES_PER_UVM_VA_BLOCK);
+    NvU32 faults = 0;
+    NvU32 prefetched_pages = 0;
+    NvU32 useful_pages = 0;
+    NvU32 evicted_untouched_pages = 0;
+    NvU32 i;
+
+    memset(replay, 0, sizeof(*replay));
+    uvm_va_block_bitmap_tree_init_from_page_count(&prefetch_info->bitmap_tree, PAGES_PER_UVM_VA_BLOCK);
+    prefetch_info->last_migration_proc_id = UVM_CPU_ID;
+    prefetch_info->prefetched_proc_id = UVM8_MAX_PROCESSORS;
+    prefetch_info->outer_page = PAGES_PER_UVM_VA_BLOCK;
+    prefetch_info->threshold = params->threshold;
+
+    for (i = 0; i < params->num_records; ++i) {
+        size_t page_index = records[i].page_index;
+        size_t prefetch_page_index;
+
+        if (records[i].type == UVM_TEST_PREFETCH_REPLAY_EVICT) {
+            __clear_bit(page_index, replay->resident_pages);
+            if (__test_and_clear_bit(page_index, replay->untouched_pages))
+                ++evicted_untouched_pages;
+
+            prefetch_resolve_wasted_pages(prefetch_info, uvm_va_block_region(page_index, page_index + 1));
+            if (policy == UVM_TEST_PREFETCH_REPLAY_POLICY_ADAPTIVE)
+                prefetch_threshold_update(prefetch_info);
+
+            continue;
+        }
+
+        if (test_bit(page_index, replay->resident_pages)) {
+            if (__test_and_clear_bit(page_index, replay->untouched_pages))
+                ++useful_pages;
+
+            // Feed the access like prefetch_fault_cb does
+            if (prefetch_info->prefetched_proc_id == UVM_CPU_ID &&
+                prefetch_resolve_accessed_page(prefetch_info, page_index) &&
+                policy == UVM_TEST_PREFETCH_REPLAY_POLICY_ADAPTIVE)
+                prefetch_threshold_update(prefetch_info);
+
+            continue;
+        }
+
+        // Fault on a non-resident page. Compute the prefetch like
+        // uvm_perf_prefetch_prenotify_fault_migrations does
+        ++faults;
+
+        uvm_page_mask_zero(prefetch_info->migrate_pages);
+        __set_bit(page_index, prefetch_info->migrate_pages);
+        uvm_page_mask_or(prefetch_info->bitmap_tree.pages, replay->resident_pages, prefetch_info->migrate_pages);
+
+        compute_prefetch_mask(prefetch_info, block_region);
+
+        __set_bit(page_index, replay->resident_pages);
+
+        if (prefetch_info->fault_migrations_to_last_proc < g_uvm_perf_prefetch_min_faults)
+            ++prefetch_info->fault_migrations_to_last_proc;
+
+        if (prefetch_info->fault_migrations_to_last_proc < g_uvm_perf_prefetch_min_faults)
+            continue;
+
+        uvm_page_mask_or(replay->resident_pages, replay->resident_pages, prefetch_info->prefetch_pages);
+        uvm_page_mask_or(replay->untouched_pages, replay->untouched_pages, prefetch_info->prefetch_pages);
+        prefetched_pages += uvm_page_mask_weight(prefetch_info->prefetch_pages);
+
+        for_each_va_block_page_in_mask(prefetch_page_index, prefetch_info->prefetch_pages, block_region) {
+            prefetch_record_prefetched_pages(prefetch_info,
+                                             UVM_CPU_ID,
+                                             uvm_va_block_region(prefetch_page_index, prefetch_page_index + 1));
+        }
+    }
+
+    TEST_CHECK_RET(useful_pages + evicted_untouched_pages + uvm_page_mask_weight(replay->untouched_pages) ==
+                   prefetched_pages);
+
+    params->faults[policy] = faults;
+    params->prefetched_pages[policy] = prefetched_pages;
+    params->useful_pages[policy] = useful_pages;
+    params->wasted_pages[policy] = prefetched_pages - useful_pages;
+    params->final_threshold[policy] = prefetch_info->threshold;
+
+    return NV_OK;
+}
+
+NV_STATUS uvm8_test_prefetch_replay(UVM_TEST_PREFETCH_REPLAY_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status = NV_OK;
+    uvm_test_rng_t rng;
+    prefetch_replay_t *replay = NULL;
+    UvmTestPrefetchReplayRecord *records = NULL;
+    NvU32 policy;
+    NvU32 i;
+
+    if (params->num_records == 0 || params->num_records > PREFETCH_REPLAY_MAX_RECORDS ||
+        params->threshold > 100 || params->sparse_percent + params->evict_percent > 100)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    if (params->threshold == 0)
+        params->threshold = g_uvm_perf_prefetch_threshold;
+
+    replay = uvm_kvmalloc(sizeof(*replay));
+    records = uvm_kvmalloc(params->num_records * sizeof(*records));
+    if (!replay || !records) {
+        status = NV_ERR_NO_MEMORY;
+        goto done;
+    }
+
+    if (params->records) {
+        if (copy_from_user(records, (void __user *)params->records, params->num_records * sizeof(*records))) {
+            status = NV_ERR_INVALID_ADDRESS;
+            goto done;
+        }
+
+        for (i = 0; i < params->num_records; ++i) {
+            if (records[i].page_index >= PAGES_PER_UVM_VA_BLOCK ||
+                (records[i].type != UVM_TEST_PREFETCH_REPLAY_ACCESS &&
+                 records[i].type != UVM_TEST_PREFETCH_REPLAY_EVICT)) {
+                status = NV_ERR_INVALID_ARGUMENT;
+                goto done;
+            }
+        }
+    }
+    else {
+        uvm_test_rng_init(&rng, params->seed);
+        prefetch_replay_generate_trace(&rng, params, records);
+    }
+
+    for (policy = 0; policy < UVM_TEST_PREFETCH_REPLAY_MAX_POLICIES; ++policy) {
+        TEST_NV_CHECK_GOTO(prefetch_replay_run(replay, policy, records, params), done);
+
+        if (fatal_signal_pending(current)) {
+            status = NV_ERR_SIGNAL_PENDING;
+            goto done;
+        }
+    }
+
+done:
+    uvm_kvfree(replay);
+    uvm_kvfree(records);
+
+    return status;
+}
@@ -53,6 +53,11 @@ void uvm_perf_prefetch_prenotify_fault_migrations(uvm_va_block_t *va_block,
                                                   const long unsigned *migrate_pages,
                                                   uvm_va_block_region_t region);
 
+// Obtain the region of the block around the given faulting CPU address whose
+// pages may be serviced by the same CPU fault. The region only contains the
+// faulting page if CPU fault-around is disabled.
+uvm_va_block_region_t uvm_perf_prefetch_cpu_fault_around_region(uvm_va_block_t *va_block, NvU64 fault_addr);
+
 #define UVM_PERF_PREFETCH_HINT_NONE()                       \
     (uvm_perf_prefetch_hint_t){ NULL, UVM8_MAX_PROCESSORS }
 
@@ -24,6 +24,7 @@
 #include "uvm8_perf_events.h"
 #include "uvm8_perf_module.h"
 #include "uvm8_perf_thrashing.h"
+#include "uvm8_perf_heatmap.h"
 #include "uvm8_perf_utils.h"
 #include "uvm8_va_block.h"
 #include "uvm8_va_range.h"
@@ -352,6 +353,7 @@ void thrashing_event_cb(uvm_perf_event_t event_id, uvm_perf_event_data_t *event_
             if (page_thrashing->num_thrashing_events == g_uvm_perf_thrashing_threshold) {
                 // Thrashing detected, record the event
                 uvm_tools_record_thrashing(va_block, address, bytes, &page_thrashing->processors);
+                uvm_perf_heatmap_record_thrashing(va_block, 1);
                 __set_bit(page_index, block_thrashing->thrashing_pages);
                 ++block_thrashing->num_thrashing_pages;
             }
@@ -434,6 +436,7 @@ get_hint_for_migration_thrashing(uvm_va_block_t *va_block,
     if (hint.type == UVM_PERF_THRASHING_HINT_TYPE_PIN) {
         uvm_processor_mask_copy(&hint.pin.processors, &page_thrashing->processors);
         ++block_thrashing->pin_count;
+        uvm_perf_heatmap_record_pinning(va_block, 1);
 
         page_thrashing->pinned = true;
     }
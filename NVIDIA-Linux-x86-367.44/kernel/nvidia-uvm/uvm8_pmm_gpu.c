@@ -100,7 +100,12 @@
 // All allocated user memory root chunks are tracked in an LRU list
 // (va_block_used_root_chunks). A root chunk is moved to the tail of that list
 // whenever any of its subchunks is allocated (unpinned) by a VA block (see
-// uvm_pmm_gpu_unpin_temp()). When a root chunk is selected for eviction, it has
+// uvm_pmm_gpu_unpin_temp()). Depending on the eviction policy (see
+// uvm_perf_pmm_eviction_policy), accesses to the root chunk reported by the VA
+// block code when mapping pages or servicing faults either move it to the tail
+// (LRU) or mark it referenced so that it gets a second chance when picked
+// (CLOCK), see uvm_pmm_gpu_mark_root_chunk_accessed(). When a root chunk
+// is selected for eviction, it has
 // the eviction flag set (see pick_root_chunk_to_evict()). This flag affects
 // many of the PMM operations on all of the subchunks of the root chunk being
 // evicted. See usage of (root_)chunk_is_in_eviction(), in particular in
@@ -176,6 +181,12 @@ static int uvm_global_oversubscription = 1;
 module_param(uvm_global_oversubscription, int, S_IRUGO);
 MODULE_PARM_DESC(uvm_global_oversubscription, "Enable (1) or disable (0) global oversubscription support.");
 
+#define UVM_PERF_PMM_EVICTION_POLICY_DEFAULT UVM_PMM_GPU_EVICTION_POLICY_LRU
+
+static unsigned uvm_perf_pmm_eviction_policy = UVM_PERF_PMM_EVICTION_POLICY_DEFAULT;
+module_param(uvm_perf_pmm_eviction_policy, uint, S_IRUGO);
+MODULE_PARM_DESC(uvm_perf_pmm_eviction_policy, "Order in which user memory is evicted: FIFO (0), LRU (1) or CLOCK (2).");
+
 // Helper type for refcounting cache
 typedef struct
 {
@@ -248,6 +259,18 @@ const char *uvm_pmm_gpu_chunk_state_string(uvm_pmm_gpu_chunk_state_t state)
     }
 }
 
+const char *uvm_pmm_gpu_eviction_policy_string(uvm_pmm_gpu_eviction_policy_t policy)
+{
+    BUILD_BUG_ON(UVM_PMM_GPU_EVICTION_POLICY_COUNT != 3);
+
+    switch (policy) {
+        UVM_ENUM_STRING_CASE(UVM_PMM_GPU_EVICTION_POLICY_FIFO);
+        UVM_ENUM_STRING_CASE(UVM_PMM_GPU_EVICTION_POLICY_LRU);
+        UVM_ENUM_STRING_CASE(UVM_PMM_GPU_EVICTION_POLICY_CLOCK);
+        UVM_ENUM_STRING_DEFAULT();
+    }
+}
+
 // The PMA APIs that can be called from PMA eviction callbacks (pmaPinPages and
 // pmaFreePages*) need to be called differently depending whether it's as part
 // of PMA eviction or not. The PMM context is used to plumb that information
@@ -356,6 +379,15 @@ NV_STATUS uvm_pmm_gpu_init(uvm_gpu_t *gpu, uvm_pmm_gpu_t *pmm)
     INIT_LIST_HEAD(&pmm->va_block_used_root_chunks);
     INIT_LIST_HEAD(&pmm->va_block_unused_root_chunks);
 
+    if (uvm_perf_pmm_eviction_policy < UVM_PMM_GPU_EVICTION_POLICY_COUNT) {
+        pmm->eviction_policy = uvm_perf_pmm_eviction_policy;
+    }
+    else {
+        pmm->eviction_policy = UVM_PERF_PMM_EVICTION_POLICY_DEFAULT;
+        pr_info("Invalid uvm_perf_pmm_eviction_policy value on GPU %s: %u. Using %d instead\n",
+                gpu->name, uvm_perf_pmm_eviction_policy, pmm->eviction_policy);
+    }
+
     uvm_mutex_init(&pmm->lock, UVM_LOCK_ORDER_PMM);
     uvm_init_rwsem(&pmm->pma_lock, UVM_LOCK_ORDER_PMM_PMA);
     uvm_spin_lock_init(&pmm->list_lock, UVM_LOCK_ORDER_LEAF);
@@ -1424,6 +1456,7 @@ static void chunk_start_eviction(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
     UVM_ASSERT(!list_empty(&chunk->list));
 
     list_del_init(&chunk->list);
+    __clear_bit(UVM_GPU_CHUNK_FLAGS_REFERENCED, &chunk->flags);
     uvm_gpu_chunk_set_in_eviction(chunk, true);
 }
 
@@ -1457,6 +1490,62 @@ void uvm_pmm_gpu_mark_root_chunk_unused(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chu
     root_chunk_update_eviction_list(pmm, chunk, &pmm->va_block_unused_root_chunks);
 }
 
+void uvm_pmm_gpu_mark_root_chunk_accessed(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk)
+{
+    uvm_gpu_root_chunk_t *root_chunk;
+
+    UVM_ASSERT(uvm_gpu_chunk_get_type(chunk) == UVM_PMM_GPU_MEMORY_TYPE_USER);
+
+    // Accesses don't affect the eviction order in FIFO mode, avoid taking the
+    // lock
+    if (pmm->eviction_policy == UVM_PMM_GPU_EVICTION_POLICY_FIFO)
+        return;
+
+    root_chunk = root_chunk_from_chunk(pmm, chunk);
+
+    uvm_spin_lock(&pmm->list_lock);
+
+    // Root chunks that are pinned or selected for eviction are not on any of
+    // the eviction lists. In LRU mode, moving to the tail of the used list
+    // also takes a root chunk off the unused list, since it can't be accessed
+    // without resident pages.
+    if (!chunk_is_root_chunk_pinned(pmm, chunk) && !chunk_is_in_eviction(pmm, chunk)) {
+        uvm_pmm_gpu_eviction_list_touch(pmm->eviction_policy, &pmm->va_block_used_root_chunks, &root_chunk->chunk);
+    }
+
+    uvm_spin_unlock(&pmm->list_lock);
+}
+
+void uvm_pmm_gpu_eviction_list_touch(uvm_pmm_gpu_eviction_policy_t policy,
+                                     struct list_head *list,
+                                     uvm_gpu_chunk_t *chunk)
+{
+    UVM_ASSERT(!list_empty(&chunk->list));
+
+    if (policy == UVM_PMM_GPU_EVICTION_POLICY_LRU)
+        list_move_tail(&chunk->list, list);
+    else if (policy == UVM_PMM_GPU_EVICTION_POLICY_CLOCK)
+        __set_bit(UVM_GPU_CHUNK_FLAGS_REFERENCED, &chunk->flags);
+}
+
+uvm_gpu_chunk_t *uvm_pmm_gpu_eviction_list_pick(uvm_pmm_gpu_eviction_policy_t policy, struct list_head *list)
+{
+    uvm_gpu_chunk_t *chunk = list_first_chunk(list);
+
+    if (policy != UVM_PMM_GPU_EVICTION_POLICY_CLOCK)
+        return chunk;
+
+    // Give referenced chunks a second chance. The flag is cleared when moving
+    // them to the tail, so this terminates after visiting every chunk at most
+    // once.
+    while (chunk && __test_and_clear_bit(UVM_GPU_CHUNK_FLAGS_REFERENCED, &chunk->flags)) {
+        list_move_tail(&chunk->list, list);
+        chunk = list_first_chunk(list);
+    }
+
+    return chunk;
+}
+
 static uvm_gpu_root_chunk_t *pick_root_chunk_to_evict(uvm_pmm_gpu_t *pmm)
 {
     uvm_gpu_chunk_t *chunk;
@@ -1465,10 +1554,8 @@ static uvm_gpu_root_chunk_t *pick_root_chunk_to_evict(uvm_pmm_gpu_t *pmm)
 
     chunk = list_first_chunk(&pmm->va_block_unused_root_chunks);
 
-    // TODO: Bug 1765193: Move the chunks to the tail of the used list whenever
-    // they get mapped.
     if (!chunk)
-        chunk = list_first_chunk(&pmm->va_block_used_root_chunks);
+        chunk = uvm_pmm_gpu_eviction_list_pick(pmm->eviction_policy, &pmm->va_block_used_root_chunks);
 
     if (chunk)
         chunk_start_eviction(pmm, chunk);
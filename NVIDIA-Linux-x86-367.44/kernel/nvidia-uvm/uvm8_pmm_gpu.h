@@ -131,6 +131,31 @@ typedef enum
 
 const char *uvm_pmm_gpu_chunk_state_string(uvm_pmm_gpu_chunk_state_t state);
 
+// Order in which root chunks used by VA blocks are picked for eviction
+typedef enum
+{
+    // Evict root chunks in the order in which they were last allocated to or
+    // became resident in a VA block
+    UVM_PMM_GPU_EVICTION_POLICY_FIFO,
+
+    // Like UVM_PMM_GPU_EVICTION_POLICY_FIFO, but root chunks are also moved to
+    // the tail of the eviction list whenever they are accessed (see
+    // uvm_pmm_gpu_mark_root_chunk_accessed())
+    UVM_PMM_GPU_EVICTION_POLICY_LRU,
+
+    // Second chance FIFO, the list-based equivalent of CLOCK. Accesses don't
+    // reorder the eviction list, they only set the referenced flag of the root
+    // chunk. When picking a root chunk for eviction, chunks at the head with
+    // the flag set have it cleared and are moved to the tail instead of being
+    // evicted.
+    UVM_PMM_GPU_EVICTION_POLICY_CLOCK,
+
+    // Number of policies - MUST BE LAST
+    UVM_PMM_GPU_EVICTION_POLICY_COUNT
+} uvm_pmm_gpu_eviction_policy_t;
+
+const char *uvm_pmm_gpu_eviction_policy_string(uvm_pmm_gpu_eviction_policy_t policy);
+
 typedef enum
 {
     // No flags passed
@@ -163,8 +188,9 @@ typedef struct uvm_pmm_gpu_chunk_suballoc_struct uvm_pmm_gpu_chunk_suballoc_t;
 #define UVM_GPU_CHUNK_FLAGS_TYPE_KERNEL         0
 #define UVM_GPU_CHUNK_FLAGS_IN_EVICTION         1
 #define UVM_GPU_CHUNK_FLAGS_INJECT_SPLIT_ERROR  2
+#define UVM_GPU_CHUNK_FLAGS_REFERENCED          3
 
-#define UVM_GPU_CHUNK_FLAGS_STATE_START     (UVM_GPU_CHUNK_FLAGS_INJECT_SPLIT_ERROR + 1)
+#define UVM_GPU_CHUNK_FLAGS_STATE_START     (UVM_GPU_CHUNK_FLAGS_REFERENCED + 1)
 #define UVM_GPU_CHUNK_FLAGS_STATE_SIZE      order_base_2(UVM_PMM_GPU_CHUNK_STATE_COUNT)
 
 #define UVM_GPU_CHUNK_FLAGS_SIZE_LOG2_START (UVM_GPU_CHUNK_FLAGS_STATE_START + UVM_GPU_CHUNK_FLAGS_STATE_SIZE)
@@ -255,9 +281,14 @@ typedef struct
     // Updated by the VA block code with uvm_pmm_gpu_mark_root_chunk_(un)used().
     struct list_head va_block_unused_root_chunks;
 
-    // List of root chunks used by VA blocks
+    // List of root chunks used by VA blocks, ordered according to
+    // eviction_policy
     struct list_head va_block_used_root_chunks;
 
+    // Policy used to pick root chunks for eviction from
+    // va_block_used_root_chunks
+    uvm_pmm_gpu_eviction_policy_t eviction_policy;
+
     // Inject an error after evicting a number of chunks. 0 means no error left
     // to be injected.
     NvU32 inject_pma_evict_error_after_num_chunks;
@@ -470,6 +501,32 @@ void uvm_pmm_gpu_mark_root_chunk_used(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk
 // Mark an allocated user chunk as unused
 void uvm_pmm_gpu_mark_root_chunk_unused(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk);
 
+// Record an access to the root chunk of an allocated user chunk, i.e. the
+// chunk got mapped or faults were serviced on it. What this does depends on the
+// eviction policy:
+//  - FIFO: nothing
+//  - LRU: the root chunk is moved to the tail of the used list, which makes it
+//    the last candidate for eviction
+//  - CLOCK: only the referenced flag of the root chunk is set, its position in
+//    the list is unchanged until uvm_pmm_gpu_eviction_list_pick() visits it
+//
+// If the root chunk is pinned or selected for eviction, this won't do
+// anything.
+void uvm_pmm_gpu_mark_root_chunk_accessed(uvm_pmm_gpu_t *pmm, uvm_gpu_chunk_t *chunk);
+
+// Eviction list primitives implementing the eviction policies. They are only
+// exposed for testing, the caller must provide the required synchronization.
+//
+// Record an access to the given chunk, which must be on a list. In LRU mode the
+// chunk is moved to the tail of list, in CLOCK mode its referenced flag is set.
+void uvm_pmm_gpu_eviction_list_touch(uvm_pmm_gpu_eviction_policy_t policy,
+                                     struct list_head *list,
+                                     uvm_gpu_chunk_t *chunk);
+
+// Return the next chunk to be evicted from list, without removing it, or NULL
+// if the list is empty. The list may be reordered.
+uvm_gpu_chunk_t *uvm_pmm_gpu_eviction_list_pick(uvm_pmm_gpu_eviction_policy_t policy, struct list_head *list);
+
 static bool uvm_gpu_chunk_same_root(uvm_gpu_chunk_t *chunk_1, uvm_gpu_chunk_t *chunk_2)
 {
     return UVM_ALIGN_DOWN(chunk_1->address, UVM_CHUNK_SIZE_MAX) == UVM_ALIGN_DOWN(chunk_2->address, UVM_CHUNK_SIZE_MAX);
@@ -891,3 +891,173 @@ out:
 
     return status == NV_OK ? tracker_status : status;
 }
+
+#define EVICTION_SIM_MAX_CHUNKS         (1 << 20)
+#define EVICTION_SIM_MAX_ACCESSES       (1 << 22)
+#define EVICTION_SIM_MAX_REUSE_DISTANCE (1 << 14)
+
+#define EVICTION_SIM_NOT_RESIDENT ((NvU32)-1)
+
+// Generate a trace of chunk ids with the requested reuse distance distribution.
+// The reuse distance of an access is its position in a stack of the most
+// recently accessed chunks. Returns the number of accesses with a reuse
+// distance smaller than num_chunks, which is the number of hits of an LRU
+// policy.
+static NvU32 eviction_sim_generate_trace(uvm_test_rng_t *rng,
+                                         UVM_TEST_PMM_EVICTION_SIMULATE_PARAMS *params,
+                                         NvU32 *stack,
+                                         NvU32 *trace)
+{
+    NvU32 i;
+    NvU32 stack_size = 0;
+    NvU32 next_id = 0;
+    NvU32 lru_hits = 0;
+
+    for (i = 0; i < params->num_accesses; ++i) {
+        NvU32 id;
+        NvU32 distance;
+
+        if (stack_size > 0 && uvm_test_rng_range_32(rng, 0, 99) < params->reuse_percent) {
+            distance = uvm_test_rng_range_32(rng, 0, min(stack_size, params->max_reuse_distance) - 1);
+            id = stack[distance];
+
+            if (distance < params->num_chunks)
+                ++lru_hits;
+        }
+        else {
+            // Chunks that fall off the stack are never accessed again
+            id = next_id++;
+            if (stack_size < params->max_reuse_distance)
+                ++stack_size;
+            distance = stack_size - 1;
+        }
+
+        // Move the chunk to the top of the stack
+        memmove(stack + 1, stack, distance * sizeof(*stack));
+        stack[0] = id;
+
+        trace[i] = id;
+    }
+
+    return lru_hits;
+}
+
+static NV_STATUS eviction_sim_run(uvm_pmm_gpu_eviction_policy_t policy,
+                                  UVM_TEST_PMM_EVICTION_SIMULATE_PARAMS *params,
+                                  const NvU32 *trace,
+                                  uvm_gpu_chunk_t *chunks,
+                                  NvU32 *chunk_ids,
+                                  NvU32 *resident_chunks)
+{
+    NvU32 i;
+    NvU32 num_used = 0;
+    LIST_HEAD(eviction_list);
+
+    params->hits[policy] = 0;
+    params->misses[policy] = 0;
+
+    for (i = 0; i < params->num_accesses; ++i)
+        resident_chunks[i] = EVICTION_SIM_NOT_RESIDENT;
+
+    for (i = 0; i < params->num_chunks; ++i) {
+        memset(&chunks[i], 0, sizeof(chunks[i]));
+        INIT_LIST_HEAD(&chunks[i].list);
+    }
+
+    for (i = 0; i < params->num_accesses; ++i) {
+        NvU32 id = trace[i];
+        NvU32 index = resident_chunks[id];
+
+        if (index != EVICTION_SIM_NOT_RESIDENT) {
+            ++params->hits[policy];
+        }
+        else {
+            ++params->misses[policy];
+
+            if (num_used < params->num_chunks) {
+                index = num_used++;
+            }
+            else {
+                uvm_gpu_chunk_t *victim = uvm_pmm_gpu_eviction_list_pick(policy, &eviction_list);
+
+                TEST_CHECK_RET(victim);
+
+                index = victim - chunks;
+                resident_chunks[chunk_ids[index]] = EVICTION_SIM_NOT_RESIDENT;
+
+                list_del_init(&victim->list);
+                victim->flags = 0;
+            }
+
+            // Newly populated chunks go to the tail, like when they are
+            // unpinned by the VA block
+            resident_chunks[id] = index;
+            chunk_ids[index] = id;
+            list_add_tail(&chunks[index].list, &eviction_list);
+        }
+
+        // Every access maps the chunk
+        uvm_pmm_gpu_eviction_list_touch(policy, &eviction_list, &chunks[index]);
+    }
+
+    return NV_OK;
+}
+
+NV_STATUS uvm8_test_pmm_eviction_simulate(UVM_TEST_PMM_EVICTION_SIMULATE_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status = NV_OK;
+    uvm_test_rng_t rng;
+    uvm_gpu_chunk_t *chunks = NULL;
+    NvU32 *chunk_ids = NULL;
+    NvU32 *resident_chunks = NULL;
+    NvU32 *stack = NULL;
+    NvU32 *trace = NULL;
+    NvU32 lru_hits;
+    NvU32 policy;
+
+    BUILD_BUG_ON(UVM_PMM_GPU_EVICTION_POLICY_COUNT > UVM_TEST_PMM_MAX_EVICTION_POLICIES);
+
+    if (params->num_chunks == 0 || params->num_chunks > EVICTION_SIM_MAX_CHUNKS ||
+        params->num_accesses == 0 || params->num_accesses > EVICTION_SIM_MAX_ACCESSES ||
+        params->max_reuse_distance == 0 || params->max_reuse_distance > EVICTION_SIM_MAX_REUSE_DISTANCE ||
+        params->reuse_percent > 100)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    chunks = uvm_kvmalloc(params->num_chunks * sizeof(*chunks));
+    chunk_ids = uvm_kvmalloc(params->num_chunks * sizeof(*chunk_ids));
+    resident_chunks = uvm_kvmalloc(params->num_accesses * sizeof(*resident_chunks));
+    stack = uvm_kvmalloc(params->max_reuse_distance * sizeof(*stack));
+    trace = uvm_kvmalloc(params->num_accesses * sizeof(*trace));
+    if (!chunks || !chunk_ids || !resident_chunks || !stack || !trace) {
+        status = NV_ERR_NO_MEMORY;
+        goto done;
+    }
+
+    uvm_test_rng_init(&rng, params->seed);
+    lru_hits = eviction_sim_generate_trace(&rng, params, stack, trace);
+
+    for (policy = 0; policy < UVM_PMM_GPU_EVICTION_POLICY_COUNT; ++policy) {
+        TEST_NV_CHECK_GOTO(eviction_sim_run(policy, params, trace, chunks, chunk_ids, resident_chunks), done);
+        TEST_CHECK_GOTO(params->hits[policy] + params->misses[policy] == params->num_accesses, done);
+
+        if (fatal_signal_pending(current)) {
+            status = NV_ERR_SIGNAL_PENDING;
+            goto done;
+        }
+    }
+
+    // LRU hits exactly the accesses with a reuse distance smaller than the
+    // number of chunks
+    TEST_CHECK_GOTO(params->hits[UVM_PMM_GPU_EVICTION_POLICY_LRU] == lru_hits, done);
+
+    params->num_policies = UVM_PMM_GPU_EVICTION_POLICY_COUNT;
+
+done:
+    uvm_kvfree(chunks);
+    uvm_kvfree(chunk_ids);
+    uvm_kvfree(resident_chunks);
+    uvm_kvfree(stack);
+    uvm_kvfree(trace);
+
+    return status;
+}
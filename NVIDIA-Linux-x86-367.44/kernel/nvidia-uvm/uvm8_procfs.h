@@ -37,6 +37,8 @@ bool uvm_procfs_is_enabled(void);
 // Is debug procfs enabled? This indicates that debug procfs files should be created.
 bool uvm_procfs_is_debug_enabled(void);
 
+struct proc_dir_entry *uvm_procfs_get_driver_dir(void);
+
 struct proc_dir_entry *uvm_procfs_get_gpu_base_dir(void);
 
 void uvm_procfs_destroy_entry(struct proc_dir_entry *entry);
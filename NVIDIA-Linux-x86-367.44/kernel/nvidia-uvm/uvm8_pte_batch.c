@@ -35,6 +35,7 @@ void uvm_pte_batch_begin(uvm_push_t *push, uvm_pte_batch_t *batch)
 
     batch->membar = UVM_MEMBAR_GPU;
     batch->push = push;
+    batch->max_memset_ptes = min(uvm_push_get_gpu(push)->pte_batch.max_memset_ptes, (NvU32)UVM_PTE_BATCH_MAX_PTES);
 }
 
 static void uvm_pte_batch_flush_ptes_inline(uvm_pte_batch_t *batch)
@@ -182,7 +183,7 @@ void uvm_pte_batch_write_pte(uvm_pte_batch_t *batch, uvm_gpu_phys_address_t pte,
         batch->pte_entry_size = pte_size;
     }
 
-    if (!batch->inlining && batch->pte_count == UVM_PTE_BATCH_MAX_PTES)
+    if (!batch->inlining && batch->pte_count == batch->max_memset_ptes)
         pte_batch_begin_inline(batch);
 
     uvm_pte_batch_write_consecutive(batch, pte_bits);
@@ -29,19 +29,23 @@
 #include "uvm8_mmu.h"
 #include "uvm8_push.h"
 
-// Max PTEs to queue up for memsets before switching to inline memcopy.
-// Currently inline memcopy has to read the data from sysmem (that's where the
-// pushbuffer is) adding some latency so it's not obvious that it's better than
-// a memset that can just write the PTE bits to local vidmem. On the other hand,
-// launching a CE memset operation per each PTE also adds latency and takes a
-// lot of pushbuffer space.
+// Max PTEs that can be queued up for memsets before switching to inline
+// memcopy.
 //
-// TODO: Bug 1767241: Benchmark the two approaches to see whether the current
-//       number makes sense.
-//
-// TODO: Bug 1767241: If pushbuffer is ever moved to vidmem the tradeoffs can
-//       change as inline memcopy would have lower latency.
-#define UVM_PTE_BATCH_MAX_PTES 4
+// The number of consecutive PTEs actually written with memsets is picked per
+// GPU (gpu->pte_batch.max_memset_ptes). With the pushbuffer in sysmem, inline
+// memcopy has to read the data from sysmem adding some latency so it's not
+// obvious that it's better than a memset that can just write the PTE bits to
+// local vidmem. On the other hand, launching a CE memset operation per each PTE
+// also adds latency and takes a lot of pushbuffer space. With the pushbuffer in
+// vidmem inline memcopy has lower latency and is preferred earlier. Instead of
+// guessing, the cost of both is measured when the GPU is registered (see
+// uvm_mmu_calibrate_pte_batch()), unless the uvm_pte_batch_memset_ptes module
+// parameter overrides it.
+#define UVM_PTE_BATCH_MAX_PTES 16
+
+// Number of consecutive PTEs to write with memsets until the GPU is calibrated
+#define UVM_PTE_BATCH_MEMSET_PTES_DEFAULT 4
 
 struct uvm_pte_batch_struct
 {
@@ -55,6 +59,10 @@ struct uvm_pte_batch_struct
     NvU64 pte_bits_queue[UVM_PTE_BATCH_MAX_PTES];
     NvU32 pte_count;
 
+    // Number of consecutive PTEs to write with memsets before switching to
+    // inline memcopy. Initialized from the GPU in uvm_pte_batch_begin().
+    NvU32 max_memset_ptes;
+
     // A membar to be applied after all the PTE writes.
     // Starts out as UVM_MEMBAR_GPU and is promoted to UVM_MEMBAR_SYS if any of
     // the written PTEs are in sysmem.
@@ -68,15 +68,46 @@ NV_STATUS __uvm_push_begin_on_channel(uvm_channel_t *channel, uvm_push_t *push)
     return push_begin_on_channel_common(channel, push);
 }
 
+// Pick a channel from the tracker's dependencies that could be used for a
+// push of the given type, so that acquiring the tracker is free. The latest
+// entry is preferred as it's most likely to still be pending. VA blocks
+// acquire their tracker for every push, so this keeps each block's work on a
+// single channel while the block is busy.
+static uvm_channel_t *push_pick_preferred_channel(uvm_channel_manager_t *manager,
+                                                  uvm_channel_type_t channel_type,
+                                                  uvm_tracker_t *tracker)
+{
+    uvm_tracker_entry_t *entry;
+    uvm_channel_t *preferred_channel = NULL;
+
+    if (!tracker)
+        return NULL;
+
+    for_each_tracker_entry(entry, tracker) {
+        uvm_channel_t *channel = entry->channel;
+
+        if (!channel || channel->pool->manager != manager)
+            continue;
+
+        if (channel_type != UVM_CHANNEL_TYPE_ANY && channel->pool->channel_type != channel_type)
+            continue;
+
+        preferred_channel = channel;
+    }
+
+    return preferred_channel;
+}
+
 NV_STATUS __uvm_push_begin_acquire(uvm_channel_manager_t *manager, uvm_channel_type_t channel_type, uvm_tracker_t *tracker, uvm_push_t *push)
 {
     NV_STATUS status;
     uvm_channel_t *channel;
 
     // Pick a channel and reserve a GPFIFO entry
-    // TODO: Bug 1764953: use the dependencies in the tracker to pick a channel
-    //       in a smarter way.
-    status = uvm_channel_reserve_type(manager, channel_type, &channel);
+    status = uvm_channel_reserve_type_preferred(manager,
+                                                channel_type,
+                                                push_pick_preferred_channel(manager, channel_type, tracker),
+                                                &channel);
 
     if (status != NV_OK)
         return status;
@@ -250,7 +250,7 @@ static NvU32 test_count_idle_chunks(uvm_pushbuffer_t *pushbuffer)
 {
     NvU32 i;
     NvU32 count = 0;
-    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i)
+    for (i = 0; i < pushbuffer->num_chunks; ++i)
         count += test_bit(i, pushbuffer->idle_chunks) ? 1 : 0;
     return count;
 }
@@ -259,13 +259,31 @@ static NvU32 test_count_available_chunks(uvm_pushbuffer_t *pushbuffer)
 {
     NvU32 i;
     NvU32 count = 0;
-    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i)
+    for (i = 0; i < pushbuffer->num_chunks; ++i)
         count += test_bit(i, pushbuffer->available_chunks) ? 1 : 0;
     return count;
 }
 
-// Reuse the whole pushbuffer 4 times, one UVM_MAX_PUSH_SIZE at a time
-#define EXTRA_MAX_PUSHES_WHILE_FULL (4 * UVM_PUSHBUFFER_SIZE / UVM_MAX_PUSH_SIZE)
+// Grow the pushbuffer to its max size so that the number of chunks cannot
+// change in the middle of a test.
+static NV_STATUS test_grow_pushbuffer_to_max(uvm_pushbuffer_t *pushbuffer)
+{
+    NV_STATUS status;
+
+    do {
+        // Wait for any grow scheduled in the background to finish
+        if (pushbuffer->grow_q_initialized)
+            nv_kthread_q_flush(&pushbuffer->grow_q);
+
+        status = uvm_pushbuffer_grow(pushbuffer);
+    } while (status == NV_OK || status == NV_ERR_BUSY_RETRY);
+
+    TEST_CHECK_RET(status == NV_ERR_NO_MORE_ENTRIES);
+    TEST_CHECK_RET(pushbuffer->num_chunks == pushbuffer->max_chunks);
+    TEST_CHECK_RET(uvm_pushbuffer_get_size(pushbuffer) == pushbuffer->max_chunks * UVM_PUSHBUFFER_CHUNK_SIZE);
+
+    return NV_OK;
+}
 
 // Test doing pushes of exactly UVM_MAX_PUSH_SIZE size and only allowing them to
 // complete one by one.
@@ -275,12 +293,17 @@ static NV_STATUS test_max_pushes_on_gpu(uvm_gpu_t *gpu)
 
     uvm_tracker_t tracker;
     uvm_gpu_semaphore_t sema;
+    uvm_pushbuffer_t *pushbuffer = gpu->channel_manager->pushbuffer;
     NvU32 total_push_size = 0;
     NvU32 push_count = 0;
+    NvU32 extra_max_pushes_while_full;
     NvU32 i;
 
     uvm_tracker_init(&tracker);
 
+    // Reuse the whole pushbuffer 4 times, one UVM_MAX_PUSH_SIZE at a time
+    extra_max_pushes_while_full = 4 * uvm_pushbuffer_get_size(pushbuffer) / UVM_MAX_PUSH_SIZE;
+
     status = uvm_gpu_semaphore_alloc(gpu->semaphore_pool, &sema);
     TEST_CHECK_GOTO(status == NV_OK, done);
 
@@ -303,7 +326,7 @@ static NV_STATUS test_max_pushes_on_gpu(uvm_gpu_t *gpu)
         uvm_tracker_add_push(&tracker, &push);
     }
 
-    if (total_push_size != UVM_PUSHBUFFER_SIZE) {
+    if (total_push_size != uvm_pushbuffer_get_size(pushbuffer)) {
         UVM_TEST_PRINT("Unexpected space in the pushbuffer, total push %u\n", total_push_size);
         uvm_pushbuffer_print(gpu->channel_manager->pushbuffer);
         status = NV_ERR_INVALID_STATE;
@@ -313,7 +336,7 @@ static NV_STATUS test_max_pushes_on_gpu(uvm_gpu_t *gpu)
     TEST_CHECK_GOTO(test_count_available_chunks(gpu->channel_manager->pushbuffer) == 0, done);
     TEST_CHECK_GOTO(test_count_idle_chunks(gpu->channel_manager->pushbuffer) == 0, done);
 
-    for (i = 0; i < EXTRA_MAX_PUSHES_WHILE_FULL; ++i) {
+    for (i = 0; i < extra_max_pushes_while_full; ++i) {
         uvm_push_t push;
 
         // There should be no space for another push until the sema is
@@ -348,14 +371,16 @@ done:
 }
 
 
-// Test doing UVM_PUSHBUFFER_CHUNKS independent pushes expecting each one to use
-// a different chunk in the pushbuffer.
+// Test doing as many independent pushes as there are chunks expecting each one
+// to use a different chunk in the pushbuffer.
 static NV_STATUS test_idle_chunks_on_gpu(uvm_gpu_t *gpu)
 {
     NV_STATUS status;
 
     uvm_gpu_semaphore_t sema;
     uvm_tracker_t tracker = UVM_TRACKER_INIT();
+    uvm_pushbuffer_t *pushbuffer = gpu->channel_manager->pushbuffer;
+    NvU32 num_chunks = pushbuffer->num_chunks;
     NvU32 i;
 
     uvm_tracker_init(&tracker);
@@ -370,7 +395,7 @@ static NV_STATUS test_idle_chunks_on_gpu(uvm_gpu_t *gpu)
     status = uvm_channel_manager_wait(gpu->channel_manager);
     TEST_CHECK_GOTO(status == NV_OK, done);
 
-    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i) {
+    for (i = 0; i < num_chunks; ++i) {
         uvm_push_t push;
         status = uvm_push_begin(gpu->channel_manager, UVM_CHANNEL_TYPE_ANY, &push, "Push using chunk %u", i);
         TEST_CHECK_GOTO(status == NV_OK, done);
@@ -380,20 +405,20 @@ static NV_STATUS test_idle_chunks_on_gpu(uvm_gpu_t *gpu)
 
         uvm_tracker_add_push(&tracker, &push);
 
-        if (test_count_idle_chunks(gpu->channel_manager->pushbuffer) != UVM_PUSHBUFFER_CHUNKS - i - 1) {
+        if (test_count_idle_chunks(gpu->channel_manager->pushbuffer) != num_chunks - i - 1) {
             UVM_TEST_PRINT("Unexpected count of idle chunks in the pushbuffer %u instead of %u\n",
-                    test_count_idle_chunks(gpu->channel_manager->pushbuffer), UVM_PUSHBUFFER_CHUNKS - i - 1);
+                    test_count_idle_chunks(gpu->channel_manager->pushbuffer), num_chunks - i - 1);
             uvm_pushbuffer_print(gpu->channel_manager->pushbuffer);
             status = NV_ERR_INVALID_STATE;
             goto done;
         }
     }
-    uvm_gpu_semaphore_set_payload(&sema, UVM_PUSHBUFFER_CHUNKS + 1);
+    uvm_gpu_semaphore_set_payload(&sema, num_chunks + 1);
 
     status = uvm_channel_manager_wait(gpu->channel_manager);
     TEST_CHECK_GOTO(status == NV_OK, done);
 
-    if (test_count_idle_chunks(gpu->channel_manager->pushbuffer) != UVM_PUSHBUFFER_CHUNKS) {
+    if (test_count_idle_chunks(gpu->channel_manager->pushbuffer) != num_chunks) {
         UVM_TEST_PRINT("Unexpected count of idle chunks in the pushbuffer %u\n", test_count_idle_chunks(gpu->channel_manager->pushbuffer));
         uvm_pushbuffer_print(gpu->channel_manager->pushbuffer);
         status = NV_ERR_INVALID_STATE;
@@ -401,7 +426,7 @@ static NV_STATUS test_idle_chunks_on_gpu(uvm_gpu_t *gpu)
     }
 
 done:
-    uvm_gpu_semaphore_set_payload(&sema, UVM_PUSHBUFFER_CHUNKS + 1);
+    uvm_gpu_semaphore_set_payload(&sema, num_chunks + 1);
     uvm_tracker_wait(&tracker);
 
     uvm_gpu_semaphore_free(&sema);
@@ -415,6 +440,9 @@ static NV_STATUS test_pushbuffer(void)
     uvm_gpu_t *gpu;
 
     for_each_global_gpu(gpu) {
+        // Exercise all the chunks the pushbuffer can have
+        TEST_CHECK_RET(test_grow_pushbuffer_to_max(gpu->channel_manager->pushbuffer) == NV_OK);
+
         TEST_CHECK_RET(test_max_pushes_on_gpu(gpu) == NV_OK);
         TEST_CHECK_RET(test_idle_chunks_on_gpu(gpu) == NV_OK);
     }
@@ -31,6 +31,12 @@
 #include "uvm_common.h"
 #include "uvm_linux.h"
 
+// When set, the pushbuffer is allocated in vidmem and written by the CPU through
+// a write-combined mapping, lowering the latency of the GPU fetching the
+// methods. Falls back to sysmem if the vidmem allocation or mapping fails.
+static unsigned uvm_pushbuffer_vidmem = 0;
+module_param(uvm_pushbuffer_vidmem, uint, S_IRUGO);
+
 // Print pushbuffer state into a seq_file if provided or with UVM_DBG_PRINT() if not.
 static void uvm_pushbuffer_print_common(uvm_pushbuffer_t *pushbuffer, struct seq_file *s);
 
@@ -58,11 +64,54 @@ static NV_STATUS create_procfs(uvm_pushbuffer_t *pushbuffer)
     return NV_OK;
 }
 
+static NV_STATUS alloc_memory(uvm_pushbuffer_t *pushbuffer, uvm_rm_mem_t **memory_out)
+{
+    uvm_gpu_t *gpu = pushbuffer->channel_manager->gpu;
+    NV_STATUS status;
+
+    status = uvm_rm_mem_alloc_and_map_cpu(gpu, pushbuffer->memory_type, UVM_PUSHBUFFER_ALLOC_SIZE, memory_out);
+    if (status == NV_OK || pushbuffer->memory_type == UVM_RM_MEM_TYPE_SYS)
+        return status;
+
+    // The vidmem allocations are opportunistic, for example BAR1 space might
+    // be exhausted. Switch to sysmem for this and all the future allocations.
+    UVM_DBG_PRINT("Vidmem pushbuffer allocation failed: %s, GPU %s. Using sysmem.\n",
+                  nvstatusToString(status),
+                  gpu->name);
+    pushbuffer->memory_type = UVM_RM_MEM_TYPE_SYS;
+
+    return uvm_rm_mem_alloc_and_map_cpu(gpu, pushbuffer->memory_type, UVM_PUSHBUFFER_ALLOC_SIZE, memory_out);
+}
+
+static void grow_q_func(void *args)
+{
+    uvm_pushbuffer_t *pushbuffer = (uvm_pushbuffer_t *)args;
+
+    // Failures are not fatal, the pushbuffer just keeps its current size
+    // until the next time a push has to wait.
+    (void)uvm_pushbuffer_grow(pushbuffer);
+}
+
+// Scale the max number of chunks with the number of CPUs and channels as
+// that's how many pushes can be in progress at the same time.
+static NvU32 compute_max_chunks(uvm_channel_manager_t *channel_manager)
+{
+    uvm_channel_t *channel;
+    NvU32 num_channels = 0;
+    NvU32 max_chunks;
+
+    uvm_for_each_channel(channel, channel_manager)
+        ++num_channels;
+
+    max_chunks = roundup(max(num_online_cpus(), num_channels), UVM_PUSHBUFFER_CHUNKS);
+
+    return clamp(max_chunks, (NvU32)UVM_PUSHBUFFER_CHUNKS, (NvU32)UVM_PUSHBUFFER_CHUNKS_MAX);
+}
+
 NV_STATUS uvm_pushbuffer_create_common(uvm_channel_manager_t *channel_manager, bool with_procfs, uvm_pushbuffer_t **pushbuffer_out)
 {
     NV_STATUS status;
     int i;
-    uvm_gpu_t *gpu = channel_manager->gpu;
 
     uvm_pushbuffer_t *pushbuffer = uvm_kvmalloc_zero(sizeof(*pushbuffer));
     if (pushbuffer == NULL)
@@ -72,20 +121,35 @@ NV_STATUS uvm_pushbuffer_create_common(uvm_channel_manager_t *channel_manager, b
 
     uvm_spin_lock_init(&pushbuffer->lock, UVM_LOCK_ORDER_LEAF);
 
-    // Currently the pushbuffer supports UVM_PUSHBUFFER_CHUNKS of concurrent
-    // pushes.
+    // Initially the pushbuffer supports UVM_PUSHBUFFER_CHUNKS of concurrent
+    // pushes, uvm_pushbuffer_grow() raises that.
     uvm_sema_init(&pushbuffer->concurrent_pushes_sema, UVM_PUSHBUFFER_CHUNKS, UVM_LOCK_ORDER_PUSH);
 
-    status = uvm_rm_mem_alloc_and_map_cpu(gpu, UVM_RM_MEM_TYPE_SYS, UVM_PUSHBUFFER_SIZE, &pushbuffer->memory);
+    pushbuffer->memory_type = uvm_pushbuffer_vidmem ? UVM_RM_MEM_TYPE_GPU : UVM_RM_MEM_TYPE_SYS;
+
+    status = alloc_memory(pushbuffer, &pushbuffer->memory[0]);
     if (status != NV_OK)
         goto error;
 
-    bitmap_fill(pushbuffer->idle_chunks, UVM_PUSHBUFFER_CHUNKS);
-    bitmap_fill(pushbuffer->available_chunks, UVM_PUSHBUFFER_CHUNKS);
+    pushbuffer->num_chunks = UVM_PUSHBUFFER_CHUNKS;
+    pushbuffer->max_chunks = compute_max_chunks(channel_manager);
 
-    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i)
+    bitmap_set(pushbuffer->idle_chunks, 0, UVM_PUSHBUFFER_CHUNKS);
+    bitmap_set(pushbuffer->available_chunks, 0, UVM_PUSHBUFFER_CHUNKS);
+
+    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS_MAX; ++i)
         INIT_LIST_HEAD(&pushbuffer->chunks[i].pending_gpfifos);
 
+    if (pushbuffer->max_chunks > pushbuffer->num_chunks) {
+        nv_kthread_q_item_init(&pushbuffer->grow_q_item, grow_q_func, pushbuffer);
+
+        status = errno_to_nv_status(nv_kthread_q_init(&pushbuffer->grow_q, "UVM pushbuffer grow"));
+        if (status != NV_OK)
+            goto error;
+
+        pushbuffer->grow_q_initialized = true;
+    }
+
     if (with_procfs) {
         status = create_procfs(pushbuffer);
         if (status != NV_OK)
@@ -101,18 +165,83 @@ error:
     return status;
 }
 
+NV_STATUS uvm_pushbuffer_grow(uvm_pushbuffer_t *pushbuffer)
+{
+    NV_STATUS status;
+    uvm_rm_mem_t *memory;
+    NvU32 first_chunk;
+    NvU32 i;
+
+    uvm_spin_lock(&pushbuffer->lock);
+
+    if (pushbuffer->num_chunks >= pushbuffer->max_chunks)
+        status = NV_ERR_NO_MORE_ENTRIES;
+    else if (pushbuffer->growing)
+        status = NV_ERR_BUSY_RETRY;
+    else
+        status = NV_OK;
+
+    if (status == NV_OK)
+        pushbuffer->growing = true;
+
+    first_chunk = pushbuffer->num_chunks;
+
+    uvm_spin_unlock(&pushbuffer->lock);
+
+    if (status != NV_OK)
+        return status;
+
+    // Only the thread that set growing can modify num_chunks and memory, so
+    // they can be accessed without the lock until growing is cleared.
+    status = alloc_memory(pushbuffer, &memory);
+
+    uvm_spin_lock(&pushbuffer->lock);
+
+    if (status == NV_OK) {
+        // Publish the allocation before the chunks it backs become available
+        UVM_WRITE_ONCE(pushbuffer->memory[first_chunk / UVM_PUSHBUFFER_CHUNKS], memory);
+        pushbuffer->num_chunks += UVM_PUSHBUFFER_CHUNKS;
+        bitmap_set(pushbuffer->idle_chunks, first_chunk, UVM_PUSHBUFFER_CHUNKS);
+        bitmap_set(pushbuffer->available_chunks, first_chunk, UVM_PUSHBUFFER_CHUNKS);
+        ++pushbuffer->stats.grows;
+    }
+
+    pushbuffer->growing = false;
+
+    uvm_spin_unlock(&pushbuffer->lock);
+
+    if (status != NV_OK)
+        return status;
+
+    // Each new chunk allows for another concurrent push
+    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i)
+        uvm_up(&pushbuffer->concurrent_pushes_sema);
+
+    return NV_OK;
+}
+
+static void schedule_grow(uvm_pushbuffer_t *pushbuffer)
+{
+    // Racy read of num_chunks, at worst the grow function finds out there is
+    // nothing to do.
+    if (!pushbuffer->grow_q_initialized || UVM_READ_ONCE(pushbuffer->num_chunks) >= pushbuffer->max_chunks)
+        return;
+
+    nv_kthread_q_schedule_q_item(&pushbuffer->grow_q, &pushbuffer->grow_q_item);
+}
+
 NvLength uvm_pushbuffer_get_size(uvm_pushbuffer_t *pushbuffer)
 {
-    return pushbuffer->memory->size;
+    return (NvLength)UVM_READ_ONCE(pushbuffer->num_chunks) * UVM_PUSHBUFFER_CHUNK_SIZE;
 }
 
 static uvm_pushbuffer_chunk_t *get_chunk_in_mask(uvm_pushbuffer_t *pushbuffer, unsigned long *mask)
 {
-    NvU32 index = find_first_bit(mask, UVM_PUSHBUFFER_CHUNKS);
+    NvU32 index = find_first_bit(mask, pushbuffer->num_chunks);
 
     uvm_assert_spinlock_locked(&pushbuffer->lock);
 
-    if (index == UVM_PUSHBUFFER_CHUNKS)
+    if (index == pushbuffer->num_chunks)
         return NULL;
 
     return &pushbuffer->chunks[index];
@@ -131,7 +260,7 @@ static uvm_pushbuffer_chunk_t *get_idle_chunk(uvm_pushbuffer_t *pushbuffer)
 static NvU32 chunk_get_index(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chunk_t *chunk)
 {
     NvU32 index = chunk - pushbuffer->chunks;
-    UVM_ASSERT(index < UVM_PUSHBUFFER_CHUNKS);
+    UVM_ASSERT(index < UVM_PUSHBUFFER_CHUNKS_MAX);
     return index;
 }
 
@@ -193,8 +322,9 @@ done:
 
 static NvU32 *chunk_get_next_push_start_addr(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chunk_t *chunk)
 {
-    char *push_start = (char *)uvm_rm_mem_get_cpu_va(pushbuffer->memory);
-    push_start += chunk_get_offset(pushbuffer, chunk);
+    NvU32 index = chunk_get_index(pushbuffer, chunk);
+    char *push_start = (char *)uvm_rm_mem_get_cpu_va(pushbuffer->memory[index / UVM_PUSHBUFFER_CHUNKS]);
+    push_start += (index % UVM_PUSHBUFFER_CHUNKS) * UVM_PUSHBUFFER_CHUNK_SIZE;
     push_start += chunk->next_push_start;
 
     UVM_ASSERT(((NvU64)push_start) % sizeof(NvU32) == 0);
@@ -212,10 +342,18 @@ static NV_STATUS claim_chunk(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push, uvm
     NV_STATUS status = NV_OK;
     uvm_channel_manager_t *channel_manager = pushbuffer->channel_manager;
     uvm_spin_loop_t spin;
+    NvU64 wait_start;
+    NvU64 wait_ns;
 
     if (try_claim_chunk(pushbuffer, push, chunk_out))
         return NV_OK;
 
+    // All chunks are busy, ask for more to be added for future pushes. This
+    // push still needs to wait for one of the current chunks.
+    schedule_grow(pushbuffer);
+
+    wait_start = NV_GETTIME();
+
     uvm_channel_manager_update_progress(channel_manager);
 
     uvm_spin_loop_init(&spin);
@@ -225,6 +363,14 @@ static NV_STATUS claim_chunk(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push, uvm
         uvm_channel_manager_update_progress(channel_manager);
     }
 
+    wait_ns = NV_GETTIME() - wait_start;
+
+    uvm_spin_lock(&pushbuffer->lock);
+    ++pushbuffer->stats.chunk_waits;
+    pushbuffer->stats.chunk_wait_ns_total += wait_ns;
+    pushbuffer->stats.chunk_wait_ns_max = max(pushbuffer->stats.chunk_wait_ns_max, wait_ns);
+    uvm_spin_unlock(&pushbuffer->lock);
+
     return status;
 }
 
@@ -338,18 +484,27 @@ static void update_chunk(uvm_pushbuffer_t *pushbuffer, uvm_pushbuffer_chunk_t *c
 
 void uvm_pushbuffer_destroy(uvm_pushbuffer_t *pushbuffer)
 {
+    NvU32 i;
+
     if (pushbuffer == NULL)
         return;
 
     uvm_procfs_destroy_entry(pushbuffer->procfs.info_file);
 
-    uvm_rm_mem_free(pushbuffer->memory);
+    // Stopping the queue flushes any pending grow, after which the memory
+    // array can't change anymore.
+    if (pushbuffer->grow_q_initialized)
+        nv_kthread_q_stop(&pushbuffer->grow_q);
+
+    for (i = 0; i < UVM_PUSHBUFFER_MAX_ALLOCS; ++i)
+        uvm_rm_mem_free(pushbuffer->memory[i]);
+
     uvm_kvfree(pushbuffer);
 }
 
 static uvm_pushbuffer_chunk_t *offset_to_chunk(uvm_pushbuffer_t *pushbuffer, NvU32 offset)
 {
-    UVM_ASSERT(offset < UVM_PUSHBUFFER_SIZE);
+    UVM_ASSERT(offset < uvm_pushbuffer_get_size(pushbuffer));
     return &pushbuffer->chunks[offset / UVM_PUSHBUFFER_CHUNK_SIZE];
 }
 
@@ -389,19 +544,50 @@ void uvm_pushbuffer_mark_completed(uvm_pushbuffer_t *pushbuffer, uvm_gpfifo_entr
     uvm_spin_unlock(&pushbuffer->lock);
 }
 
+// Get the index of the allocation backing an on-going push
+//
+// The allocation of a chunk is published before the chunk can be claimed, so
+// the allocations backing any on-going push can be accessed without the lock.
+static NvU32 push_get_alloc_index(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push)
+{
+    NvU32 i;
+
+    for (i = 0; i < UVM_PUSHBUFFER_MAX_ALLOCS; ++i) {
+        uvm_rm_mem_t *memory = UVM_READ_ONCE(pushbuffer->memory[i]);
+        char *alloc_start;
+
+        // Allocations are added in order
+        if (memory == NULL)
+            break;
+
+        alloc_start = (char *)uvm_rm_mem_get_cpu_va(memory);
+
+        if ((char *)push->begin >= alloc_start && (char *)push->begin < alloc_start + UVM_PUSHBUFFER_ALLOC_SIZE)
+            return i;
+    }
+
+    UVM_ASSERT_MSG(0, "Push 0x%p not in the pushbuffer\n", push->begin);
+
+    return 0;
+}
+
 NvU32 uvm_pushbuffer_get_offset_for_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push)
 {
-    NvU32 offset = (char*)push->begin - (char *)uvm_rm_mem_get_cpu_va(pushbuffer->memory);
+    NvU32 alloc_index = push_get_alloc_index(pushbuffer, push);
+    NvU32 offset = (char*)push->begin - (char *)uvm_rm_mem_get_cpu_va(pushbuffer->memory[alloc_index]);
 
     UVM_ASSERT(((NvU64)offset) % sizeof(NvU32) == 0);
 
-    return offset;
+    return alloc_index * UVM_PUSHBUFFER_ALLOC_SIZE + offset;
 }
 
 NvU64 uvm_pushbuffer_get_gpu_va_for_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push)
 {
-    NvU64 pushbuffer_base = uvm_rm_mem_get_gpu_va(pushbuffer->memory, uvm_push_get_gpu(push));
-    return pushbuffer_base + uvm_pushbuffer_get_offset_for_push(pushbuffer, push);
+    NvU32 alloc_index = push_get_alloc_index(pushbuffer, push);
+    NvU64 alloc_base = uvm_rm_mem_get_gpu_va(pushbuffer->memory[alloc_index], uvm_push_get_gpu(push));
+    NvU32 offset = (char*)push->begin - (char *)uvm_rm_mem_get_cpu_va(pushbuffer->memory[alloc_index]);
+
+    return alloc_base + offset;
 }
 
 void uvm_pushbuffer_end_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push, uvm_gpfifo_entry_t *gpfifo)
@@ -444,7 +630,17 @@ void uvm_pushbuffer_print_common(uvm_pushbuffer_t *pushbuffer, struct seq_file *
 
     uvm_spin_lock(&pushbuffer->lock);
 
-    for (i = 0; i < UVM_PUSHBUFFER_CHUNKS; ++i) {
+    UVM_SEQ_OR_DBG_PRINT(s, " memory: %s\n", pushbuffer->memory_type == UVM_RM_MEM_TYPE_GPU ? "vidmem" : "sysmem");
+    UVM_SEQ_OR_DBG_PRINT(s, " chunks: %u max %u grows %llu\n",
+                         pushbuffer->num_chunks,
+                         pushbuffer->max_chunks,
+                         pushbuffer->stats.grows);
+    UVM_SEQ_OR_DBG_PRINT(s, " chunk waits: %llu total %llu ns max %llu ns\n",
+                         pushbuffer->stats.chunk_waits,
+                         pushbuffer->stats.chunk_wait_ns_total,
+                         pushbuffer->stats.chunk_wait_ns_max);
+
+    for (i = 0; i < pushbuffer->num_chunks; ++i) {
         uvm_pushbuffer_chunk_t *chunk = &pushbuffer->chunks[i];
         NvU32 cpu_put = chunk_get_cpu_put(pushbuffer, chunk);
         NvU32 gpu_get = chunk_get_gpu_get(pushbuffer, chunk);
@@ -26,7 +26,9 @@
 
 #include "uvm8_forward_decl.h"
 #include "uvm8_lock.h"
+#include "uvm8_rm_mem.h"
 #include "uvm_linux.h"
+#include "nv-kthread-q.h"
 #include "nvtypes.h"
 
 //
@@ -53,8 +55,15 @@
 //
 // With the above in mind, we can go through the implementation details of the
 // current solution.
-// The pushbuffer backing store is a single big allocation logically divided
-// into largely independent parts called chunks.
+// The pushbuffer backing store is one or more big allocations logically divided
+// into largely independent parts called chunks. The pushbuffer starts with a
+// single allocation and, when a push has to wait for a chunk, more allocations
+// are added in the background up to a limit scaled by the number of CPUs and
+// channels. Chunks are indexed consecutively across allocations and the offset
+// of a push within the pushbuffer is the offset within this virtual
+// concatenation of the allocations. Optionally, the allocations can be placed
+// in vidmem (uvm_pushbuffer_vidmem module parameter) in which case the CPU
+// writes the methods through a write-combined BAR1 mapping.
 // Each chunk is roughly a ringbuffer tracking multiple pending pushes being
 // processed by the GPU. The pushbuffer maintains two bitmaps, one tracking
 // completely idle (with no pending pushes) chunks and a second one tracking
@@ -145,14 +154,22 @@
 //
 #define UVM_MAX_PUSH_SIZE (128 * 1024)
 #define UVM_PUSHBUFFER_CHUNK_SIZE (8 * UVM_MAX_PUSH_SIZE)
+
+// Number of chunks backed by a single pushbuffer allocation. The pushbuffer
+// starts with one allocation and can grow, see uvm_pushbuffer_grow().
 #define UVM_PUSHBUFFER_CHUNKS 16
 
-// Total size of the pushbuffer
-#define UVM_PUSHBUFFER_SIZE (UVM_PUSHBUFFER_CHUNK_SIZE * UVM_PUSHBUFFER_CHUNKS)
+// Size of a single pushbuffer allocation
+#define UVM_PUSHBUFFER_ALLOC_SIZE (UVM_PUSHBUFFER_CHUNK_SIZE * UVM_PUSHBUFFER_CHUNKS)
+
+// Max number of allocations, and hence chunks, a pushbuffer can grow to
+#define UVM_PUSHBUFFER_MAX_ALLOCS 4
+#define UVM_PUSHBUFFER_CHUNKS_MAX (UVM_PUSHBUFFER_CHUNKS * UVM_PUSHBUFFER_MAX_ALLOCS)
 
-// The max number of concurrent pushes that can be happening at the same time.
-// Concurrent pushes are ones that are after uvm_push_begin*(), but before
-// uvm_push_end().
+// The max number of concurrent pushes that are guaranteed to be able to happen
+// at the same time. Concurrent pushes are ones that are after
+// uvm_push_begin*(), but before uvm_push_end(). A pushbuffer that has grown
+// supports one concurrent push per chunk.
 #define UVM_PUSH_MAX_CONCURRENT_PUSHES UVM_PUSHBUFFER_CHUNKS
 
 typedef struct
@@ -173,18 +190,32 @@ struct uvm_pushbuffer_struct
 {
     uvm_channel_manager_t *channel_manager;
 
-    // Memory allocation backing the pushbuffer
-    uvm_rm_mem_t *memory;
+    // Memory allocations backing the pushbuffer, each one backs
+    // UVM_PUSHBUFFER_CHUNKS chunks. Only the first num_chunks /
+    // UVM_PUSHBUFFER_CHUNKS are valid.
+    uvm_rm_mem_t *memory[UVM_PUSHBUFFER_MAX_ALLOCS];
+
+    // Type of memory used for the allocations
+    uvm_rm_mem_type_t memory_type;
+
+    // Number of chunks currently usable. Only grows and is protected by lock.
+    NvU32 num_chunks;
+
+    // Number of chunks the pushbuffer is allowed to grow to
+    NvU32 max_chunks;
+
+    // Whether uvm_pushbuffer_grow() is in progress. Protected by lock.
+    bool growing;
 
     // Array of the pushbuffer chunks
-    uvm_pushbuffer_chunk_t chunks[UVM_PUSHBUFFER_CHUNKS];
+    uvm_pushbuffer_chunk_t chunks[UVM_PUSHBUFFER_CHUNKS_MAX];
 
     // Chunks that do not have an on-going push and have at least
     // UVM_MAX_PUSH_SIZE space free.
-    DECLARE_BITMAP(available_chunks, UVM_PUSHBUFFER_CHUNKS);
+    DECLARE_BITMAP(available_chunks, UVM_PUSHBUFFER_CHUNKS_MAX);
 
     // Chunks that do not have an on-going push nor any pending pushes.
-    DECLARE_BITMAP(idle_chunks, UVM_PUSHBUFFER_CHUNKS);
+    DECLARE_BITMAP(idle_chunks, UVM_PUSHBUFFER_CHUNKS_MAX);
 
     // Lock protecting chunk state and the bitmaps.
     uvm_spinlock_t lock;
@@ -193,9 +224,29 @@ struct uvm_pushbuffer_struct
     // Decremented in uvm_pushbuffer_begin_push(), incremented in
     // uvm_pushbuffer_end_push().
     // Initialized to the number of chunks as that's how many concurrent pushes
-    // are supported.
+    // are supported and incremented for each chunk added when growing.
     uvm_semaphore_t concurrent_pushes_sema;
 
+    // Queue used to grow the pushbuffer in the background. Growing requires
+    // RM calls that cannot be made with the locks held by the threads
+    // beginning pushes. Only initialized if max_chunks > UVM_PUSHBUFFER_CHUNKS.
+    nv_kthread_q_t grow_q;
+    nv_kthread_q_item_t grow_q_item;
+    bool grow_q_initialized;
+
+    struct
+    {
+        // Number of times a push had to wait for a chunk to become available
+        NvU64 chunk_waits;
+
+        // Total and max time spent waiting for a chunk
+        NvU64 chunk_wait_ns_total;
+        NvU64 chunk_wait_ns_max;
+
+        // Number of allocations added by uvm_pushbuffer_grow()
+        NvU64 grows;
+    } stats;
+
     struct
     {
         struct proc_dir_entry *info_file;
@@ -237,7 +288,8 @@ void uvm_pushbuffer_mark_completed(uvm_pushbuffer_t *pushbuffer, uvm_gpfifo_entr
 // Get the GPU VA for an ongoing push
 NvU64 uvm_pushbuffer_get_gpu_va_for_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push);
 
-// Get the offset of the beginning of the push from the base of the pushbuffer allocation
+// Get the offset of the beginning of the push from the base of the pushbuffer.
+// Offsets are contiguous across all the allocations backing the pushbuffer.
 NvU32 uvm_pushbuffer_get_offset_for_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push);
 
 // End an on-going push
@@ -249,6 +301,21 @@ void uvm_pushbuffer_end_push(uvm_pushbuffer_t *pushbuffer, uvm_push_t *push, uvm
 // Mostly useful in pushbuffer tests
 bool uvm_pushbuffer_has_space(uvm_pushbuffer_t *pushbuffer);
 
+// Add another allocation worth of chunks to the pushbuffer
+//
+// Returns NV_ERR_NO_MORE_ENTRIES if the pushbuffer already has max_chunks and
+// NV_ERR_BUSY_RETRY if another thread is growing it at the same time. Usually
+// called from the pushbuffer's grow_q, but tests call it directly.
+//
+// Locking:
+//  - Internally acquires:
+//    - RM API lock
+//    - RM GPUs lock
+NV_STATUS uvm_pushbuffer_grow(uvm_pushbuffer_t *pushbuffer);
+
+// Total size of the memory currently backing the pushbuffer
+NvLength uvm_pushbuffer_get_size(uvm_pushbuffer_t *pushbuffer);
+
 // Helper to print pushbuffer state for debugging
 void uvm_pushbuffer_print(uvm_pushbuffer_t *pushbuffer);
 
@@ -24,13 +24,92 @@
 #include "uvm8_range_allocator.h"
 #include "uvm8_kvmalloc.h"
 
+static uvm_range_allocator_node_t *allocator_node(uvm_range_tree_node_t *node)
+{
+    return container_of(node, uvm_range_allocator_node_t, range_tree_node);
+}
+
+static NvU64 allocator_node_size(uvm_range_allocator_node_t *node)
+{
+    return node->range_tree_node.end - node->range_tree_node.start + 1;
+}
+
+// Returns whether a orders before b in the size tree
+static bool size_tree_less(uvm_range_allocator_node_t *a, uvm_range_allocator_node_t *b)
+{
+    NvU64 size_a = allocator_node_size(a);
+    NvU64 size_b = allocator_node_size(b);
+
+    if (size_a != size_b)
+        return size_a < size_b;
+
+    return a->range_tree_node.start < b->range_tree_node.start;
+}
+
+static void size_tree_add(uvm_range_allocator_t *range_allocator, uvm_range_allocator_node_t *node)
+{
+    struct rb_node **link = &range_allocator->size_tree.rb_node;
+    struct rb_node *parent = NULL;
+
+    while (*link) {
+        uvm_range_allocator_node_t *other = rb_entry(*link, uvm_range_allocator_node_t, size_node);
+
+        parent = *link;
+        if (size_tree_less(node, other))
+            link = &(*link)->rb_left;
+        else
+            link = &(*link)->rb_right;
+    }
+
+    rb_link_node(&node->size_node, parent, link);
+    rb_insert_color(&node->size_node, &range_allocator->size_tree);
+}
+
+static void size_tree_remove(uvm_range_allocator_t *range_allocator, uvm_range_allocator_node_t *node)
+{
+    rb_erase(&node->size_node, &range_allocator->size_tree);
+}
+
+// Returns the smallest free range with size greater or equal to the given
+// size, if any
+static uvm_range_allocator_node_t *size_tree_lower_bound(uvm_range_allocator_t *range_allocator, NvU64 size)
+{
+    struct rb_node *rb_node = range_allocator->size_tree.rb_node;
+    uvm_range_allocator_node_t *found = NULL;
+
+    while (rb_node) {
+        uvm_range_allocator_node_t *node = rb_entry(rb_node, uvm_range_allocator_node_t, size_node);
+
+        if (allocator_node_size(node) >= size) {
+            found = node;
+            rb_node = rb_node->rb_left;
+        }
+        else {
+            rb_node = rb_node->rb_right;
+        }
+    }
+
+    return found;
+}
+
+static uvm_range_allocator_node_t *size_tree_next(uvm_range_allocator_node_t *node)
+{
+    struct rb_node *rb_node = rb_next(&node->size_node);
+
+    if (!rb_node)
+        return NULL;
+
+    return rb_entry(rb_node, uvm_range_allocator_node_t, size_node);
+}
+
 NV_STATUS uvm_range_allocator_init(NvU64 size, uvm_range_allocator_t *range_allocator)
 {
     NV_STATUS status;
-    uvm_range_tree_node_t *node;
+    uvm_range_allocator_node_t *node;
 
     uvm_spin_lock_init(&range_allocator->lock, UVM_LOCK_ORDER_LEAF);
     uvm_range_tree_init(&range_allocator->range_tree);
+    range_allocator->size_tree = RB_ROOT;
 
     UVM_ASSERT(size > 0);
 
@@ -38,12 +117,14 @@ NV_STATUS uvm_range_allocator_init(NvU64 size, uvm_range_allocator_t *range_allo
     if (!node)
         return NV_ERR_NO_MEMORY;
 
-    node->start = 0;
-    node->end = size - 1;
+    node->range_tree_node.start = 0;
+    node->range_tree_node.end = size - 1;
 
-    status = uvm_range_tree_add(&range_allocator->range_tree, node);
+    status = uvm_range_tree_add(&range_allocator->range_tree, &node->range_tree_node);
     UVM_ASSERT(status == NV_OK);
 
+    size_tree_add(range_allocator, node);
+
     range_allocator->size = size;
 
     return NV_OK;
@@ -60,13 +141,16 @@ void uvm_range_allocator_deinit(uvm_range_allocator_t *range_allocator)
     // Remove the node for completeness even though after deinit the state of
     // tree doesn't matter anyway.
     uvm_range_tree_remove(&range_allocator->range_tree, node);
+    size_tree_remove(range_allocator, allocator_node(node));
+    UVM_ASSERT(RB_EMPTY_ROOT(&range_allocator->size_tree));
 
-    uvm_kvfree(node);
+    uvm_kvfree(allocator_node(node));
 }
 
 NV_STATUS uvm_range_allocator_alloc(uvm_range_allocator_t *range_allocator, NvU64 size, NvU64 alignment, uvm_range_allocation_t *range_alloc)
 {
-    uvm_range_tree_node_t *node;
+    uvm_range_allocator_node_t *new_node;
+    uvm_range_allocator_node_t *free_node;
     bool found = false;
 
     UVM_ASSERT(size > 0);
@@ -81,17 +165,21 @@ NV_STATUS uvm_range_allocator_alloc(uvm_range_allocator_t *range_allocator, NvU6
 
     // Pre-allocate a tree node as part of the allocation so that freeing the
     // range won't require allocating memory and will always succeed.
-    range_alloc->node = uvm_kvmalloc(sizeof(*range_alloc->node));
-    if (!range_alloc->node)
+    new_node = uvm_kvmalloc(sizeof(*new_node));
+    if (!new_node)
         return NV_ERR_NO_MEMORY;
 
+    range_alloc->node = &new_node->range_tree_node;
+
     uvm_spin_lock(&range_allocator->lock);
 
-    // This is a very simple brute force going over all the free ranges in
-    // address order and returning the first one that's big enough.
-    // This could be improved by e.g. also maintaining a binary tree of free
-    // ranges ordered by their size.
-    uvm_range_tree_for_each_in(node, &range_allocator->range_tree, 0, range_allocator->size - size) {
+    // Best-fit search over the free ranges in size order starting with the
+    // smallest one that's big enough. A free range that's at least
+    // size + alignment - 1 big always fits the aligned allocation so the walk
+    // only ever skips free ranges in [size, size + alignment - 1) that don't
+    // fit because of their alignment.
+    for (free_node = size_tree_lower_bound(range_allocator, size); free_node; free_node = size_tree_next(free_node)) {
+        uvm_range_tree_node_t *node = &free_node->range_tree_node;
         NvU64 aligned_start = UVM_ALIGN_UP(node->start, alignment);
         NvU64 aligned_end = aligned_start + size - 1;
 
@@ -111,16 +199,20 @@ NV_STATUS uvm_range_allocator_alloc(uvm_range_allocator_t *range_allocator, NvU6
         range_alloc->node->start = node->start;
         range_alloc->node->end = aligned_end;
 
+        // The node changes its size or goes away so it needs to be removed
+        // from the size tree in both cases. The walk terminates immediately.
+        size_tree_remove(range_allocator, free_node);
+
         if (aligned_end < node->end) {
             // Shrink the node if the claimed size is smaller than the node.
             uvm_range_tree_shrink_node(&range_allocator->range_tree, node, aligned_end + 1, node->end);
+            size_tree_add(range_allocator, free_node);
         }
         else {
-            // Otherwise just remove it. The removal is safe to do in the loop
-            // over nodes as a break is following immediately.
+            // Otherwise just remove it.
             UVM_ASSERT(node->end == aligned_end);
             uvm_range_tree_remove(&range_allocator->range_tree, node);
-            uvm_kvfree(node);
+            uvm_kvfree(free_node);
         }
         found = true;
         break;
@@ -129,7 +221,7 @@ NV_STATUS uvm_range_allocator_alloc(uvm_range_allocator_t *range_allocator, NvU6
     uvm_spin_unlock(&range_allocator->lock);
 
     if (!found) {
-        uvm_kvfree(range_alloc->node);
+        uvm_kvfree(new_node);
         range_alloc->node = NULL;
         return NV_ERR_UVM_ADDRESS_IN_USE;
     }
@@ -155,12 +247,19 @@ void uvm_range_allocator_free(uvm_range_allocator_t *range_allocator, uvm_range_
 
     // And try merging it with adjacent nodes
     adjacent_node = uvm_range_tree_merge_prev(&range_allocator->range_tree, range_alloc->node);
-    if (adjacent_node)
-        uvm_kvfree(adjacent_node);
+    if (adjacent_node) {
+        size_tree_remove(range_allocator, allocator_node(adjacent_node));
+        uvm_kvfree(allocator_node(adjacent_node));
+    }
 
     adjacent_node = uvm_range_tree_merge_next(&range_allocator->range_tree, range_alloc->node);
-    if (adjacent_node)
-        uvm_kvfree(adjacent_node);
+    if (adjacent_node) {
+        size_tree_remove(range_allocator, allocator_node(adjacent_node));
+        uvm_kvfree(allocator_node(adjacent_node));
+    }
+
+    // Only add the node to the size tree once its final size is known
+    size_tree_add(range_allocator, allocator_node(range_alloc->node));
 
     uvm_spin_unlock(&range_allocator->lock);
 
@@ -36,8 +36,21 @@ typedef struct {
 
     // Range tree tracking all the free ranges
     uvm_range_tree_t range_tree;
+
+    // Tree of the same free ranges (uvm_range_allocator_node_t) ordered by
+    // their size and then by their start. Used for best-fit lookups.
+    struct rb_root size_tree;
 } uvm_range_allocator_t;
 
+// A free range tracked by the range allocator
+typedef struct {
+    // Node in uvm_range_allocator_t::range_tree
+    uvm_range_tree_node_t range_tree_node;
+
+    // Node in uvm_range_allocator_t::size_tree
+    struct rb_node size_node;
+} uvm_range_allocator_node_t;
+
 // A free range allocation
 typedef struct {
     // The allocated start of the range
@@ -46,6 +59,8 @@ typedef struct {
     // A tree node allocated at the time of range allocation and used by the
     // range allocator when the range allocation is freed. This allows to
     // guarantee that uvm_range_allocator_free() always succeeds.
+    //
+    // The node is embedded in a uvm_range_allocator_node_t.
     uvm_range_tree_node_t *node;
 } uvm_range_allocation_t;
 
@@ -63,6 +78,9 @@ void uvm_range_allocator_deinit(uvm_range_allocator_t *range_allocator);
 // Alignment needs to be a power of 2 or 0. Alignment of 0 is converted into
 // alignment of 1.
 //
+// The smallest free range that can fit the aligned allocation is picked. Ties
+// are broken by picking the free range with the lowest address.
+//
 // On success, the start of the allocated range is returned in
 // free_range_alloc->aligned_start.
 NV_STATUS uvm_range_allocator_alloc(uvm_range_allocator_t *range_allocator, NvU64 size, NvU64 alignment, uvm_range_allocation_t *free_range_alloc);
@@ -43,6 +43,43 @@ static NV_STATUS test_check_range_allocator_empty(uvm_range_allocator_t *range_a
     return NV_OK;
 }
 
+// Verify that the size tree tracks exactly the free ranges of the range tree
+// and that it's ordered by size and then by start.
+static NV_STATUS test_check_size_tree(uvm_range_allocator_t *range_allocator)
+{
+    uvm_range_tree_node_t *node;
+    struct rb_node *rb_node;
+    uvm_range_allocator_node_t *prev = NULL;
+    NvU64 range_tree_count = 0;
+    NvU64 size_tree_count = 0;
+
+    uvm_range_tree_for_each(node, &range_allocator->range_tree)
+        ++range_tree_count;
+
+    for (rb_node = rb_first(&range_allocator->size_tree); rb_node; rb_node = rb_next(rb_node)) {
+        uvm_range_allocator_node_t *curr = rb_entry(rb_node, uvm_range_allocator_node_t, size_node);
+        NvU64 curr_size = curr->range_tree_node.end - curr->range_tree_node.start + 1;
+
+        TEST_CHECK_RET(uvm_range_tree_find(&range_allocator->range_tree, curr->range_tree_node.start) ==
+                       &curr->range_tree_node);
+
+        if (prev) {
+            NvU64 prev_size = prev->range_tree_node.end - prev->range_tree_node.start + 1;
+
+            TEST_CHECK_RET(prev_size <= curr_size);
+            if (prev_size == curr_size)
+                TEST_CHECK_RET(prev->range_tree_node.start < curr->range_tree_node.start);
+        }
+
+        prev = curr;
+        ++size_tree_count;
+    }
+
+    TEST_CHECK_RET(range_tree_count == size_tree_count);
+
+    return NV_OK;
+}
+
 static NvU64 range_alloc_size(uvm_range_allocation_t *alloc)
 {
     return alloc->node->end - alloc->node->start + 1;
@@ -65,6 +102,7 @@ static NV_STATUS test_alloc_range(uvm_range_allocator_t *range_allocator, NvU64
     TEST_CHECK_RET(alloc->aligned_start + size - 1 == node_end);
     TEST_CHECK_RET(IS_ALIGNED(alloc->aligned_start, alignment));
     TEST_CHECK_RET(uvm_range_tree_iter_first(&range_allocator->range_tree, node_start, node_end) == NULL);
+    TEST_CHECK_RET(test_check_size_tree(range_allocator) == NV_OK);
 
     return NV_OK;
 }
@@ -163,6 +201,7 @@ static NV_STATUS basic_test(void)
 
     TEST_CHECK_RET(test_alloc_range(&range_allocator, ULLONG_MAX - 3 * 128, max_alignment, &range_allocs[0]) == NV_OK);
     TEST_CHECK_RET(test_check_free_range(&range_allocator, ULLONG_MAX - 3 * 128, 3 * 128) == NV_OK);
+    TEST_CHECK_RET(test_check_size_tree(&range_allocator) == NV_OK);
 
     TEST_CHECK_RET(test_alloc_range(&range_allocator, 128, 1, &range_allocs[1]) == NV_OK);
     TEST_CHECK_RET(test_alloc_range(&range_allocator, 128, 1, &range_allocs[2]) == NV_OK);
@@ -188,6 +227,45 @@ static NV_STATUS basic_test(void)
 
     uvm_range_allocator_deinit(&range_allocator);
 
+    // Best-fit: with free ranges of 4, 2 and 4 units the smallest one that can
+    // fit the allocation is picked, regardless of the address order.
+    status = uvm_range_allocator_init(16, &range_allocator);
+    TEST_CHECK_RET(status == NV_OK);
+
+    for (i = 0; i < 8; ++i)
+        TEST_CHECK_RET(test_alloc_range(&range_allocator, 2, 1, &range_allocs[i]) == NV_OK);
+
+    // Free [0, 4), [6, 8) and [10, 14) while keeping [4, 6), [8, 10) and
+    // [14, 16) allocated.
+    test_free_range(&range_allocator, &range_allocs[0]);
+    test_free_range(&range_allocator, &range_allocs[1]);
+    test_free_range(&range_allocator, &range_allocs[3]);
+    test_free_range(&range_allocator, &range_allocs[5]);
+    test_free_range(&range_allocator, &range_allocs[6]);
+    TEST_CHECK_RET(test_check_size_tree(&range_allocator) == NV_OK);
+
+    TEST_CHECK_RET(test_alloc_range(&range_allocator, 1, 1, &range_allocs[0]) == NV_OK);
+    TEST_CHECK_RET(range_allocs[0].aligned_start == 6);
+
+    // Alignment is taken into account: [7, 8) isn't 2-aligned so the first
+    // fitting range in size order is [0, 4).
+    TEST_CHECK_RET(test_alloc_range(&range_allocator, 1, 2, &range_allocs[1]) == NV_OK);
+    TEST_CHECK_RET(range_allocs[1].aligned_start == 0);
+
+    TEST_CHECK_RET(test_alloc_range(&range_allocator, 4, 1, &range_allocs[3]) == NV_OK);
+    TEST_CHECK_RET(range_allocs[3].aligned_start == 10);
+
+    test_free_range(&range_allocator, &range_allocs[0]);
+    test_free_range(&range_allocator, &range_allocs[1]);
+    test_free_range(&range_allocator, &range_allocs[2]);
+    test_free_range(&range_allocator, &range_allocs[3]);
+    test_free_range(&range_allocator, &range_allocs[4]);
+    test_free_range(&range_allocator, &range_allocs[7]);
+    TEST_CHECK_RET(test_check_range_allocator_empty(&range_allocator) == NV_OK);
+    TEST_CHECK_RET(test_check_size_tree(&range_allocator) == NV_OK);
+
+    uvm_range_allocator_deinit(&range_allocator);
+
     uvm_kvfree(range_allocs);
 
     return NV_OK;
@@ -336,6 +414,7 @@ static NV_STATUS random_test(NvU32 iters, NvU32 seed, bool verbose)
         UVM_TEST_PRINT("Iters %u, total allocs made %llu\n", iters, state.total_allocs);
 
     TEST_CHECK_RET(test_check_range_allocator_empty(&state.range_allocator) == NV_OK);
+    TEST_CHECK_RET(test_check_size_tree(&state.range_allocator) == NV_OK);
 
     uvm_range_allocator_deinit(&state.range_allocator);
     uvm_kvfree(state.range_allocs);
@@ -349,3 +428,134 @@ NV_STATUS uvm8_test_range_allocator_sanity(UVM_TEST_RANGE_ALLOCATOR_SANITY_PARAM
 
     return NV_OK;
 }
+
+#define BENCHMARK_PAGE_SIZE (4 * 1024ull)
+#define BENCHMARK_PAGES     (64 * 1024)
+#define BENCHMARK_SIZE      (BENCHMARK_PAGES * BENCHMARK_PAGE_SIZE)
+
+// Fragmentation stress benchmark. The allocator is first filled with small
+// allocations of random sizes and then every other allocation is freed to
+// leave behind a large number of small free ranges. Then each iteration
+// allocates a range of random size and alignment and frees a random live
+// allocation, keeping the allocator fragmented.
+//
+// The time spent in each uvm_range_allocator_alloc() call is an upper bound on
+// the time the allocator's lock is held by it. Both the throughput and the
+// worst-case latency are reported.
+//
+// Notably this test leaks memory on failure as it's hard to clean up correctly
+// if something goes wrong and uvm_range_allocator_deinit would likely hit
+// asserts.
+static NV_STATUS fragmentation_benchmark(UVM_TEST_RANGE_ALLOCATOR_BENCHMARK_PARAMS *params)
+{
+    NV_STATUS status;
+    uvm_range_allocator_t range_allocator;
+    uvm_range_allocation_t *range_allocs;
+    uvm_range_tree_node_t *node;
+    uvm_test_rng_t rng;
+    size_t allocated_ranges = 0;
+    size_t i;
+    NvU64 total_ns = 0;
+    NvU64 max_ns = 0;
+    NvU64 num_allocs = 0;
+    NvU64 num_failed_allocs = 0;
+    NvU32 iter;
+
+    uvm_test_rng_init(&rng, params->seed);
+
+    // One extra entry for the alloc attempt that fails once the allocator is full
+    range_allocs = uvm_kvmalloc(sizeof(*range_allocs) * (BENCHMARK_PAGES + 1));
+    if (!range_allocs)
+        return NV_ERR_NO_MEMORY;
+
+    status = uvm_range_allocator_init(BENCHMARK_SIZE, &range_allocator);
+    TEST_CHECK_RET(status == NV_OK);
+
+    // Fill up the allocator
+    for (;;) {
+        NvU64 size = uvm_test_rng_range_64(&rng, 1, 4) * BENCHMARK_PAGE_SIZE;
+
+        status = uvm_range_allocator_alloc(&range_allocator, size, BENCHMARK_PAGE_SIZE, &range_allocs[allocated_ranges]);
+        if (status == NV_ERR_UVM_ADDRESS_IN_USE)
+            break;
+        TEST_CHECK_RET(status == NV_OK);
+        ++allocated_ranges;
+    }
+
+    // Free every other allocation
+    for (i = 0; i < allocated_ranges; i += 2)
+        uvm_range_allocator_free(&range_allocator, &range_allocs[i]);
+
+    for (i = 1; i < allocated_ranges; i += 2)
+        range_allocs[i / 2] = range_allocs[i];
+    allocated_ranges /= 2;
+
+    params->free_ranges = 0;
+    uvm_range_tree_for_each(node, &range_allocator.range_tree)
+        ++params->free_ranges;
+
+    for (iter = 0; iter < params->iters; ++iter) {
+        NvU64 size = uvm_test_rng_range_64(&rng, 1, 4) * BENCHMARK_PAGE_SIZE;
+        NvU64 alignment = BENCHMARK_PAGE_SIZE << uvm_test_rng_range_32(&rng, 0, 4);
+        NvU64 start_time;
+        NvU64 lapse;
+
+        start_time = NV_GETTIME();
+        status = uvm_range_allocator_alloc(&range_allocator, size, alignment, &range_allocs[allocated_ranges]);
+        lapse = NV_GETTIME() - start_time;
+
+        TEST_CHECK_RET(status == NV_OK || status == NV_ERR_UVM_ADDRESS_IN_USE);
+
+        total_ns += lapse;
+        max_ns = max(max_ns, lapse);
+
+        if (status == NV_OK) {
+            ++num_allocs;
+            ++allocated_ranges;
+        }
+        else {
+            ++num_failed_allocs;
+        }
+
+        if (allocated_ranges > 0) {
+            size_t index = uvm_test_rng_range_ptr(&rng, 0, allocated_ranges - 1);
+
+            uvm_range_allocator_free(&range_allocator, &range_allocs[index]);
+            --allocated_ranges;
+            if (index != allocated_ranges)
+                range_allocs[index] = range_allocs[allocated_ranges];
+        }
+
+        if (iter % 1024 == 0)
+            schedule();
+    }
+
+    while (allocated_ranges > 0)
+        uvm_range_allocator_free(&range_allocator, &range_allocs[--allocated_ranges]);
+
+    TEST_CHECK_RET(test_check_range_allocator_empty(&range_allocator) == NV_OK);
+    TEST_CHECK_RET(test_check_size_tree(&range_allocator) == NV_OK);
+
+    uvm_range_allocator_deinit(&range_allocator);
+    uvm_kvfree(range_allocs);
+
+    params->allocs_per_sec = total_ns ? ((num_allocs + num_failed_allocs) * 1000 * 1000 * 1000) / total_ns : 0;
+    params->max_alloc_ns = max_ns;
+
+    if (params->verbose) {
+        UVM_TEST_PRINT("Free ranges %llu, iters %u, allocs %llu (%llu failed), %llu allocs/s, max alloc time %llu ns\n",
+                       params->free_ranges,
+                       params->iters,
+                       num_allocs,
+                       num_failed_allocs,
+                       params->allocs_per_sec,
+                       params->max_alloc_ns);
+    }
+
+    return NV_OK;
+}
+
+NV_STATUS uvm8_test_range_allocator_benchmark(UVM_TEST_RANGE_ALLOCATOR_BENCHMARK_PARAMS *params, struct file *filp)
+{
+    return fragmentation_benchmark(params);
+}
@@ -34,6 +34,8 @@
 #include "uvm8_tools.h"
 #include "uvm8_mmu.h"
 
+#include <linux/kthread.h>
+
 static NV_STATUS uvm8_test_get_gpu_ref_count(UVM_TEST_GET_GPU_REF_COUNT_PARAMS *params, struct file *filp)
 {
     NvU64 retained_count = 0;
@@ -112,6 +114,92 @@ static NV_STATUS uvm8_test_get_kernel_virtual_address(
     return NV_OK;
 }
 
+typedef struct
+{
+    uvm_test_benchmark_thread_func_t func;
+    void *arg;
+    NvU32 index;
+    NV_STATUS status;
+    struct completion done;
+} uvm_test_benchmark_thread_t;
+
+static int uvm_test_benchmark_thread(void *arg)
+{
+    uvm_test_benchmark_thread_t *thread = (uvm_test_benchmark_thread_t *)arg;
+
+    thread->status = thread->func(thread->arg, thread->index);
+    complete(&thread->done);
+
+    return 0;
+}
+
+NV_STATUS uvm_test_benchmark_run(const char *name,
+                                 NvU32 num_threads,
+                                 uvm_test_benchmark_thread_func_t thread_func,
+                                 uvm_test_benchmark_poll_func_t poll_func,
+                                 void *arg,
+                                 NvU64 *elapsed_ns)
+{
+    NV_STATUS status = NV_OK;
+    NV_STATUS poll_status;
+    uvm_test_benchmark_thread_t *threads;
+    NvU32 num_started = 0;
+    NvU64 start_ns;
+    NvU32 i;
+
+    threads = uvm_kvmalloc_zero(num_threads * sizeof(*threads));
+    if (!threads)
+        return NV_ERR_NO_MEMORY;
+
+    start_ns = NV_GETTIME();
+
+    for (i = 0; i < num_threads; ++i) {
+        struct task_struct *thread;
+
+        threads[i].func = thread_func;
+        threads[i].arg = arg;
+        threads[i].index = i;
+        init_completion(&threads[i].done);
+
+        thread = kthread_run(uvm_test_benchmark_thread, &threads[i], "%s/%u", name, i);
+        if (IS_ERR(thread)) {
+            status = errno_to_nv_status(PTR_ERR(thread));
+            break;
+        }
+
+        ++num_started;
+    }
+
+    for (i = 0; i < num_started; ++i) {
+        if (poll_func) {
+            while (!try_wait_for_completion(&threads[i].done)) {
+                poll_status = poll_func(arg);
+                if (status == NV_OK)
+                    status = poll_status;
+                cond_resched();
+            }
+        }
+        else {
+            wait_for_completion(&threads[i].done);
+        }
+
+        if (status == NV_OK)
+            status = threads[i].status;
+    }
+
+    *elapsed_ns = NV_GETTIME() - start_ns;
+
+    if (poll_func) {
+        poll_status = poll_func(arg);
+        if (status == NV_OK)
+            status = poll_status;
+    }
+
+    uvm_kvfree(threads);
+
+    return status;
+}
+
 long uvm8_test_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 {
     // Disable all test entry points if the module parameter wasn't provided.
@@ -177,6 +265,19 @@ long uvm8_test_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
         UVM_ROUTE_CMD_STACK(UVM_TEST_PMA_ALLOC_FREE,                uvm8_test_pma_alloc_free);
         UVM_ROUTE_CMD_STACK(UVM_TEST_PMM_ALLOC_FREE_ROOT,           uvm8_test_pmm_alloc_free_root);
         UVM_ROUTE_CMD_STACK(UVM_TEST_PMM_INJECT_PMA_EVICT_ERROR,    uvm8_test_pmm_inject_pma_evict_error);
+        UVM_ROUTE_CMD_STACK(UVM_TEST_RANGE_ALLOCATOR_BENCHMARK,     uvm8_test_range_allocator_benchmark);
+        UVM_ROUTE_CMD_STACK(UVM_TEST_FAULT_SORT_BENCHMARK,          uvm8_test_fault_sort_benchmark);
+        UVM_ROUTE_CMD_STACK(UVM_TEST_FAULT_REPLAY_POLICY_SIMULATE,  uvm8_test_fault_replay_policy_simulate);
+        UVM_ROUTE_CMD_STACK(UVM_TEST_PMM_EVICTION_SIMULATE,         uvm8_test_pmm_eviction_simulate);
+        UVM_ROUTE_CMD_STACK(UVM_TEST_PREFETCH_REPLAY,               uvm8_test_prefetch_replay);
+        UVM_ROUTE_CMD_STACK(UVM_TEST_TOOLS_ENQUEUE_BENCHMARK,       uvm8_test_tools_enqueue_benchmark);
+        UVM_ROUTE_CMD_STACK(UVM_TEST_FAULT_SERVICE_WORKER_STATS,    uvm8_test_fault_service_worker_stats);
+        UVM_ROUTE_CMD_STACK(UVM_TEST_MIGRATE_BANDWIDTH,             uvm8_test_migrate_bandwidth);
+        UVM_ROUTE_CMD_STACK(UVM_TEST_PERF_EVENTS_BENCHMARK,         uvm8_test_perf_events_benchmark);
+        UVM_ROUTE_CMD_STACK(UVM_TEST_THREAD_CONTEXT_BENCHMARK,      uvm8_test_thread_context_benchmark);
+        UVM_ROUTE_CMD_STACK(UVM_TEST_CHANNEL_PUSH_BENCHMARK,        uvm8_test_channel_push_benchmark);
+        UVM_ROUTE_CMD_STACK(UVM_TEST_PTE_TLB_BATCH_BENCHMARK,       uvm8_test_pte_tlb_batch_benchmark);
+        UVM_ROUTE_CMD_STACK(UVM_TEST_VA_BLOCK_HEATMAP,              uvm8_test_va_block_heatmap);
     }
 
     return -EINVAL;
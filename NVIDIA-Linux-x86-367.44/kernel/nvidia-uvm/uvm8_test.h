@@ -84,12 +84,42 @@
         }                                                                           \
     } while(0)
 
+// Body of a benchmark thread, see uvm_test_benchmark_run()
+typedef NV_STATUS (*uvm_test_benchmark_thread_func_t)(void *arg, NvU32 thread_index);
+
+// Called repeatedly by uvm_test_benchmark_run() while the threads run
+typedef NV_STATUS (*uvm_test_benchmark_poll_func_t)(void *arg);
+
+// Run thread_func(arg, i) for i in [0, num_threads) concurrently, each in its
+// own kthread named "<name>/<i>", and wait for all of them to finish.
+//
+// If poll_func is not NULL, it is called with arg while waiting for the
+// threads, and once more after all of them have finished.
+//
+// elapsed_ns is the time between starting the first thread and the last one
+// finishing. The first error returned by a thread or by poll_func, or the
+// error starting a thread, is returned.
+NV_STATUS uvm_test_benchmark_run(const char *name,
+                                 NvU32 num_threads,
+                                 uvm_test_benchmark_thread_func_t thread_func,
+                                 uvm_test_benchmark_poll_func_t poll_func,
+                                 void *arg,
+                                 NvU64 *elapsed_ns);
+
+// Number of operations per second for count operations done in elapsed_ns.
+// Microseconds are used so that the product can't overflow for the sizes the
+// benchmarks accept.
+static inline NvU64 uvm_test_rate_per_sec(NvU64 count, NvU64 elapsed_ns)
+{
+    return (count * 1000 * 1000) / max(elapsed_ns / 1000, 1ULL);
+}
 
 long uvm8_test_ioctl(struct file *filp, unsigned int cmd, unsigned long arg);
 
 NV_STATUS uvm8_test_range_tree_directed(UVM_TEST_RANGE_TREE_DIRECTED_PARAMS *params, struct file *filp);
 NV_STATUS uvm8_test_range_tree_random(UVM_TEST_RANGE_TREE_RANDOM_PARAMS *params, struct file *filp);
 NV_STATUS uvm8_test_range_allocator_sanity(UVM_TEST_RANGE_ALLOCATOR_SANITY_PARAMS *params, struct file *filp);
+NV_STATUS uvm8_test_range_allocator_benchmark(UVM_TEST_RANGE_ALLOCATOR_BENCHMARK_PARAMS *params, struct file *filp);
 NV_STATUS uvm8_test_page_tree(UVM_TEST_PAGE_TREE_PARAMS *params, struct file *filp);
 NV_STATUS uvm8_test_rm_mem_sanity(UVM_TEST_RM_MEM_SANITY_PARAMS *params, struct file *filp);
 NV_STATUS uvm8_test_mem_sanity(UVM_TEST_MEM_SANITY_PARAMS *params, struct file *filp);
@@ -115,12 +145,19 @@ NV_STATUS uvm8_test_pmm_check_leak(UVM_TEST_PMM_CHECK_LEAK_PARAMS *params, struc
 NV_STATUS uvm8_test_pmm_async_alloc(UVM_TEST_PMM_ASYNC_ALLOC_PARAMS *params, struct file *filp);
 
 NV_STATUS uvm8_test_perf_events_sanity(UVM_TEST_PERF_EVENTS_SANITY_PARAMS *params, struct file *filp);
+NV_STATUS uvm8_test_perf_events_benchmark(UVM_TEST_PERF_EVENTS_BENCHMARK_PARAMS *params, struct file *filp);
+NV_STATUS uvm8_test_thread_context_benchmark(UVM_TEST_THREAD_CONTEXT_BENCHMARK_PARAMS *params, struct file *filp);
+NV_STATUS uvm8_test_channel_push_benchmark(UVM_TEST_CHANNEL_PUSH_BENCHMARK_PARAMS *params, struct file *filp);
+NV_STATUS uvm8_test_va_block_heatmap(UVM_TEST_VA_BLOCK_HEATMAP_PARAMS *params, struct file *filp);
 
 NV_STATUS uvm8_test_perf_module_sanity(UVM_TEST_PERF_MODULE_SANITY_PARAMS *params, struct file *filp);
 
 NV_STATUS uvm8_test_get_rm_ptes(UVM_TEST_GET_RM_PTES_PARAMS *params, struct file *filp);
 
 NV_STATUS uvm8_test_fault_buffer_flush(UVM_TEST_FAULT_BUFFER_FLUSH_PARAMS *params, struct file *filp);
+NV_STATUS uvm8_test_fault_sort_benchmark(UVM_TEST_FAULT_SORT_BENCHMARK_PARAMS *params, struct file *filp);
+NV_STATUS uvm8_test_fault_replay_policy_simulate(UVM_TEST_FAULT_REPLAY_POLICY_SIMULATE_PARAMS *params,
+                                                 struct file *filp);
 
 NV_STATUS uvm8_test_mmu_sanity(UVM_TEST_MMU_SANITY_PARAMS *params, struct file *filp);
 
@@ -146,5 +183,9 @@ NV_STATUS uvm8_test_set_prefetch_faults_reenable_lapse(UVM_TEST_SET_PREFETCH_FAU
 NV_STATUS uvm8_test_pma_alloc_free(UVM_TEST_PMA_ALLOC_FREE_PARAMS *params, struct file *filp);
 NV_STATUS uvm8_test_pmm_alloc_free_root(UVM_TEST_PMM_ALLOC_FREE_ROOT_PARAMS *params, struct file *filp);
 NV_STATUS uvm8_test_pmm_inject_pma_evict_error(UVM_TEST_PMM_INJECT_PMA_EVICT_ERROR_PARAMS *params, struct file *filp);
+NV_STATUS uvm8_test_pmm_eviction_simulate(UVM_TEST_PMM_EVICTION_SIMULATE_PARAMS *params, struct file *filp);
+NV_STATUS uvm8_test_prefetch_replay(UVM_TEST_PREFETCH_REPLAY_PARAMS *params, struct file *filp);
+NV_STATUS uvm8_test_fault_service_worker_stats(UVM_TEST_FAULT_SERVICE_WORKER_STATS_PARAMS *params, struct file *filp);
+NV_STATUS uvm8_test_migrate_bandwidth(UVM_TEST_MIGRATE_BANDWIDTH_PARAMS *params, struct file *filp);
 
 #endif
@@ -846,6 +846,345 @@ typedef struct
     NV_STATUS                       rmStatus;                                           // Out
 } UVM_TEST_PMM_INJECT_PMA_EVICT_ERROR_PARAMS;
 
+// Fragmentation stress benchmark of the range allocator. See
+// fragmentation_benchmark() in uvm8_range_allocator_test.c.
+#define UVM_TEST_RANGE_ALLOCATOR_BENCHMARK              UVM8_TEST_IOCTL_BASE(56)
+typedef struct
+{
+    NvU32                           verbose;                                            // In
+    NvU32                           seed;                                               // In
+    NvU32                           iters;                                              // In
+
+    // Number of free ranges in the fragmented allocator before the timed
+    // iterations start.
+    NvU64                           free_ranges                      NV_ALIGN_BYTES(8); // Out
+
+    // Alloc calls (successful or not) per second
+    NvU64                           allocs_per_sec                   NV_ALIGN_BYTES(8); // Out
+
+    // Worst-case duration of a single alloc call, which bounds the time the
+    // allocator lock is held.
+    NvU64                           max_alloc_ns                     NV_ALIGN_BYTES(8); // Out
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_RANGE_ALLOCATOR_BENCHMARK_PARAMS;
+
+// A recorded replayable fault, used to replay fault batches in tests
+typedef struct
+{
+    NvU64                           instance_ptr                     NV_ALIGN_BYTES(8);
+    NvU64                           fault_address                    NV_ALIGN_BYTES(8);
+
+    // uvm_aperture_t
+    NvU32                           instance_ptr_aperture;
+
+    // uvm_fault_access_type_t
+    NvU32                           access_type;
+} UvmTestFaultRecord;
+
+// Replay fault batches through both the generic sort() and the specialized
+// fault sort used by fault batch preprocessing, check that both produce the
+// same ordering and report the time spent by each of them.
+//
+// If records is 0, num_records synthetic faults coming from num_instance_ptrs
+// different instance pointers are generated using the given seed.
+#define UVM_TEST_FAULT_SORT_BENCHMARK                   UVM8_TEST_IOCTL_BASE(57)
+typedef struct
+{
+    // Pointer to an array of UvmTestFaultRecord
+    NvU64                           records                          NV_ALIGN_BYTES(8); // In
+    NvU32                           num_records;                                        // In
+    NvU32                           batch_size;                                         // In
+    NvU32                           iterations;                                         // In
+    NvU32                           seed;                                               // In
+    NvU32                           num_instance_ptrs;                                  // In
+    NvU64                           generic_sort_ns                  NV_ALIGN_BYTES(8); // Out
+    NvU64                           fault_sort_ns                    NV_ALIGN_BYTES(8); // Out
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_FAULT_SORT_BENCHMARK_PARAMS;
+
+typedef struct
+{
+    NvU64                           fault_address                    NV_ALIGN_BYTES(8);
+    NvU32                           utlb_id;
+
+    // uvm_fault_access_type_t
+    NvU32                           access_type;
+} UvmTestFaultReplayRecord;
+
+#define UVM_TEST_FAULT_REPLAY_MAX_POLICIES 8
+#define UVM_TEST_FAULT_REPLAY_MAX_UTLBS    256
+
+// Simulate the servicing of a fault trace under every fault replay policy
+// (uvm_perf_fault_replay_policy_t) using a simple cost model: servicing a VA
+// block costs block_service_ns plus page_service_ns per distinct page, and
+// issuing a replay costs replay_ns. Faults are fetched in batches of
+// batch_size and serviced in VA block order, like the fault servicing code
+// does, and replays are issued wherever the replay policy decision used by the
+// fault servicing code (uvm_perf_fault_replay_policy_should_replay) says so.
+//
+// A uTLB is considered resumed at the first replay issued after all its faults
+// in the trace have been serviced. For each policy, the simulated time of the
+// first replay, the average and maximum time to resume the uTLBs, the number
+// of replays and the number of replays issued while a uTLB still had faults
+// left to service (which would make it fault again) are reported, indexed by
+// policy.
+//
+// If records is 0, num_records synthetic faults coming from num_utlbs uTLBs
+// are generated using the given seed.
+#define UVM_TEST_FAULT_REPLAY_POLICY_SIMULATE           UVM8_TEST_IOCTL_BASE(58)
+typedef struct
+{
+    // Pointer to an array of UvmTestFaultReplayRecord
+    NvU64                           records                          NV_ALIGN_BYTES(8); // In
+    NvU32                           num_records;                                        // In
+    NvU32                           batch_size;                                         // In
+    NvU32                           seed;                                               // In
+    NvU32                           num_utlbs;                                          // In
+    NvU32                           block_service_ns;                                   // In
+    NvU32                           page_service_ns;                                    // In
+    NvU32                           replay_ns;                                          // In
+    NvU32                           num_policies;                                       // Out
+    NvU64                           first_replay_ns[UVM_TEST_FAULT_REPLAY_MAX_POLICIES] NV_ALIGN_BYTES(8); // Out
+    NvU64                           avg_resume_ns[UVM_TEST_FAULT_REPLAY_MAX_POLICIES] NV_ALIGN_BYTES(8); // Out
+    NvU64                           max_resume_ns[UVM_TEST_FAULT_REPLAY_MAX_POLICIES] NV_ALIGN_BYTES(8); // Out
+    NvU32                           replays[UVM_TEST_FAULT_REPLAY_MAX_POLICIES];          // Out
+    NvU32                           premature_replays[UVM_TEST_FAULT_REPLAY_MAX_POLICIES]; // Out
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_FAULT_REPLAY_POLICY_SIMULATE_PARAMS;
+
+#define UVM_TEST_PMM_MAX_EVICTION_POLICIES 4
+
+// Simulate the eviction of root chunks used by VA blocks under every PMM
+// eviction policy (uvm_pmm_gpu_eviction_policy_t), using the same eviction
+// list primitives as PMM. num_chunks root chunks fit in the simulated vidmem.
+//
+// The synthetic trace has num_accesses accesses. reuse_percent of them reuse a
+// previously accessed chunk, with a reuse distance (number of distinct chunks
+// accessed since the last access to the chunk) uniformly distributed in
+// [0, max_reuse_distance). The rest access new chunks. The number of hits and
+// misses is reported for each policy, indexed by policy.
+#define UVM_TEST_PMM_EVICTION_SIMULATE                  UVM8_TEST_IOCTL_BASE(59)
+typedef struct
+{
+    NvU32                           num_chunks;                                         // In
+    NvU32                           num_accesses;                                       // In
+    NvU32                           reuse_percent;                                      // In
+    NvU32                           max_reuse_distance;                                 // In
+    NvU32                           seed;                                               // In
+    NvU32                           num_policies;                                       // Out
+    NvU32                           hits[UVM_TEST_PMM_MAX_EVICTION_POLICIES];           // Out
+    NvU32                           misses[UVM_TEST_PMM_MAX_EVICTION_POLICIES];         // Out
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_PMM_EVICTION_SIMULATE_PARAMS;
+
+#define UVM_TEST_PREFETCH_REPLAY_ACCESS 0
+#define UVM_TEST_PREFETCH_REPLAY_EVICT  1
+
+typedef struct
+{
+    NvU16                           page_index;
+
+    // UVM_TEST_PREFETCH_REPLAY_ACCESS or UVM_TEST_PREFETCH_REPLAY_EVICT
+    NvU8                            type;
+    NvU8                            padding;
+} UvmTestPrefetchReplayRecord;
+
+#define UVM_TEST_PREFETCH_REPLAY_POLICY_FIXED    0
+#define UVM_TEST_PREFETCH_REPLAY_POLICY_ADAPTIVE 1
+#define UVM_TEST_PREFETCH_REPLAY_MAX_POLICIES    2
+
+// Replay a trace of page accesses and evictions on a single, fully-sized VA
+// block through the bitmap tree prefetcher, using a fixed threshold and the
+// adaptive threshold. Both policies start with the given threshold, or the
+// uvm_perf_prefetch_threshold module parameter if it is 0. Accesses to
+// non-resident pages fault and may prefetch other pages; evictions make pages
+// non-resident. The adaptive policy is fed every access to a prefetched page
+// as useful and every eviction of an untouched prefetched page as wasted. The
+// driver only observes the accesses that fault on the prefetched page, so the
+// replay shows what the policy does with a complete access signal.
+//
+// For each policy, the number of faults, prefetched pages, prefetched pages
+// actually accessed before being evicted (useful) and the rest (wasted) are
+// reported, as well as the final threshold, indexed by policy.
+//
+// If records is 0, num_records synthetic records are generated using the
+// given seed: evict_percent of them evict a random page, sparse_percent of
+// them access a random page and the rest access the block sequentially.
+#define UVM_TEST_PREFETCH_REPLAY                        UVM8_TEST_IOCTL_BASE(60)
+typedef struct
+{
+    // Pointer to an array of UvmTestPrefetchReplayRecord
+    NvU64                           records                          NV_ALIGN_BYTES(8); // In
+    NvU32                           num_records;                                        // In
+    NvU32                           threshold;                                          // In
+    NvU32                           seed;                                               // In
+    NvU32                           sparse_percent;                                     // In
+    NvU32                           evict_percent;                                      // In
+    NvU32                           faults[UVM_TEST_PREFETCH_REPLAY_MAX_POLICIES];      // Out
+    NvU32                           prefetched_pages[UVM_TEST_PREFETCH_REPLAY_MAX_POLICIES]; // Out
+    NvU32                           useful_pages[UVM_TEST_PREFETCH_REPLAY_MAX_POLICIES]; // Out
+    NvU32                           wasted_pages[UVM_TEST_PREFETCH_REPLAY_MAX_POLICIES]; // Out
+    NvU32                           final_threshold[UVM_TEST_PREFETCH_REPLAY_MAX_POLICIES]; // Out
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_PREFETCH_REPLAY_PARAMS;
+
+// Stress the tools event queue by enqueueing num_events events from each of
+// num_producers kernel threads into a private queue of queue_size entries.
+// If consume is set, the calling thread consumes the events concurrently and
+// checks that the events of each producer are received in order.
+//
+// no_tracer_ns is the time taken by the producers to generate their events
+// when no tracer is attached, and tracer_ns the time taken to generate and
+// enqueue them. Every event is either consumed (or left in the queue if
+// consume is not set) or accounted as dropped.
+#define UVM_TEST_TOOLS_ENQUEUE_BENCHMARK                UVM8_TEST_IOCTL_BASE(61)
+typedef struct
+{
+    NvU32                           num_producers;                                      // In
+    NvU32                           num_events;                                         // In
+    NvU32                           queue_size;                                         // In
+    NvU32                           consume;                                            // In
+    NvU64                           no_tracer_ns                     NV_ALIGN_BYTES(8); // Out
+    NvU64                           tracer_ns                        NV_ALIGN_BYTES(8); // Out
+    NvU64                           events_consumed                  NV_ALIGN_BYTES(8); // Out
+    NvU64                           events_dropped                   NV_ALIGN_BYTES(8); // Out
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_TOOLS_ENQUEUE_BENCHMARK_PARAMS;
+
+#define UVM_TEST_FAULT_SERVICE_WORKERS_MAX 16
+
+// Report the statistics of the workers servicing the VA blocks of the fault
+// batches of the given GPU in parallel (see uvm_perf_fault_service_workers).
+// num_workers is 0 if the VA blocks are serviced serially by the bottom half.
+// service_time_ns is the time each worker has spent servicing VA blocks. If
+// reset is set, the statistics are cleared after being reported.
+#define UVM_TEST_FAULT_SERVICE_WORKER_STATS             UVM8_TEST_IOCTL_BASE(62)
+typedef struct
+{
+    NvProcessorUuid                 gpu_uuid;                                           // In
+    NvU32                           reset;                                              // In
+    NvU32                           num_workers;                                        // Out
+    NvU64                           service_time_ns[UVM_TEST_FAULT_SERVICE_WORKERS_MAX] NV_ALIGN_BYTES(8); // Out
+    NvU64                           num_blocks[UVM_TEST_FAULT_SERVICE_WORKERS_MAX]      NV_ALIGN_BYTES(8); // Out
+    NvU64                           num_faults[UVM_TEST_FAULT_SERVICE_WORKERS_MAX]      NV_ALIGN_BYTES(8); // Out
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_FAULT_SERVICE_WORKER_STATS_PARAMS;
+
+// Synchronously migrate [base, base + length) to the destination processor and
+// report the time it took and the achieved bandwidth. The range should not be
+// resident on the destination already, or there is nothing to copy.
+//
+// num_channels and num_copy_engines are the number of copy channels and of
+// distinct CEs (across all the GPUs involved) the migration was spread across.
+// See uvm_channel_copy_ce_stripe_width.
+#define UVM_TEST_MIGRATE_BANDWIDTH                      UVM8_TEST_IOCTL_BASE(63)
+typedef struct
+{
+    NvU64                           base                             NV_ALIGN_BYTES(8); // In
+    NvU64                           length                           NV_ALIGN_BYTES(8); // In
+    NvProcessorUuid                 destination_uuid;                                   // In
+    NvU64                           migrate_ns                       NV_ALIGN_BYTES(8); // Out
+    NvU64                           bandwidth_mbps                   NV_ALIGN_BYTES(8); // Out
+    NvU32                           num_channels;                                       // Out
+    NvU32                           num_copy_engines;                                   // Out
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_MIGRATE_BANDWIDTH_PARAMS;
+
+// Measure the cost of uvm_perf_event_notify() when num_threads kernel threads
+// concurrently notify num_events events each on a private set of VA space
+// events. no_callbacks_ns is the time taken when the event has no callbacks
+// registered and callback_ns the time taken when it has a single (empty)
+// callback registered.
+#define UVM_TEST_PERF_EVENTS_BENCHMARK                  UVM8_TEST_IOCTL_BASE(64)
+typedef struct
+{
+    NvU32                           num_threads;                                        // In
+    NvU32                           num_events;                                         // In
+    NvU64                           no_callbacks_ns                  NV_ALIGN_BYTES(8); // Out
+    NvU64                           callback_ns                      NV_ALIGN_BYTES(8); // Out
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_PERF_EVENTS_BENCHMARK_PARAMS;
+
+// Measure the rate of thread context lookups when num_threads kernel threads
+// concurrently retain their context and look it up num_lookups times each, like
+// the lock tracking code does. elapsed_ns is the time taken by all the threads
+// and lookups_per_sec the aggregate lookup rate.
+#define UVM_TEST_THREAD_CONTEXT_BENCHMARK               UVM8_TEST_IOCTL_BASE(65)
+typedef struct
+{
+    NvU32                           num_threads;                                        // In
+    NvU32                           num_lookups;                                        // In
+    NvU64                           elapsed_ns                       NV_ALIGN_BYTES(8); // Out
+    NvU64                           lookups_per_sec                  NV_ALIGN_BYTES(8); // Out
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_THREAD_CONTEXT_BENCHMARK_PARAMS;
+
+// Measure the push submission rate when num_threads kernel threads concurrently
+// begin and end num_pushes empty pushes each on channels of channel_type
+// (uvm_channel_type_t) of the first GPU registered in the VA space. doorbells
+// is the number of GPPut writes done for these pushes, which is lower than the
+// number of pushes if doorbell coalescing is enabled. Other work submitted to
+// the GPU during the benchmark is included in the count.
+#define UVM_TEST_CHANNEL_PUSH_BENCHMARK                 UVM8_TEST_IOCTL_BASE(66)
+typedef struct
+{
+    NvU32                           num_threads;                                        // In
+    NvU32                           num_pushes;                                         // In
+    NvU32                           channel_type;                                       // In
+    NvU64                           elapsed_ns                       NV_ALIGN_BYTES(8); // Out
+    NvU64                           pushes_per_sec                   NV_ALIGN_BYTES(8); // Out
+    NvU64                           doorbells                        NV_ALIGN_BYTES(8); // Out
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_CHANNEL_PUSH_BENCHMARK_PARAMS;
+
+// Measure the cost of remapping a scattered pattern of pages on the given GPU.
+// Every stride-th page of num_pages * stride pages of page_size (4K or the big
+// page size of the GPU VA space) is mapped and then unmapped iterations times
+// in a page tree private to the test, once with PTEs written with memsets and
+// once with inline memcopies. Each iteration also queues up invalidates of the
+// touched pages in a TLB batch. tlb_ranges is the number of ranges the TLB
+// batch tracked and tlb_invalidate_all whether it fell back to invalidating
+// all. The costs are the GPU completion times divided by the number of PTEs
+// written or pages invalidated. num_pages * stride * page_size must not exceed
+// 128MB.
+//
+// If apply is set, the number of consecutive PTEs written with memsets
+// (max_memset_ptes) is recomputed for the GPU from the measured costs, the same
+// way the GPU registration calibration does. This requires stride > 1 so that
+// each PTE is written separately.
+#define UVM_TEST_PTE_TLB_BATCH_BENCHMARK                UVM8_TEST_IOCTL_BASE(67)
+typedef struct
+{
+    NvProcessorUuid                 gpu_uuid;                                           // In
+    NvU32                           page_size;                                          // In
+    NvU32                           num_pages;                                          // In
+    NvU32                           stride;                                             // In
+    NvU32                           iterations;                                         // In
+    NvBool                          apply;                                              // In
+    NvU64                           pte_memset_ns_per_page           NV_ALIGN_BYTES(8); // Out
+    NvU64                           pte_inline_ns_per_page           NV_ALIGN_BYTES(8); // Out
+    NvU64                           tlb_invalidate_ns_per_page       NV_ALIGN_BYTES(8); // Out
+    NvU32                           tlb_ranges;                                         // Out
+    NvBool                          tlb_invalidate_all;                                 // Out
+    NvU32                           max_memset_ptes;                                    // Out
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_PTE_TLB_BATCH_BENCHMARK_PARAMS;
+
+// Check the per-VA block heatmap (see UVM_GET_VA_BLOCK_HEATMAP). Counters are
+// recorded directly on the VA blocks of [base, base + length), which must be
+// aligned to the VA block size, span 2 to 8 VA blocks and be covered by a
+// single managed allocation. The test checks that the recorded faults and
+// migrations are reported, that the walk can be paginated through
+// nextAddress, and that reset blocks are not reported again. The memory must
+// not be accessed while the test runs.
+#define UVM_TEST_VA_BLOCK_HEATMAP                       UVM8_TEST_IOCTL_BASE(68)
+typedef struct
+{
+    NvU64                           base                             NV_ALIGN_BYTES(8); // In
+    NvU64                           length                           NV_ALIGN_BYTES(8); // In
+    NV_STATUS                       rmStatus;                                           // Out
+} UVM_TEST_VA_BLOCK_HEATMAP_PARAMS;
+
 #ifdef __cplusplus
 }
 #endif
@@ -27,11 +27,23 @@
 #include "uvm_linux.h"
 #include "uvm_common.h"
 
-// Use a raw spinlock as thread contexts are used for lock tracking
-static spinlock_t g_lock;
+// Number of shards of the user context table. Must be a power of 2.
+#define UVM_THREAD_CONTEXT_SHARD_COUNT 64
+
+// Shard of the user context table. Every lock tracking operation and API entry
+// looks up the context of the current thread, so the contexts are spread
+// across shards with their own lock to keep the threads of a process from all
+// contending on a single lock. Each shard lives in its own cache line.
+typedef struct
+{
+    // Use a raw spinlock as thread contexts are used for lock tracking
+    spinlock_t lock;
+
+    // Radix tree for user contexts, mapping get_current()->pid to a uvm_thread_context_t.
+    struct radix_tree_root tree;
+} ____cacheline_aligned_in_smp uvm_thread_context_shard_t;
 
-// Radix tree for user contexts, mapping get_current()->pid to a uvm_thread_context_t.
-static struct radix_tree_root g_user_context_tree;
+static uvm_thread_context_shard_t g_user_context_shards[UVM_THREAD_CONTEXT_SHARD_COUNT];
 
 // Cache for allocating uvm_thread_context_t
 static struct kmem_cache *g_uvm_thread_context_cache __read_mostly;
@@ -39,10 +51,23 @@ static struct kmem_cache *g_uvm_thread_context_cache __read_mostly;
 // Per cpu uvm_thread_context_t used for interrupt context
 static DEFINE_PER_CPU(uvm_thread_context_t, interrupt_thread_context);
 
+// Threads of the same process usually have consecutive pids, so they end up in
+// different shards.
+static uvm_thread_context_shard_t *thread_context_shard(pid_t pid)
+{
+    return &g_user_context_shards[(unsigned long)pid & (UVM_THREAD_CONTEXT_SHARD_COUNT - 1)];
+}
+
 NV_STATUS uvm_thread_context_init(void)
 {
-    spin_lock_init(&g_lock);
-    uvm_init_radix_tree_preloadable(&g_user_context_tree);
+    size_t i;
+
+    BUILD_BUG_ON(!is_power_of_2(UVM_THREAD_CONTEXT_SHARD_COUNT));
+
+    for (i = 0; i < UVM_THREAD_CONTEXT_SHARD_COUNT; ++i) {
+        spin_lock_init(&g_user_context_shards[i].lock);
+        uvm_init_radix_tree_preloadable(&g_user_context_shards[i].tree);
+    }
 
     g_uvm_thread_context_cache = NV_KMEM_CACHE_CREATE("uvm_thread_context_t", uvm_thread_context_t);
     if (!g_uvm_thread_context_cache)
@@ -54,12 +79,17 @@ NV_STATUS uvm_thread_context_init(void)
 void uvm_thread_context_exit(void)
 {
     uvm_thread_context_t *thread_context;
+    size_t i;
+
+    for (i = 0; i < UVM_THREAD_CONTEXT_SHARD_COUNT; ++i) {
+        struct radix_tree_root *tree = &g_user_context_shards[i].tree;
 
-    while (radix_tree_gang_lookup(&g_user_context_tree, (void**)&thread_context, 0, 1)) {
-        radix_tree_delete(&g_user_context_tree, thread_context->pid);
-        UVM_ERR_PRINT("Left-over thread_context %p pid %u\n", thread_context, thread_context->pid);
-        UVM_ASSERT(__uvm_check_all_unlocked(thread_context));
-        kmem_cache_free(g_uvm_thread_context_cache, thread_context);
+        while (radix_tree_gang_lookup(tree, (void**)&thread_context, 0, 1)) {
+            radix_tree_delete(tree, thread_context->pid);
+            UVM_ERR_PRINT("Left-over thread_context %p pid %u\n", thread_context, thread_context->pid);
+            UVM_ASSERT(__uvm_check_all_unlocked(thread_context));
+            kmem_cache_free(g_uvm_thread_context_cache, thread_context);
+        }
     }
 
     kmem_cache_destroy_safe(&g_uvm_thread_context_cache);
@@ -68,14 +98,13 @@ void uvm_thread_context_exit(void)
 static uvm_thread_context_t *uvm_thread_context_user(void)
 {
     unsigned long flags;
-    unsigned long key;
+    pid_t pid = get_current()->pid;
+    uvm_thread_context_shard_t *shard = thread_context_shard(pid);
     uvm_thread_context_t *thread_context;
 
-    key = (unsigned long)get_current()->pid;
-
-    spin_lock_irqsave(&g_lock, flags);
-    thread_context = (uvm_thread_context_t *)radix_tree_lookup(&g_user_context_tree, key);
-    spin_unlock_irqrestore(&g_lock, flags);
+    spin_lock_irqsave(&shard->lock, flags);
+    thread_context = (uvm_thread_context_t *)radix_tree_lookup(&shard->tree, (unsigned long)pid);
+    spin_unlock_irqrestore(&shard->lock, flags);
 
     return thread_context;
 }
@@ -86,6 +115,7 @@ static uvm_thread_context_t *uvm_thread_context_user_retain(void)
     uvm_thread_context_t *thread_context = uvm_thread_context_user();
 
     if (thread_context == NULL) {
+        uvm_thread_context_shard_t *shard = thread_context_shard(get_current()->pid);
         int ret;
         thread_context = kmem_cache_zalloc(g_uvm_thread_context_cache, NV_UVM_GFP_FLAGS);
         if (thread_context == NULL)
@@ -103,10 +133,10 @@ static uvm_thread_context_t *uvm_thread_context_user_retain(void)
             return NULL;
         }
 
-        spin_lock_irqsave(&g_lock, flags);
+        spin_lock_irqsave(&shard->lock, flags);
         // After preloading this should always succeed
-        ret = radix_tree_insert(&g_user_context_tree, thread_context->pid, thread_context);
-        spin_unlock_irqrestore(&g_lock, flags);
+        ret = radix_tree_insert(&shard->tree, thread_context->pid, thread_context);
+        spin_unlock_irqrestore(&shard->lock, flags);
 
         radix_tree_preload_end();
 
@@ -134,11 +164,12 @@ static void uvm_thread_context_user_release(void)
     UVM_ASSERT(thread_context->ref_count > 0);
 
     if (--thread_context->ref_count == 0) {
+        uvm_thread_context_shard_t *shard = thread_context_shard(thread_context->pid);
         uvm_thread_context_t *removed;
 
-        spin_lock_irqsave(&g_lock, flags);
-        removed = radix_tree_delete(&g_user_context_tree, thread_context->pid);
-        spin_unlock_irqrestore(&g_lock, flags);
+        spin_lock_irqsave(&shard->lock, flags);
+        removed = radix_tree_delete(&shard->tree, thread_context->pid);
+        spin_unlock_irqrestore(&shard->lock, flags);
 
         UVM_ASSERT(removed == thread_context);
         kmem_cache_free(g_uvm_thread_context_cache, removed);
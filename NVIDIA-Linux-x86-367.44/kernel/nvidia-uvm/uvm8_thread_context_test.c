@@ -0,0 +1,70 @@
+/*******************************************************************************
+    Copyright (c) 2016 NVIDIA Corporation
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to
+    deal in the Software without restriction, including without limitation the
+    rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+    sell copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+        The above copyright notice and this permission notice shall be
+        included in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+
+*******************************************************************************/
+
+#include "uvm8_thread_context.h"
+#include "uvm8_test.h"
+
+#define THREAD_CONTEXT_BENCHMARK_MAX_THREADS 256
+
+static NV_STATUS thread_context_benchmark_thread(void *arg, NvU32 thread_index)
+{
+    UVM_TEST_THREAD_CONTEXT_BENCHMARK_PARAMS *params = (UVM_TEST_THREAD_CONTEXT_BENCHMARK_PARAMS *)arg;
+    uvm_thread_context_t *thread_context = uvm_thread_context_retain();
+    NV_STATUS status = NV_OK;
+    NvU32 i;
+
+    if (!thread_context)
+        return NV_ERR_NO_MEMORY;
+
+    for (i = 0; i < params->num_lookups; ++i) {
+        if (uvm_thread_context() != thread_context) {
+            status = NV_ERR_INVALID_STATE;
+            break;
+        }
+    }
+
+    uvm_thread_context_release();
+
+    return status;
+}
+
+NV_STATUS uvm8_test_thread_context_benchmark(UVM_TEST_THREAD_CONTEXT_BENCHMARK_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status;
+
+    if (params->num_threads == 0 || params->num_threads > THREAD_CONTEXT_BENCHMARK_MAX_THREADS ||
+        params->num_lookups == 0)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    status = uvm_test_benchmark_run("uvm-ctx-bench",
+                                    params->num_threads,
+                                    thread_context_benchmark_thread,
+                                    NULL,
+                                    params,
+                                    &params->elapsed_ns);
+
+    params->lookups_per_sec = uvm_test_rate_per_sec((NvU64)params->num_threads * params->num_lookups,
+                                                    params->elapsed_ns);
+
+    return status;
+}
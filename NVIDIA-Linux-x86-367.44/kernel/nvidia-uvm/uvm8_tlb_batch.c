@@ -81,12 +81,12 @@ static void tlb_batch_flush_invalidate_all(uvm_tlb_batch_t *batch, uvm_push_t *p
     gpu->host_hal->tlb_invalidate_all(push, uvm_page_tree_pdb(tree)->addr, page_table_depth, batch->membar);
 }
 
-static bool tlb_batch_should_invalidate_all(uvm_tlb_batch_t *batch)
+bool uvm_tlb_batch_should_invalidate_all(uvm_tlb_batch_t *batch)
 {
     if (!batch->tree->gpu->tlb_batch.va_invalidate_supported)
         return true;
 
-    if (batch->count > UVM_TLB_BATCH_MAX_ENTRIES)
+    if (batch->count > min(batch->tree->gpu->tlb_batch.max_ranges, (NvU32)UVM_TLB_BATCH_MAX_ENTRIES))
         return true;
 
     if (batch->total_pages > batch->tree->gpu->tlb_batch.max_pages)
@@ -102,7 +102,7 @@ void uvm_tlb_batch_end(uvm_tlb_batch_t *batch, uvm_push_t *push, uvm_membar_t tl
 
     batch->membar = uvm_membar_max(tlb_membar, batch->membar);
 
-    if (tlb_batch_should_invalidate_all(batch))
+    if (uvm_tlb_batch_should_invalidate_all(batch))
         tlb_batch_flush_invalidate_all(batch, push);
     else
         tlb_batch_flush_invalidate_per_va(batch, push);
@@ -114,11 +114,24 @@ void uvm_tlb_batch_invalidate(uvm_tlb_batch_t *batch, NvU64 start, NvU64 size, N
 
     batch->membar = uvm_membar_max(tlb_membar, batch->membar);
 
-    ++batch->count;
     batch->total_pages += uvm_div_pow2_64(size, smallest_page_size(page_sizes));
     batch->biggest_page_size = max(batch->biggest_page_size, biggest_page_size(page_sizes));
 
-    if (tlb_batch_should_invalidate_all(batch))
+    // Extend the last range if the new one directly follows it. This keeps
+    // remaps of consecutive pages done one at a time using a single targeted
+    // invalidate.
+    if (batch->count > 0 && batch->count <= UVM_TLB_BATCH_MAX_ENTRIES) {
+        uvm_tlb_batch_range_t *last_entry = &batch->ranges[batch->count - 1];
+
+        if (last_entry->page_sizes == page_sizes && last_entry->start + last_entry->size == start) {
+            last_entry->size += size;
+            return;
+        }
+    }
+
+    ++batch->count;
+
+    if (uvm_tlb_batch_should_invalidate_all(batch))
         return;
 
     new_entry = &batch->ranges[batch->count - 1];
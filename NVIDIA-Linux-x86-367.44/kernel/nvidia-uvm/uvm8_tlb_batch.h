@@ -29,13 +29,13 @@
 #include "uvm8_mmu.h"
 #include "uvm8_push.h"
 
-// Max number of separate VA ranges to track before falling back to invalidate all.
-// TLB batches take space on the stack so this number should be big enough to
-// cover our common cases, but not bigger.
-//
-// TODO: Bug 1767241: Once we have all the paths using TLB invalidates
-//       implemented, verify whether it makes sense.
-#define UVM_TLB_BATCH_MAX_ENTRIES 4
+// Max number of separate VA ranges that can be tracked before falling back to
+// invalidate all. The number actually used is picked per GPU
+// (gpu->tlb_batch.max_ranges). Ranges directly following the last queued up
+// range with the same page sizes are merged into it and don't use up another
+// entry. TLB batches take space on the stack so this number should be big
+// enough to cover scattered remaps of a VA block, but not bigger.
+#define UVM_TLB_BATCH_MAX_ENTRIES 16
 
 typedef struct
 {
@@ -89,6 +89,10 @@ void uvm_tlb_batch_invalidate(uvm_tlb_batch_t *batch, NvU64 start, NvU64 size, N
 // batch.
 void uvm_tlb_batch_end(uvm_tlb_batch_t *batch, uvm_push_t *push, uvm_membar_t tlb_membar);
 
+// Query whether ending the batch would invalidate all instead of the queued up
+// ranges
+bool uvm_tlb_batch_should_invalidate_all(uvm_tlb_batch_t *batch);
+
 // Helper for invalidating a single range immediately.
 //
 // Internally begins and ends a TLB batch.
@@ -32,6 +32,7 @@
 #include "uvm8_push.h"
 #include "uvm8_forward_decl.h"
 #include "uvm8_range_group.h"
+#include "uvm8_test.h"
 
 // We limit the number of times a page can be retained by the kernel
 // to prevent the user from maliciously passing UVM tools the same page
@@ -46,8 +47,13 @@ typedef struct
     NvU32 put_behind;
 } uvm_tools_queue_snapshot_t;
 
+// Set in uvm_tools_queue_t::wakeup_get when it holds a valid get_ahead value
+#define UVM_TOOLS_WAKEUP_GET_VALID 0x80000000
+
 typedef struct
 {
+    // Protects the notification threshold updates. Events are enqueued
+    // without taking the lock, see enqueue_event().
     uvm_spinlock_t lock;
     NvU64 subscribed_queues;
     struct list_head queue_nodes[UvmEventNumTypes];
@@ -60,9 +66,29 @@ typedef struct
     struct page **control_buffer_pages;
     UvmToolsEventControlData *control;
 
+    // Kernel-private copies of the put pointer. put_reserved is the next
+    // entry to be reserved by a producer and put_committed is the next entry
+    // to be committed. Entries in between are being written.
+    atomic_t put_reserved;
+    atomic_t put_committed;
+
     wait_queue_head_t wait_queue;
-    bool is_wakeup_get_valid;
-    NvU32 wakeup_get;
+
+    // get_ahead value the consumer was last woken up for, ORed with
+    // UVM_TOOLS_WAKEUP_GET_VALID, or 0 if not valid
+    atomic_t wakeup_get;
+
+    // Wakeup coalescing, see UvmToolsSetNotificationCoalescing. The consumer
+    // is woken up at most once every notification_interval_ns unless at
+    // least urgent_threshold entries are pending. Wakeups within the
+    // interval are deferred to wakeup_timer.
+    NvU64 notification_interval_ns;
+    NvU32 urgent_threshold;
+    atomic64_t last_wakeup_ns;
+    struct timer_list wakeup_timer;
+
+    // Merge consecutive migration events for adjacent ranges into one entry
+    bool aggregate_migrations;
 } uvm_tools_queue_t;
 
 typedef struct
@@ -144,6 +170,12 @@ static struct cdev g_uvm_tools_cdev;
 static struct kmem_cache *g_tools_event_tracker_cache __read_mostly = NULL;
 static LIST_HEAD(g_tools_va_space_list);
 static uvm_rw_semaphore_t g_tools_va_space_list_lock;
+
+// Number of queues subscribed to each event type, across all VA spaces. Lets
+// broadcast events skip g_tools_va_space_list_lock when nobody listens.
+// Updated with g_tools_va_space_list_lock held for write.
+static atomic_t g_tools_queue_subscriptions[UvmEventNumTypes];
+
 static struct kmem_cache *g_tools_block_migration_data_cache __read_mostly = NULL;
 static struct kmem_cache *g_tools_migration_data_cache __read_mostly = NULL;
 static nv_kthread_q_t g_tools_queue;
@@ -260,18 +292,24 @@ fail:
     return status;
 }
 
+// If subscription_counts is not NULL, the per-list counts of subscribed
+// trackers are updated too.
 static void insert_event_tracker(struct list_head *node,
                                  NvU32 list_count,
                                  NvU64 list_mask,
                                  NvU64 *subscribed_mask,
-                                 struct list_head *lists)
+                                 struct list_head *lists,
+                                 atomic_t *subscription_counts)
 {
     NvU32 i;
     NvU64 insertable_lists = list_mask & ~*subscribed_mask;
 
     for (i = 0; i < list_count; i++) {
-        if (insertable_lists & (1ULL << i))
+        if (insertable_lists & (1ULL << i)) {
             list_add(node + i, lists + i);
+            if (subscription_counts)
+                atomic_inc(subscription_counts + i);
+        }
     }
 
     *subscribed_mask |= list_mask;
@@ -280,13 +318,17 @@ static void insert_event_tracker(struct list_head *node,
 static void remove_event_tracker(struct list_head *node,
                                  NvU32 list_count,
                                  NvU64 list_mask,
-                                 NvU64 *subscribed_mask)
+                                 NvU64 *subscribed_mask,
+                                 atomic_t *subscription_counts)
 {
     NvU32 i;
     NvU64 removable_lists = list_mask & *subscribed_mask;
     for (i = 0; i < list_count; i++) {
-        if (removable_lists & (1ULL << i))
+        if (removable_lists & (1ULL << i)) {
             list_del(node + i);
+            if (subscription_counts)
+                atomic_dec(subscription_counts + i);
+        }
     }
 
     *subscribed_mask &= ~list_mask;
@@ -296,10 +338,62 @@ static bool queue_needs_wakeup(uvm_tools_queue_t *queue, uvm_tools_queue_snapsho
 {
     NvU32 queue_mask = queue->queue_buffer_count - 1;
 
-    uvm_assert_spinlock_locked(&queue->lock);
     return ((queue->queue_buffer_count + sn->put_behind - sn->get_ahead) & queue_mask) >= queue->notification_threshold;
 }
 
+static void queue_wakeup_timer(unsigned long data)
+{
+    uvm_tools_queue_t *queue = (uvm_tools_queue_t *)data;
+    NvU32 queue_mask = queue->queue_buffer_count - 1;
+    NvU32 get_ahead = atomic_read((atomic_t *)&queue->control->get_ahead);
+
+    atomic64_set(&queue->last_wakeup_ns, NV_GETTIME());
+    atomic_set(&queue->wakeup_get, UVM_TOOLS_WAKEUP_GET_VALID | (get_ahead & queue_mask));
+    wake_up_all(&queue->wait_queue);
+}
+
+static void queue_init_wakeup_coalescing(uvm_tools_queue_t *queue)
+{
+    // Coalescing is disabled until UvmToolsSetNotificationCoalescing is called
+    queue->notification_interval_ns = 0;
+    atomic64_set(&queue->last_wakeup_ns, 0);
+
+    init_timer(&queue->wakeup_timer);
+    queue->wakeup_timer.function = queue_wakeup_timer;
+    queue->wakeup_timer.data = (unsigned long)queue;
+}
+
+// Returns true if waking up the consumer has been deferred to
+// queue->wakeup_timer because it was woken up less than the notification
+// interval ago and the queue is not filled up to the urgent threshold.
+static bool queue_defer_wakeup(uvm_tools_queue_t *queue, uvm_tools_queue_snapshot_t *sn)
+{
+    NvU32 queue_mask = queue->queue_buffer_count - 1;
+    NvU64 interval_ns = UVM_READ_ONCE(queue->notification_interval_ns);
+    NvU64 elapsed_ns;
+
+    if (interval_ns == 0)
+        return false;
+
+    // Pairs with the smp_wmb() in uvm_api_tools_set_notification_coalescing()
+    smp_rmb();
+
+    if (((queue->queue_buffer_count + sn->put_behind - sn->get_ahead) & queue_mask) >= UVM_READ_ONCE(queue->urgent_threshold))
+        return false;
+
+    elapsed_ns = NV_GETTIME() - atomic64_read(&queue->last_wakeup_ns);
+    if (elapsed_ns >= interval_ns)
+        return false;
+
+    if (!timer_pending(&queue->wakeup_timer)) {
+        unsigned long delay = usecs_to_jiffies((unsigned)div_u64(interval_ns - elapsed_ns, 1000));
+
+        mod_timer(&queue->wakeup_timer, jiffies + max(delay, 1UL));
+    }
+
+    return true;
+}
+
 static void destroy_event_tracker(uvm_tools_event_tracker_t *event_tracker)
 {
     if (event_tracker->uvm_file != NULL) {
@@ -315,7 +409,11 @@ static void destroy_event_tracker(uvm_tools_event_tracker_t *event_tracker)
             remove_event_tracker(queue->queue_nodes,
                                  UvmEventNumTypes,
                                  queue->subscribed_queues,
-                                 &queue->subscribed_queues);
+                                 &queue->subscribed_queues,
+                                 g_tools_queue_subscriptions);
+
+            // No more events can be enqueued, so the timer cannot be re-armed
+            del_timer_sync(&queue->wakeup_timer);
 
             if (queue->queue != NULL) {
                 unmap_user_pages(queue->queue_buffer_pages,
@@ -335,7 +433,8 @@ static void destroy_event_tracker(uvm_tools_event_tracker_t *event_tracker)
             remove_event_tracker(counters->counter_nodes,
                                  UVM_TOTAL_COUNTERS,
                                  counters->subscribed_counters,
-                                 &counters->subscribed_counters);
+                                 &counters->subscribed_counters,
+                                 NULL);
 
             if (counters->counters != NULL) {
                 unmap_user_pages(counters->counter_buffer_pages,
@@ -356,45 +455,87 @@ static void destroy_event_tracker(uvm_tools_event_tracker_t *event_tracker)
     kmem_cache_free(g_tools_event_tracker_cache, event_tracker);
 }
 
+// Events can be enqueued by multiple producers concurrently without locking.
+// A producer reserves an entry by advancing queue->put_reserved, writes it,
+// and then commits it once all the previous reservations have been committed,
+// so that the put pointers seen by the consumer only cover fully written
+// entries. Preemption is disabled between the reservation and the commit so
+// that producers never wait for a preempted one.
 static void enqueue_event(UvmEventEntry *entry, uvm_tools_queue_t *queue)
 {
     UvmToolsEventControlData *ctrl = queue->control;
     uvm_tools_queue_snapshot_t sn;
     NvU32 queue_size = queue->queue_buffer_count;
     NvU32 queue_mask = queue_size - 1;
+    NvU32 put;
+    NvU32 reserved_put;
+    bool needs_wakeup;
 
-    uvm_spin_lock(&queue->lock);
+    preempt_disable();
 
-    // ctrl is mapped into user space with read and write permissions,
-    // so its values cannot be trusted.
-    sn.get_behind = atomic_read((atomic_t *)&ctrl->get_behind) & queue_mask;
-    sn.put_behind = atomic_read((atomic_t *)&ctrl->put_behind) & queue_mask;
-    sn.put_ahead = (sn.put_behind + 1) & queue_mask;
+    put = atomic_read(&queue->put_reserved);
+    do {
+        reserved_put = put;
 
-    // one free element means that the queue is full
-    if (((queue_size + sn.get_behind - sn.put_behind) & queue_mask) == 1) {
-        atomic64_inc((atomic64_t *)&ctrl->dropped + entry->eventData.eventType);
-        goto unlock;
-    }
+        // ctrl is mapped into user space with read and write permissions,
+        // so its values cannot be trusted.
+        sn.get_behind = atomic_read((atomic_t *)&ctrl->get_behind) & queue_mask;
+
+        // one free element means that the queue is full
+        if (((queue_size + sn.get_behind - reserved_put) & queue_mask) == 1) {
+            atomic64_inc((atomic64_t *)&ctrl->dropped + entry->eventData.eventType);
+            preempt_enable();
+            return;
+        }
+
+        put = atomic_cmpxchg(&queue->put_reserved, reserved_put, (reserved_put + 1) & queue_mask);
+    } while (put != reserved_put);
 
-    memcpy(queue->queue + sn.put_behind, entry, sizeof(*entry));
+    memcpy(queue->queue + reserved_put, entry, sizeof(*entry));
 
-    sn.put_behind = sn.put_ahead;
-    // put_ahead and put_behind will always be the same outside of queue->lock
+    sn.put_behind = (reserved_put + 1) & queue_mask;
+    sn.put_ahead = sn.put_behind;
+
+    // Wait for the producers that reserved the previous entries to commit
+    while (atomic_read(&queue->put_committed) != reserved_put)
+        cpu_relax();
+
+    // Acquire the previous producer's commit, so that the put pointer updates
+    // below are ordered after its own, and make sure the entry is written
+    // before it is published to the consumer. Both need a full barrier as the
+    // read of put_committed has to be ordered with the stores that follow.
+    smp_mb();
+
+    // put_ahead and put_behind are always the same when the consumer observes them.
     // this allows the user-space consumer to choose either a 2 or 4 pointer synchronization approach
     atomic_set((atomic_t *)&ctrl->put_ahead, sn.put_behind);
     atomic_set((atomic_t *)&ctrl->put_behind, sn.put_behind);
 
+    // Let the next producer commit only after the put pointers have been
+    // updated, so that they never move backwards
+    smp_mb();
+    atomic_set(&queue->put_committed, sn.put_behind);
+
     sn.get_ahead = atomic_read((atomic_t *)&ctrl->get_ahead);
+    needs_wakeup = queue_needs_wakeup(queue, &sn);
+
+    preempt_enable();
+
     // if the queue needs to be woken up, only signal if we haven't signaled before for this value of get_ahead
-    if (queue_needs_wakeup(queue, &sn) && !(queue->is_wakeup_get_valid && queue->wakeup_get == sn.get_ahead)) {
-        queue->is_wakeup_get_valid = true;
-        queue->wakeup_get = sn.get_ahead;
-        wake_up_all(&queue->wait_queue);
-    }
+    if (needs_wakeup) {
+        NvU32 wakeup_get = UVM_TOOLS_WAKEUP_GET_VALID | (sn.get_ahead & queue_mask);
 
-unlock:
-    uvm_spin_unlock(&queue->lock);
+        if (atomic_read(&queue->wakeup_get) == wakeup_get)
+            return;
+
+        if (queue_defer_wakeup(queue, &sn))
+            return;
+
+        if (atomic_xchg(&queue->wakeup_get, wakeup_get) != wakeup_get) {
+            atomic64_set(&queue->last_wakeup_ns, NV_GETTIME());
+            wake_up_all(&queue->wait_queue);
+        }
+    }
 }
 
 static void uvm_tools_record_event(uvm_va_space_t *va_space, UvmEventEntry *entry)
@@ -410,10 +551,34 @@ static void uvm_tools_record_event(uvm_va_space_t *va_space, UvmEventEntry *entr
         enqueue_event(entry, queue);
 }
 
+// Like uvm_tools_record_event, but only records the migration event in the
+// queues whose aggregate_migrations setting matches aggregated
+static void uvm_tools_record_migration_event(uvm_va_space_t *va_space, UvmEventEntry *entry, bool aggregated)
+{
+    uvm_tools_queue_t *queue;
+
+    UVM_ASSERT(entry->eventData.eventType == UvmEventTypeMigration);
+
+    uvm_assert_rwsem_locked(&va_space->perf_events.lock);
+
+    list_for_each_entry(queue, va_space->tools.queues + UvmEventTypeMigration, queue_nodes[UvmEventTypeMigration]) {
+        if (UVM_READ_ONCE(queue->aggregate_migrations) == aggregated)
+            enqueue_event(entry, queue);
+    }
+}
+
+static bool tools_is_event_subscribed(UvmEventType event_type)
+{
+    return atomic_read(&g_tools_queue_subscriptions[event_type]) > 0;
+}
+
 static void uvm_tools_broadcast_event(UvmEventEntry *entry)
 {
     uvm_va_space_t *va_space;
 
+    if (!tools_is_event_subscribed(entry->eventData.eventType))
+        return;
+
     uvm_down_read(&g_tools_va_space_list_lock);
     list_for_each_entry(va_space, &g_tools_va_space_list, tools.node) {
         uvm_down_read(&va_space->perf_events.lock);
@@ -489,6 +654,7 @@ static long uvm_tools_unlocked_ioctl(struct file *filp, unsigned int cmd, unsign
     switch (cmd) {
         UVM_ROUTE_CMD_STACK(UVM_TOOLS_INIT_EVENT_TRACKER,         uvm_api_tools_init_event_tracker);
         UVM_ROUTE_CMD_STACK(UVM_TOOLS_SET_NOTIFICATION_THRESHOLD, uvm_api_tools_set_notification_threshold);
+        UVM_ROUTE_CMD_STACK(UVM_TOOLS_SET_NOTIFICATION_COALESCING, uvm_api_tools_set_notification_coalescing);
         UVM_ROUTE_CMD_STACK(UVM_TOOLS_EVENT_QUEUE_ENABLE_EVENTS,  uvm_api_tools_event_queue_enable_events);
         UVM_ROUTE_CMD_STACK(UVM_TOOLS_EVENT_QUEUE_DISABLE_EVENTS, uvm_api_tools_event_queue_disable_events);
         UVM_ROUTE_CMD_STACK(UVM_TOOLS_ENABLE_COUNTERS,            uvm_api_tools_enable_counters);
@@ -513,7 +679,7 @@ static unsigned int uvm_tools_poll(struct file *filp, poll_table *wait)
 
     uvm_spin_lock(&event_tracker->queue.lock);
 
-    event_tracker->queue.is_wakeup_get_valid = false;
+    atomic_set(&event_tracker->queue.wakeup_get, 0);
     ctrl = event_tracker->queue.control;
     sn.get_ahead = atomic_read((atomic_t *)&ctrl->get_ahead);
     sn.put_behind = atomic_read((atomic_t *)&ctrl->put_behind);
@@ -665,6 +831,8 @@ void record_migration_events(void *args)
     migration_data_t *next;
     UvmEventEntry entry;
     UvmEventMigrationInfo *info = &entry.eventData.migration;
+    UvmEventEntry aggregated_entry;
+    UvmEventMigrationInfo *aggregated_info = &aggregated_entry.eventData.migration;
     uvm_va_space_t *va_space = block_mig->va_space;
 
     NvU64 gpu_timestamp = block_mig->start_timestamp_gpu;
@@ -679,6 +847,7 @@ void record_migration_events(void *args)
     info->endTimeStamp = block_mig->end_timestamp_cpu;
     info->rangeGroupId = block_mig->range_group_id;
     info->migrationCause = block_mig->cause;
+    aggregated_info->migratedBytes = 0;
 
     uvm_down_read(&va_space->perf_events.lock);
     list_for_each_entry_safe(mig, next, &block_mig->events, events_node) {
@@ -694,8 +863,25 @@ void record_migration_events(void *args)
         gpu_timestamp = mig->end_timestamp_gpu;
         kmem_cache_free(g_tools_migration_data_cache, mig);
 
-        uvm_tools_record_event(block_mig->va_space, &entry);
+        uvm_tools_record_migration_event(va_space, &entry, false);
+
+        // Queues aggregating migrations get a single event for each run of
+        // migrations covering adjacent ranges
+        if (aggregated_info->migratedBytes > 0 &&
+            aggregated_info->address + aggregated_info->migratedBytes == info->address) {
+            aggregated_info->migratedBytes += info->migratedBytes;
+            aggregated_info->endTimeStampGpu = info->endTimeStampGpu;
+        }
+        else {
+            if (aggregated_info->migratedBytes > 0)
+                uvm_tools_record_migration_event(va_space, &aggregated_entry, true);
+
+            aggregated_entry = entry;
+        }
     }
+
+    if (aggregated_info->migratedBytes > 0)
+        uvm_tools_record_migration_event(va_space, &aggregated_entry, true);
     uvm_up_read(&va_space->perf_events.lock);
 
     uvm_spin_lock(&va_space->tools.channel_list_lock);
@@ -819,6 +1005,10 @@ void uvm_tools_broadcast_replay(uvm_gpu_id_t gpu_id, NvU32 batch_id)
 {
     UvmEventEntry entry;
     UvmEventGpuFaultReplayInfo *info = &entry.eventData.gpuFaultReplay;
+
+    if (!tools_is_event_subscribed(UvmEventTypeGpuFaultReplay))
+        return;
+
     memset(&entry, 0, sizeof(entry));
 
     info->eventType = UvmEventTypeGpuFaultReplay;
@@ -1129,6 +1319,7 @@ NV_STATUS uvm_api_tools_init_event_tracker(UVM_TOOLS_INIT_EVENT_TRACKER_PARAMS *
         uvm_tools_queue_t *queue = &event_tracker->queue;
         uvm_spin_lock_init(&queue->lock, UVM_LOCK_ORDER_LEAF);
         init_waitqueue_head(&queue->wait_queue);
+        queue_init_wakeup_coalescing(queue);
 
         if (params->queueBufferSize > UINT_MAX) {
             status = NV_ERR_INVALID_ARGUMENT;
@@ -1158,6 +1349,11 @@ NV_STATUS uvm_api_tools_init_event_tracker(UVM_TOOLS_INIT_EVENT_TRACKER_PARAMS *
 
         if (status != NV_OK)
             goto fail;
+
+        // Start producing where the consumer expects it
+        atomic_set(&queue->put_reserved,
+                   atomic_read((atomic_t *)&queue->control->put_behind) & (queue->queue_buffer_count - 1));
+        atomic_set(&queue->put_committed, atomic_read(&queue->put_reserved));
     }
     else {
         uvm_tools_counter_t *counter = &event_tracker->counter;
@@ -1208,6 +1404,48 @@ NV_STATUS uvm_api_tools_set_notification_threshold(UVM_TOOLS_SET_NOTIFICATION_TH
     return NV_OK;
 }
 
+NV_STATUS uvm_api_tools_set_notification_coalescing(UVM_TOOLS_SET_NOTIFICATION_COALESCING_PARAMS *params,
+                                                     struct file *filp)
+{
+    uvm_tools_queue_t *queue;
+    uvm_tools_event_tracker_t *event_tracker = tools_event_tracker(filp);
+
+    if (!tracker_is_queue(event_tracker))
+        return NV_ERR_INVALID_ARGUMENT;
+
+    if (params->urgentThresholdPercent > 100)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    if (params->flags & ~UVM_TOOLS_NOTIFICATION_COALESCING_FLAGS_ALL)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    queue = &event_tracker->queue;
+
+    uvm_spin_lock(&queue->lock);
+
+    // An urgent threshold of 0% never bypasses the interval, as the queue
+    // can hold at most queue_buffer_count - 1 entries
+    if (params->urgentThresholdPercent == 0)
+        queue->urgent_threshold = queue->queue_buffer_count;
+    else
+        queue->urgent_threshold = (NvU32)div_u64((NvU64)queue->queue_buffer_count * params->urgentThresholdPercent, 100);
+
+    queue->aggregate_migrations = !!(params->flags & UVM_TOOLS_NOTIFICATION_COALESCING_FLAG_AGGREGATE_MIGRATIONS);
+
+    // Publish the interval last so that enqueue_event() never coalesces
+    // with a stale urgent threshold
+    smp_wmb();
+    queue->notification_interval_ns = (NvU64)params->notificationIntervalUs * 1000;
+
+    uvm_spin_unlock(&queue->lock);
+
+    // Deliver any wakeup deferred with the previous interval right away
+    if (params->notificationIntervalUs == 0 && del_timer_sync(&queue->wakeup_timer))
+        queue_wakeup_timer((unsigned long)queue);
+
+    return NV_OK;
+}
+
 static NV_STATUS tools_register_perf_events(uvm_va_space_t *va_space)
 {
     NV_STATUS status;
@@ -1296,7 +1534,8 @@ NV_STATUS uvm_api_tools_event_queue_enable_events(UVM_TOOLS_EVENT_QUEUE_ENABLE_E
                          UvmEventNumTypes,
                          params->eventTypeFlags,
                          &event_tracker->queue.subscribed_queues,
-                         va_space->tools.queues);
+                         va_space->tools.queues,
+                         g_tools_queue_subscriptions);
 
     // perform any necessary registration
     status = tools_update_status(va_space);
@@ -1323,7 +1562,8 @@ NV_STATUS uvm_api_tools_event_queue_disable_events(UVM_TOOLS_EVENT_QUEUE_DISABLE
     remove_event_tracker(event_tracker->queue.queue_nodes,
                          UvmEventNumTypes,
                          params->eventTypeFlags,
-                         &event_tracker->queue.subscribed_queues);
+                         &event_tracker->queue.subscribed_queues,
+                         g_tools_queue_subscriptions);
 
     // de-registration should not fail
     status = tools_update_status(va_space);
@@ -1351,7 +1591,8 @@ NV_STATUS uvm_api_tools_enable_counters(UVM_TOOLS_ENABLE_COUNTERS_PARAMS *params
                          UVM_TOTAL_COUNTERS,
                          params->counterTypeFlags,
                          &event_tracker->counter.subscribed_counters,
-                         va_space->tools.counters);
+                         va_space->tools.counters,
+                         NULL);
 
     status = tools_update_status(va_space);
 
@@ -1377,7 +1618,8 @@ NV_STATUS uvm_api_tools_disable_counters(UVM_TOOLS_DISABLE_COUNTERS_PARAMS *para
     remove_event_tracker(event_tracker->counter.counter_nodes,
                          UVM_TOTAL_COUNTERS,
                          params->counterTypeFlags,
-                         &event_tracker->counter.subscribed_counters);
+                         &event_tracker->counter.subscribed_counters,
+                         NULL);
 
     // de-registration should not fail
     status = tools_update_status(va_space);
@@ -1530,6 +1772,168 @@ NV_STATUS uvm8_test_increment_tools_counter(UVM_TEST_INCREMENT_TOOLS_COUNTER_PAR
     return NV_OK;
 }
 
+#define TOOLS_ENQUEUE_BENCHMARK_MAX_PRODUCERS 16
+#define TOOLS_ENQUEUE_BENCHMARK_MAX_QUEUE_SIZE (1024 * 1024)
+
+typedef struct
+{
+    uvm_tools_queue_t *queue;
+    NvU32 num_events;
+    bool enqueue;
+    UVM_TEST_TOOLS_ENQUEUE_BENCHMARK_PARAMS *params;
+    NvU32 next_batch_ids[TOOLS_ENQUEUE_BENCHMARK_MAX_PRODUCERS];
+} tools_enqueue_benchmark_t;
+
+static NV_STATUS tools_enqueue_benchmark_producer(void *arg, NvU32 producer_id)
+{
+    tools_enqueue_benchmark_t *bench = (tools_enqueue_benchmark_t *)arg;
+    NvU32 i;
+
+    for (i = 0; i < bench->num_events; ++i) {
+        UvmEventEntry entry;
+        UvmEventGpuFaultReplayInfo *info = &entry.eventData.gpuFaultReplay;
+
+        // Without a tracer attached, events are skipped by the subscription
+        // check like in uvm_tools_broadcast_replay()
+        if (!bench->enqueue && !tools_is_event_subscribed(UvmEventTypeGpuFaultReplay))
+            continue;
+
+        memset(&entry, 0, sizeof(entry));
+        info->eventType = UvmEventTypeGpuFaultReplay;
+        info->gpuIndex  = producer_id;
+        info->batchId   = i;
+        info->timeStamp = NV_GETTIME();
+
+        if (bench->enqueue)
+            enqueue_event(&entry, bench->queue);
+    }
+
+    return NV_OK;
+}
+
+// Consume the events available in the queue, checking that the events of
+// each producer are seen in order.
+static NV_STATUS tools_enqueue_benchmark_consume(void *arg)
+{
+    tools_enqueue_benchmark_t *bench = (tools_enqueue_benchmark_t *)arg;
+    uvm_tools_queue_t *queue = bench->queue;
+    UvmToolsEventControlData *ctrl = queue->control;
+    NvU32 queue_mask = queue->queue_buffer_count - 1;
+    NvU32 get = atomic_read((atomic_t *)&ctrl->get_behind);
+    NvU32 put = atomic_read((atomic_t *)&ctrl->put_behind);
+
+    // Read the entries after the put pointer
+    smp_rmb();
+
+    for (; get != put; get = (get + 1) & queue_mask) {
+        UvmEventGpuFaultReplayInfo *info = &queue->queue[get].eventData.gpuFaultReplay;
+
+        if (info->eventType != UvmEventTypeGpuFaultReplay ||
+            info->gpuIndex >= TOOLS_ENQUEUE_BENCHMARK_MAX_PRODUCERS ||
+            info->batchId < bench->next_batch_ids[info->gpuIndex])
+            return NV_ERR_INVALID_STATE;
+
+        bench->next_batch_ids[info->gpuIndex] = info->batchId + 1;
+        ++bench->params->events_consumed;
+    }
+
+    // Finish reading the entries before handing them back to the producers
+    smp_mb();
+    atomic_set((atomic_t *)&ctrl->get_ahead, get);
+    atomic_set((atomic_t *)&ctrl->get_behind, get);
+
+    return NV_OK;
+}
+
+static NV_STATUS tools_enqueue_benchmark_run(uvm_tools_queue_t *queue,
+                                             bool enqueue,
+                                             UVM_TEST_TOOLS_ENQUEUE_BENCHMARK_PARAMS *params,
+                                             NvU64 *elapsed_ns)
+{
+    tools_enqueue_benchmark_t bench;
+
+    memset(&bench, 0, sizeof(bench));
+    bench.queue = queue;
+    bench.num_events = params->num_events;
+    bench.enqueue = enqueue;
+    bench.params = params;
+
+    // Consume concurrently with the producers
+    return uvm_test_benchmark_run("uvm-tools-bench",
+                                  params->num_producers,
+                                  tools_enqueue_benchmark_producer,
+                                  enqueue && params->consume ? tools_enqueue_benchmark_consume : NULL,
+                                  &bench,
+                                  elapsed_ns);
+}
+
+NV_STATUS uvm8_test_tools_enqueue_benchmark(UVM_TEST_TOOLS_ENQUEUE_BENCHMARK_PARAMS *params, struct file *filp)
+{
+    NV_STATUS status;
+    uvm_tools_queue_t *queue = NULL;
+    NvU64 total_events;
+    NvU32 i;
+
+    if (params->num_producers == 0 || params->num_producers > TOOLS_ENQUEUE_BENCHMARK_MAX_PRODUCERS ||
+        params->num_events == 0 ||
+        !is_power_of_2(params->queue_size) || params->queue_size < 2 ||
+        params->queue_size > TOOLS_ENQUEUE_BENCHMARK_MAX_QUEUE_SIZE)
+        return NV_ERR_INVALID_ARGUMENT;
+
+    queue = uvm_kvmalloc_zero(sizeof(*queue));
+    if (!queue) {
+        status = NV_ERR_NO_MEMORY;
+        goto done;
+    }
+
+    // The queue is not mapped to user space, so it only gets the events
+    // enqueued by the benchmark
+    uvm_spin_lock_init(&queue->lock, UVM_LOCK_ORDER_LEAF);
+    init_waitqueue_head(&queue->wait_queue);
+    queue_init_wakeup_coalescing(queue);
+    queue->queue_buffer_count = params->queue_size;
+    queue->notification_threshold = params->queue_size / 2;
+    queue->queue = uvm_kvmalloc_zero(params->queue_size * sizeof(*queue->queue));
+    queue->control = uvm_kvmalloc_zero(sizeof(*queue->control));
+    if (!queue->queue || !queue->control) {
+        status = NV_ERR_NO_MEMORY;
+        goto done;
+    }
+
+    params->events_consumed = 0;
+
+    status = tools_enqueue_benchmark_run(queue, false, params, &params->no_tracer_ns);
+    if (status != NV_OK)
+        goto done;
+
+    status = tools_enqueue_benchmark_run(queue, true, params, &params->tracer_ns);
+    if (status != NV_OK)
+        goto done;
+
+    params->events_dropped = 0;
+    for (i = 0; i < UvmEventNumTypes; ++i)
+        params->events_dropped += queue->control->dropped[i];
+
+    total_events = (NvU64)params->num_events * params->num_producers;
+
+    // Every event is either dropped or left in the queue
+    if (!params->consume) {
+        params->events_consumed = (atomic_read((atomic_t *)&queue->control->put_behind) -
+                                   atomic_read((atomic_t *)&queue->control->get_behind)) & (params->queue_size - 1);
+    }
+
+    TEST_CHECK_GOTO(params->events_consumed + params->events_dropped == total_events, done);
+
+done:
+    if (queue) {
+        uvm_kvfree(queue->queue);
+        uvm_kvfree(queue->control);
+    }
+    uvm_kvfree(queue);
+
+    return status;
+}
+
 NV_STATUS uvm_api_tools_get_processor_uuid_table(UVM_TOOLS_GET_PROCESSOR_UUID_TABLE_PARAMS *params, struct file *filp)
 {
     NvProcessorUuid *uuids;
@@ -46,6 +46,11 @@ static int uvm_fault_force_sysmem = 0;
 module_param(uvm_fault_force_sysmem, int, S_IRUGO|S_IWUSR);
 MODULE_PARM_DESC(uvm_fault_force_sysmem, "Force (1) using sysmem storage for pages that faulted. Default: 0.");
 
+static int uvm_va_block_cpu_huge_pages = 0;
+module_param(uvm_va_block_cpu_huge_pages, int, S_IRUGO);
+MODULE_PARM_DESC(uvm_va_block_cpu_huge_pages, "Back (1) the CPU pages of whole VA blocks with a single compound "
+                 "page, falling back to separate pages on failure. Default: 0.");
+
 static struct kmem_cache *g_uvm_va_block_cache __read_mostly;
 static struct kmem_cache *g_uvm_va_block_gpu_state_cache __read_mostly;
 static struct kmem_cache *g_uvm_page_mask_cache __read_mostly;
@@ -471,6 +476,37 @@ static uvm_va_block_region_t block_gpu_chunk_region(uvm_va_block_t *block,
     return uvm_va_block_region(first, first + (chunk_size / PAGE_SIZE));
 }
 
+// Report accesses to the chunks backing the given pages on the GPU to PMM, so
+// that they are taken into account when picking chunks for eviction.
+static void block_mark_gpu_chunks_accessed(uvm_va_block_t *block,
+                                           uvm_gpu_t *gpu,
+                                           const unsigned long *page_mask,
+                                           uvm_va_block_region_t region)
+{
+    uvm_va_block_gpu_state_t *gpu_state = block->gpus[gpu->id - 1];
+    uvm_gpu_chunk_t *last_chunk = NULL;
+    size_t page_index;
+
+    if (!gpu_state || !uvm_gpu_supports_eviction(gpu))
+        return;
+
+    for_each_va_block_page_in_mask(page_index, page_mask, region) {
+        uvm_chunk_size_t chunk_size;
+        size_t chunk_index = block_gpu_chunk_index(block, gpu, page_index, &chunk_size);
+        uvm_gpu_chunk_t *chunk = gpu_state->chunks[chunk_index];
+
+        // Subchunks of the same root chunk are usually contiguous in the block,
+        // only report each root chunk once per run
+        if (chunk && (!last_chunk || !uvm_gpu_chunk_same_root(chunk, last_chunk))) {
+            uvm_pmm_gpu_mark_root_chunk_accessed(&gpu->pmm, chunk);
+            last_chunk = chunk;
+        }
+
+        // Skip the rest of the pages in the chunk
+        page_index = block_gpu_chunk_region(block, chunk_size, page_index).outer - 1;
+    }
+}
+
 uvm_gpu_chunk_t *uvm_va_block_lookup_gpu_chunk(uvm_va_block_t *va_block, uvm_gpu_t *gpu, NvU64 address)
 {
     size_t chunk_index;
@@ -566,6 +602,47 @@ error:
     return NULL;
 }
 
+// Back all the CPU pages of a full-size VA block with a single zeroed compound
+// page. This saves one allocation per page and makes the CPU memory of the
+// block physically contiguous, so copies to and from it can be coalesced (see
+// block_copy_resident_pages_between). The allocation is only attempted while
+// no CPU page has been populated yet, so blocks that fall back to order-0 pages
+// do not retry it.
+//
+// The compound page is reference counted as a whole, so the individual pages
+// are never freed on their own and can still be inserted into the CPU page
+// tables one by one with vm_insert_page.
+static NV_STATUS block_populate_huge_page_cpu(uvm_va_block_t *block)
+{
+    struct page *page;
+    size_t page_index;
+    gfp_t gfp_flags = NV_UVM_GFP_FLAGS | GFP_HIGHUSER | __GFP_ZERO | __GFP_COMP | __GFP_NOWARN;
+
+    if (!uvm_va_block_cpu_huge_pages || uvm_va_block_size(block) != UVM_VA_BLOCK_SIZE)
+        return NV_ERR_NOT_SUPPORTED;
+
+    if (block->cpu.pages_populated)
+        return NV_ERR_NOT_SUPPORTED;
+
+    UVM_ASSERT(!block->cpu.huge_page);
+
+    page = alloc_pages(gfp_flags, UVM_VA_BLOCK_BITS - PAGE_SHIFT);
+    if (!page)
+        return NV_ERR_NO_MEMORY;
+
+    // The kernel has 'written' zeros to the pages. The dirty state of all the
+    // pages in a compound page is tracked in its head page.
+    SetPageDirty(page);
+
+    for (page_index = 0; page_index < PAGES_PER_UVM_VA_BLOCK; page_index++)
+        block->cpu.pages[page_index] = page + page_index;
+
+    block->cpu.huge_page = page;
+    block->cpu.pages_populated = true;
+
+    return NV_OK;
+}
+
 // Allocates the input page in the block, if it doesn't already exist
 static NV_STATUS block_populate_page_cpu(uvm_va_block_t *block, size_t page_index, bool zero)
 {
@@ -577,6 +654,11 @@ static NV_STATUS block_populate_page_cpu(uvm_va_block_t *block, size_t page_inde
 
     UVM_ASSERT(!test_bit(page_index, block->cpu.resident));
 
+    // Fall back to a separate page if the block cannot be backed by a compound
+    // page, for example due to fragmentation
+    if (block_populate_huge_page_cpu(block) == NV_OK)
+        return NV_OK;
+
     gfp_flags = NV_UVM_GFP_FLAGS | GFP_HIGHUSER;
     if (zero)
         gfp_flags |= __GFP_ZERO;
@@ -590,6 +672,7 @@ static NV_STATUS block_populate_page_cpu(uvm_va_block_t *block, size_t page_inde
         SetPageDirty(page);
 
     block->cpu.pages[page_index] = page;
+    block->cpu.pages_populated = true;
     return NV_OK;
 }
 
@@ -1665,9 +1748,12 @@ static bool block_page_is_clean(uvm_va_block_t *block,
                                 uvm_processor_id_t src_id,
                                 size_t page_index)
 {
+    // Pages of a compound page share the dirty bit of the head page, so they
+    // are never considered clean
     return dst_id == block->va_range->preferred_location &&
            src_id == UVM_CPU_ID &&
            !uvm_gpu_get(dst_id)->handling_replayable_faults &&
+           !block->cpu.huge_page &&
            !PageDirty(block->cpu.pages[page_index]);
 }
 
@@ -1682,7 +1768,9 @@ static void block_update_page_dirty_state(uvm_va_block_t *block,
     if (dst_id != UVM_CPU_ID)
         return;
 
-    if (src_id == block->va_range->preferred_location)
+    // Clearing the shared dirty bit of a compound page would make the rest of
+    // its pages look clean, too
+    if (src_id == block->va_range->preferred_location && !block->cpu.huge_page)
         ClearPageDirty(block->cpu.pages[page_index]);
     else
         SetPageDirty(block->cpu.pages[page_index]);
@@ -1744,6 +1832,52 @@ typedef enum
     BLOCK_TRANSFER_MODE_INTERNAL_COPY_FROM_STAGE = 6
 } block_transfer_mode_internal_t;
 
+// Moves to and from a staging processor are still moves: the pages do not
+// remain resident on the source
+static uvm_va_block_transfer_mode_t get_block_transfer_mode_from_internal(block_transfer_mode_internal_t transfer_mode)
+{
+    switch (transfer_mode) {
+        case BLOCK_TRANSFER_MODE_INTERNAL_MOVE:
+        case BLOCK_TRANSFER_MODE_INTERNAL_MOVE_TO_STAGE:
+        case BLOCK_TRANSFER_MODE_INTERNAL_MOVE_FROM_STAGE:
+            return UVM_VA_BLOCK_TRANSFER_MODE_MOVE;
+
+        case BLOCK_TRANSFER_MODE_INTERNAL_COPY:
+        case BLOCK_TRANSFER_MODE_INTERNAL_COPY_TO_STAGE:
+        case BLOCK_TRANSFER_MODE_INTERNAL_COPY_FROM_STAGE:
+            return UVM_VA_BLOCK_TRANSFER_MODE_COPY;
+    }
+
+    UVM_ASSERT_MSG(0, "Invalid transfer mode %u\n", transfer_mode);
+    return UVM_VA_BLOCK_TRANSFER_MODE_MOVE;
+}
+
+// Whether next is the address that immediately follows the size bytes starting
+// at base, in the same aperture
+static bool block_gpu_address_is_next(uvm_gpu_address_t base, size_t size, uvm_gpu_address_t next)
+{
+    return base.is_virtual == next.is_virtual &&
+           base.aperture == next.aperture &&
+           base.address + size == next.address;
+}
+
+// Push a copy of pages that are contiguous in both the source and the
+// destination. All copies but the first one in a push are pipelined.
+static void block_copy_push_contig(uvm_push_t *push,
+                                   uvm_gpu_address_t dst_address,
+                                   uvm_gpu_address_t src_address,
+                                   size_t size,
+                                   bool first_copy)
+{
+    uvm_gpu_t *copying_gpu = uvm_push_get_gpu(push);
+
+    if (!first_copy)
+        uvm_push_set_flag(push, UVM_PUSH_FLAG_CE_NEXT_PIPELINED);
+
+    uvm_push_set_flag(push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
+    copying_gpu->ce_hal->memcopy(push, dst_address, src_address, size);
+}
+
 // Copies pages resident on the src_id processor to the dst_id processor
 //
 // Acquires the block's tracker and adds all of its pushes to the copy_tracker.
@@ -1765,6 +1899,10 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
     uvm_gpu_t *copying_gpu = NULL;
     uvm_gpu_address_t src_address;
     uvm_gpu_address_t dst_address;
+    uvm_gpu_address_t copy_src_address = {0};
+    uvm_gpu_address_t copy_dst_address = {0};
+    size_t copy_size = 0;
+    bool first_copy = true;
     uvm_push_t push;
     size_t page_index;
     size_t contig_start_index = region.outer;
@@ -1860,15 +1998,31 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
 
             uvm_perf_event_notify(&block->va_range->va_space->perf_events, UVM_PERF_EVENT_BLOCK_MIGRATION_BEGIN, &event_data);
         }
-        else {
-            uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_PIPELINED);
-        }
 
         block_update_page_dirty_state(block, dst_id, src_id, page_index);
 
         src_address = block_phys_page_copy_address(block, block_phys_page(src_id, page_index), copying_gpu);
         dst_address = block_phys_page_copy_address(block, block_phys_page(dst_id, page_index), copying_gpu);
 
+        // Pages that are physically contiguous in both the source and the
+        // destination, like the ones in large GPU chunks or in CPU compound
+        // pages, are copied with a single transfer
+        if (copy_size > 0 &&
+            (page_index != last_index + 1 ||
+             !block_gpu_address_is_next(copy_src_address, copy_size, src_address) ||
+             !block_gpu_address_is_next(copy_dst_address, copy_size, dst_address))) {
+            block_copy_push_contig(&push, copy_dst_address, copy_src_address, copy_size, first_copy);
+            first_copy = false;
+            copy_size = 0;
+        }
+
+        if (copy_size == 0) {
+            copy_src_address = src_address;
+            copy_dst_address = dst_address;
+        }
+
+        copy_size += PAGE_SIZE;
+
         if (last_index == region.outer) {
             contig_start_index = page_index;
         }
@@ -1885,7 +2039,7 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
                             .address       = uvm_va_block_region_start(block, contig_region),
                             .bytes         = uvm_va_block_region_size(contig_region),
                             .cause         = cause,
-                            .transfer_mode = transfer_mode
+                            .transfer_mode = get_block_transfer_mode_from_internal(transfer_mode)
                         }
                 };
 
@@ -1894,9 +2048,6 @@ static NV_STATUS block_copy_resident_pages_between(uvm_va_block_t *block,
             contig_start_index = page_index;
         }
 
-        uvm_push_set_flag(&push, UVM_PUSH_FLAG_CE_NEXT_MEMBAR_NONE);
-        copying_gpu->ce_hal->memcopy(&push, dst_address, src_address, PAGE_SIZE);
-
         last_index = page_index;
 
 update_bits:
@@ -1929,6 +2080,9 @@ update_bits:
     if (!copying_gpu)
         return status;
 
+    if (copy_size > 0)
+        block_copy_push_contig(&push, copy_dst_address, copy_src_address, copy_size, first_copy);
+
     {
         uvm_va_block_region_t contig_region = uvm_va_block_region(contig_start_index, last_index + 1);
         uvm_perf_event_data_t event_data =
@@ -1942,8 +2096,7 @@ update_bits:
                         .address       = uvm_va_block_region_start(block, contig_region),
                         .bytes         = uvm_va_block_region_size(contig_region),
                         .cause         = cause,
-                        .transfer_mode = transfer_mode
-
+                        .transfer_mode = get_block_transfer_mode_from_internal(transfer_mode)
                     }
             };
 
@@ -5759,6 +5912,12 @@ static NV_STATUS uvm_va_block_map_gpu_to(uvm_va_block_t *va_block,
 
     uvm_push_end(&push);
 
+    if (resident_id != UVM_CPU_ID)
+        block_mark_gpu_chunks_accessed(va_block,
+                                       uvm_gpu_get(resident_id),
+                                       pages_to_map,
+                                       uvm_va_block_region_from_block(va_block));
+
     // If we are mapping remotely, record the event
     if (va_space->tools.enabled && resident_id != gpu->id && cause != UvmEventMapRemoteCauseInvalid) {
         uvm_va_block_region_t subregion, region = uvm_va_block_region_from_block(va_block);
@@ -6567,15 +6726,24 @@ static void block_kill(uvm_va_block_t *block)
 
     // Free CPU pages
     if (block->cpu.pages) {
-        for (i = 0; i < uvm_va_block_num_cpu_pages(block); i++) {
-            if (block->cpu.pages[i]) {
-                // be conservative.
-                // Tell the OS we wrote to the page because we sometimes clear the dirty bit after writing to it.
-                SetPageDirty(block->cpu.pages[i]);
-                __free_page(block->cpu.pages[i]);
-            }
-            else {
-                UVM_ASSERT(!test_bit(i, block->cpu.resident));
+        // Pages of a compound page are released all at once by dropping the
+        // block's reference on it
+        if (block->cpu.huge_page) {
+            SetPageDirty(block->cpu.huge_page);
+            put_page(block->cpu.huge_page);
+            block->cpu.huge_page = NULL;
+        }
+        else {
+            for (i = 0; i < uvm_va_block_num_cpu_pages(block); i++) {
+                if (block->cpu.pages[i]) {
+                    // be conservative.
+                    // Tell the OS we wrote to the page because we sometimes clear the dirty bit after writing to it.
+                    SetPageDirty(block->cpu.pages[i]);
+                    __free_page(block->cpu.pages[i]);
+                }
+                else {
+                    UVM_ASSERT(!test_bit(i, block->cpu.resident));
+                }
             }
         }
 
@@ -7054,6 +7222,15 @@ static void uvm_va_block_split_cpu(uvm_va_block_t *existing, uvm_va_block_t *new
            &existing->cpu.pages[existing_pages],
            uvm_va_block_num_cpu_pages(new) * sizeof(new->cpu.pages[0]));
 
+    // Both blocks keep pointing into the compound page, if any, so each of them
+    // needs its own reference
+    if (existing->cpu.huge_page) {
+        get_page(existing->cpu.huge_page);
+        new->cpu.huge_page = existing->cpu.huge_page;
+    }
+
+    new->cpu.pages_populated = existing->cpu.pages_populated;
+
     // Attempt to shrink existing's pages allocation. If the realloc fails, just
     // keep on using the old larger one.
     temp_pages = uvm_kvrealloc(existing->cpu.pages, existing_pages * sizeof(existing->cpu.pages[0]));
@@ -7971,6 +8148,13 @@ NV_STATUS uvm_va_block_service_faults_locked(uvm_processor_id_t processor_id, uv
         if (status != NV_OK)
             goto done;
 
+        if (new_residency != UVM_CPU_ID) {
+            block_mark_gpu_chunks_accessed(va_block,
+                                           uvm_gpu_get(new_residency),
+                                           service_context->per_processor_masks[new_residency].new_residency,
+                                           service_context->fault_region);
+        }
+
         if (prefetch_hint.residency != UVM8_MAX_PROCESSORS) {
             UVM_ASSERT(prefetch_hint.residency == new_residency);
             UVM_ASSERT(prefetch_hint.prefetch_pages_mask != NULL);
@@ -8334,6 +8518,56 @@ done:
     return status == NV_OK ? tracker_status : status;
 }
 
+// Add the pages around the faulting CPU page that are resident on other
+// processors to the fault service context, so that they are migrated to and
+// mapped on the CPU by the same fault instead of faulting one by one. Pages
+// that are thrashing or not resident anywhere are left alone. Fault-around
+// pages get the prefetch access type and follow the same read duplication
+// policy as the pages prefetched by uvm_va_block_service_faults_locked.
+static void block_cpu_fault_around(uvm_va_block_t *va_block,
+                                   NvU64 fault_addr,
+                                   uvm_fault_service_block_context_t *service_context)
+{
+    uvm_va_range_t *va_range = va_block->va_range;
+    uvm_va_space_t *va_space = va_range->va_space;
+    uvm_va_block_region_t fault_region = service_context->fault_region;
+    uvm_va_block_region_t around_region = uvm_perf_prefetch_cpu_fault_around_region(va_block, fault_addr);
+    const unsigned long *cpu_resident_mask = uvm_va_block_resident_mask_get(va_block, UVM_CPU_ID);
+    const unsigned long *thrashing_pages = uvm_perf_thrashing_get_thrashing_pages(va_block);
+    unsigned long *new_residency_mask = service_context->per_processor_masks[UVM_CPU_ID].new_residency;
+    size_t page_index;
+
+    if (uvm_va_block_region_num_pages(around_region) <= 1)
+        return;
+
+    for_each_va_block_page_in_region(page_index, around_region) {
+        if (page_index == fault_region.first)
+            continue;
+
+        if (test_bit(page_index, cpu_resident_mask) || !block_is_page_resident_anywhere(va_block, page_index))
+            continue;
+
+        if (thrashing_pages && test_bit(page_index, thrashing_pages))
+            continue;
+
+        __set_bit(page_index, new_residency_mask);
+        service_context->fault_access_type[page_index] = UVM_FAULT_ACCESS_TYPE_PREFETCH;
+
+        if ((va_range->read_duplication == UVM_READ_DUPLICATION_ENABLED &&
+             uvm_va_space_can_read_duplicate(va_space, NULL)) ||
+            (va_range->read_duplication != UVM_READ_DUPLICATION_DISABLED &&
+             test_bit(page_index, va_block->read_duplicated_pages))) {
+            if (service_context->read_duplicate_count++ == 0)
+                uvm_page_mask_zero(service_context->read_duplicate_mask);
+
+            __set_bit(page_index, service_context->read_duplicate_mask);
+        }
+    }
+
+    service_context->fault_region.first = min(fault_region.first, around_region.first);
+    service_context->fault_region.outer = max(fault_region.outer, around_region.outer);
+}
+
 static NV_STATUS block_cpu_fault_locked(uvm_va_block_t *va_block,
                                         NvU64 fault_addr,
                                         uvm_fault_access_type_t fault_access_type,
@@ -8418,6 +8652,10 @@ static NV_STATUS block_cpu_fault_locked(uvm_va_block_t *va_block,
 
     service_context->fault_region = region;
 
+    // Pinned pages are serviced on their own
+    if (thrashing_hint.type == UVM_PERF_THRASHING_HINT_TYPE_NONE)
+        block_cpu_fault_around(va_block, fault_addr, service_context);
+
     status = uvm_va_block_service_faults_locked(UVM_CPU_ID, va_block, NULL, service_context);
 
     ++service_context->num_retries;
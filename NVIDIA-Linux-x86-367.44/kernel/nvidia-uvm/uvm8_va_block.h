@@ -333,6 +333,17 @@ struct uvm_va_block_struct
         // track CPU PFNs for the same reason.
         struct page **pages;
 
+        // Head of the compound page backing all the entries of pages, or NULL
+        // if they are separate order-0 allocations. Blocks split from a block
+        // backed by a compound page share it, and each of them holds a
+        // reference on it. See uvm_va_block_cpu_huge_pages.
+        struct page *huge_page;
+
+        // Whether any entry of pages has been populated. CPU pages are only
+        // freed when the block is destroyed, so this tells in O(1) whether a
+        // compound page can still back the whole block.
+        bool pages_populated;
+
         // Per-page mapping bit vectors, one per bit we need to track. These are
         // used for fast traversal of valid mappings in the block. These contain
         // all non-address bits needed to establish a virtual mapping on this
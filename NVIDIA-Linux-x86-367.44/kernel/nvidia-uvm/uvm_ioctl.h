@@ -967,6 +967,114 @@ typedef struct
     NV_STATUS rmStatus;                    // OUT
 } UVM_CLEAN_UP_ZOMBIE_RESOURCES_PARAMS;
 
+//
+// UvmToolsSetNotificationCoalescing
+//
+#define UVM_TOOLS_SET_NOTIFICATION_COALESCING                         UVM_IOCTL_BASE(70)
+
+#define UVM_TOOLS_NOTIFICATION_COALESCING_FLAG_AGGREGATE_MIGRATIONS   0x1
+#define UVM_TOOLS_NOTIFICATION_COALESCING_FLAGS_ALL                   0x1
+
+typedef struct
+{
+    NvU32     notificationIntervalUs;                      // IN
+    NvU32     urgentThresholdPercent;                      // IN
+    NvU32     flags;                                       // IN
+    NV_STATUS rmStatus;                                    // OUT
+} UVM_TOOLS_SET_NOTIFICATION_COALESCING_PARAMS;
+
+//
+// UvmMigrateBatch
+//
+// Performs the equivalent of one UVM_MIGRATE call per entry, but takes the
+// driver locks once and tracks all the migrations together. flags,
+// semaphoreAddress and semaphorePayload follow the UVM_MIGRATE semantics and
+// apply to the batch as a whole: if UVM_MIGRATE_FLAG_ASYNC is 0 the ioctl
+// returns once all the migrations are done, otherwise the semaphore (if any) is
+// released once when all of them are complete.
+//
+// The status of each migration is written to the rmStatus field of its entry.
+// A failing entry does not prevent the remaining entries from being migrated.
+// The top-level rmStatus is the status of the first entry that did not return
+// NV_OK, and the semaphore is only released if all entries returned NV_OK.
+// Entries that were not attempted because the batch failed early report
+// NV_ERR_BUSY_RETRY.
+//
+#define UVM_MIGRATE_BATCH                                             UVM_IOCTL_BASE(71)
+
+#define UVM_MIGRATE_BATCH_MAX_ENTRIES                                 4096
+
+typedef struct
+{
+    NvU64           base               NV_ALIGN_BYTES(8); // IN
+    NvU64           length             NV_ALIGN_BYTES(8); // IN
+    NvProcessorUuid destinationUuid;                      // IN
+    NV_STATUS       rmStatus;                             // OUT
+} UVM_MIGRATE_BATCH_ENTRY;
+
+typedef struct
+{
+    NvU64           entries            NV_ALIGN_BYTES(8); // IN/OUT: UVM_MIGRATE_BATCH_ENTRY array
+    NvU32           numEntries;                           // IN
+    NvU32           flags;                                // IN
+    NvU64           semaphoreAddress   NV_ALIGN_BYTES(8); // IN
+    NvU32           semaphorePayload;                     // IN
+    NV_STATUS       rmStatus;                             // OUT
+} UVM_MIGRATE_BATCH_PARAMS;
+
+//
+// UvmGetVaBlockHeatmap
+//
+// Returns a snapshot of the access and migration counters of the VA blocks
+// within [base, base + length). Only blocks with at least one recorded event
+// are returned. Per-processor counters are indexed by the processor indices of
+// UVM_TOOLS_GET_PROCESSOR_UUID_TABLE. Counters saturate instead of wrapping.
+//
+// At most numEntries entries are written. On return numEntries holds the
+// number of entries written and nextAddress the address at which a subsequent
+// call must start to continue the walk, which is base + length once all the
+// blocks in the range have been reported.
+//
+// If UVM_VA_BLOCK_HEATMAP_FLAG_RESET is set, the counters of the reported
+// blocks are discarded after being read. Those blocks are not reported again
+// until new activity is recorded on them.
+//
+// prefetchHitPages counts the prefetched pages that the processor they were
+// prefetched to later faulted on. Accesses that don't fault are not counted.
+//
+// The snapshot is not atomic across blocks: each block is sampled under its
+// own lock while the rest of the VA space keeps running.
+//
+#define UVM_GET_VA_BLOCK_HEATMAP                                      UVM_IOCTL_BASE(72)
+
+#define UVM_VA_BLOCK_HEATMAP_MAX_ENTRIES                              1024
+
+#define UVM_VA_BLOCK_HEATMAP_FLAG_RESET                               0x1
+#define UVM_VA_BLOCK_HEATMAP_FLAGS_ALL                                0x1
+
+typedef struct
+{
+    NvU64     start                              NV_ALIGN_BYTES(8); // OUT
+    NvU64     end                                NV_ALIGN_BYTES(8); // OUT, inclusive
+    NvU32     faults[UVM_MAX_PROCESSORS];                           // OUT
+    NvU32     pagesMigratedIn[UVM_MAX_PROCESSORS];                  // OUT
+    NvU32     pagesMigratedOut[UVM_MAX_PROCESSORS];                 // OUT
+    NvU32     thrashingPages;                                       // OUT
+    NvU32     pinnedPages;                                          // OUT
+    NvU32     prefetchHitPages;                                     // OUT
+} UVM_VA_BLOCK_HEATMAP_ENTRY;
+
+typedef struct
+{
+    NvU64     base                               NV_ALIGN_BYTES(8); // IN
+    NvU64     length                             NV_ALIGN_BYTES(8); // IN
+    NvU64     entries                            NV_ALIGN_BYTES(8); // IN: UVM_VA_BLOCK_HEATMAP_ENTRY array
+    NvU32     numEntries;                                           // IN/OUT
+    NvU32     flags;                                                // IN
+    NvU64     nextAddress                        NV_ALIGN_BYTES(8); // OUT
+    NV_STATUS rmStatus;                                             // OUT
+} UVM_GET_VA_BLOCK_HEATMAP_PARAMS;
+
 //
 // Temporary ioctls which should be removed before UVM 8 release
 // Number backwards from 2047 - highest custom ioctl function number
@@ -56,8 +56,15 @@ static int nvidia_p2p_map_status(NV_STATUS status)
     return error;
 }
 
+//
+// RM always hands out 64KB pages; 2MB is only ever reported for v2 page
+// tables whose extents happen to be 2MB aligned and sized.
+//
+#define NVIDIA_P2P_PAGESIZE_HUGE_2M (2 << 20)
+
 static NvU32 nvidia_p2p_page_size_mappings[NVIDIA_P2P_PAGE_SIZE_COUNT] = {
-    NVRM_P2P_PAGESIZE_SMALL_4K, NVRM_P2P_PAGESIZE_BIG_64K, NVRM_P2P_PAGESIZE_BIG_128K
+    NVRM_P2P_PAGESIZE_SMALL_4K, NVRM_P2P_PAGESIZE_BIG_64K, NVRM_P2P_PAGESIZE_BIG_128K,
+    NVIDIA_P2P_PAGESIZE_HUGE_2M
 };
 
 static NV_STATUS nvidia_p2p_map_page_size(NvU32 page_size, NvU32 *page_size_index)
@@ -524,4 +531,596 @@ int nvidia_p2p_free_dma_mapping(
 
 EXPORT_SYMBOL(nvidia_p2p_free_dma_mapping);
 
+//
+// Merge the per-page arrays returned by RM into extents. Pages are merged
+// when they are physically contiguous and share the same request registers.
+// If extents is NULL, only the number of extents is returned.
+//
+static NvU32 nvidia_p2p_build_extents(
+    struct nvidia_p2p_extent *extents,
+    NvU64 *physical_addresses,
+    NvU32 *wreqmb_h,
+    NvU32 *rreqmb_h,
+    NvU32 entries,
+    NvU32 page_size
+)
+{
+    struct nvidia_p2p_extent extent;
+    NvU32 count = 0;
+    NvU32 i;
+
+    memset(&extent, 0, sizeof(extent));
+
+    for (i = 0; i < entries; i++)
+    {
+        if ((count != 0) &&
+            (extent.physical_address + extent.length == physical_addresses[i]) &&
+            (extent.registers.fermi.wreqmb_h == wreqmb_h[i]) &&
+            (extent.registers.fermi.rreqmb_h == rreqmb_h[i]))
+        {
+            extent.length += page_size;
+            continue;
+        }
+
+        if ((count != 0) && (extents != NULL))
+            extents[count - 1] = extent;
+
+        memset(&extent, 0, sizeof(extent));
+        extent.physical_address = physical_addresses[i];
+        extent.length = page_size;
+        extent.registers.fermi.wreqmb_h = wreqmb_h[i];
+        extent.registers.fermi.rreqmb_h = rreqmb_h[i];
+        count++;
+    }
+
+    if ((count != 0) && (extents != NULL))
+        extents[count - 1] = extent;
+
+    return count;
+}
+
+//
+// Merge the per-page DMA addresses returned by RM into segments. If segments
+// is NULL, only the number of segments is returned.
+//
+static NvU32 nvidia_p2p_build_dma_segments(
+    struct nvidia_p2p_dma_segment *segments,
+    NvU64 *dma_addresses,
+    NvU32 page_count,
+    NvU32 page_size
+)
+{
+    struct nvidia_p2p_dma_segment segment;
+    NvU32 count = 0;
+    NvU32 i;
+
+    memset(&segment, 0, sizeof(segment));
+
+    for (i = 0; i < page_count; i++)
+    {
+        if ((count != 0) &&
+            (segment.dma_address + segment.length == dma_addresses[i]))
+        {
+            segment.length += page_size;
+            continue;
+        }
+
+        if ((count != 0) && (segments != NULL))
+            segments[count - 1] = segment;
+
+        segment.dma_address = dma_addresses[i];
+        segment.length = page_size;
+        count++;
+    }
+
+    if ((count != 0) && (segments != NULL))
+        segments[count - 1] = segment;
+
+    return count;
+}
+
+//
+// Return the number of RM pages of size page_size covered by the extents of
+// a v2 page table.
+//
+static NvU32 nvidia_p2p_page_table_v2_page_count(
+    struct nvidia_p2p_page_table_v2 *page_table,
+    NvU32 page_size
+)
+{
+    NvU64 length;
+    NvU32 page_count = 0;
+    NvU32 i;
+
+    for (i = 0; i < page_table->entries; i++)
+    {
+        length = page_table->extents[i].length;
+        do_div(length, page_size);
+        page_count += length;
+    }
+
+    return page_count;
+}
+
+int nvidia_p2p_get_pages_v2(
+    uint64_t p2p_token,
+    uint32_t va_space,
+    uint64_t virtual_address,
+    uint64_t length,
+    uint32_t flags,
+    struct nvidia_p2p_page_table_v2 **page_table,
+    void (*free_callback)(void * data),
+    void *data
+)
+{
+    NV_STATUS status;
+    nvidia_stack_t *sp = NULL;
+    struct nvidia_p2p_page_table_v2 *table = NULL;
+    NvU32 entries;
+    NvU32 *wreqmb_h = NULL;
+    NvU32 *rreqmb_h = NULL;
+    NvU64 *physical_addresses = NULL;
+    NvU32 page_count;
+    NvU32 extent_count;
+    NvU32 i;
+    NvBool bGetPages = NV_FALSE;
+    NvU32 page_size = NVRM_P2P_PAGESIZE_BIG_64K;
+    NvU32 extent_page_size;
+    NvU32 page_size_index;
+    NvU64 temp_length;
+    NvU8 *gpu_uuid = NULL;
+    int rc;
+
+    if ((page_table == NULL) || (length == 0) ||
+        (flags & ~NVIDIA_P2P_GET_PAGES_FLAGS_PAGE_SIZE_2MB))
+    {
+        return -EINVAL;
+    }
+
+    if (flags & NVIDIA_P2P_GET_PAGES_FLAGS_PAGE_SIZE_2MB)
+        extent_page_size = NVIDIA_P2P_PAGESIZE_HUGE_2M;
+    else
+        extent_page_size = page_size;
+
+    if ((virtual_address | length) & (extent_page_size - 1))
+        return -EINVAL;
+
+    *page_table = NULL;
+
+    rc = nv_kmem_cache_alloc_stack(&sp);
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    //
+    // RM identifies the mapping by the page table pointer, so the table
+    // header has to exist before the extent count is known; the extents go
+    // into a single separate array sized once RM has returned the pages.
+    //
+    status = os_alloc_mem((void **)&table, sizeof(*table));
+    if (status != NV_OK)
+    {
+        goto failed;
+    }
+    memset(table, 0, sizeof(*table));
+
+    //asign length to temporary variable since do_div macro does in-place division
+    temp_length = length;
+    do_div(temp_length, page_size);
+    page_count = temp_length;
+
+    status = os_alloc_mem((void **)&physical_addresses,
+            (page_count * sizeof(NvU64)));
+    if (status != NV_OK)
+    {
+        goto failed;
+    }
+    status = os_alloc_mem((void **)&wreqmb_h, (page_count * sizeof(NvU32)));
+    if (status != NV_OK)
+    {
+        goto failed;
+    }
+    status = os_alloc_mem((void **)&rreqmb_h, (page_count * sizeof(NvU32)));
+    if (status != NV_OK)
+    {
+        goto failed;
+    }
+
+    status = rm_p2p_get_pages(sp, p2p_token, va_space,
+            virtual_address, length, physical_addresses, wreqmb_h,
+            rreqmb_h, &entries, &gpu_uuid, table,
+            free_callback, data);
+    if (status != NV_OK)
+    {
+        goto failed;
+    }
+
+    bGetPages = NV_TRUE;
+
+    if ((entries == 0) || (entries > page_count))
+    {
+        status = NV_ERR_INVALID_STATE;
+        goto failed;
+    }
+
+    extent_count = nvidia_p2p_build_extents(NULL, physical_addresses,
+            wreqmb_h, rreqmb_h, entries, page_size);
+
+    status = os_alloc_mem((void **)&table->extents,
+            (extent_count * sizeof(*table->extents)));
+    if (status != NV_OK)
+    {
+        goto failed;
+    }
+
+    nvidia_p2p_build_extents(table->extents, physical_addresses,
+            wreqmb_h, rreqmb_h, entries, page_size);
+
+    for (i = 0; i < extent_count; i++)
+    {
+        if ((table->extents[i].physical_address |
+             table->extents[i].length) & (extent_page_size - 1))
+        {
+            status = NV_ERR_NOT_SUPPORTED;
+            goto failed;
+        }
+    }
+
+    status = nvidia_p2p_map_page_size(extent_page_size, &page_size_index);
+    if (status != NV_OK)
+    {
+        goto failed;
+    }
+
+    table->version = NVIDIA_P2P_PAGE_TABLE_V2_VERSION;
+    table->page_size = page_size_index;
+    table->entries = extent_count;
+    table->gpu_uuid = gpu_uuid;
+
+    *page_table = table;
+
+    os_free_mem(physical_addresses);
+    os_free_mem(wreqmb_h);
+    os_free_mem(rreqmb_h);
+
+    nv_kmem_cache_free_stack(sp);
+
+    return 0;
+
+failed:
+    if (physical_addresses != NULL)
+    {
+        os_free_mem(physical_addresses);
+    }
+    if (wreqmb_h != NULL)
+    {
+        os_free_mem(wreqmb_h);
+    }
+    if (rreqmb_h != NULL)
+    {
+        os_free_mem(rreqmb_h);
+    }
+
+    if (bGetPages)
+    {
+        rm_p2p_put_pages(sp, p2p_token, va_space, virtual_address,
+                gpu_uuid, table);
+    }
+
+    if (table != NULL)
+    {
+        if (table->extents != NULL)
+        {
+            os_free_mem(table->extents);
+        }
+        os_free_mem(table);
+    }
+
+    nv_kmem_cache_free_stack(sp);
+
+    return nvidia_p2p_map_status(status);
+}
+
+EXPORT_SYMBOL(nvidia_p2p_get_pages_v2);
+
+int nvidia_p2p_free_page_table_v2(struct nvidia_p2p_page_table_v2 *page_table)
+{
+    if (page_table == NULL)
+        return -EINVAL;
+
+    if (page_table->extents != NULL)
+        os_free_mem(page_table->extents);
+    os_free_mem(page_table);
+
+    return 0;
+}
+
+EXPORT_SYMBOL(nvidia_p2p_free_page_table_v2);
+
+int nvidia_p2p_put_pages_v2(
+    uint64_t p2p_token,
+    uint32_t va_space,
+    uint64_t virtual_address,
+    struct nvidia_p2p_page_table_v2 *page_table
+)
+{
+    NV_STATUS status;
+    nvidia_stack_t *sp = NULL;
+    int rc;
+
+    if (page_table == NULL)
+        return -EINVAL;
+
+    rc = nv_kmem_cache_alloc_stack(&sp);
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    status = rm_p2p_put_pages(sp, p2p_token, va_space, virtual_address,
+            page_table->gpu_uuid, page_table);
+    if (status == NV_OK)
+        nvidia_p2p_free_page_table_v2(page_table);
+
+    nv_kmem_cache_free_stack(sp);
+
+    return nvidia_p2p_map_status(status);
+}
+
+EXPORT_SYMBOL(nvidia_p2p_put_pages_v2);
+
+int nvidia_p2p_dma_map_pages_v2(
+    struct pci_dev *peer,
+    struct nvidia_p2p_page_table_v2 *page_table,
+    struct nvidia_p2p_dma_mapping_v2 **dma_mapping
+)
+{
+    NV_STATUS status;
+    nv_linux_state_t *peer_nvl = NULL;
+    nvidia_stack_t *sp = NULL;
+    struct nvidia_p2p_dma_mapping_v2 *mapping = NULL;
+    NvU64 *dma_addresses = NULL;
+    NvU64 offset;
+    NvU32 page_count;
+    NvU32 segment_count;
+    NvU32 page_size = NVRM_P2P_PAGESIZE_BIG_64K;
+    NvU32 segment_page_size;
+    NvBool bMapped = NV_FALSE;
+    NvU32 i, j;
+    int rc;
+
+    if (peer == NULL || page_table == NULL || dma_mapping == NULL ||
+        page_table->gpu_uuid == NULL)
+    {
+        return -EINVAL;
+    }
+
+    if ((page_table->version != NVIDIA_P2P_PAGE_TABLE_V2_VERSION) ||
+        (page_table->page_size <= NVIDIA_P2P_PAGE_SIZE_4KB) ||
+        (page_table->page_size >= NVIDIA_P2P_PAGE_SIZE_COUNT))
+    {
+        return -EINVAL;
+    }
+
+    *dma_mapping = NULL;
+
+    rc = nv_kmem_cache_alloc_stack(&sp);
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    //
+    // RM maps and unmaps at its own page granularity, so expand the extents
+    // into per-page addresses for the call and merge the results back into
+    // segments afterwards.
+    //
+    page_count = nvidia_p2p_page_table_v2_page_count(page_table, page_size);
+
+    status = os_alloc_mem((void **)&dma_addresses,
+            (page_count * sizeof(NvU64)));
+    if (status != NV_OK)
+    {
+        goto failed;
+    }
+
+    for (i = 0, j = 0; i < page_table->entries; i++)
+    {
+        for (offset = 0; offset < page_table->extents[i].length;
+             offset += page_size)
+        {
+            dma_addresses[j++] = page_table->extents[i].physical_address +
+                                 offset;
+        }
+    }
+
+    status = os_alloc_mem((void **)&peer_nvl, sizeof(nv_linux_state_t));
+    if (status != NV_OK)
+    {
+        goto failed;
+    }
+
+    peer_nvl->dev = peer;
+
+    status = rm_p2p_dma_map_pages(sp, NV_STATE_PTR(peer_nvl),
+            page_table->gpu_uuid, page_table,
+            page_size, page_count, dma_addresses);
+    if (status != NV_OK)
+    {
+        goto failed;
+    }
+
+    bMapped = NV_TRUE;
+
+    segment_count = nvidia_p2p_build_dma_segments(NULL, dma_addresses,
+            page_count, page_size);
+
+    status = os_alloc_mem((void **)&mapping, sizeof(*mapping) +
+            (segment_count * sizeof(*mapping->segments)));
+    if (status != NV_OK)
+    {
+        goto failed;
+    }
+    memset(mapping, 0, sizeof(*mapping));
+
+    mapping->segments = (struct nvidia_p2p_dma_segment *)(mapping + 1);
+    nvidia_p2p_build_dma_segments(mapping->segments, dma_addresses,
+            page_count, page_size);
+
+    // Report the page table's granularity if the IOMMU preserved it.
+    segment_page_size =
+        nvidia_p2p_page_size_mappings[page_table->page_size];
+    for (i = 0; i < segment_count; i++)
+    {
+        if ((mapping->segments[i].dma_address |
+             mapping->segments[i].length) & (segment_page_size - 1))
+        {
+            segment_page_size = page_size;
+            break;
+        }
+    }
+
+    status = nvidia_p2p_map_page_size(segment_page_size,
+            &mapping->page_size_type);
+    if (status != NV_OK)
+    {
+        goto failed;
+    }
+
+    mapping->version = NVIDIA_P2P_DMA_MAPPING_V2_VERSION;
+    mapping->entries = segment_count;
+
+    *dma_mapping = mapping;
+
+failed:
+    if ((status != NV_OK) && bMapped)
+    {
+        rm_p2p_dma_unmap_pages(sp, NV_STATE_PTR(peer_nvl),
+                page_size, page_count, dma_addresses);
+    }
+
+    nv_kmem_cache_free_stack(sp);
+    if (peer_nvl != NULL)
+    {
+        os_free_mem(peer_nvl);
+    }
+    if (dma_addresses != NULL)
+    {
+        os_free_mem(dma_addresses);
+    }
+    if ((status != NV_OK) && (mapping != NULL))
+    {
+        os_free_mem(mapping);
+    }
+
+    return nvidia_p2p_map_status(status);
+}
+
+EXPORT_SYMBOL(nvidia_p2p_dma_map_pages_v2);
+
+int nvidia_p2p_dma_unmap_pages_v2(
+    struct pci_dev *peer,
+    struct nvidia_p2p_page_table_v2 *page_table,
+    struct nvidia_p2p_dma_mapping_v2 *dma_mapping
+)
+{
+    NV_STATUS status;
+    nv_linux_state_t *peer_nvl = NULL;
+    nvidia_stack_t *sp = NULL;
+    NvU64 *dma_addresses = NULL;
+    NvU64 length;
+    NvU64 offset;
+    NvU32 page_count = 0;
+    NvU32 page_size = NVRM_P2P_PAGESIZE_BIG_64K;
+    NvU32 i, j;
+    int rc;
+
+    if (peer == NULL || page_table == NULL || dma_mapping == NULL ||
+        page_table->version != NVIDIA_P2P_PAGE_TABLE_V2_VERSION ||
+        dma_mapping->version != NVIDIA_P2P_DMA_MAPPING_V2_VERSION)
+    {
+        return -EINVAL;
+    }
+
+    rc = nv_kmem_cache_alloc_stack(&sp);
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    for (i = 0; i < dma_mapping->entries; i++)
+    {
+        length = dma_mapping->segments[i].length;
+        do_div(length, page_size);
+        page_count += length;
+    }
+
+    // Segments are DMA contiguous, so they expand back into the exact
+    // per-page addresses RM handed out.
+    status = os_alloc_mem((void **)&dma_addresses,
+            (page_count * sizeof(NvU64)));
+    if (status != NV_OK)
+    {
+        goto failed;
+    }
+
+    for (i = 0, j = 0; i < dma_mapping->entries; i++)
+    {
+        for (offset = 0; offset < dma_mapping->segments[i].length;
+             offset += page_size)
+        {
+            dma_addresses[j++] = dma_mapping->segments[i].dma_address +
+                                 offset;
+        }
+    }
+
+    status = os_alloc_mem((void **)&peer_nvl, sizeof(nv_linux_state_t));
+    if (status != NV_OK)
+    {
+        goto failed;
+    }
+
+    peer_nvl->dev = peer;
+
+    status = rm_p2p_dma_unmap_pages(sp, NV_STATE_PTR(peer_nvl),
+            page_size, page_count, dma_addresses);
+    if (status == NV_OK)
+    {
+        nvidia_p2p_free_dma_mapping_v2(dma_mapping);
+    }
+
+failed:
+    nv_kmem_cache_free_stack(sp);
+    if (peer_nvl != NULL)
+    {
+        os_free_mem(peer_nvl);
+    }
+    if (dma_addresses != NULL)
+    {
+        os_free_mem(dma_addresses);
+    }
+
+    return nvidia_p2p_map_status(status);
+}
+
+EXPORT_SYMBOL(nvidia_p2p_dma_unmap_pages_v2);
+
+int nvidia_p2p_free_dma_mapping_v2(
+    struct nvidia_p2p_dma_mapping_v2 *dma_mapping
+)
+{
+    if (dma_mapping == NULL)
+    {
+        return -EINVAL;
+    }
+
+    // The segments live in the same allocation as the mapping.
+    os_free_mem(dma_mapping);
+
+    return 0;
+}
+
+EXPORT_SYMBOL(nvidia_p2p_free_dma_mapping_v2);
+
 #endif
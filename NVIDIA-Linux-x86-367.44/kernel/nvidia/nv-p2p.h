@@ -101,6 +101,7 @@ enum nvidia_p2p_page_size_type {
     NVIDIA_P2P_PAGE_SIZE_4KB = 0,
     NVIDIA_P2P_PAGE_SIZE_64KB,
     NVIDIA_P2P_PAGE_SIZE_128KB,
+    NVIDIA_P2P_PAGE_SIZE_2MB,
     NVIDIA_P2P_PAGE_SIZE_COUNT
 };
 
@@ -274,4 +275,206 @@ int nvidia_p2p_free_page_table(struct nvidia_p2p_page_table *page_table);
  */
 int nvidia_p2p_free_dma_mapping(struct nvidia_p2p_dma_mapping *dma_mapping);
 
+/*
+ * Version 2 of the page table interface describes the pages underlying a
+ * P2P mapping as physically contiguous extents rather than as one
+ * nvidia_p2p_page per 64KB GPU page. Consumers of the interfaces above are
+ * not affected.
+ */
+
+/*
+ * Request that every extent be aligned to and a multiple of 2MB. The
+ * virtual address and length passed to nvidia_p2p_get_pages_v2() must be
+ * 2MB aligned as well.
+ */
+#define NVIDIA_P2P_GET_PAGES_FLAGS_PAGE_SIZE_2MB    0x00000001
+
+typedef
+struct nvidia_p2p_extent {
+    uint64_t physical_address;
+    uint64_t length;
+    union nvidia_p2p_request_registers registers;
+} nvidia_p2p_extent_t;
+
+#define NVIDIA_P2P_PAGE_TABLE_V2_VERSION   0x00020000
+
+typedef
+struct nvidia_p2p_page_table_v2 {
+    uint32_t version;
+    uint32_t page_size; /* enum nvidia_p2p_page_size_type */
+    struct nvidia_p2p_extent *extents;
+    uint32_t entries;
+    uint8_t *gpu_uuid;
+} nvidia_p2p_page_table_v2_t;
+
+/*
+ * @brief
+ *   Make the pages underlying a range of GPU virtual memory
+ *   accessible to a third-party device, described as extents.
+ *
+ *   Pages are merged into a single extent when they are physically
+ *   contiguous and share the same request registers. The length of every
+ *   extent is a multiple of the page size reported in the page table.
+ *
+ * @param[in]     p2p_token
+ *   A token that uniquely identifies the P2P mapping.
+ * @param[in]     va_space
+ *   A GPU virtual address space qualifier.
+ * @param[in]     virtual_address
+ *   The start address in the specified virtual address space.
+ *   Address must be aligned to the 64KB boundary, or to the 2MB boundary
+ *   if NVIDIA_P2P_GET_PAGES_FLAGS_PAGE_SIZE_2MB is set.
+ * @param[in]     length
+ *   The length of the requested P2P mapping.
+ *   Length must be a multiple of 64KB, or of 2MB if
+ *   NVIDIA_P2P_GET_PAGES_FLAGS_PAGE_SIZE_2MB is set.
+ * @param[in]     flags
+ *   A combination of NVIDIA_P2P_GET_PAGES_FLAGS_* values.
+ * @param[out]    page_table
+ *   A pointer to the page table describing the extents.
+ * @param[in]     free_callback
+ *   A non-NULL pointer to the function to be invoked when the pages
+ *   underlying the virtual address range are freed
+ *   implicitly. Must be non NULL.
+ * @param[in]     data
+ *   A non-NULL opaque pointer to private data to be passed to the
+ *   callback function.
+ *
+ * @return
+ *    0           upon successful completion.
+ *   -EINVAL      if an invalid argument was supplied.
+ *   -ENOTSUPP    if the requested operation is not supported, or if 2MB
+ *     granularity was requested and the underlying pages are not 2MB
+ *     contiguous.
+ *   -ENOMEM      if the driver failed to allocate memory or if
+ *     insufficient resources were available to complete the operation.
+ *   -EIO         if an unknown error occurred.
+ */
+int nvidia_p2p_get_pages_v2(uint64_t p2p_token, uint32_t va_space,
+        uint64_t virtual_address,
+        uint64_t length,
+        uint32_t flags,
+        struct nvidia_p2p_page_table_v2 **page_table,
+        void (*free_callback)(void *data),
+        void *data);
+
+/*
+ * @brief
+ *   Release a set of pages previously made accessible to a third-party
+ *   device with nvidia_p2p_get_pages_v2().
+ *
+ * @param[in]     p2p_token
+ *   A token that uniquely identifies the P2P mapping.
+ * @param[in]     va_space
+ *   A GPU virtual address space qualifier.
+ * @param[in]     virtual_address
+ *   The start address in the specified virtual address space.
+ * @param[in]     page_table
+ *   A pointer to the page table returned by nvidia_p2p_get_pages_v2().
+ *
+ * @return
+ *    0           upon successful completion.
+ *   -EINVAL      if an invalid argument was supplied.
+ *   -EIO         if an unknown error occurred.
+ */
+int nvidia_p2p_put_pages_v2(uint64_t p2p_token, uint32_t va_space,
+        uint64_t virtual_address,
+        struct nvidia_p2p_page_table_v2 *page_table);
+
+/*
+ * @brief
+ *   Free a page table returned by nvidia_p2p_get_pages_v2().
+ *
+ * @param[in]     page_table
+ *   A pointer to the page table.
+ *
+ * @return
+ *    0           upon successful completion.
+ *   -EINVAL      if an invalid argument was supplied.
+ */
+int nvidia_p2p_free_page_table_v2(struct nvidia_p2p_page_table_v2 *page_table);
+
+typedef
+struct nvidia_p2p_dma_segment {
+    uint64_t dma_address;
+    uint64_t length;
+} nvidia_p2p_dma_segment_t;
+
+#define NVIDIA_P2P_DMA_MAPPING_V2_VERSION   0x00020000
+
+typedef
+struct nvidia_p2p_dma_mapping_v2 {
+    uint32_t version;
+    uint32_t page_size_type; /* enum nvidia_p2p_page_size_type */
+    uint32_t entries;
+    struct nvidia_p2p_dma_segment *segments;
+} nvidia_p2p_dma_mapping_v2_t;
+
+/*
+ * @brief
+ *   Make the extents retrieved using nvidia_p2p_get_pages_v2() accessible
+ *   to a third-party device.
+ *
+ *   Pages whose DMA addresses are contiguous are merged into a single
+ *   segment. The length of every segment is a multiple of the page size
+ *   reported in the DMA mapping.
+ *
+ * @param[in]     peer
+ *   The struct pci_dev * of the peer device that needs to DMA to/from the
+ *   mapping.
+ * @param[in]     page_table
+ *   The page table outlining the extents underlying the mapping, as
+ *   retrieved with nvidia_p2p_get_pages_v2().
+ * @param[out]    dma_mapping
+ *   The DMA mapping containing the DMA segments to use on the third-party
+ *   device.
+ *
+ * @return
+ *    0           upon successful completion.
+ *    -EINVAL     if an invalid argument was supplied.
+ *    -ENOTSUPP   if the requested operation is not supported.
+ *    -ENOMEM     if the driver failed to allocate memory.
+ *    -EIO        if an unknown error occurred.
+ */
+int nvidia_p2p_dma_map_pages_v2(struct pci_dev *peer,
+        struct nvidia_p2p_page_table_v2 *page_table,
+        struct nvidia_p2p_dma_mapping_v2 **dma_mapping);
+
+/*
+ * @brief
+ *   Unmap the extents previously mapped to the third-party device by
+ *   nvidia_p2p_dma_map_pages_v2().
+ *
+ * @param[in]     peer
+ *   The struct pci_dev * of the peer device that the DMA mapping belongs to.
+ * @param[in]     page_table
+ *   The page table backing the DMA mapping to be unmapped.
+ * @param[in]     dma_mapping
+ *   The DMA mapping returned by nvidia_p2p_dma_map_pages_v2(). After this
+ *   call returns, neither this struct nor the segments contained within
+ *   will be valid for use by the third-party device.
+ *
+ * @return
+ *    0           upon successful completion.
+ *    -EINVAL     if an invalid argument was supplied.
+ *    -ENOMEM     if the driver failed to allocate memory.
+ *    -EIO        if an unknown error occurred.
+ */
+int nvidia_p2p_dma_unmap_pages_v2(struct pci_dev *peer,
+        struct nvidia_p2p_page_table_v2 *page_table,
+        struct nvidia_p2p_dma_mapping_v2 *dma_mapping);
+
+/*
+ * @brief
+ *   Free a DMA mapping returned by nvidia_p2p_dma_map_pages_v2().
+ *
+ * @param[in]     dma_mapping
+ *   A pointer to the DMA mapping structure.
+ *
+ * @return
+ *    0           upon successful completion.
+ *    -EINVAL     if an invalid argument was supplied.
+ */
+int nvidia_p2p_free_dma_mapping_v2(struct nvidia_p2p_dma_mapping_v2 *dma_mapping);
+
 #endif /* _NV_P2P_H_ */
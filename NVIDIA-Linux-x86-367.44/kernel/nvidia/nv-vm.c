@@ -121,9 +121,14 @@ static inline void nv_set_contig_memory_type(
     }
 }
 
+/*
+ * Changes the memory type of a system memory allocation. Each physically
+ * contiguous chunk of more than one page is updated with a single range
+ * call, while single pages are batched into one array call if possible.
+ */
 static inline void nv_set_memory_type(nv_alloc_t *at, NvU32 type)
 {
-    NvU32 i;
+    NvU32 i, num_array_pages, chunk_pages;
     NV_STATUS status;
     unsigned long *pages;
     nvidia_pte_t *page_ptr;
@@ -132,6 +137,7 @@ static inline void nv_set_memory_type(nv_alloc_t *at, NvU32 type)
     if (nv_update_memory_types)
     {
         pages = NULL;
+        num_array_pages = 0;
 
         if (nv_set_memory_array_type_present(type))
         {
@@ -141,21 +147,27 @@ static inline void nv_set_memory_type(nv_alloc_t *at, NvU32 type)
                 pages = NULL;
         }
 
-        if (pages)
+        for (i = 0; i < at->num_pages; i += chunk_pages)
         {
-            for (i = 0; i < at->num_pages; i++)
+            page_ptr = at->page_table[i];
+            chunk_pages = 1 << page_ptr->order;
+
+            if (pages && (chunk_pages == 1))
             {
-                page_ptr = at->page_table[i];
                 page = NV_GET_PAGE_STRUCT(page_ptr->phys_addr);
-                pages[i] = (unsigned long)page_address(page);
+                pages[num_array_pages++] = (unsigned long)page_address(page);
+            }
+            else
+            {
+                nv_set_contig_memory_type(page_ptr, chunk_pages, type);
             }
-            nv_set_memory_array_type(pages, at->num_pages, type);
-            os_free_mem(pages);
         }
-        else
+
+        if (pages)
         {
-            for (i = 0; i < at->num_pages; i++)
-                nv_set_contig_memory_type(at->page_table[i], 1, type);
+            if (num_array_pages != 0)
+                nv_set_memory_array_type(pages, num_array_pages, type);
+            os_free_mem(pages);
         }
     }
 }
@@ -473,27 +485,109 @@ void nv_free_contig_pages(
     NV_FREE_PAGES(page_ptr->virt_addr, at->order);
 }
 
-NV_STATUS nv_alloc_system_pages(
-    nv_state_t *nv,
-    nv_alloc_t *at
+/*
+ * Orders of the physically contiguous chunks nv_alloc_system_pages() tries
+ * to allocate before falling back to single pages, largest first (2MB and
+ * 64KB). Large chunks amortize the per-page allocation and memory type
+ * update costs of multi-GB allocations.
+ */
+static const unsigned int nv_system_chunk_orders[] =
+{
+    21 - PAGE_SHIFT,
+    16 - PAGE_SHIFT,
+};
+
+#define NV_SYSTEM_CHUNK_ORDER_COUNT \
+    (sizeof(nv_system_chunk_orders) / sizeof(nv_system_chunk_orders[0]))
+
+/*
+ * Allocates the largest chunk of at most num_pages pages, starting at
+ * nv_system_chunk_orders[*order_index]. An order that fails once is not
+ * tried again for the rest of the allocation.
+ */
+static unsigned long nv_alloc_system_chunk(
+    unsigned int gfp_mask,
+    NvU32 num_pages,
+    unsigned int *order_index,
+    unsigned int *order
+)
+{
+    unsigned long virt_addr = 0;
+    unsigned int chunk_order;
+    unsigned int chunk_gfp_mask = gfp_mask;
+
+#if defined(__GFP_NOWARN)
+    chunk_gfp_mask |= __GFP_NOWARN;
+#endif
+
+    for (; *order_index < NV_SYSTEM_CHUNK_ORDER_COUNT; (*order_index)++)
+    {
+        chunk_order = nv_system_chunk_orders[*order_index];
+        if ((chunk_order == 0) || ((1 << chunk_order) > num_pages))
+            continue;
+
+        NV_GET_FREE_PAGES(virt_addr, chunk_order, chunk_gfp_mask);
+        if (virt_addr != 0)
+        {
+            *order = chunk_order;
+            return virt_addr;
+        }
+    }
+
+    *order = 0;
+    NV_GET_FREE_PAGES(virt_addr, 0, gfp_mask);
+
+    return virt_addr;
+}
+
+static void nv_free_system_chunks(
+    nv_alloc_t *at,
+    NvU32 num_pages
+)
+{
+    nvidia_pte_t *page_ptr;
+    NvU32 i = 0;
+
+    while (i < num_pages)
+    {
+        page_ptr = at->page_table[i];
+        NV_FREE_PAGES(page_ptr->virt_addr, page_ptr->order);
+        i += 1 << page_ptr->order;
+    }
+}
+
+/*
+ * Allocates the pages of a system memory allocation, starting with the chunk
+ * order nv_system_chunk_orders[order_index]. Passing
+ * NV_SYSTEM_CHUNK_ORDER_COUNT allocates single pages only.
+ */
+static NV_STATUS nv_alloc_system_pages_from_order(
+    nv_alloc_t *at,
+    unsigned int order_index
 )
 {
     NV_STATUS status;
     nvidia_pte_t *page_ptr;
-    NvU32 i, j;
+    NvU32 i, j, chunk_pages;
     unsigned int gfp_mask;
+    unsigned int order;
     unsigned long virt_addr = 0;
     NvU64 phys_addr;
     struct pci_dev *dev = at->dev;
+    NvU32 start_sec, start_usec, end_sec, end_usec;
 
     nv_printf(NV_DBG_MEMINFO,
-            "NVRM: VM: %u: %u pages\n", __FUNCTION__, at->num_pages);
+            "NVRM: VM: %s: %u pages\n", __FUNCTION__, at->num_pages);
+
+    os_get_current_time(&start_sec, &start_usec);
 
     gfp_mask = nv_compute_gfp_mask(at);
+    at->num_chunks = 0;
 
-    for (i = 0; i < at->num_pages; i++)
+    for (i = 0; i < at->num_pages; i += chunk_pages)
     {
-        NV_GET_FREE_PAGES(virt_addr, 0, gfp_mask);
+        virt_addr = nv_alloc_system_chunk(gfp_mask, at->num_pages - i,
+                                          &order_index, &order);
         if (virt_addr == 0)
         {
             nv_printf(NV_DBG_MEMINFO,
@@ -501,9 +595,10 @@ NV_STATUS nv_alloc_system_pages(
             status = NV_ERR_NO_MEMORY;
             goto failed;
         }
+        chunk_pages = 1 << order;
 #if !defined(__GFP_ZERO)
         if (at->flags & NV_ALLOC_TYPE_ZEROED)
-            memset((void *)virt_addr, 0, PAGE_SIZE);
+            memset((void *)virt_addr, 0, chunk_pages * PAGE_SIZE);
 #endif
 
         phys_addr = nv_get_kern_phys_address(virt_addr);
@@ -512,7 +607,7 @@ NV_STATUS nv_alloc_system_pages(
             nv_printf(NV_DBG_ERRORS,
                 "NVRM: VM: %s: failed to look up physical address\n",
                 __FUNCTION__);
-            NV_FREE_PAGES(virt_addr, 0);
+            NV_FREE_PAGES(virt_addr, order);
             status = NV_ERR_OPERATING_SYSTEM;
             goto failed;
         }
@@ -521,21 +616,39 @@ NV_STATUS nv_alloc_system_pages(
         if (((_PAGE_NX & pgprot_val(PAGE_KERNEL)) != 0) &&
                 (phys_addr < 0x400000))
         {
+            /*
+             * Return large chunks and only use single pages from now on,
+             * so that just the pages below the limit are discarded.
+             */
+            if (order != 0)
+            {
+                NV_FREE_PAGES(virt_addr, order);
+                order_index = NV_SYSTEM_CHUNK_ORDER_COUNT;
+                chunk_pages = 0;
+                continue;
+            }
+
             nv_printf(NV_DBG_SETUP,
                 "NVRM: VM: %s: discarding page @ 0x%llx\n",
                 __FUNCTION__, phys_addr);
-            --i;
+            chunk_pages = 0;
             continue;
         }
 #endif
 
-        page_ptr = at->page_table[i];
-        page_ptr->phys_addr = phys_addr;
-        page_ptr->page_count = NV_GET_PAGE_COUNT(page_ptr);
-        page_ptr->virt_addr = virt_addr;
-        page_ptr->dma_addr = nv_phys_to_dma(dev, page_ptr->phys_addr);
+        for (j = 0; j < chunk_pages; j++)
+        {
+            page_ptr = at->page_table[i + j];
+            page_ptr->phys_addr = phys_addr + j * PAGE_SIZE;
+            page_ptr->page_count = NV_GET_PAGE_COUNT(page_ptr);
+            page_ptr->virt_addr = virt_addr + j * PAGE_SIZE;
+            page_ptr->dma_addr = nv_phys_to_dma(dev, page_ptr->phys_addr);
+            page_ptr->order = (j == 0) ? order : 0;
+
+            NV_LOCK_PAGE(page_ptr);
+        }
 
-        NV_LOCK_PAGE(page_ptr);
+        at->num_chunks++;
     }
 
     if (!NV_ALLOC_MAPPING_CACHED(at->flags))
@@ -544,22 +657,32 @@ NV_STATUS nv_alloc_system_pages(
     if (!NV_ALLOC_MAPPING_CACHED(at->flags))
         nv_flush_caches();
 
+    os_get_current_time(&end_sec, &end_usec);
+
+    nv_printf(NV_DBG_MEMINFO,
+            "NVRM: VM: %s: %u pages in %u chunks, %llu us\n", __FUNCTION__,
+            at->num_pages, at->num_chunks,
+            (NvU64)(end_sec - start_sec) * 1000000 + end_usec - start_usec);
+
     return NV_OK;
 
 failed:
-    if (i > 0)
-    {
-        for (j = 0; j < i; j++)
-        {
-            page_ptr = at->page_table[j];
-            NV_UNLOCK_PAGE(page_ptr);
-            NV_FREE_PAGES(page_ptr->virt_addr, 0);
-        }
-    }
+    for (j = 0; j < i; j++)
+        NV_UNLOCK_PAGE(at->page_table[j]);
+
+    nv_free_system_chunks(at, i);
 
     return status;
 }
 
+NV_STATUS nv_alloc_system_pages(
+    nv_state_t *nv,
+    nv_alloc_t *at
+)
+{
+    return nv_alloc_system_pages_from_order(at, 0);
+}
+
 void nv_free_system_pages(
     nv_alloc_t *at
 )
@@ -589,13 +712,178 @@ void nv_free_system_pages(
             }
         }
         NV_UNLOCK_PAGE(page_ptr);
-        NV_FREE_PAGES(page_ptr->virt_addr, 0);
     }
 
+    nv_free_system_chunks(at, at->num_pages);
+
     if (!NV_ALLOC_MAPPING_CACHED(at->flags))
         nv_flush_caches();
 }
 
+#if defined(DEBUG)
+#define NV_ALLOC_SYSTEM_PAGES_TEST_PAGES ((8 << 20) >> PAGE_SHIFT)
+
+//
+// Allocates NV_ALLOC_SYSTEM_PAGES_TEST_PAGES pages starting with the chunk
+// order nv_system_chunk_orders[order_index], checks that the page table
+// describes physically contiguous chunks matching at->num_chunks, and returns
+// how long the allocation took.
+//
+static int nv_alloc_system_pages_test_one(
+    struct pci_dev *dev,
+    unsigned int order_index,
+    NvU32 mapping,
+    NvU64 *alloc_usec
+)
+{
+    nv_alloc_t *at = NULL;
+    nvidia_pte_t *ptes = NULL;
+    nvidia_pte_t *page_ptr;
+    NvU32 start_sec, start_usec, end_sec, end_usec;
+    NvU32 i, j, chunk_pages;
+    NvU32 num_chunks = 0;
+    NV_STATUS status;
+    int rc = 0;
+
+    if ((os_alloc_mem((void **)&at, sizeof(*at)) != NV_OK) ||
+        (os_alloc_mem((void **)&ptes,
+            NV_ALLOC_SYSTEM_PAGES_TEST_PAGES * sizeof(*ptes)) != NV_OK))
+    {
+        rc = -ENOMEM;
+        goto done;
+    }
+
+    os_mem_set(at, 0, sizeof(*at));
+    os_mem_set(ptes, 0, NV_ALLOC_SYSTEM_PAGES_TEST_PAGES * sizeof(*ptes));
+
+    if (os_alloc_mem((void **)&at->page_table,
+            NV_ALLOC_SYSTEM_PAGES_TEST_PAGES * sizeof(*at->page_table)) != NV_OK)
+    {
+        rc = -ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < NV_ALLOC_SYSTEM_PAGES_TEST_PAGES; i++)
+        at->page_table[i] = &ptes[i];
+
+    at->dev = dev;
+    at->num_pages = NV_ALLOC_SYSTEM_PAGES_TEST_PAGES;
+    at->flags = NV_ALLOC_ENC_MAPPING(mapping);
+
+    os_get_current_time(&start_sec, &start_usec);
+
+    status = nv_alloc_system_pages_from_order(at, order_index);
+
+    os_get_current_time(&end_sec, &end_usec);
+
+    if (status != NV_OK)
+    {
+        nv_printf(NV_DBG_ERRORS,
+            "NVRM: VM: %s: allocation failed: 0x%x\n", __FUNCTION__, status);
+        rc = -ENOMEM;
+        goto done;
+    }
+
+    *alloc_usec = (NvU64)(end_sec - start_sec) * 1000000 +
+                  end_usec - start_usec;
+
+    for (i = 0; (rc == 0) && (i < at->num_pages); i += chunk_pages)
+    {
+        page_ptr = at->page_table[i];
+        chunk_pages = 1 << page_ptr->order;
+
+        if (((order_index == NV_SYSTEM_CHUNK_ORDER_COUNT) &&
+                (page_ptr->order != 0)) ||
+            (i + chunk_pages > at->num_pages))
+        {
+            rc = -EINVAL;
+            break;
+        }
+
+        for (j = 0; j < chunk_pages; j++)
+        {
+            if ((at->page_table[i + j]->phys_addr !=
+                    page_ptr->phys_addr + j * PAGE_SIZE) ||
+                ((j != 0) && (at->page_table[i + j]->order != 0)))
+            {
+                rc = -EINVAL;
+                break;
+            }
+        }
+
+        if (rc != 0)
+            break;
+
+        num_chunks++;
+    }
+
+    if ((rc == 0) && (num_chunks != at->num_chunks))
+        rc = -EINVAL;
+
+    if (rc != 0)
+    {
+        nv_printf(NV_DBG_ERRORS,
+            "NVRM: VM: %s: inconsistent chunks at page %u (%u chunks, %u expected)\n",
+            __FUNCTION__, i, num_chunks, at->num_chunks);
+    }
+
+    nv_printf(NV_DBG_MEMINFO,
+        "NVRM: VM: %s: %u pages, mapping %u, %u chunks, %llu us\n",
+        __FUNCTION__, at->num_pages, mapping, at->num_chunks, *alloc_usec);
+
+    nv_free_system_pages(at);
+
+done:
+    if (at != NULL)
+    {
+        if (at->page_table != NULL)
+            os_free_mem(at->page_table);
+        os_free_mem(at);
+    }
+    if (ptes != NULL)
+        os_free_mem(ptes);
+
+    return rc;
+}
+
+//
+// Check nv_alloc_system_pages() with and without high-order chunks, cached
+// and uncached, and compare how long the allocations take. Allocating in
+// chunks is expected to be faster, but the system memory may be too
+// fragmented for it, so only the consistency of the allocations is checked.
+//
+int nv_alloc_system_pages_self_test(struct pci_dev *dev)
+{
+    static const NvU32 mappings[] =
+    {
+        NV_MEMORY_CACHED,
+        NV_MEMORY_UNCACHED
+    };
+    NvU64 chunked_usec = 0, single_usec = 0;
+    NvU32 i;
+    int rc = 0;
+
+    for (i = 0; (rc == 0) && (i < ARRAY_SIZE(mappings)); i++)
+    {
+        rc = nv_alloc_system_pages_test_one(dev, 0, mappings[i],
+                                            &chunked_usec);
+        if (rc != 0)
+            break;
+
+        rc = nv_alloc_system_pages_test_one(dev, NV_SYSTEM_CHUNK_ORDER_COUNT,
+                                            mappings[i], &single_usec);
+        if (rc != 0)
+            break;
+
+        nv_printf(NV_DBG_MEMINFO,
+            "NVRM: VM: %s: mapping %u: %llu us in chunks, %llu us in single pages\n",
+            __FUNCTION__, mappings[i], chunked_usec, single_usec);
+    }
+
+    return rc;
+}
+#endif
+
 NvUPtr nv_vm_map_pages(
     struct page **pages,
     NvU32 count,
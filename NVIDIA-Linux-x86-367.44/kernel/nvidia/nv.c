@@ -936,6 +936,22 @@ int __init nvidia_init_module(void)
     rm_register_compatible_ioctls(sp);
 #endif
 
+#if defined(DEBUG)
+    rc = nv_lock_user_pages_self_test();
+    if (rc < 0)
+    {
+        nv_printf(NV_DBG_ERRORS, "NVRM: os_lock_user_pages() self-test failed!\n");
+        goto failed;
+    }
+
+    rc = nv_alloc_system_pages_self_test(nv_linux_devices->dev);
+    if (rc < 0)
+    {
+        nv_printf(NV_DBG_ERRORS, "NVRM: nv_alloc_system_pages() self-test failed!\n");
+        goto failed;
+    }
+#endif
+
     rc = nv_init_pat_support(sp);
     if (rc < 0)
         goto failed;
@@ -85,6 +85,114 @@ done:
 #endif
 }
 
+/*
+ * Maximum number of pages pinned by a single get_user_pages() call in
+ * os_lock_user_pages(). mmap_sem is dropped between the chunks so that large
+ * registrations don't block page faults and mmap()/munmap() calls of the other
+ * threads of the process for their whole duration.
+ *
+ * Pinned pages are not cached across registrations: a cached range would have
+ * to be invalidated when it's unmapped or remapped, which requires MMU
+ * notifiers (exported GPL-only), and revalidating the identity of every page
+ * costs as much as pinning it again.
+ */
+#define NV_LOCK_USER_PAGES_CHUNK_PAGES  ((4 * 1024 * 1024) >> PAGE_SHIFT)
+
+#if defined(NV_VM_INSERT_PAGE_PRESENT)
+/*
+ * Source of the pages pinned by nv_lock_user_pages_chunked(). pin() pins up to
+ * page_count pages starting at address and returns the number of pages pinned
+ * or a negative error code, like get_user_pages(). unpin() releases a single
+ * pinned page. The self-test replaces the current process with a fake source.
+ */
+typedef struct nv_user_page_source_s
+{
+    long (*pin)(void *ctx, unsigned long address, unsigned long page_count,
+                struct page **pages);
+    void (*unpin)(void *ctx, struct page *page);
+    void *ctx;
+} nv_user_page_source_t;
+
+static long nv_user_page_source_pin_current(
+    void          *ctx,
+    unsigned long  address,
+    unsigned long  page_count,
+    struct page  **pages
+)
+{
+    struct mm_struct *mm = current->mm;
+    NvBool write = 1, force = 0;
+    long ret;
+
+    down_read(&mm->mmap_sem);
+    ret = NV_GET_USER_PAGES(address, page_count, write, force, pages, NULL);
+    up_read(&mm->mmap_sem);
+
+    return ret;
+}
+
+static void nv_user_page_source_unpin_current(
+    void        *ctx,
+    struct page *page
+)
+{
+    put_page(page);
+}
+
+static const nv_user_page_source_t nv_user_page_source_current =
+{
+    .pin   = nv_user_page_source_pin_current,
+    .unpin = nv_user_page_source_unpin_current,
+    .ctx   = NULL,
+};
+
+//
+// Pin page_count pages starting at address into user_pages, at most
+// chunk_pages at a time. If any of the pages can't be pinned, the pages pinned
+// so far are released.
+//
+static NV_STATUS nv_lock_user_pages_chunked(
+    const nv_user_page_source_t *source,
+    unsigned long                address,
+    NvU64                        page_count,
+    NvU64                        chunk_pages,
+    struct page                **user_pages
+)
+{
+    NvU64 i, pinned = 0;
+    long ret;
+
+    while (pinned < page_count)
+    {
+        NvU64 chunk = NV_MIN(page_count - pinned, chunk_pages);
+
+        ret = source->pin(source->ctx, address + (pinned * PAGE_SIZE),
+                          chunk, &user_pages[pinned]);
+        if (ret <= 0)
+            break;
+
+        pinned += ret;
+
+        if ((NvU64)ret < chunk)
+            break;
+
+        if (fatal_signal_pending(current))
+            break;
+
+        cond_resched();
+    }
+
+    if (pinned < page_count)
+    {
+        for (i = 0; i < pinned; i++)
+            source->unpin(source->ctx, user_pages[i]);
+        return NV_ERR_INVALID_ADDRESS;
+    }
+
+    return NV_OK;
+}
+#endif
+
 NV_STATUS NV_API_CALL os_lock_user_pages(
     void   *address,
     NvU64   page_count,
@@ -93,11 +201,7 @@ NV_STATUS NV_API_CALL os_lock_user_pages(
 {
 #if defined(NV_VM_INSERT_PAGE_PRESENT)
     NV_STATUS rmStatus;
-    struct mm_struct *mm = current->mm;
     struct page **user_pages;
-    NvU64 i, pinned;
-    NvBool write = 1, force = 0;
-    int ret;
 
     if (!NV_MAY_SLEEP())
     {
@@ -115,23 +219,14 @@ NV_STATUS NV_API_CALL os_lock_user_pages(
         return rmStatus;
     }
 
-    down_read(&mm->mmap_sem);
-    ret = NV_GET_USER_PAGES((unsigned long)address,
-                            page_count, write, force, user_pages, NULL);
-    up_read(&mm->mmap_sem);
-    pinned = ret;
-
-    if (ret < 0)
-    {
-        os_free_mem(user_pages);
-        return NV_ERR_INVALID_ADDRESS;
-    }
-    else if (pinned < page_count)
+    rmStatus = nv_lock_user_pages_chunked(&nv_user_page_source_current,
+                                          (unsigned long)address, page_count,
+                                          NV_LOCK_USER_PAGES_CHUNK_PAGES,
+                                          user_pages);
+    if (rmStatus != NV_OK)
     {
-        for (i = 0; i < pinned; i++)
-            put_page(user_pages[i]);
         os_free_mem(user_pages);
-        return NV_ERR_INVALID_ADDRESS;
+        return rmStatus;
     }
 
     *page_array = user_pages;
@@ -166,3 +261,212 @@ NV_STATUS NV_API_CALL os_unlock_user_pages(
     return NV_ERR_NOT_SUPPORTED;
 #endif
 }
+
+#if defined(DEBUG)
+#define NV_LOCK_USER_PAGES_TEST_PAGES       64
+#define NV_LOCK_USER_PAGES_TEST_CHUNK_PAGES 8
+
+#if defined(NV_VM_INSERT_PAGE_PRESENT)
+//
+// Fake page source for the self-test. Pages are identified by their index in
+// tokens[] and never dereferenced. Pinning stops short at fail_index, like
+// get_user_pages() reaching an unmapped address.
+//
+typedef struct
+{
+    unsigned long base;
+    unsigned long next_address;
+    NvU64 fail_index;
+    NvU32 calls;
+    NvBool bad_call;
+    NvU32 refs[NV_LOCK_USER_PAGES_TEST_PAGES];
+    char tokens[NV_LOCK_USER_PAGES_TEST_PAGES];
+} nv_lock_user_pages_test_t;
+
+static long nv_lock_user_pages_test_pin(
+    void          *ctx,
+    unsigned long  address,
+    unsigned long  page_count,
+    struct page  **pages
+)
+{
+    nv_lock_user_pages_test_t *test = ctx;
+    NvU64 index = (address - test->base) >> PAGE_SHIFT;
+    unsigned long i;
+
+    test->calls++;
+
+    // Each call has to continue where the previous one stopped, without
+    // exceeding the chunk size.
+    if ((address != test->next_address) || (page_count == 0) ||
+        (page_count > NV_LOCK_USER_PAGES_TEST_CHUNK_PAGES) ||
+        (index + page_count > NV_LOCK_USER_PAGES_TEST_PAGES))
+    {
+        test->bad_call = NV_TRUE;
+        return -EINVAL;
+    }
+
+    for (i = 0; i < page_count; i++)
+    {
+        if (index + i >= test->fail_index)
+            break;
+
+        test->refs[index + i]++;
+        pages[i] = (struct page *)&test->tokens[index + i];
+    }
+
+    test->next_address = address + (i * PAGE_SIZE);
+
+    return (i == 0) ? -EFAULT : (long)i;
+}
+
+static void nv_lock_user_pages_test_unpin(
+    void        *ctx,
+    struct page *page
+)
+{
+    nv_lock_user_pages_test_t *test = ctx;
+    NvU64 index = (char *)page - test->tokens;
+
+    if ((index >= NV_LOCK_USER_PAGES_TEST_PAGES) || (test->refs[index] == 0))
+        test->bad_call = NV_TRUE;
+    else
+        test->refs[index]--;
+}
+
+static int nv_lock_user_pages_test_one(
+    NvU64         page_count,
+    NvU64         fail_index,
+    struct page **user_pages
+)
+{
+    nv_lock_user_pages_test_t *test;
+    nv_user_page_source_t source;
+    NV_STATUS status;
+    NvU64 chunk = NV_LOCK_USER_PAGES_TEST_CHUNK_PAGES;
+    NvBool fail = (fail_index < page_count);
+    NvU32 expected_calls;
+    NvU64 i;
+    int rc = 0;
+
+    if (os_alloc_mem((void **)&test, sizeof(*test)) != NV_OK)
+        return -ENOMEM;
+
+    os_mem_set(test, 0, sizeof(*test));
+
+    // Never accessed, any page aligned user address works
+    test->base = 0x10000000;
+    test->next_address = test->base;
+    test->fail_index = fail_index;
+
+    source.pin = nv_lock_user_pages_test_pin;
+    source.unpin = nv_lock_user_pages_test_unpin;
+    source.ctx = test;
+
+    status = nv_lock_user_pages_chunked(&source, test->base, page_count, chunk,
+                                        user_pages);
+
+    // Every chunk up to and including the one containing the failing page is
+    // pinned with a separate call.
+    if (fail)
+        expected_calls = (fail_index / chunk) + 1;
+    else
+        expected_calls = (page_count + chunk - 1) / chunk;
+
+    if (test->bad_call || (test->calls != expected_calls) ||
+        (status != (fail ? NV_ERR_INVALID_ADDRESS : NV_OK)))
+    {
+        rc = -EIO;
+        goto done;
+    }
+
+    for (i = 0; i < NV_LOCK_USER_PAGES_TEST_PAGES; i++)
+    {
+        NvBool pinned = (!fail && (i < page_count));
+
+        if (test->refs[i] != (pinned ? 1 : 0))
+        {
+            rc = -EIO;
+            goto done;
+        }
+
+        if (pinned && (user_pages[i] != (struct page *)&test->tokens[i]))
+        {
+            rc = -EIO;
+            goto done;
+        }
+    }
+
+done:
+    if (rc != 0)
+    {
+        nv_printf(NV_DBG_ERRORS,
+            "NVRM: %s(): failed for %llu pages failing at %llu: status 0x%x, %u calls!\n",
+            __FUNCTION__, page_count, fail_index, status, test->calls);
+    }
+
+    os_free_mem(test);
+
+    return rc;
+}
+#endif
+
+//
+// Exercise the chunked pinning of os_lock_user_pages() with a fake page source:
+// ranges ending on either side of chunk boundaries, and failures at the start,
+// middle and end of chunks, which must release all the pages pinned so far.
+//
+int nv_lock_user_pages_self_test(void)
+{
+#if defined(NV_VM_INSERT_PAGE_PRESENT)
+    const NvU64 chunk = NV_LOCK_USER_PAGES_TEST_CHUNK_PAGES;
+    static const NvU64 page_counts[] =
+    {
+        1,
+        NV_LOCK_USER_PAGES_TEST_CHUNK_PAGES - 1,
+        NV_LOCK_USER_PAGES_TEST_CHUNK_PAGES,
+        NV_LOCK_USER_PAGES_TEST_CHUNK_PAGES + 1,
+        2 * NV_LOCK_USER_PAGES_TEST_CHUNK_PAGES,
+        NV_LOCK_USER_PAGES_TEST_PAGES
+    };
+    static const NvU64 fail_indices[] =
+    {
+        0,
+        1,
+        NV_LOCK_USER_PAGES_TEST_CHUNK_PAGES - 1,
+        NV_LOCK_USER_PAGES_TEST_CHUNK_PAGES,
+        NV_LOCK_USER_PAGES_TEST_CHUNK_PAGES + 1,
+        2 * NV_LOCK_USER_PAGES_TEST_CHUNK_PAGES - 1,
+        3 * NV_LOCK_USER_PAGES_TEST_CHUNK_PAGES
+    };
+    struct page **user_pages;
+    NvU32 i;
+    int rc = 0;
+
+    if (os_alloc_mem((void **)&user_pages,
+            NV_LOCK_USER_PAGES_TEST_PAGES * sizeof(*user_pages)) != NV_OK)
+    {
+        return -ENOMEM;
+    }
+
+    for (i = 0; (rc == 0) && (i < ARRAY_SIZE(page_counts)); i++)
+    {
+        rc = nv_lock_user_pages_test_one(page_counts[i],
+                                         NV_LOCK_USER_PAGES_TEST_PAGES,
+                                         user_pages);
+    }
+
+    for (i = 0; (rc == 0) && (i < ARRAY_SIZE(fail_indices)); i++)
+    {
+        rc = nv_lock_user_pages_test_one(3 * chunk + 1, fail_indices[i],
+                                         user_pages);
+    }
+
+    os_free_mem(user_pages);
+
+    return rc;
+#else
+    return 0;
+#endif
+}
+#endif